@@ -0,0 +1,89 @@
+#include "Arena.h"
+#include "Trace.h"
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <utility>
+
+// Blocks start with their header, data follows at the strictest fundamental alignment
+static const size_t kHeaderSize = (sizeof(void*) + alignof(std::max_align_t) - 1) / alignof(std::max_align_t) * alignof(std::max_align_t);
+
+Arena::~Arena()
+{
+    Reset();
+}
+
+Arena::Arena(Arena&& other) noexcept
+    : head(other.head), cursor(other.cursor), limit(other.limit), blockSize(other.blockSize),
+      blockCount(other.blockCount), bytesReserved(other.bytesReserved)
+{
+    other.head = nullptr;
+    other.cursor = nullptr;
+    other.limit = nullptr;
+    other.blockCount = 0;
+    other.bytesReserved = 0;
+}
+
+Arena& Arena::operator=(Arena&& other) noexcept
+{
+    if (this != &other)
+    {
+        Reset();
+        std::swap(head, other.head);
+        std::swap(cursor, other.cursor);
+        std::swap(limit, other.limit);
+        std::swap(blockCount, other.blockCount);
+        std::swap(bytesReserved, other.bytesReserved);
+        blockSize = other.blockSize;
+    }
+    return *this;
+}
+
+void Arena::AddBlock(size_t minimumBytes)
+{
+    size_t bytes = minimumBytes > blockSize ? minimumBytes : blockSize;
+    Block* block = static_cast<Block*>(malloc(kHeaderSize + bytes));
+    if (block == nullptr)
+        throw std::bad_alloc();
+
+    block->next = head;
+    head = block;
+    cursor = reinterpret_cast<char*>(block) + kHeaderSize;
+    limit = cursor + bytes;
+    blockCount++;
+    bytesReserved += bytes;
+    TRACE_COUNT(Allocations, 1);
+}
+
+void Arena::Reserve(size_t bytes)
+{
+    // Worst-case padding for the arrays that follow is covered by the caller's alignment slack
+    if (static_cast<size_t>(limit - cursor) < bytes)
+        AddBlock(bytes);
+}
+
+void* Arena::Allocate(size_t size, size_t alignment)
+{
+    uintptr_t aligned = (reinterpret_cast<uintptr_t>(cursor) + alignment - 1) & ~(static_cast<uintptr_t>(alignment) - 1);
+    if (cursor == nullptr || aligned + size > reinterpret_cast<uintptr_t>(limit))
+    {
+        AddBlock(size + alignment);
+        aligned = (reinterpret_cast<uintptr_t>(cursor) + alignment - 1) & ~(static_cast<uintptr_t>(alignment) - 1);
+    }
+    cursor = reinterpret_cast<char*>(aligned + size);
+    return reinterpret_cast<void*>(aligned);
+}
+
+void Arena::Reset()
+{
+    while (head != nullptr)
+    {
+        Block* next = head->next;
+        free(head);
+        head = next;
+    }
+    cursor = nullptr;
+    limit = nullptr;
+    blockCount = 0;
+    bytesReserved = 0;
+}
@@ -0,0 +1,58 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <cstddef>
+#include <type_traits>
+
+// Bump allocator for per-image parse results. Memory comes from a short chain of blocks
+// and is only released all at once, when the arena is destroyed or Reset.
+// Only trivially destructible types may live here, nothing is destroyed individually.
+// Move-only: moving keeps every pointer handed out so far valid.
+class Arena
+{
+public:
+    explicit Arena(size_t blockSize = 4096) : blockSize(blockSize) {}
+    ~Arena();
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+    Arena(Arena&& other) noexcept;
+    Arena& operator=(Arena&& other) noexcept;
+
+    // Make sure the next `bytes` of allocations are served by one block, so a caller
+    // that knows its total up front costs exactly one heap allocation
+    void Reserve(size_t bytes);
+
+    void* Allocate(size_t size, size_t alignment);
+
+    template <typename T>
+    T* AllocateArray(size_t count)
+    {
+        static_assert(std::is_trivially_destructible<T>::value, "Arena memory is never destroyed element by element");
+        if (count == 0)
+            return nullptr;
+        return static_cast<T*>(Allocate(count * sizeof(T), alignof(T)));
+    }
+
+    void Reset();
+
+    size_t BlockCount() const { return blockCount; }
+    size_t BytesReserved() const { return bytesReserved; }
+
+private:
+    struct Block
+    {
+        Block* next;
+    };
+
+    void AddBlock(size_t minimumBytes);
+
+    Block* head = nullptr;
+    char* cursor = nullptr;
+    char* limit = nullptr;
+    size_t blockSize;
+    size_t blockCount = 0;
+    size_t bytesReserved = 0;
+};
+
+#endif // ARENA_H
@@ -0,0 +1,201 @@
+#include "Carver.h"
+#include "PEImage.h"
+#include "Simd.h"
+#include "Trace.h"
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstring>
+#include <thread>
+
+// Linkers put the NT headers within the first few hundred bytes. A false "MZ" with a random e_lfanew would
+// otherwise fault in a random page of a multi-GB dump, turning the sequential read into random I/O.
+static const size_t kMaxHeaderOffset = 0x10000;
+
+// Large enough that the per-chunk bookkeeping disappears, small enough to balance threads on a few-GB dump
+static const size_t kChunkSize = size_t(4) << 20;
+
+// First position p in [position, end) with "MZ" at p, or end. The 'Z' may lie at end, but never at size.
+typedef size_t (*FindKernel)(const BYTE* data, size_t position, size_t end, size_t size);
+
+static size_t FindScalar(const BYTE* data, size_t position, size_t end, size_t size)
+{
+    while (position < end)
+    {
+        const void* found = memchr(data + position, 'M', end - position);
+        if (found == nullptr)
+            return end;
+        position = static_cast<size_t>(static_cast<const BYTE*>(found) - data);
+        if (position + 1 < size && data[position + 1] == 'Z')
+            return position;
+        position++;
+    }
+    return end;
+}
+
+#if INSPECTOR_X86 && INSPECTOR_X86_64
+
+// The 'M' lanes of one load ANDed with the 'Z' lanes of the load one byte later
+INSPECTOR_TARGET("sse2")
+static size_t FindSse2(const BYTE* data, size_t position, size_t end, size_t size)
+{
+    const __m128i m = _mm_set1_epi8('M');
+    const __m128i z = _mm_set1_epi8('Z');
+    for (; position < end && position + 17 <= size; position += 16)
+    {
+        __m128i first = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + position));
+        __m128i second = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + position + 1));
+        unsigned mask = unsigned(_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(first, m), _mm_cmpeq_epi8(second, z))));
+        if (mask != 0)
+            return std::min(end, position + CountTrailingZeros(mask));
+    }
+    return FindScalar(data, std::min(position, end), end, size);
+}
+
+// Two 32-byte blocks per iteration, so the loop branches once per cache line
+INSPECTOR_TARGET("avx2")
+static size_t FindAvx2(const BYTE* data, size_t position, size_t end, size_t size)
+{
+    const __m256i m = _mm256_set1_epi8('M');
+    const __m256i z = _mm256_set1_epi8('Z');
+    for (; position < end && position + 65 <= size; position += 64)
+    {
+        __m256i lo = _mm256_and_si256(_mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + position)), m),
+                                      _mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + position + 1)), z));
+        __m256i hi = _mm256_and_si256(_mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + position + 32)), m),
+                                      _mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + position + 33)), z));
+        if (_mm256_testz_si256(_mm256_or_si256(lo, hi), _mm256_or_si256(lo, hi)))
+            continue;
+        uint64_t mask = uint64_t(uint32_t(_mm256_movemask_epi8(lo))) | (uint64_t(uint32_t(_mm256_movemask_epi8(hi))) << 32);
+        return std::min(end, position + CountTrailingZeros(mask));
+    }
+    return FindScalar(data, std::min(position, end), end, size);
+}
+
+#endif // INSPECTOR_X86 && INSPECTOR_X86_64
+
+struct FindChoice
+{
+    FindKernel kernel;
+    const char* name;
+};
+
+static FindChoice SelectFind()
+{
+#if INSPECTOR_X86 && INSPECTOR_X86_64
+    if (CpuHasAvx2())
+        return { FindAvx2, "avx2" };
+    if (CpuHasSse2())
+        return { FindSse2, "sse2" };
+#endif
+    return { FindScalar, "scalar" };
+}
+
+static const FindChoice& Find()
+{
+    static const FindChoice choice = SelectFind();
+    return choice;
+}
+
+const char* CarveKernelName()
+{
+    return Find().name;
+}
+
+// Runs the header stages of the parser on the candidate; the extent is what a file holding the image would need
+template <typename Image>
+static bool ValidateImage(const BYTE* data, size_t size, CarvedImage& carved)
+{
+    Image image(data, size);
+    if (!(image.ParseDOSHeader() &&
+          image.ParseNTHeader() &&
+          image.ParseFileHeader() &&
+          image.ParseOptionalHeader() &&
+          image.ParseSectionHeader() &&
+          image.ParseDataDirectories()))
+        return false;
+
+    size_t end = std::min<size_t>(image.GetOptionalHeader()->SizeOfHeaders, size);
+    const IMAGE_SECTION_HEADER* sections = image.GetSectionHeader();
+    for (WORD i = 0; i < image.GetFileHeader()->NumberOfSections; i++)
+    {
+        size_t offset, length;
+        if (SectionRawRange(sections[i], size, offset, length))
+            end = std::max(end, offset + length);
+    }
+
+    // Signed images end in their certificate table, whose "RVA" is a file offset
+    const IMAGE_DATA_DIRECTORY& certificates = image.GetDataDirectory(IMAGE_DIRECTORY_ENTRY_SECURITY);
+    if (certificates.Size != 0 && certificates.VirtualAddress < size)
+        end = std::max(end, std::min<size_t>(size, size_t(certificates.VirtualAddress) + certificates.Size));
+    carved.size = end;
+    return true;
+}
+
+static bool Validate(const BYTE* data, size_t size, size_t offset, CarvedImage& carved)
+{
+    // Cheap checks on the DOS header first, before anything past it is read
+    size_t available = size - offset;
+    if (available < sizeof(IMAGE_DOS_HEADER))
+        return false;
+    LONG headerOffset;
+    memcpy(&headerOffset, data + offset + offsetof(IMAGE_DOS_HEADER, e_lfanew), sizeof(headerOffset));
+    if (headerOffset < 0 || size_t(headerOffset) > kMaxHeaderOffset)
+        return false;
+
+    carved.offset = offset;
+    carved.magic = DetectImageMagic(data + offset, available);
+    switch (carved.magic)
+    {
+    case IMAGE_NT_OPTIONAL_HDR32_MAGIC:
+        return ValidateImage<PE32>(data + offset, available, carved);
+    case IMAGE_NT_OPTIONAL_HDR64_MAGIC:
+        return ValidateImage<PE64>(data + offset, available, carved);
+    default:
+        return false;
+    }
+}
+
+std::vector<CarvedImage> CarveImages(const BYTE* data, size_t size, unsigned threads)
+{
+    std::vector<CarvedImage> images;
+    if (data == nullptr || size < sizeof(IMAGE_DOS_HEADER))
+        return images;
+    TRACE_SCOPE("CarveImages");
+
+    size_t chunkCount = (size + kChunkSize - 1) / kChunkSize;
+    if (threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    threads = unsigned(std::max<size_t>(1, std::min<size_t>(threads, chunkCount)));
+
+    // Chunks are handed out in file order, so the threads together still read the dump front to back
+    std::vector<std::vector<CarvedImage>> chunkImages(chunkCount);
+    std::atomic<size_t> next(0);
+    auto work = [&]()
+    {
+        const FindKernel find = Find().kernel;
+        for (size_t i = next++; i < chunkCount; i = next++)
+        {
+            TRACE_SCOPE("CarveChunk");
+            size_t end = std::min(size, (i + 1) * kChunkSize);
+            TRACE_COUNT(Bytes, end - i * kChunkSize);
+            for (size_t position = find(data, i * kChunkSize, end, size); position < end; position = find(data, position + 1, end, size))
+            {
+                CarvedImage carved;
+                if (Validate(data, size, position, carved))
+                    chunkImages[i].push_back(carved);
+            }
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (unsigned t = 1; t < threads; t++)
+        workers.emplace_back(work);
+    work();
+    for (std::thread& worker : workers)
+        worker.join();
+
+    for (const std::vector<CarvedImage>& chunk : chunkImages)
+        images.insert(images.end(), chunk.begin(), chunk.end());
+    return images;
+}
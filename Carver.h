@@ -0,0 +1,26 @@
+#ifndef CARVER_H
+#define CARVER_H
+
+#include "PETypes.h"
+#include <cstdint>
+#include <vector>
+
+// A PE image found inside a larger buffer such as a memory dump or a disk image
+struct CarvedImage
+{
+    uint64_t offset; // Of the MZ header within the buffer
+    uint64_t size;   // Headers, the raw data of every section and any certificates, clipped to the end of the buffer
+    WORD magic;      // OptionalHeader.Magic, selects PE32 or PE64
+};
+
+// Every "MZ" in [data, data + size) whose e_lfanew points at "PE\0\0", a known optional header magic and a section
+// table that the header stages of the parser accept. The buffer is split into chunks searched in parallel on up to
+// `threads` threads (0 = hardware concurrency); a chunk owns the candidates that start inside it and reads past its
+// end to validate them. Candidates are found with SIMD compares, and e_lfanew is capped so random "MZ" bytes never
+// make the search fault in far-away pages. In offset order; images nested in other images are reported too.
+std::vector<CarvedImage> CarveImages(const BYTE* data, size_t size, unsigned threads = 0);
+
+// Name of the search kernel picked for this CPU ("avx2", "sse2" or "scalar")
+const char* CarveKernelName();
+
+#endif // CARVER_H
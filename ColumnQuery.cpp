@@ -0,0 +1,270 @@
+#include "ColumnQuery.h"
+#include "Simd.h"
+#include <bitset>
+#include <cstring>
+
+// Range tests subtract lo and compare against hi - lo as unsigned, so one compare covers both bounds. Kernels
+// fill whole 64-row words; the last partial word is always done by the scalar loops.
+typedef void (*Range16Kernel)(const uint16_t* values, size_t words, uint16_t lo, uint16_t span, uint64_t* bits);
+typedef void (*Range32Kernel)(const uint32_t* values, size_t words, uint32_t lo, uint32_t span, uint64_t* bits);
+typedef void (*Range64Kernel)(const uint64_t* values, size_t words, uint64_t lo, uint64_t span, uint64_t* bits);
+typedef void (*AboveKernel)(const float* values, size_t words, float threshold, uint64_t* bits);
+
+template <typename T>
+static uint64_t RangeWord(const T* values, size_t count, T lo, T span)
+{
+    uint64_t word = 0;
+    for (size_t i = 0; i < count; i++)
+        word |= uint64_t(T(values[i] - lo) <= span) << i;
+    return word;
+}
+
+static uint64_t AboveWord(const float* values, size_t count, float threshold)
+{
+    uint64_t word = 0;
+    for (size_t i = 0; i < count; i++)
+        word |= uint64_t(values[i] > threshold) << i;
+    return word;
+}
+
+template <typename T>
+static void RangeScalar(const T* values, size_t words, T lo, T span, uint64_t* bits)
+{
+    for (size_t w = 0; w < words; w++)
+        bits[w] = RangeWord(values + w * 64, 64, lo, span);
+}
+
+static void AboveScalar(const float* values, size_t words, float threshold, uint64_t* bits)
+{
+    for (size_t w = 0; w < words; w++)
+        bits[w] = AboveWord(values + w * 64, 64, threshold);
+}
+
+#if INSPECTOR_X86 && INSPECTOR_X86_64
+
+INSPECTOR_TARGET("sse2")
+static void Range16Sse2(const uint16_t* values, size_t words, uint16_t lo, uint16_t span, uint64_t* bits)
+{
+    const __m128i low = _mm_set1_epi16(static_cast<short>(lo));
+    const __m128i width = _mm_set1_epi16(static_cast<short>(span));
+    const __m128i zero = _mm_setzero_si128();
+    for (size_t w = 0; w < words; w++)
+    {
+        const __m128i* in = reinterpret_cast<const __m128i*>(values + w * 64);
+        uint64_t word = 0;
+        for (int j = 0; j < 4; j++)
+        {
+            // Saturating subtract is zero exactly when value - lo <= span
+            __m128i a = _mm_cmpeq_epi16(_mm_subs_epu16(_mm_sub_epi16(_mm_loadu_si128(in + 2 * j), low), width), zero);
+            __m128i b = _mm_cmpeq_epi16(_mm_subs_epu16(_mm_sub_epi16(_mm_loadu_si128(in + 2 * j + 1), low), width), zero);
+            word |= uint64_t(static_cast<uint32_t>(_mm_movemask_epi8(_mm_packs_epi16(a, b)))) << (j * 16);
+        }
+        bits[w] = word;
+    }
+}
+
+INSPECTOR_TARGET("sse2")
+static void Range32Sse2(const uint32_t* values, size_t words, uint32_t lo, uint32_t span, uint64_t* bits)
+{
+    // SSE2 only compares signed, so both sides are biased by 2^31
+    const __m128i sign = _mm_set1_epi32(static_cast<int>(0x80000000u));
+    const __m128i low = _mm_set1_epi32(static_cast<int>(lo));
+    const __m128i width = _mm_xor_si128(_mm_set1_epi32(static_cast<int>(span)), sign);
+    for (size_t w = 0; w < words; w++)
+    {
+        const __m128i* in = reinterpret_cast<const __m128i*>(values + w * 64);
+        uint64_t outside = 0;
+        for (int j = 0; j < 16; j++)
+        {
+            __m128i d = _mm_xor_si128(_mm_sub_epi32(_mm_loadu_si128(in + j), low), sign);
+            outside |= uint64_t(static_cast<uint32_t>(_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(d, width))))) << (j * 4);
+        }
+        bits[w] = ~outside;
+    }
+}
+
+INSPECTOR_TARGET("sse2")
+static void AboveSse2(const float* values, size_t words, float threshold, uint64_t* bits)
+{
+    const __m128 limit = _mm_set1_ps(threshold);
+    for (size_t w = 0; w < words; w++)
+    {
+        const float* in = values + w * 64;
+        uint64_t word = 0;
+        for (int j = 0; j < 16; j++)
+            word |= uint64_t(static_cast<uint32_t>(_mm_movemask_ps(_mm_cmpgt_ps(_mm_loadu_ps(in + j * 4), limit)))) << (j * 4);
+        bits[w] = word;
+    }
+}
+
+INSPECTOR_TARGET("avx2")
+static void Range16Avx2(const uint16_t* values, size_t words, uint16_t lo, uint16_t span, uint64_t* bits)
+{
+    const __m256i low = _mm256_set1_epi16(static_cast<short>(lo));
+    const __m256i width = _mm256_set1_epi16(static_cast<short>(span));
+    const __m256i zero = _mm256_setzero_si256();
+    for (size_t w = 0; w < words; w++)
+    {
+        const __m256i* in = reinterpret_cast<const __m256i*>(values + w * 64);
+        uint64_t word = 0;
+        for (int j = 0; j < 2; j++)
+        {
+            __m256i a = _mm256_cmpeq_epi16(_mm256_subs_epu16(_mm256_sub_epi16(_mm256_loadu_si256(in + 2 * j), low), width), zero);
+            __m256i b = _mm256_cmpeq_epi16(_mm256_subs_epu16(_mm256_sub_epi16(_mm256_loadu_si256(in + 2 * j + 1), low), width), zero);
+            // packs works per 128-bit lane; the permute puts the 32 byte masks back in row order
+            __m256i packed = _mm256_permute4x64_epi64(_mm256_packs_epi16(a, b), 0xD8);
+            word |= uint64_t(static_cast<uint32_t>(_mm256_movemask_epi8(packed))) << (j * 32);
+        }
+        bits[w] = word;
+    }
+}
+
+INSPECTOR_TARGET("avx2")
+static void Range32Avx2(const uint32_t* values, size_t words, uint32_t lo, uint32_t span, uint64_t* bits)
+{
+    const __m256i low = _mm256_set1_epi32(static_cast<int>(lo));
+    const __m256i width = _mm256_set1_epi32(static_cast<int>(span));
+    for (size_t w = 0; w < words; w++)
+    {
+        const __m256i* in = reinterpret_cast<const __m256i*>(values + w * 64);
+        uint64_t word = 0;
+        for (int j = 0; j < 8; j++)
+        {
+            __m256i d = _mm256_sub_epi32(_mm256_loadu_si256(in + j), low);
+            __m256i inside = _mm256_cmpeq_epi32(_mm256_min_epu32(d, width), d);
+            word |= uint64_t(static_cast<uint32_t>(_mm256_movemask_ps(_mm256_castsi256_ps(inside)))) << (j * 8);
+        }
+        bits[w] = word;
+    }
+}
+
+INSPECTOR_TARGET("avx2")
+static void Range64Avx2(const uint64_t* values, size_t words, uint64_t lo, uint64_t span, uint64_t* bits)
+{
+    const __m256i sign = _mm256_set1_epi64x(static_cast<long long>(0x8000000000000000ull));
+    const __m256i low = _mm256_set1_epi64x(static_cast<long long>(lo));
+    const __m256i width = _mm256_xor_si256(_mm256_set1_epi64x(static_cast<long long>(span)), sign);
+    for (size_t w = 0; w < words; w++)
+    {
+        const __m256i* in = reinterpret_cast<const __m256i*>(values + w * 64);
+        uint64_t outside = 0;
+        for (int j = 0; j < 16; j++)
+        {
+            __m256i d = _mm256_xor_si256(_mm256_sub_epi64(_mm256_loadu_si256(in + j), low), sign);
+            outside |= uint64_t(static_cast<uint32_t>(_mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(d, width))))) << (j * 4);
+        }
+        bits[w] = ~outside;
+    }
+}
+
+INSPECTOR_TARGET("avx2")
+static void AboveAvx2(const float* values, size_t words, float threshold, uint64_t* bits)
+{
+    const __m256 limit = _mm256_set1_ps(threshold);
+    for (size_t w = 0; w < words; w++)
+    {
+        const float* in = values + w * 64;
+        uint64_t word = 0;
+        for (int j = 0; j < 8; j++)
+            word |= uint64_t(static_cast<uint32_t>(_mm256_movemask_ps(_mm256_cmp_ps(_mm256_loadu_ps(in + j * 8), limit, _CMP_GT_OQ)))) << (j * 8);
+        bits[w] = word;
+    }
+}
+
+#endif // INSPECTOR_X86 && INSPECTOR_X86_64
+
+struct QueryKernels
+{
+    Range16Kernel range16;
+    Range32Kernel range32;
+    Range64Kernel range64;
+    AboveKernel above;
+    const char* name;
+};
+
+static QueryKernels SelectKernels()
+{
+#if INSPECTOR_X86 && INSPECTOR_X86_64
+    if (CpuHasAvx2())
+        return { Range16Avx2, Range32Avx2, Range64Avx2, AboveAvx2, "avx2" };
+    // 64-bit compares need SSE4.2, so that one stays scalar here
+    if (CpuHasSse2())
+        return { Range16Sse2, Range32Sse2, RangeScalar<uint64_t>, AboveSse2, "sse2" };
+#endif
+    return { RangeScalar<uint16_t>, RangeScalar<uint32_t>, RangeScalar<uint64_t>, AboveScalar, "scalar" };
+}
+
+static const QueryKernels& Kernels()
+{
+    static const QueryKernels kernels = SelectKernels();
+    return kernels;
+}
+
+const char* QueryKernelName()
+{
+    return Kernels().name;
+}
+
+template <typename T, typename Kernel>
+static void SelectRangeWith(Kernel kernel, const T* values, size_t count, T lo, T hi, uint64_t* bits)
+{
+    size_t words = count / 64;
+    size_t tail = count % 64;
+    if (lo > hi)
+    {
+        memset(bits, 0, (words + (tail != 0)) * sizeof(uint64_t));
+        return;
+    }
+
+    T span = T(hi - lo);
+    kernel(values, words, lo, span, bits);
+    if (tail != 0)
+        bits[words] = RangeWord(values + words * 64, tail, lo, span);
+}
+
+void SelectRange(const uint16_t* values, size_t count, uint16_t lo, uint16_t hi, uint64_t* bits)
+{
+    SelectRangeWith(Kernels().range16, values, count, lo, hi, bits);
+}
+
+void SelectRange(const uint32_t* values, size_t count, uint32_t lo, uint32_t hi, uint64_t* bits)
+{
+    SelectRangeWith(Kernels().range32, values, count, lo, hi, bits);
+}
+
+void SelectRange(const uint64_t* values, size_t count, uint64_t lo, uint64_t hi, uint64_t* bits)
+{
+    SelectRangeWith(Kernels().range64, values, count, lo, hi, bits);
+}
+
+void SelectAbove(const float* values, size_t count, float threshold, uint64_t* bits)
+{
+    size_t words = count / 64;
+    Kernels().above(values, words, threshold, bits);
+    if (count % 64 != 0)
+        bits[words] = AboveWord(values + words * 64, count % 64, threshold);
+}
+
+void MarkParents(const uint32_t* parents, const uint64_t* childBits, size_t childCount, uint64_t* parentBits, size_t parentCount)
+{
+    size_t words = (childCount + 63) / 64;
+    for (size_t w = 0; w < words; w++)
+    {
+        // Matches are usually rare, so this walks set bits rather than rows
+        for (uint64_t word = childBits[w]; word != 0; word &= word - 1)
+        {
+            size_t child = w * 64 + CountTrailingZeros(word);
+            uint32_t parent = parents[child];
+            if (parent < parentCount)
+                parentBits[parent / 64] |= uint64_t(1) << (parent % 64);
+        }
+    }
+}
+
+size_t CountRows(const uint64_t* bits, size_t count)
+{
+    size_t rows = 0;
+    for (size_t w = 0; w < (count + 63) / 64; w++)
+        rows += std::bitset<64>(bits[w]).count();
+    return rows;
+}
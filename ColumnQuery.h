@@ -0,0 +1,27 @@
+#ifndef COLUMNQUERY_H
+#define COLUMNQUERY_H
+
+#include <cstddef>
+#include <cstdint>
+
+// Predicates over the flat columns of a ColumnStoreReader. Each one sets bit (i % 64) of bits[i / 64] when row i
+// matches and clears it otherwise, writing all (count + 63) / 64 words; bits past count are zero.
+
+// lo <= value <= hi, unsigned. An empty range (lo > hi) matches nothing.
+void SelectRange(const uint16_t* values, size_t count, uint16_t lo, uint16_t hi, uint64_t* bits);
+void SelectRange(const uint32_t* values, size_t count, uint32_t lo, uint32_t hi, uint64_t* bits);
+void SelectRange(const uint64_t* values, size_t count, uint64_t lo, uint64_t hi, uint64_t* bits);
+
+// value > threshold; NaN never matches
+void SelectAbove(const float* values, size_t count, float threshold, uint64_t* bits);
+
+// Sets parentBits[parents[i]] for every set childBits[i], e.g. the files owning matching sections. Parents past
+// parentCount are ignored; bits already set in parentBits stay set.
+void MarkParents(const uint32_t* parents, const uint64_t* childBits, size_t childCount, uint64_t* parentBits, size_t parentCount);
+
+size_t CountRows(const uint64_t* bits, size_t count);
+
+// Name of the predicate kernels picked for this CPU ("avx2", "sse2" or "scalar")
+const char* QueryKernelName();
+
+#endif // COLUMNQUERY_H
@@ -0,0 +1,452 @@
+#include "ColumnStore.h"
+#include "Trace.h"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <utility>
+
+namespace fs = std::filesystem;
+
+static const char kColumnMagic[8] = { 'I', 'N', 'S', 'P', 'C', 'O', 'L', '\0' };
+static const uint32_t kColumnVersion = 1;
+static const size_t kColumnAlignment = 64; // A cache line, and enough for any vector load the query kernels do
+static const size_t kSpillSize = size_t(4) << 20;
+static const size_t kNameSize = 40;
+
+// How many values a column holds, checked when a file is opened
+enum class ColumnRows
+{
+    Files,       // One per file row
+    FileIndex,   // One per file row plus an end
+    Sections,    // One per section row
+    Imports,     // One per import row
+    PathBytes,   // Any count, indexed by path.offsets
+    Dictionary,  // One per dictionary string plus an end
+    DictionaryBytes
+};
+
+enum ColumnIndex
+{
+    PathData,
+    PathOffsets,
+    Offset,
+    FileSize,
+    Error,
+    Machine,
+    Magic,
+    Characteristics,
+    Timestamp,
+    EntryPoint,
+    SizeOfImage,
+    ImportHash,
+    SectionStart,
+    ImportStart,
+    SectionFile,
+    SectionName,
+    SectionVirtualAddress,
+    SectionVirtualSize,
+    SectionRawSize,
+    SectionCharacteristics,
+    SectionEntropyColumn,
+    ImportFile,
+    ImportModule,
+    ImportFunction,
+    ImportOrdinal,
+    DictionaryData,
+    DictionaryOffsets,
+    ColumnCount
+};
+
+struct ColumnSpec
+{
+    const char* name;
+    ColumnType type;
+    ColumnRows rows;
+};
+
+// In ColumnIndex order
+static const ColumnSpec kColumns[ColumnCount] = {
+    { "path", ColumnType::U8, ColumnRows::PathBytes },
+    { "path.offsets", ColumnType::U64, ColumnRows::FileIndex },
+    { "offset", ColumnType::U64, ColumnRows::Files },
+    { "fileSize", ColumnType::U64, ColumnRows::Files },
+    { "error", ColumnType::U32, ColumnRows::Files },
+    { "machine", ColumnType::U16, ColumnRows::Files },
+    { "magic", ColumnType::U16, ColumnRows::Files },
+    { "characteristics", ColumnType::U16, ColumnRows::Files },
+    { "timestamp", ColumnType::U32, ColumnRows::Files },
+    { "entryPoint", ColumnType::U32, ColumnRows::Files },
+    { "sizeOfImage", ColumnType::U32, ColumnRows::Files },
+    { "importHash", ColumnType::U64, ColumnRows::Files },
+    { "sectionStart", ColumnType::U64, ColumnRows::FileIndex },
+    { "importStart", ColumnType::U64, ColumnRows::FileIndex },
+    { "section.file", ColumnType::U32, ColumnRows::Sections },
+    { "section.name", ColumnType::U64, ColumnRows::Sections },
+    { "section.virtualAddress", ColumnType::U32, ColumnRows::Sections },
+    { "section.virtualSize", ColumnType::U32, ColumnRows::Sections },
+    { "section.rawSize", ColumnType::U32, ColumnRows::Sections },
+    { "section.characteristics", ColumnType::U32, ColumnRows::Sections },
+    { "section.entropy", ColumnType::F32, ColumnRows::Sections },
+    { "import.file", ColumnType::U32, ColumnRows::Imports },
+    { "import.module", ColumnType::U32, ColumnRows::Imports },
+    { "import.function", ColumnType::U32, ColumnRows::Imports },
+    { "import.ordinal", ColumnType::U16, ColumnRows::Imports },
+    { "dictionary", ColumnType::U8, ColumnRows::DictionaryBytes },
+    { "dictionary.offsets", ColumnType::U64, ColumnRows::Dictionary },
+};
+
+#pragma pack(push, 1)
+struct ColumnFileHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t columnCount;
+    uint64_t rows;
+    uint64_t sectionRows;
+    uint64_t importRows;
+    uint64_t dictionaryCount;
+    uint64_t reserved[2];
+};
+
+// Directory entry, one per column right after the header
+struct ColumnFileEntry
+{
+    char name[kNameSize]; // NUL-padded
+    uint32_t type;
+    uint32_t reserved;
+    uint64_t count;
+    uint64_t offset; // From the start of the file, a multiple of kColumnAlignment
+};
+#pragma pack(pop)
+
+static_assert(sizeof(ColumnFileHeader) == 64 && sizeof(ColumnFileEntry) == 64, "Column file records must stay 64 bytes");
+
+static size_t TypeWidth(ColumnType type)
+{
+    switch (type)
+    {
+    case ColumnType::U8:  return 1;
+    case ColumnType::U16: return 2;
+    case ColumnType::U32: return 4;
+    case ColumnType::U64: return 8;
+    case ColumnType::F32: return 4;
+    }
+    return 0;
+}
+
+ColumnStoreWriter::ColumnStoreWriter()
+{
+    for (const ColumnSpec& spec : kColumns)
+        columns.push_back({ spec.name, spec.type, {} });
+
+    // The offsets start with that of the first path
+    Append<uint64_t>(PathOffsets, 0);
+}
+
+ColumnStoreWriter::~ColumnStoreWriter()
+{
+    for (Column& column : columns)
+    {
+        if (column.spill != nullptr)
+            fclose(column.spill);
+    }
+}
+
+void ColumnStoreWriter::AppendBytes(size_t index, const void* data, size_t size)
+{
+    // Finish will fail anyway; buffering every later row would only hold it all in memory until then
+    if (failed)
+        return;
+
+    Column& column = columns[index];
+    column.buffer.append(static_cast<const char*>(data), size);
+    if (column.buffer.size() < kSpillSize)
+        return;
+
+    if (column.spill == nullptr)
+        column.spill = tmpfile();
+    if (column.spill == nullptr || fwrite(column.buffer.data(), 1, column.buffer.size(), column.spill) != column.buffer.size())
+    {
+        failed = true;
+        errorString = "Failed to write a temporary column file.";
+        return;
+    }
+    column.spilled += column.buffer.size();
+    column.buffer.clear();
+}
+
+template <typename T>
+void ColumnStoreWriter::Append(size_t index, const T& value)
+{
+    AppendBytes(index, &value, sizeof(value));
+}
+
+void ColumnStoreWriter::Add(const std::string& path, uint64_t offset, uint64_t size, const ImageSummary& summary)
+{
+    // Interned and hashed before taking the lock; the import lists are symbol IDs already
+    SymbolTable& symbols = SymbolTable::Global();
+    uint32_t error = summary.parsed ? 0 : symbols.Intern(summary.error.empty() ? "Unknown error." : summary.error);
+    uint64_t importHash = summary.parsed ? summary.ImportHash() : 0;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    uint32_t row = static_cast<uint32_t>(rows++);
+
+    AppendBytes(PathData, path.data(), path.size());
+    pathBytes += path.size();
+    Append<uint64_t>(PathOffsets, pathBytes);
+    Append<uint64_t>(Offset, offset);
+    Append<uint64_t>(FileSize, size);
+    // A failed row always has a non-zero error ID, even when nothing said why
+    Append<uint32_t>(Error, error);
+    Append<uint16_t>(Machine, summary.machine);
+    Append<uint16_t>(Magic, summary.magic);
+    Append<uint16_t>(Characteristics, summary.characteristics);
+    Append<uint32_t>(Timestamp, summary.timestamp);
+    Append<uint32_t>(EntryPoint, summary.entryPoint);
+    Append<uint32_t>(SizeOfImage, summary.sizeOfImage);
+    Append<uint64_t>(ImportHash, importHash);
+    Append<uint64_t>(SectionStart, sectionRows);
+    Append<uint64_t>(ImportStart, importRows);
+
+    for (size_t i = 0; i < summary.sections.size(); i++)
+    {
+        const IMAGE_SECTION_HEADER& section = summary.sections[i];
+        uint64_t name = 0;
+        memcpy(&name, section.Name, sizeof(section.Name));
+        Append<uint32_t>(SectionFile, row);
+        Append<uint64_t>(SectionName, name);
+        Append<uint32_t>(SectionVirtualAddress, section.VirtualAddress);
+        Append<uint32_t>(SectionVirtualSize, section.Misc.VirtualSize);
+        Append<uint32_t>(SectionRawSize, section.SizeOfRawData);
+        Append<uint32_t>(SectionCharacteristics, section.Characteristics);
+        Append<float>(SectionEntropyColumn, summary.hasEntropy ? summary.sectionEntropy[i] : -1.0f);
+    }
+    sectionRows += summary.sections.size();
+
+    for (const ImageSummary::Import& import : summary.imports)
+    {
+        Append<uint32_t>(ImportFile, row);
+        Append<uint32_t>(ImportModule, summary.importModules[import.module]);
+        Append<uint32_t>(ImportFunction, import.name);
+        Append<uint16_t>(ImportOrdinal, import.ordinal);
+    }
+    importRows += summary.imports.size();
+}
+
+bool ColumnStoreWriter::Finish(const std::string& path)
+{
+    TRACE_SCOPE("WriteColumns");
+    std::lock_guard<std::mutex> lock(mutex);
+    Append<uint64_t>(SectionStart, sectionRows);
+    Append<uint64_t>(ImportStart, importRows);
+
+    // Every scan is done, so the table holds still while it is copied
+    const SymbolTable& symbols = SymbolTable::Global();
+    uint64_t dictionaryBytes = 0;
+    Append<uint64_t>(DictionaryOffsets, 0);
+    for (uint32_t id = 0; id < symbols.Size(); id++)
+    {
+        std::string_view name = symbols.Name(id);
+        AppendBytes(DictionaryData, name.data(), name.size());
+        dictionaryBytes += name.size();
+        Append<uint64_t>(DictionaryOffsets, dictionaryBytes);
+    }
+    if (failed)
+        return false;
+
+    ColumnFileHeader header = {};
+    memcpy(header.magic, kColumnMagic, sizeof(header.magic));
+    header.version = kColumnVersion;
+    header.columnCount = ColumnCount;
+    header.rows = rows;
+    header.sectionRows = sectionRows;
+    header.importRows = importRows;
+    header.dictionaryCount = symbols.Size();
+
+    std::vector<ColumnFileEntry> entries(columns.size());
+    uint64_t position = sizeof(header) + entries.size() * sizeof(ColumnFileEntry);
+    for (size_t i = 0; i < columns.size(); i++)
+    {
+        uint64_t size = columns[i].spilled + columns[i].buffer.size();
+        position = (position + kColumnAlignment - 1) / kColumnAlignment * kColumnAlignment;
+        strncpy(entries[i].name, columns[i].name, kNameSize - 1);
+        entries[i].type = static_cast<uint32_t>(columns[i].type);
+        entries[i].count = size / TypeWidth(columns[i].type);
+        entries[i].offset = position;
+        position += size;
+    }
+
+    std::ofstream out(fs::u8path(path), std::ios::binary | std::ios::trunc);
+    if (!out)
+    {
+        errorString = "Failed to create the column file.";
+        return false;
+    }
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(entries.data()), static_cast<std::streamsize>(entries.size() * sizeof(ColumnFileEntry)));
+
+    std::vector<char> chunk(kSpillSize);
+    uint64_t written = sizeof(header) + entries.size() * sizeof(ColumnFileEntry);
+    for (size_t i = 0; i < columns.size() && out; i++)
+    {
+        static const char padding[kColumnAlignment] = {};
+        out.write(padding, static_cast<std::streamsize>(entries[i].offset - written));
+
+        Column& column = columns[i];
+        if (column.spill != nullptr)
+        {
+            rewind(column.spill);
+            uint64_t remaining = column.spilled;
+            while (remaining > 0 && out)
+            {
+                size_t length = fread(chunk.data(), 1, static_cast<size_t>(std::min<uint64_t>(remaining, chunk.size())), column.spill);
+                if (length == 0)
+                {
+                    errorString = "Failed to read a temporary column file.";
+                    return false;
+                }
+                out.write(chunk.data(), static_cast<std::streamsize>(length));
+                remaining -= length;
+            }
+        }
+        out.write(column.buffer.data(), static_cast<std::streamsize>(column.buffer.size()));
+        written = entries[i].offset + column.spilled + column.buffer.size();
+    }
+
+    if (!out)
+    {
+        errorString = "Failed to write the column file.";
+        return false;
+    }
+    return true;
+}
+
+bool ColumnStoreReader::Open(const std::string& path)
+{
+    entries.clear();
+    if (!mapping.Open(path))
+    {
+        errorString = mapping.ErrorString();
+        return false;
+    }
+
+    const uint8_t* data = mapping.Data();
+    size_t size = mapping.Size();
+    ColumnFileHeader header;
+    if (size < sizeof(header))
+    {
+        errorString = "Not a column file.";
+        return false;
+    }
+    memcpy(&header, data, sizeof(header));
+    if (memcmp(header.magic, kColumnMagic, sizeof(header.magic)) != 0)
+    {
+        errorString = "Not a column file.";
+        return false;
+    }
+    if (header.version != kColumnVersion)
+    {
+        errorString = "Unsupported column file version.";
+        return false;
+    }
+    if (header.columnCount > (size - sizeof(header)) / sizeof(ColumnFileEntry))
+    {
+        errorString = "Column directory extends past the end of the file.";
+        return false;
+    }
+
+    for (uint32_t i = 0; i < header.columnCount; i++)
+    {
+        ColumnFileEntry entry;
+        memcpy(&entry, data + sizeof(header) + i * sizeof(ColumnFileEntry), sizeof(entry));
+        size_t width = entry.type <= static_cast<uint32_t>(ColumnType::F32) ? TypeWidth(static_cast<ColumnType>(entry.type)) : 0;
+        if (width == 0 || entry.offset % kColumnAlignment != 0 || entry.offset > size || entry.count > (size - entry.offset) / width)
+        {
+            errorString = "Column extends past the end of the file.";
+            return false;
+        }
+        entry.name[kNameSize - 1] = '\0';
+        entries.push_back({ entry.name, static_cast<ColumnType>(entry.type), entry.count, data + entry.offset });
+    }
+
+    // Every column of this version must be there with the type and length the header implies
+    rows = header.rows;
+    sectionRows = header.sectionRows;
+    importRows = header.importRows;
+    dictionaryCount = header.dictionaryCount;
+    for (const ColumnSpec& spec : kColumns)
+    {
+        size_t count;
+        if (Find(spec.name, spec.type, count) == nullptr)
+        {
+            errorString = std::string("Column ") + spec.name + " is missing.";
+            return false;
+        }
+
+        bool valid = true;
+        switch (spec.rows)
+        {
+        case ColumnRows::Files:      valid = count == rows; break;
+        case ColumnRows::FileIndex:  valid = count == rows + 1; break;
+        case ColumnRows::Sections:   valid = count == sectionRows; break;
+        case ColumnRows::Imports:    valid = count == importRows; break;
+        case ColumnRows::Dictionary: valid = count == dictionaryCount + 1; break;
+        default: break;
+        }
+        if (!valid)
+        {
+            errorString = std::string("Column ") + spec.name + " has the wrong length.";
+            return false;
+        }
+    }
+
+    size_t count;
+    pathOffsets = Column<uint64_t>("path.offsets", count);
+    paths = Column<uint8_t>("path", pathBytes);
+    dictionaryOffsets = Column<uint64_t>("dictionary.offsets", count);
+    dictionary = Column<uint8_t>("dictionary", dictionaryBytes);
+
+    // Index columns never go down and never point past what they index, so every span taken from two neighbouring
+    // entries lies inside its column
+    const std::pair<const char*, uint64_t> indexes[] = {
+        { "sectionStart", sectionRows },
+        { "importStart", importRows },
+        { "path.offsets", pathBytes },
+        { "dictionary.offsets", dictionaryBytes },
+    };
+    for (const std::pair<const char*, uint64_t>& index : indexes)
+    {
+        const uint64_t* values = Column<uint64_t>(index.first, count);
+        for (size_t i = 0; i < count; i++)
+        {
+            if (values[i] > index.second || (i > 0 && values[i] < values[i - 1]))
+            {
+                errorString = std::string("Column ") + index.first + " is not a valid index.";
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+const void* ColumnStoreReader::Find(const char* name, ColumnType type, size_t& count) const
+{
+    for (const Entry& entry : entries)
+    {
+        if (entry.type == type && entry.name == name)
+        {
+            count = static_cast<size_t>(entry.count);
+            return entry.data;
+        }
+    }
+    count = 0;
+    return nullptr;
+}
+
+std::string_view ColumnStoreReader::StringAt(const uint8_t* bytes, size_t size, const uint64_t* offsets, uint64_t index, uint64_t count)
+{
+    if (index >= count || offsets[index] > offsets[index + 1] || offsets[index + 1] > size)
+        return std::string_view();
+    return std::string_view(reinterpret_cast<const char*>(bytes) + offsets[index], static_cast<size_t>(offsets[index + 1] - offsets[index]));
+}
@@ -0,0 +1,136 @@
+#ifndef COLUMNSTORE_H
+#define COLUMNSTORE_H
+
+#include "ImageSummary.h"
+#include "MappedFile.h"
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Columnar file of batch scan results, made to be mapped and scanned rather than parsed.
+// Every column is one flat array of a fixed-width type, 64-byte aligned in the file:
+//  - one row per file (or carved image): path, offset, fileSize, error, machine, magic, characteristics,
+//    timestamp, entryPoint, sizeOfImage, importHash (ImageSummary::ImportHash), and sectionStart/importStart,
+//    which index the child columns and have one extra entry at the end;
+//  - one row per section: section.file (the file row), section.name (the 8 name bytes), virtual address and
+//    size, raw size, characteristics and entropy (-1 when it was not computed);
+//  - one row per import: import.file, import.module and import.function (dictionary IDs, function 0 when
+//    imported by ordinal) and import.ordinal.
+// Module, function and error strings are symbol IDs, and the dictionary is SymbolTable::Global() as it stands when
+// the file is written, ID 0 being the empty string; paths and the dictionary are byte columns indexed by a U64
+// offsets column with one entry more than there are strings.
+// Little-endian hosts only, like the rest of the parser.
+enum class ColumnType : uint32_t
+{
+    U8,
+    U16,
+    U32,
+    U64,
+    F32
+};
+
+template <typename T> struct ColumnTypeOf;
+template <> struct ColumnTypeOf<uint8_t> { static constexpr ColumnType type = ColumnType::U8; };
+template <> struct ColumnTypeOf<uint16_t> { static constexpr ColumnType type = ColumnType::U16; };
+template <> struct ColumnTypeOf<uint32_t> { static constexpr ColumnType type = ColumnType::U32; };
+template <> struct ColumnTypeOf<uint64_t> { static constexpr ColumnType type = ColumnType::U64; };
+template <> struct ColumnTypeOf<float> { static constexpr ColumnType type = ColumnType::F32; };
+
+// Collects rows from many threads and writes the file once the scan is done. Columns are buffered in memory up to
+// a few MB each and spilled to temporary files beyond that, so only the symbol table grows with the corpus.
+class ColumnStoreWriter
+{
+public:
+    ColumnStoreWriter();
+    ~ColumnStoreWriter();
+
+    ColumnStoreWriter(const ColumnStoreWriter&) = delete;
+    ColumnStoreWriter& operator=(const ColumnStoreWriter&) = delete;
+
+    // One row. offset is where the image starts in the file (non-zero only for carved images), size its length.
+    // Safe to call from many threads; rows are stored in the order the calls complete.
+    void Add(const std::string& path, uint64_t offset, uint64_t size, const ImageSummary& summary);
+
+    // Writes every column to path; the writer is spent afterwards
+    bool Finish(const std::string& path);
+
+    uint64_t RowCount() const { return rows; }
+    const std::string& ErrorString() const { return errorString; }
+
+private:
+    struct Column
+    {
+        const char* name;
+        ColumnType type;
+        std::string buffer;
+        FILE* spill = nullptr; // Temporary file holding everything before buffer
+        uint64_t spilled = 0;  // Bytes in spill
+    };
+
+    template <typename T> void Append(size_t column, const T& value);
+    void AppendBytes(size_t column, const void* data, size_t size);
+
+    std::mutex mutex;
+    std::vector<Column> columns;
+    uint64_t pathBytes = 0;
+    uint64_t rows = 0;
+    uint64_t sectionRows = 0;
+    uint64_t importRows = 0;
+    bool failed = false;
+    std::string errorString;
+};
+
+// Read-only view of a column file. Columns are typed spans straight into the mapping.
+class ColumnStoreReader
+{
+public:
+    bool Open(const std::string& path);
+
+    uint64_t RowCount() const { return rows; }
+    uint64_t SectionRowCount() const { return sectionRows; }
+    uint64_t ImportRowCount() const { return importRows; }
+    const std::string& ErrorString() const { return errorString; }
+
+    // The column's values, or nullptr if there is no such column of type T; count is set either way
+    template <typename T>
+    const T* Column(const char* name, size_t& count) const
+    {
+        return static_cast<const T*>(Find(name, ColumnTypeOf<T>::type, count));
+    }
+
+    // Empty for a row or ID out of range
+    std::string_view Path(uint64_t row) const { return StringAt(paths, pathBytes, pathOffsets, row, rows); }
+    size_t DictionarySize() const { return static_cast<size_t>(dictionaryCount); }
+    std::string_view DictionaryString(uint32_t id) const { return StringAt(dictionary, dictionaryBytes, dictionaryOffsets, id, dictionaryCount); }
+
+private:
+    struct Entry
+    {
+        std::string name;
+        ColumnType type;
+        uint64_t count;
+        const void* data;
+    };
+
+    const void* Find(const char* name, ColumnType type, size_t& count) const;
+    static std::string_view StringAt(const uint8_t* bytes, size_t size, const uint64_t* offsets, uint64_t index, uint64_t count);
+
+    MappedFile mapping;
+    std::vector<Entry> entries;
+    uint64_t rows = 0;
+    uint64_t sectionRows = 0;
+    uint64_t importRows = 0;
+    uint64_t dictionaryCount = 0;
+    const uint8_t* paths = nullptr;
+    size_t pathBytes = 0;
+    const uint64_t* pathOffsets = nullptr;
+    const uint8_t* dictionary = nullptr;
+    size_t dictionaryBytes = 0;
+    const uint64_t* dictionaryOffsets = nullptr;
+    std::string errorString;
+};
+
+#endif // COLUMNSTORE_H
@@ -0,0 +1,295 @@
+#include "Entropy.h"
+#include "PEImage.h"
+#include "Simd.h"
+#include "Trace.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <thread>
+
+// Kernels count into several sub-histograms so that runs of one byte value (padding, zero fill)
+// do not serialise on a single counter's store-to-load dependency. Sub-histograms use 32-bit
+// counters, so callers feed at most kMaxBlock bytes per call and fold into the 64-bit totals.
+static const size_t kMaxBlock = size_t(1) << 30;
+
+typedef void (*HistogramKernel)(const BYTE* data, size_t size, uint64_t* counts);
+
+static void FoldCounts(const uint32_t (*sub)[256], int lanes, uint64_t* counts)
+{
+    for (int b = 0; b < 256; b++)
+    {
+        uint64_t sum = 0;
+        for (int lane = 0; lane < lanes; lane++)
+            sum += sub[lane][b];
+        counts[b] += sum;
+    }
+}
+
+static void HistogramScalar(const BYTE* data, size_t size, uint64_t* counts)
+{
+    uint32_t sub[4][256] = {};
+    size_t i = 0;
+    for (; i + 4 <= size; i += 4)
+    {
+        sub[0][data[i]]++;
+        sub[1][data[i + 1]]++;
+        sub[2][data[i + 2]]++;
+        sub[3][data[i + 3]]++;
+    }
+    for (; i < size; i++)
+        sub[0][data[i]]++;
+    FoldCounts(sub, 4, counts);
+}
+
+#if INSPECTOR_X86
+
+// Spread the bytes of a 64-bit lane over eight sub-histograms
+#define COUNT_LANE(value)                \
+    do                                   \
+    {                                    \
+        uint64_t bytes = (value);        \
+        sub[0][bytes & 0xFF]++;          \
+        sub[1][(bytes >> 8) & 0xFF]++;   \
+        sub[2][(bytes >> 16) & 0xFF]++;  \
+        sub[3][(bytes >> 24) & 0xFF]++;  \
+        sub[4][(bytes >> 32) & 0xFF]++;  \
+        sub[5][(bytes >> 40) & 0xFF]++;  \
+        sub[6][(bytes >> 48) & 0xFF]++;  \
+        sub[7][bytes >> 56]++;           \
+    } while (0)
+
+#if INSPECTOR_X86_64
+
+INSPECTOR_TARGET("sse2")
+static void HistogramSse2(const BYTE* data, size_t size, uint64_t* counts)
+{
+    uint32_t sub[8][256] = {};
+    size_t i = 0;
+    for (; i + 16 <= size; i += 16)
+    {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+
+        // Runs of one value (zero fill, 0xCC padding) are counted in one step
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8(static_cast<char>(data[i])))) == 0xFFFF)
+        {
+            sub[0][data[i]] += 16;
+            continue;
+        }
+
+        COUNT_LANE(uint64_t(_mm_cvtsi128_si64(v)));
+        COUNT_LANE(uint64_t(_mm_cvtsi128_si64(_mm_unpackhi_epi64(v, v))));
+    }
+    for (; i < size; i++)
+        sub[0][data[i]]++;
+    FoldCounts(sub, 8, counts);
+}
+
+INSPECTOR_TARGET("avx2")
+static void HistogramAvx2(const BYTE* data, size_t size, uint64_t* counts)
+{
+    uint32_t sub[8][256] = {};
+    size_t i = 0;
+    for (; i + 32 <= size; i += 32)
+    {
+        // One 256-bit load per 32 bytes; lanes are pulled out as scalars for the scatter
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+
+        // Runs of one value (zero fill, 0xCC padding) are counted in one step
+        if (_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(static_cast<char>(data[i])))) == -1)
+        {
+            sub[0][data[i]] += 32;
+            continue;
+        }
+
+        __m128i low = _mm256_castsi256_si128(v);
+        __m128i high = _mm256_extracti128_si256(v, 1);
+        COUNT_LANE(uint64_t(_mm_cvtsi128_si64(low)));
+        COUNT_LANE(uint64_t(_mm_extract_epi64(low, 1)));
+        COUNT_LANE(uint64_t(_mm_cvtsi128_si64(high)));
+        COUNT_LANE(uint64_t(_mm_extract_epi64(high, 1)));
+    }
+    for (; i < size; i++)
+        sub[0][data[i]]++;
+    FoldCounts(sub, 8, counts);
+}
+
+#endif // INSPECTOR_X86_64
+
+#undef COUNT_LANE
+
+#endif // INSPECTOR_X86
+
+struct KernelChoice
+{
+    HistogramKernel kernel;
+    const char* name;
+};
+
+static KernelChoice SelectKernel()
+{
+#if INSPECTOR_X86 && INSPECTOR_X86_64
+    if (CpuHasAvx2())
+        return { HistogramAvx2, "avx2" };
+    if (CpuHasSse2())
+        return { HistogramSse2, "sse2" };
+#endif
+    return { HistogramScalar, "scalar" };
+}
+
+static const KernelChoice& Kernel()
+{
+    static const KernelChoice choice = SelectKernel();
+    return choice;
+}
+
+const char* HistogramKernelName()
+{
+    return Kernel().name;
+}
+
+void ByteHistogram::Add(const BYTE* data, size_t size)
+{
+    HistogramKernel kernel = Kernel().kernel;
+    total += size;
+    while (size > 0)
+    {
+        size_t block = std::min(size, kMaxBlock);
+        kernel(data, block, counts);
+        data += block;
+        size -= block;
+    }
+}
+
+void ByteHistogram::Merge(const ByteHistogram& other)
+{
+    for (int b = 0; b < 256; b++)
+        counts[b] += other.counts[b];
+    total += other.total;
+}
+
+double ByteHistogram::Entropy() const
+{
+    if (total == 0)
+        return 0.0;
+
+    double entropy = 0.0;
+    double scale = 1.0 / double(total);
+    for (int b = 0; b < 256; b++)
+    {
+        if (counts[b] == 0)
+            continue;
+        double p = double(counts[b]) * scale;
+        entropy -= p * std::log2(p);
+    }
+    return entropy;
+}
+
+std::vector<float> WindowEntropy(const BYTE* data, size_t size, size_t windowSize)
+{
+    std::vector<float> windows;
+    if (windowSize == 0 || size == 0)
+        return windows;
+
+    windows.reserve((size + windowSize - 1) / windowSize);
+    for (size_t offset = 0; offset < size; offset += windowSize)
+    {
+        ByteHistogram histogram;
+        histogram.Add(data + offset, std::min(windowSize, size - offset));
+        windows.push_back(float(histogram.Entropy()));
+    }
+    return windows;
+}
+
+// Raw bytes of a section actually present in the file
+static SectionEntropy SectionEntropyOf(const BYTE* data, size_t size, size_t windowSize)
+{
+    // One pass: windows are histogrammed individually and merged for the section total
+    SectionEntropy result;
+    ByteHistogram total;
+    if (windowSize == 0)
+    {
+        total.Add(data, size);
+        result.entropy = total.Entropy();
+        return result;
+    }
+
+    result.windows.reserve((size + windowSize - 1) / windowSize);
+    for (size_t offset = 0; offset < size; offset += windowSize)
+    {
+        ByteHistogram window;
+        window.Add(data + offset, std::min(windowSize, size - offset));
+        result.windows.push_back(float(window.Entropy()));
+        total.Merge(window);
+    }
+    result.entropy = total.Entropy();
+    return result;
+}
+
+// Fills results[i] for every section with wanted[i] set (every section without wanted), leaving the others alone
+static void ComputeSections(const PEImageBase& image, const std::vector<bool>* wanted, size_t windowSize, unsigned threads,
+                            std::vector<SectionEntropy>& results)
+{
+    const std::vector<IMAGE_SECTION_HEADER>& sections = image.GetSections();
+    const BYTE* base = reinterpret_cast<const BYTE*>(image.GetImageBase());
+    size_t fileSize = image.GetImageSize();
+
+    // Threads only pay off once there is real data to chew through
+    const size_t kBytesPerThread = size_t(4) << 20;
+    size_t rawBytes = 0;
+    for (size_t i = 0; i < sections.size(); i++)
+    {
+        size_t offset, size;
+        if ((wanted == nullptr || (*wanted)[i]) && SectionRawRange(sections[i], fileSize, offset, size))
+            rawBytes += size;
+    }
+    TRACE_SCOPE("ComputeSectionEntropy");
+    TRACE_COUNT(Bytes, rawBytes);
+
+    if (threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    threads = unsigned(std::min<size_t>({ size_t(threads), sections.size(), rawBytes / kBytesPerThread + 1 }));
+
+    std::atomic<size_t> next(0);
+    auto work = [&]()
+    {
+        for (size_t i = next++; i < sections.size(); i = next++)
+        {
+            size_t offset, size;
+            if (wanted != nullptr && !(*wanted)[i])
+                continue;
+            if (SectionRawRange(sections[i], fileSize, offset, size))
+                results[i] = SectionEntropyOf(base + offset, size, windowSize);
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (unsigned t = 1; t < threads; t++)
+        workers.emplace_back(work);
+    work();
+    for (std::thread& worker : workers)
+        worker.join();
+}
+
+std::vector<SectionEntropy> ComputeSectionEntropy(const PEImageBase& image, size_t windowSize, unsigned threads)
+{
+    std::vector<SectionEntropy> results(image.GetSections().size());
+    ComputeSections(image, nullptr, windowSize, threads, results);
+    return results;
+}
+
+std::vector<SectionEntropy> UpdateSectionEntropy(const PEImageBase& image, const std::vector<SectionEntropy>& previous,
+                                                 const std::vector<bool>& changed, size_t windowSize, unsigned threads)
+{
+    if (previous.size() != image.GetSections().size() || changed.size() != previous.size())
+        return ComputeSectionEntropy(image, windowSize, threads);
+
+    std::vector<SectionEntropy> results(previous.size());
+    for (size_t i = 0; i < previous.size(); i++)
+    {
+        if (!changed[i])
+            results[i] = previous[i];
+    }
+    ComputeSections(image, &changed, windowSize, threads, results);
+    return results;
+}
@@ -0,0 +1,47 @@
+#ifndef ENTROPY_H
+#define ENTROPY_H
+
+#include "PETypes.h"
+#include <cstdint>
+#include <vector>
+
+class PEImageBase;
+
+// Byte histogram of a buffer: counts[b] is the number of bytes equal to b
+struct ByteHistogram
+{
+    uint64_t counts[256] = {};
+    uint64_t total = 0;
+
+    void Add(const BYTE* data, size_t size);
+    void Merge(const ByteHistogram& other);
+
+    // Shannon entropy in bits per byte, 0.0 (constant) to 8.0 (uniform)
+    double Entropy() const;
+};
+
+// Entropy of one section's raw data, overall and per fixed-size window.
+// Packed or encrypted sections sit close to 8.0; code is typically 5.5-6.5.
+struct SectionEntropy
+{
+    double entropy = 0.0;
+    std::vector<float> windows;
+};
+
+// Name of the histogram kernel picked for this CPU ("avx2", "sse2" or "scalar")
+const char* HistogramKernelName();
+
+// Entropy of every window of windowSize bytes in [data, data + size); the last window may be shorter
+std::vector<float> WindowEntropy(const BYTE* data, size_t size, size_t windowSize);
+
+// Entropy of each section's raw data, in section table order. windowSize 0 skips the per-window series.
+// Sections are spread over up to `threads` threads (0 = hardware concurrency);
+// the image must have been parsed up to ParseSections.
+std::vector<SectionEntropy> ComputeSectionEntropy(const PEImageBase& image, size_t windowSize = 4096, unsigned threads = 0);
+
+// Same, but sections whose changed flag is clear are copied from previous instead of read again, e.g. after a
+// rebuild that left them alone. previous must come from the same section table; otherwise everything is recomputed.
+std::vector<SectionEntropy> UpdateSectionEntropy(const PEImageBase& image, const std::vector<SectionEntropy>& previous,
+                                                 const std::vector<bool>& changed, size_t windowSize = 4096, unsigned threads = 0);
+
+#endif // ENTROPY_H
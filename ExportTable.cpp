@@ -0,0 +1,158 @@
+#include "ExportTable.h"
+#include "PEImage.h"
+
+void ExportTable::Clear()
+{
+    symbols.clear();
+    buckets.clear();
+    slotSymbols.clear();
+    moduleName = std::string_view();
+    ordinalBase = 0;
+    errorString.clear();
+}
+
+// FNV-1a, short symbol names make anything heavier pointless
+uint32_t ExportTable::Hash(std::string_view name)
+{
+    uint32_t hash = 2166136261u;
+    for (char c : name)
+    {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+void ExportTable::InsertName(uint32_t symbol)
+{
+    uint32_t hash = Hash(symbols[symbol].name);
+    size_t mask = buckets.size() - 1;
+    size_t i = hash & mask;
+    while (buckets[i].symbol != kEmpty)
+    {
+        // Duplicate names are malformed; the first one wins, like the loader's binary search would mostly find
+        if (buckets[i].hash == hash && symbols[buckets[i].symbol].name == symbols[symbol].name)
+            return;
+        i = (i + 1) & mask;
+    }
+    buckets[i].hash = hash;
+    buckets[i].symbol = symbol;
+}
+
+bool ExportTable::Parse(const PEImageBase& image, DWORD rva, DWORD size)
+{
+    Clear();
+    if (rva == 0)
+        return true;
+
+    const IMAGE_EXPORT_DIRECTORY* directory = image.RvaToPointer<IMAGE_EXPORT_DIRECTORY>(rva);
+    if (directory == nullptr)
+    {
+        errorString = "Export directory points outside the file.";
+        return false;
+    }
+
+    ordinalBase = directory->Base;
+    if (directory->Name != 0)
+    {
+        const char* name = image.RvaToString(directory->Name);
+        if (name != nullptr)
+            moduleName = name;
+    }
+
+    // Every array must lie in the file; RvaToPointer also rejects counts larger than the file itself
+    const DWORD* functions = nullptr;
+    const DWORD* names = nullptr;
+    const WORD* nameOrdinals = nullptr;
+    if (directory->NumberOfFunctions > 0)
+        functions = image.RvaToPointer<DWORD>(directory->AddressOfFunctions, directory->NumberOfFunctions);
+    if (directory->NumberOfNames > 0)
+    {
+        names = image.RvaToPointer<DWORD>(directory->AddressOfNames, directory->NumberOfNames);
+        nameOrdinals = image.RvaToPointer<WORD>(directory->AddressOfNameOrdinals, directory->NumberOfNames);
+    }
+    if ((directory->NumberOfFunctions > 0 && functions == nullptr) ||
+        (directory->NumberOfNames > 0 && (names == nullptr || nameOrdinals == nullptr)))
+    {
+        errorString = "Export tables extend past the end of the file.";
+        return false;
+    }
+
+    DWORD slotCount = directory->NumberOfFunctions;
+    slotSymbols.assign(slotCount, kEmpty);
+    symbols.reserve(directory->NumberOfNames);
+
+    // The export directory's own range holds forwarder strings instead of code
+    auto makeSymbol = [&](DWORD slot) -> ExportSymbol
+    {
+        ExportSymbol symbol = {};
+        symbol.ordinal = ordinalBase + slot;
+        symbol.rva = functions[slot];
+        if (symbol.rva >= rva && symbol.rva - rva < size)
+        {
+            const char* forwarder = image.RvaToString(symbol.rva);
+            if (forwarder != nullptr)
+                symbol.forwarder = forwarder;
+        }
+        return symbol;
+    };
+
+    for (DWORD i = 0; i < directory->NumberOfNames; i++)
+    {
+        WORD slot = nameOrdinals[i];
+        const char* name = image.RvaToString(names[i]);
+        if (slot >= slotCount || name == nullptr)
+        {
+            errorString = "Export name table entry is invalid.";
+            return false;
+        }
+
+        ExportSymbol symbol = makeSymbol(slot);
+        symbol.name = name;
+        if (slotSymbols[slot] == kEmpty)
+            slotSymbols[slot] = static_cast<uint32_t>(symbols.size());
+        symbols.push_back(symbol);
+    }
+
+    // Slots without a name are exported by ordinal only; zero entries are gaps in the ordinal range
+    for (DWORD slot = 0; slot < slotCount; slot++)
+    {
+        if (slotSymbols[slot] != kEmpty || functions[slot] == 0)
+            continue;
+        slotSymbols[slot] = static_cast<uint32_t>(symbols.size());
+        symbols.push_back(makeSymbol(slot));
+    }
+
+    size_t capacity = 16;
+    while (capacity < size_t(directory->NumberOfNames) * 2)
+        capacity *= 2;
+    buckets.assign(capacity, Bucket{ 0, kEmpty });
+    for (DWORD i = 0; i < directory->NumberOfNames; i++)
+        InsertName(i);
+
+    return true;
+}
+
+const ExportSymbol* ExportTable::FindByName(std::string_view name) const
+{
+    if (buckets.empty())
+        return nullptr;
+
+    uint32_t hash = Hash(name);
+    size_t mask = buckets.size() - 1;
+    for (size_t i = hash & mask; buckets[i].symbol != kEmpty; i = (i + 1) & mask)
+    {
+        if (buckets[i].hash == hash && symbols[buckets[i].symbol].name == name)
+            return &symbols[buckets[i].symbol];
+    }
+    return nullptr;
+}
+
+const ExportSymbol* ExportTable::FindByOrdinal(DWORD ordinal) const
+{
+    // Unsigned wrap sends ordinals below the base past the end as well
+    DWORD slot = ordinal - ordinalBase;
+    if (slot >= slotSymbols.size() || slotSymbols[slot] == kEmpty)
+        return nullptr;
+    return &symbols[slotSymbols[slot]];
+}
@@ -0,0 +1,61 @@
+#ifndef EXPORTTABLE_H
+#define EXPORTTABLE_H
+
+#include "PETypes.h"
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+class PEImageBase;
+
+// One exported symbol. Names and forwarders point into the mapped image.
+struct ExportSymbol
+{
+    std::string_view name;      // Empty when exported by ordinal only
+    std::string_view forwarder; // "DLL.Function" or "DLL.#ordinal" when forwarded, otherwise empty
+    DWORD ordinal;              // Biased ordinal, as used by importers
+    DWORD rva;                  // Function RVA; meaningless for forwarders
+};
+
+// Export directory with O(1) lookup by name and by ordinal.
+// Names are hashed into an open-addressing table of symbol indices, ordinals index a dense slot table,
+// so resolving thousands of imports against a system DLL never scans the export list.
+class ExportTable
+{
+public:
+    // Parse the export directory at [rva, rva + size). An image without exports yields an empty table.
+    bool Parse(const PEImageBase& image, DWORD rva, DWORD size);
+    void Clear();
+
+    // Named symbols first, in the order of the name table (sorted by the linker), then ordinal-only symbols
+    const std::vector<ExportSymbol>& GetSymbols() const { return symbols; }
+    std::string_view GetModuleName() const { return moduleName; }
+    DWORD GetOrdinalBase() const { return ordinalBase; }
+    const std::string& ErrorString() const { return errorString; }
+
+    // nullptr if no symbol has that name or ordinal
+    const ExportSymbol* FindByName(std::string_view name) const;
+    const ExportSymbol* FindByOrdinal(DWORD ordinal) const;
+
+private:
+    static constexpr uint32_t kEmpty = UINT32_MAX;
+
+    struct Bucket
+    {
+        uint32_t hash;   // Full hash, compared before touching the string
+        uint32_t symbol; // Index into symbols, kEmpty if unused
+    };
+
+    static uint32_t Hash(std::string_view name);
+    void InsertName(uint32_t symbol);
+
+    std::vector<ExportSymbol> symbols;
+    std::vector<Bucket> buckets;       // Power-of-two size, linear probing, at most half full
+    std::vector<uint32_t> slotSymbols; // Export address table slot (ordinal - base) -> symbol index or kEmpty
+    std::string_view moduleName;
+    DWORD ordinalBase = 0;
+    std::string errorString;
+};
+
+#endif // EXPORTTABLE_H
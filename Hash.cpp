@@ -0,0 +1,372 @@
+#include "Hash.h"
+#include "Simd.h"
+#include <algorithm>
+#include <cstring>
+
+static const uint64_t kPrime1 = 11400714785074694791ULL;
+static const uint64_t kPrime2 = 14029467366897019727ULL;
+static const uint64_t kPrime3 = 1609587929392839161ULL;
+static const uint64_t kPrime4 = 9650029242287828579ULL;
+static const uint64_t kPrime5 = 2870177450012600261ULL;
+
+static inline uint64_t RotateLeft(uint64_t value, int bits)
+{
+    return (value << bits) | (value >> (64 - bits));
+}
+
+// Unaligned little-endian reads; memcpy compiles to a plain load
+static inline uint64_t Read64(const unsigned char* p)
+{
+    uint64_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static inline uint32_t Read32(const unsigned char* p)
+{
+    uint32_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static inline uint64_t Round(uint64_t accumulator, uint64_t input)
+{
+    accumulator += input * kPrime2;
+    accumulator = RotateLeft(accumulator, 31);
+    return accumulator * kPrime1;
+}
+
+static inline uint64_t MergeRound(uint64_t hash, uint64_t accumulator)
+{
+    hash ^= Round(0, accumulator);
+    return hash * kPrime1 + kPrime4;
+}
+
+// Everything after the 32-byte stripes: the last few bytes, then the avalanche. hash already includes the length.
+static uint64_t FinishXXHash64(uint64_t hash, const unsigned char* p, const unsigned char* end)
+{
+    for (; p + 8 <= end; p += 8)
+    {
+        hash ^= Round(0, Read64(p));
+        hash = RotateLeft(hash, 27) * kPrime1 + kPrime4;
+    }
+    if (p + 4 <= end)
+    {
+        hash ^= static_cast<uint64_t>(Read32(p)) * kPrime1;
+        hash = RotateLeft(hash, 23) * kPrime2 + kPrime3;
+        p += 4;
+    }
+    for (; p < end; p++)
+    {
+        hash ^= (*p) * kPrime5;
+        hash = RotateLeft(hash, 11) * kPrime1;
+    }
+
+    // Final avalanche
+    hash ^= hash >> 33;
+    hash *= kPrime2;
+    hash ^= hash >> 29;
+    hash *= kPrime3;
+    hash ^= hash >> 32;
+    return hash;
+}
+
+uint64_t XXHash64(const void* data, size_t size, uint64_t seed)
+{
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    const unsigned char* end = p + size;
+    uint64_t hash;
+
+    if (size >= 32)
+    {
+        // Four independent lanes keep the multiplier pipelines full
+        uint64_t v1 = seed + kPrime1 + kPrime2;
+        uint64_t v2 = seed + kPrime2;
+        uint64_t v3 = seed;
+        uint64_t v4 = seed - kPrime1;
+        const unsigned char* limit = end - 32;
+        do
+        {
+            v1 = Round(v1, Read64(p));
+            v2 = Round(v2, Read64(p + 8));
+            v3 = Round(v3, Read64(p + 16));
+            v4 = Round(v4, Read64(p + 24));
+            p += 32;
+        } while (p <= limit);
+
+        hash = RotateLeft(v1, 1) + RotateLeft(v2, 7) + RotateLeft(v3, 12) + RotateLeft(v4, 18);
+        hash = MergeRound(hash, v1);
+        hash = MergeRound(hash, v2);
+        hash = MergeRound(hash, v3);
+        hash = MergeRound(hash, v4);
+    }
+    else
+    {
+        hash = seed + kPrime5;
+    }
+
+    hash += static_cast<uint64_t>(size);
+    return FinishXXHash64(hash, p, end);
+}
+
+XXHash64Stream::XXHash64Stream(uint64_t _seed)
+    : seed(_seed)
+{
+    lanes[0] = seed + kPrime1 + kPrime2;
+    lanes[1] = seed + kPrime2;
+    lanes[2] = seed;
+    lanes[3] = seed - kPrime1;
+}
+
+void XXHash64Stream::Update(const void* data, size_t size)
+{
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    const unsigned char* end = p + size;
+    length += size;
+
+    // Top up a partial stripe first
+    if (buffered > 0)
+    {
+        size_t take = std::min(size, sizeof(buffer) - buffered);
+        memcpy(buffer + buffered, p, take);
+        buffered += take;
+        p += take;
+        if (buffered < sizeof(buffer))
+            return;
+        for (int lane = 0; lane < 4; lane++)
+            lanes[lane] = Round(lanes[lane], Read64(buffer + 8 * lane));
+        buffered = 0;
+    }
+
+    for (; end - p >= 32; p += 32)
+    {
+        lanes[0] = Round(lanes[0], Read64(p));
+        lanes[1] = Round(lanes[1], Read64(p + 8));
+        lanes[2] = Round(lanes[2], Read64(p + 16));
+        lanes[3] = Round(lanes[3], Read64(p + 24));
+    }
+
+    memcpy(buffer, p, end - p);
+    buffered = end - p;
+}
+
+uint64_t XXHash64Stream::Final() const
+{
+    uint64_t hash;
+    if (length >= 32)
+    {
+        hash = RotateLeft(lanes[0], 1) + RotateLeft(lanes[1], 7) + RotateLeft(lanes[2], 12) + RotateLeft(lanes[3], 18);
+        for (int lane = 0; lane < 4; lane++)
+            hash = MergeRound(hash, lanes[lane]);
+    }
+    else
+    {
+        hash = seed + kPrime5;
+    }
+    hash += length;
+    return FinishXXHash64(hash, buffer, buffer + buffered);
+}
+
+// SHA-256 round constants
+alignas(16) static const uint32_t kSha256K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+typedef void (*Sha256Kernel)(uint32_t* state, const uint8_t* data, size_t blocks);
+
+static inline uint32_t RotateRight(uint32_t value, int bits)
+{
+    return (value >> bits) | (value << (32 - bits));
+}
+
+static inline uint32_t ReadBigEndian32(const uint8_t* p)
+{
+    return (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | uint32_t(p[3]);
+}
+
+static void Sha256Scalar(uint32_t* state, const uint8_t* data, size_t blocks)
+{
+    for (; blocks > 0; blocks--, data += 64)
+    {
+        uint32_t w[64];
+        for (int t = 0; t < 16; t++)
+            w[t] = ReadBigEndian32(data + t * 4);
+        for (int t = 16; t < 64; t++)
+        {
+            uint32_t s0 = RotateRight(w[t - 15], 7) ^ RotateRight(w[t - 15], 18) ^ (w[t - 15] >> 3);
+            uint32_t s1 = RotateRight(w[t - 2], 17) ^ RotateRight(w[t - 2], 19) ^ (w[t - 2] >> 10);
+            w[t] = w[t - 16] + s0 + w[t - 7] + s1;
+        }
+
+        uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+        uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+        for (int t = 0; t < 64; t++)
+        {
+            uint32_t s1 = RotateRight(e, 6) ^ RotateRight(e, 11) ^ RotateRight(e, 25);
+            uint32_t choose = (e & f) ^ (~e & g);
+            uint32_t t1 = h + s1 + choose + kSha256K[t] + w[t];
+            uint32_t s0 = RotateRight(a, 2) ^ RotateRight(a, 13) ^ RotateRight(a, 22);
+            uint32_t majority = (a & b) ^ (a & c) ^ (b & c);
+            uint32_t t2 = s0 + majority;
+            h = g;
+            g = f;
+            f = e;
+            e = d + t1;
+            d = c;
+            c = b;
+            b = a;
+            a = t1 + t2;
+        }
+        state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+        state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+    }
+}
+
+#if INSPECTOR_X86
+
+// The SHA extensions keep the state as ABEF/CDGH pairs and do two rounds per sha256rnds2
+INSPECTOR_TARGET("sha,sse4.1")
+static void Sha256Ni(uint32_t* state, const uint8_t* data, size_t blocks)
+{
+    const __m128i byteSwap = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+
+    __m128i dcba = _mm_loadu_si128(reinterpret_cast<const __m128i*>(state));
+    __m128i hgfe = _mm_loadu_si128(reinterpret_cast<const __m128i*>(state + 4));
+    __m128i cdab = _mm_shuffle_epi32(dcba, 0xB1);
+    __m128i efgh = _mm_shuffle_epi32(hgfe, 0x1B);
+    __m128i abef = _mm_alignr_epi8(cdab, efgh, 8);
+    __m128i cdgh = _mm_blend_epi16(efgh, cdab, 0xF0);
+
+    for (; blocks > 0; blocks--, data += 64)
+    {
+        __m128i abefSaved = abef;
+        __m128i cdghSaved = cdgh;
+
+        __m128i message[4];
+        for (int i = 0; i < 4; i++)
+            message[i] = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i * 16)), byteSwap);
+
+        // Group g holds the schedule words for rounds 4g..4g+3; group g + 4 is derived from groups g..g+3
+        // and replaces group g in the ring once its rounds are done
+        for (int g = 0; g < 16; g++)
+        {
+            __m128i words = message[g & 3];
+            __m128i scheduled = _mm_add_epi32(words, _mm_load_si128(reinterpret_cast<const __m128i*>(kSha256K + g * 4)));
+            cdgh = _mm_sha256rnds2_epu32(cdgh, abef, scheduled);
+            abef = _mm_sha256rnds2_epu32(abef, cdgh, _mm_shuffle_epi32(scheduled, 0x0E));
+
+            if (g < 12)
+            {
+                __m128i next = _mm_sha256msg1_epu32(words, message[(g + 1) & 3]);
+                next = _mm_add_epi32(next, _mm_alignr_epi8(message[(g + 3) & 3], message[(g + 2) & 3], 4));
+                message[g & 3] = _mm_sha256msg2_epu32(next, message[(g + 3) & 3]);
+            }
+        }
+
+        abef = _mm_add_epi32(abef, abefSaved);
+        cdgh = _mm_add_epi32(cdgh, cdghSaved);
+    }
+
+    __m128i feba = _mm_shuffle_epi32(abef, 0x1B);
+    __m128i dchg = _mm_shuffle_epi32(cdgh, 0xB1);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(state), _mm_blend_epi16(feba, dchg, 0xF0));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(state + 4), _mm_alignr_epi8(dchg, feba, 8));
+}
+
+#endif // INSPECTOR_X86
+
+struct Sha256Choice
+{
+    Sha256Kernel kernel;
+    const char* name;
+};
+
+static Sha256Choice SelectSha256()
+{
+#if INSPECTOR_X86
+    if (CpuHasSha())
+        return { Sha256Ni, "sha-ni" };
+#endif
+    return { Sha256Scalar, "scalar" };
+}
+
+static const Sha256Choice& SelectedSha256()
+{
+    static const Sha256Choice choice = SelectSha256();
+    return choice;
+}
+
+const char* Sha256::KernelName()
+{
+    return SelectedSha256().name;
+}
+
+Sha256::Sha256()
+{
+    Reset();
+}
+
+void Sha256::Reset()
+{
+    static const uint32_t initial[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+    };
+    memcpy(state, initial, sizeof(state));
+    buffered = 0;
+    length = 0;
+}
+
+void Sha256::Update(const void* data, size_t size)
+{
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    Sha256Kernel kernel = SelectedSha256().kernel;
+    length += size;
+
+    if (buffered > 0)
+    {
+        size_t take = std::min(size, sizeof(buffer) - buffered);
+        memcpy(buffer + buffered, p, take);
+        buffered += take;
+        p += take;
+        size -= take;
+        if (buffered < sizeof(buffer))
+            return;
+        kernel(state, buffer, 1);
+        buffered = 0;
+    }
+
+    // Whole blocks straight from the caller's memory
+    size_t blocks = size / 64;
+    if (blocks > 0)
+        kernel(state, p, blocks);
+    p += blocks * 64;
+    size -= blocks * 64;
+
+    memcpy(buffer, p, size);
+    buffered = size;
+}
+
+void Sha256::Final(uint8_t digest[kDigestSize])
+{
+    uint64_t bits = length * 8;
+    uint8_t padding[72] = { 0x80 };
+    size_t padLength = (buffered < 56 ? 56 : 120) - buffered;
+    for (int i = 0; i < 8; i++)
+        padding[padLength + i] = static_cast<uint8_t>(bits >> (56 - i * 8));
+    Update(padding, padLength + 8);
+
+    for (int i = 0; i < 8; i++)
+    {
+        digest[i * 4] = static_cast<uint8_t>(state[i] >> 24);
+        digest[i * 4 + 1] = static_cast<uint8_t>(state[i] >> 16);
+        digest[i * 4 + 2] = static_cast<uint8_t>(state[i] >> 8);
+        digest[i * 4 + 3] = static_cast<uint8_t>(state[i]);
+    }
+}
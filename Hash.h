@@ -0,0 +1,52 @@
+#ifndef HASH_H
+#define HASH_H
+
+#include <cstddef>
+#include <cstdint>
+
+// XXH64 (xxHash, 64-bit variant). Several GB/s per core, good enough to key caches by file content.
+// Output matches the reference implementation for the same seed.
+uint64_t XXHash64(const void* data, size_t size, uint64_t seed = 0);
+
+// The same hash fed in pieces: Final gives what XXHash64 returns for all of them back to back
+class XXHash64Stream
+{
+public:
+    explicit XXHash64Stream(uint64_t seed = 0);
+
+    void Update(const void* data, size_t size);
+    uint64_t Final() const;
+
+private:
+    uint64_t seed;
+    uint64_t lanes[4];
+    unsigned char buffer[32];
+    size_t buffered = 0;
+    uint64_t length = 0;
+};
+
+// Incremental SHA-256 (FIPS 180-4). Blocks go through the SHA-NI instructions when the CPU has them,
+// otherwise through a portable implementation; both produce the same digest.
+class Sha256
+{
+public:
+    static const size_t kDigestSize = 32;
+
+    Sha256();
+
+    void Update(const void* data, size_t size);
+    // Pads and writes the digest; the object must be reset before it is used again
+    void Final(uint8_t digest[kDigestSize]);
+    void Reset();
+
+    // "sha-ni" or "scalar"
+    static const char* KernelName();
+
+private:
+    uint32_t state[8];
+    uint8_t buffer[64];
+    size_t buffered;
+    uint64_t length;
+};
+
+#endif // HASH_H
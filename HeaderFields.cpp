@@ -0,0 +1,160 @@
+#include "HeaderFields.h"
+#include <cstring>
+
+// Field tables are generated from the structure definitions with offsetof/sizeof,
+// so they always agree with the layout the parser uses.
+
+static const HeaderField dosHeaderFields[] = {
+    { "e_magic", offsetof(IMAGE_DOS_HEADER, e_magic), sizeof(IMAGE_DOS_HEADER::e_magic), "Magic number" },
+    { "e_cblp", offsetof(IMAGE_DOS_HEADER, e_cblp), sizeof(IMAGE_DOS_HEADER::e_cblp), "Bytes on last page of file" },
+    { "e_cp", offsetof(IMAGE_DOS_HEADER, e_cp), sizeof(IMAGE_DOS_HEADER::e_cp), "Pages in file" },
+    { "e_crlc", offsetof(IMAGE_DOS_HEADER, e_crlc), sizeof(IMAGE_DOS_HEADER::e_crlc), "Relocations" },
+    { "e_cparhdr", offsetof(IMAGE_DOS_HEADER, e_cparhdr), sizeof(IMAGE_DOS_HEADER::e_cparhdr), "Size of header in paragraphs" },
+    { "e_minalloc", offsetof(IMAGE_DOS_HEADER, e_minalloc), sizeof(IMAGE_DOS_HEADER::e_minalloc), "Minimum extra paragraphs needed" },
+    { "e_maxalloc", offsetof(IMAGE_DOS_HEADER, e_maxalloc), sizeof(IMAGE_DOS_HEADER::e_maxalloc), "Maximum extra paragraphs needed" },
+    { "e_ss", offsetof(IMAGE_DOS_HEADER, e_ss), sizeof(IMAGE_DOS_HEADER::e_ss), "Initial (relative) SS value" },
+    { "e_sp", offsetof(IMAGE_DOS_HEADER, e_sp), sizeof(IMAGE_DOS_HEADER::e_sp), "Initial SP value" },
+    { "e_csum", offsetof(IMAGE_DOS_HEADER, e_csum), sizeof(IMAGE_DOS_HEADER::e_csum), "Checksum" },
+    { "e_ip", offsetof(IMAGE_DOS_HEADER, e_ip), sizeof(IMAGE_DOS_HEADER::e_ip), "Initial IP value" },
+    { "e_cs", offsetof(IMAGE_DOS_HEADER, e_cs), sizeof(IMAGE_DOS_HEADER::e_cs), "Initial (relative) CS value" },
+    { "e_lfarlc", offsetof(IMAGE_DOS_HEADER, e_lfarlc), sizeof(IMAGE_DOS_HEADER::e_lfarlc), "File address of relocation table" },
+    { "e_ovno", offsetof(IMAGE_DOS_HEADER, e_ovno), sizeof(IMAGE_DOS_HEADER::e_ovno), "Overlay number" },
+    { "e_res", offsetof(IMAGE_DOS_HEADER, e_res), sizeof(IMAGE_DOS_HEADER::e_res), "Reserved words" },
+    { "e_oemid", offsetof(IMAGE_DOS_HEADER, e_oemid), sizeof(IMAGE_DOS_HEADER::e_oemid), "OEM identifier" },
+    { "e_oeminfo", offsetof(IMAGE_DOS_HEADER, e_oeminfo), sizeof(IMAGE_DOS_HEADER::e_oeminfo), "OEM information" },
+    { "e_res2", offsetof(IMAGE_DOS_HEADER, e_res2), sizeof(IMAGE_DOS_HEADER::e_res2), "Reserved words" },
+    { "e_lfanew", offsetof(IMAGE_DOS_HEADER, e_lfanew), sizeof(IMAGE_DOS_HEADER::e_lfanew), "File address of new exe header" },
+};
+
+static const HeaderField ntHeadersFields[] = {
+    { "Signature", offsetof(IMAGE_NT_HEADERS32, Signature), sizeof(DWORD), "PE\\0\\0" },
+};
+
+static const HeaderField fileHeaderFields[] = {
+    { "Machine", offsetof(IMAGE_FILE_HEADER, Machine), sizeof(IMAGE_FILE_HEADER::Machine), "Target machine type" },
+    { "NumberOfSections", offsetof(IMAGE_FILE_HEADER, NumberOfSections), sizeof(IMAGE_FILE_HEADER::NumberOfSections), "Number of sections" },
+    { "TimeDateStamp", offsetof(IMAGE_FILE_HEADER, TimeDateStamp), sizeof(IMAGE_FILE_HEADER::TimeDateStamp), "Link time (seconds since 1970)" },
+    { "PointerToSymbolTable", offsetof(IMAGE_FILE_HEADER, PointerToSymbolTable), sizeof(IMAGE_FILE_HEADER::PointerToSymbolTable), "File offset of the COFF symbol table" },
+    { "NumberOfSymbols", offsetof(IMAGE_FILE_HEADER, NumberOfSymbols), sizeof(IMAGE_FILE_HEADER::NumberOfSymbols), "Number of COFF symbols" },
+    { "SizeOfOptionalHeader", offsetof(IMAGE_FILE_HEADER, SizeOfOptionalHeader), sizeof(IMAGE_FILE_HEADER::SizeOfOptionalHeader), "Size of the optional header" },
+    { "Characteristics", offsetof(IMAGE_FILE_HEADER, Characteristics), sizeof(IMAGE_FILE_HEADER::Characteristics), "Image flags" },
+};
+
+static const HeaderField optionalHeader32Fields[] = {
+    { "Magic", offsetof(IMAGE_OPTIONAL_HEADER32, Magic), sizeof(IMAGE_OPTIONAL_HEADER32::Magic), "PE32 (0x10b) or PE32+ (0x20b)" },
+    { "MajorLinkerVersion", offsetof(IMAGE_OPTIONAL_HEADER32, MajorLinkerVersion), sizeof(IMAGE_OPTIONAL_HEADER32::MajorLinkerVersion), "Linker major version" },
+    { "MinorLinkerVersion", offsetof(IMAGE_OPTIONAL_HEADER32, MinorLinkerVersion), sizeof(IMAGE_OPTIONAL_HEADER32::MinorLinkerVersion), "Linker minor version" },
+    { "SizeOfCode", offsetof(IMAGE_OPTIONAL_HEADER32, SizeOfCode), sizeof(IMAGE_OPTIONAL_HEADER32::SizeOfCode), "Size of all code sections" },
+    { "SizeOfInitializedData", offsetof(IMAGE_OPTIONAL_HEADER32, SizeOfInitializedData), sizeof(IMAGE_OPTIONAL_HEADER32::SizeOfInitializedData), "Size of all initialized data sections" },
+    { "SizeOfUninitializedData", offsetof(IMAGE_OPTIONAL_HEADER32, SizeOfUninitializedData), sizeof(IMAGE_OPTIONAL_HEADER32::SizeOfUninitializedData), "Size of all BSS sections" },
+    { "AddressOfEntryPoint", offsetof(IMAGE_OPTIONAL_HEADER32, AddressOfEntryPoint), sizeof(IMAGE_OPTIONAL_HEADER32::AddressOfEntryPoint), "Entry point RVA" },
+    { "BaseOfCode", offsetof(IMAGE_OPTIONAL_HEADER32, BaseOfCode), sizeof(IMAGE_OPTIONAL_HEADER32::BaseOfCode), "RVA of the start of code" },
+    { "BaseOfData", offsetof(IMAGE_OPTIONAL_HEADER32, BaseOfData), sizeof(IMAGE_OPTIONAL_HEADER32::BaseOfData), "RVA of the start of data" },
+    { "ImageBase", offsetof(IMAGE_OPTIONAL_HEADER32, ImageBase), sizeof(IMAGE_OPTIONAL_HEADER32::ImageBase), "Preferred load address" },
+    { "SectionAlignment", offsetof(IMAGE_OPTIONAL_HEADER32, SectionAlignment), sizeof(IMAGE_OPTIONAL_HEADER32::SectionAlignment), "Section alignment in memory" },
+    { "FileAlignment", offsetof(IMAGE_OPTIONAL_HEADER32, FileAlignment), sizeof(IMAGE_OPTIONAL_HEADER32::FileAlignment), "Section alignment in the file" },
+    { "MajorOperatingSystemVersion", offsetof(IMAGE_OPTIONAL_HEADER32, MajorOperatingSystemVersion), sizeof(IMAGE_OPTIONAL_HEADER32::MajorOperatingSystemVersion), "Required OS major version" },
+    { "MinorOperatingSystemVersion", offsetof(IMAGE_OPTIONAL_HEADER32, MinorOperatingSystemVersion), sizeof(IMAGE_OPTIONAL_HEADER32::MinorOperatingSystemVersion), "Required OS minor version" },
+    { "MajorImageVersion", offsetof(IMAGE_OPTIONAL_HEADER32, MajorImageVersion), sizeof(IMAGE_OPTIONAL_HEADER32::MajorImageVersion), "Image major version" },
+    { "MinorImageVersion", offsetof(IMAGE_OPTIONAL_HEADER32, MinorImageVersion), sizeof(IMAGE_OPTIONAL_HEADER32::MinorImageVersion), "Image minor version" },
+    { "MajorSubsystemVersion", offsetof(IMAGE_OPTIONAL_HEADER32, MajorSubsystemVersion), sizeof(IMAGE_OPTIONAL_HEADER32::MajorSubsystemVersion), "Subsystem major version" },
+    { "MinorSubsystemVersion", offsetof(IMAGE_OPTIONAL_HEADER32, MinorSubsystemVersion), sizeof(IMAGE_OPTIONAL_HEADER32::MinorSubsystemVersion), "Subsystem minor version" },
+    { "Win32VersionValue", offsetof(IMAGE_OPTIONAL_HEADER32, Win32VersionValue), sizeof(IMAGE_OPTIONAL_HEADER32::Win32VersionValue), "Reserved, must be zero" },
+    { "SizeOfImage", offsetof(IMAGE_OPTIONAL_HEADER32, SizeOfImage), sizeof(IMAGE_OPTIONAL_HEADER32::SizeOfImage), "Size of the image in memory" },
+    { "SizeOfHeaders", offsetof(IMAGE_OPTIONAL_HEADER32, SizeOfHeaders), sizeof(IMAGE_OPTIONAL_HEADER32::SizeOfHeaders), "Size of all headers in the file" },
+    { "CheckSum", offsetof(IMAGE_OPTIONAL_HEADER32, CheckSum), sizeof(IMAGE_OPTIONAL_HEADER32::CheckSum), "Image checksum" },
+    { "Subsystem", offsetof(IMAGE_OPTIONAL_HEADER32, Subsystem), sizeof(IMAGE_OPTIONAL_HEADER32::Subsystem), "Required subsystem" },
+    { "DllCharacteristics", offsetof(IMAGE_OPTIONAL_HEADER32, DllCharacteristics), sizeof(IMAGE_OPTIONAL_HEADER32::DllCharacteristics), "DLL flags" },
+    { "SizeOfStackReserve", offsetof(IMAGE_OPTIONAL_HEADER32, SizeOfStackReserve), sizeof(IMAGE_OPTIONAL_HEADER32::SizeOfStackReserve), "Stack reserve size" },
+    { "SizeOfStackCommit", offsetof(IMAGE_OPTIONAL_HEADER32, SizeOfStackCommit), sizeof(IMAGE_OPTIONAL_HEADER32::SizeOfStackCommit), "Stack commit size" },
+    { "SizeOfHeapReserve", offsetof(IMAGE_OPTIONAL_HEADER32, SizeOfHeapReserve), sizeof(IMAGE_OPTIONAL_HEADER32::SizeOfHeapReserve), "Heap reserve size" },
+    { "SizeOfHeapCommit", offsetof(IMAGE_OPTIONAL_HEADER32, SizeOfHeapCommit), sizeof(IMAGE_OPTIONAL_HEADER32::SizeOfHeapCommit), "Heap commit size" },
+    { "LoaderFlags", offsetof(IMAGE_OPTIONAL_HEADER32, LoaderFlags), sizeof(IMAGE_OPTIONAL_HEADER32::LoaderFlags), "Reserved, must be zero" },
+    { "NumberOfRvaAndSizes", offsetof(IMAGE_OPTIONAL_HEADER32, NumberOfRvaAndSizes), sizeof(IMAGE_OPTIONAL_HEADER32::NumberOfRvaAndSizes), "Number of data directory entries" },
+};
+
+static const HeaderField optionalHeader64Fields[] = {
+    { "Magic", offsetof(IMAGE_OPTIONAL_HEADER64, Magic), sizeof(IMAGE_OPTIONAL_HEADER64::Magic), "PE32 (0x10b) or PE32+ (0x20b)" },
+    { "MajorLinkerVersion", offsetof(IMAGE_OPTIONAL_HEADER64, MajorLinkerVersion), sizeof(IMAGE_OPTIONAL_HEADER64::MajorLinkerVersion), "Linker major version" },
+    { "MinorLinkerVersion", offsetof(IMAGE_OPTIONAL_HEADER64, MinorLinkerVersion), sizeof(IMAGE_OPTIONAL_HEADER64::MinorLinkerVersion), "Linker minor version" },
+    { "SizeOfCode", offsetof(IMAGE_OPTIONAL_HEADER64, SizeOfCode), sizeof(IMAGE_OPTIONAL_HEADER64::SizeOfCode), "Size of all code sections" },
+    { "SizeOfInitializedData", offsetof(IMAGE_OPTIONAL_HEADER64, SizeOfInitializedData), sizeof(IMAGE_OPTIONAL_HEADER64::SizeOfInitializedData), "Size of all initialized data sections" },
+    { "SizeOfUninitializedData", offsetof(IMAGE_OPTIONAL_HEADER64, SizeOfUninitializedData), sizeof(IMAGE_OPTIONAL_HEADER64::SizeOfUninitializedData), "Size of all BSS sections" },
+    { "AddressOfEntryPoint", offsetof(IMAGE_OPTIONAL_HEADER64, AddressOfEntryPoint), sizeof(IMAGE_OPTIONAL_HEADER64::AddressOfEntryPoint), "Entry point RVA" },
+    { "BaseOfCode", offsetof(IMAGE_OPTIONAL_HEADER64, BaseOfCode), sizeof(IMAGE_OPTIONAL_HEADER64::BaseOfCode), "RVA of the start of code" },
+    { "ImageBase", offsetof(IMAGE_OPTIONAL_HEADER64, ImageBase), sizeof(IMAGE_OPTIONAL_HEADER64::ImageBase), "Preferred load address" },
+    { "SectionAlignment", offsetof(IMAGE_OPTIONAL_HEADER64, SectionAlignment), sizeof(IMAGE_OPTIONAL_HEADER64::SectionAlignment), "Section alignment in memory" },
+    { "FileAlignment", offsetof(IMAGE_OPTIONAL_HEADER64, FileAlignment), sizeof(IMAGE_OPTIONAL_HEADER64::FileAlignment), "Section alignment in the file" },
+    { "MajorOperatingSystemVersion", offsetof(IMAGE_OPTIONAL_HEADER64, MajorOperatingSystemVersion), sizeof(IMAGE_OPTIONAL_HEADER64::MajorOperatingSystemVersion), "Required OS major version" },
+    { "MinorOperatingSystemVersion", offsetof(IMAGE_OPTIONAL_HEADER64, MinorOperatingSystemVersion), sizeof(IMAGE_OPTIONAL_HEADER64::MinorOperatingSystemVersion), "Required OS minor version" },
+    { "MajorImageVersion", offsetof(IMAGE_OPTIONAL_HEADER64, MajorImageVersion), sizeof(IMAGE_OPTIONAL_HEADER64::MajorImageVersion), "Image major version" },
+    { "MinorImageVersion", offsetof(IMAGE_OPTIONAL_HEADER64, MinorImageVersion), sizeof(IMAGE_OPTIONAL_HEADER64::MinorImageVersion), "Image minor version" },
+    { "MajorSubsystemVersion", offsetof(IMAGE_OPTIONAL_HEADER64, MajorSubsystemVersion), sizeof(IMAGE_OPTIONAL_HEADER64::MajorSubsystemVersion), "Subsystem major version" },
+    { "MinorSubsystemVersion", offsetof(IMAGE_OPTIONAL_HEADER64, MinorSubsystemVersion), sizeof(IMAGE_OPTIONAL_HEADER64::MinorSubsystemVersion), "Subsystem minor version" },
+    { "Win32VersionValue", offsetof(IMAGE_OPTIONAL_HEADER64, Win32VersionValue), sizeof(IMAGE_OPTIONAL_HEADER64::Win32VersionValue), "Reserved, must be zero" },
+    { "SizeOfImage", offsetof(IMAGE_OPTIONAL_HEADER64, SizeOfImage), sizeof(IMAGE_OPTIONAL_HEADER64::SizeOfImage), "Size of the image in memory" },
+    { "SizeOfHeaders", offsetof(IMAGE_OPTIONAL_HEADER64, SizeOfHeaders), sizeof(IMAGE_OPTIONAL_HEADER64::SizeOfHeaders), "Size of all headers in the file" },
+    { "CheckSum", offsetof(IMAGE_OPTIONAL_HEADER64, CheckSum), sizeof(IMAGE_OPTIONAL_HEADER64::CheckSum), "Image checksum" },
+    { "Subsystem", offsetof(IMAGE_OPTIONAL_HEADER64, Subsystem), sizeof(IMAGE_OPTIONAL_HEADER64::Subsystem), "Required subsystem" },
+    { "DllCharacteristics", offsetof(IMAGE_OPTIONAL_HEADER64, DllCharacteristics), sizeof(IMAGE_OPTIONAL_HEADER64::DllCharacteristics), "DLL flags" },
+    { "SizeOfStackReserve", offsetof(IMAGE_OPTIONAL_HEADER64, SizeOfStackReserve), sizeof(IMAGE_OPTIONAL_HEADER64::SizeOfStackReserve), "Stack reserve size" },
+    { "SizeOfStackCommit", offsetof(IMAGE_OPTIONAL_HEADER64, SizeOfStackCommit), sizeof(IMAGE_OPTIONAL_HEADER64::SizeOfStackCommit), "Stack commit size" },
+    { "SizeOfHeapReserve", offsetof(IMAGE_OPTIONAL_HEADER64, SizeOfHeapReserve), sizeof(IMAGE_OPTIONAL_HEADER64::SizeOfHeapReserve), "Heap reserve size" },
+    { "SizeOfHeapCommit", offsetof(IMAGE_OPTIONAL_HEADER64, SizeOfHeapCommit), sizeof(IMAGE_OPTIONAL_HEADER64::SizeOfHeapCommit), "Heap commit size" },
+    { "LoaderFlags", offsetof(IMAGE_OPTIONAL_HEADER64, LoaderFlags), sizeof(IMAGE_OPTIONAL_HEADER64::LoaderFlags), "Reserved, must be zero" },
+    { "NumberOfRvaAndSizes", offsetof(IMAGE_OPTIONAL_HEADER64, NumberOfRvaAndSizes), sizeof(IMAGE_OPTIONAL_HEADER64::NumberOfRvaAndSizes), "Number of data directory entries" },
+};
+
+static const HeaderField dataDirectoriesFields[] = {
+    { "Export RVA", 0 * sizeof(IMAGE_DATA_DIRECTORY) + offsetof(IMAGE_DATA_DIRECTORY, VirtualAddress), sizeof(DWORD), "Export directory address" },
+    { "Export Size", 0 * sizeof(IMAGE_DATA_DIRECTORY) + offsetof(IMAGE_DATA_DIRECTORY, Size), sizeof(DWORD), "Export directory size" },
+    { "Import RVA", 1 * sizeof(IMAGE_DATA_DIRECTORY) + offsetof(IMAGE_DATA_DIRECTORY, VirtualAddress), sizeof(DWORD), "Import directory address" },
+    { "Import Size", 1 * sizeof(IMAGE_DATA_DIRECTORY) + offsetof(IMAGE_DATA_DIRECTORY, Size), sizeof(DWORD), "Import directory size" },
+    { "Resource RVA", 2 * sizeof(IMAGE_DATA_DIRECTORY) + offsetof(IMAGE_DATA_DIRECTORY, VirtualAddress), sizeof(DWORD), "Resource directory address" },
+    { "Resource Size", 2 * sizeof(IMAGE_DATA_DIRECTORY) + offsetof(IMAGE_DATA_DIRECTORY, Size), sizeof(DWORD), "Resource directory size" },
+    { "Exception RVA", 3 * sizeof(IMAGE_DATA_DIRECTORY) + offsetof(IMAGE_DATA_DIRECTORY, VirtualAddress), sizeof(DWORD), "Exception directory address" },
+    { "Exception Size", 3 * sizeof(IMAGE_DATA_DIRECTORY) + offsetof(IMAGE_DATA_DIRECTORY, Size), sizeof(DWORD), "Exception directory size" },
+    { "Security RVA", 4 * sizeof(IMAGE_DATA_DIRECTORY) + offsetof(IMAGE_DATA_DIRECTORY, VirtualAddress), sizeof(DWORD), "Security directory address" },
+    { "Security Size", 4 * sizeof(IMAGE_DATA_DIRECTORY) + offsetof(IMAGE_DATA_DIRECTORY, Size), sizeof(DWORD), "Security directory size" },
+    { "Base Relocation RVA", 5 * sizeof(IMAGE_DATA_DIRECTORY) + offsetof(IMAGE_DATA_DIRECTORY, VirtualAddress), sizeof(DWORD), "Base Relocation directory address" },
+    { "Base Relocation Size", 5 * sizeof(IMAGE_DATA_DIRECTORY) + offsetof(IMAGE_DATA_DIRECTORY, Size), sizeof(DWORD), "Base Relocation directory size" },
+    { "Debug RVA", 6 * sizeof(IMAGE_DATA_DIRECTORY) + offsetof(IMAGE_DATA_DIRECTORY, VirtualAddress), sizeof(DWORD), "Debug directory address" },
+    { "Debug Size", 6 * sizeof(IMAGE_DATA_DIRECTORY) + offsetof(IMAGE_DATA_DIRECTORY, Size), sizeof(DWORD), "Debug directory size" },
+    { "Architecture RVA", 7 * sizeof(IMAGE_DATA_DIRECTORY) + offsetof(IMAGE_DATA_DIRECTORY, VirtualAddress), sizeof(DWORD), "Architecture directory address" },
+    { "Architecture Size", 7 * sizeof(IMAGE_DATA_DIRECTORY) + offsetof(IMAGE_DATA_DIRECTORY, Size), sizeof(DWORD), "Architecture directory size" },
+    { "Global Pointer RVA", 8 * sizeof(IMAGE_DATA_DIRECTORY) + offsetof(IMAGE_DATA_DIRECTORY, VirtualAddress), sizeof(DWORD), "Global Pointer directory address" },
+    { "Global Pointer Size", 8 * sizeof(IMAGE_DATA_DIRECTORY) + offsetof(IMAGE_DATA_DIRECTORY, Size), sizeof(DWORD), "Global Pointer directory size" },
+    { "TLS RVA", 9 * sizeof(IMAGE_DATA_DIRECTORY) + offsetof(IMAGE_DATA_DIRECTORY, VirtualAddress), sizeof(DWORD), "TLS directory address" },
+    { "TLS Size", 9 * sizeof(IMAGE_DATA_DIRECTORY) + offsetof(IMAGE_DATA_DIRECTORY, Size), sizeof(DWORD), "TLS directory size" },
+    { "Load Config RVA", 10 * sizeof(IMAGE_DATA_DIRECTORY) + offsetof(IMAGE_DATA_DIRECTORY, VirtualAddress), sizeof(DWORD), "Load Config directory address" },
+    { "Load Config Size", 10 * sizeof(IMAGE_DATA_DIRECTORY) + offsetof(IMAGE_DATA_DIRECTORY, Size), sizeof(DWORD), "Load Config directory size" },
+    { "Bound Import RVA", 11 * sizeof(IMAGE_DATA_DIRECTORY) + offsetof(IMAGE_DATA_DIRECTORY, VirtualAddress), sizeof(DWORD), "Bound Import directory address" },
+    { "Bound Import Size", 11 * sizeof(IMAGE_DATA_DIRECTORY) + offsetof(IMAGE_DATA_DIRECTORY, Size), sizeof(DWORD), "Bound Import directory size" },
+    { "IAT RVA", 12 * sizeof(IMAGE_DATA_DIRECTORY) + offsetof(IMAGE_DATA_DIRECTORY, VirtualAddress), sizeof(DWORD), "IAT directory address" },
+    { "IAT Size", 12 * sizeof(IMAGE_DATA_DIRECTORY) + offsetof(IMAGE_DATA_DIRECTORY, Size), sizeof(DWORD), "IAT directory size" },
+    { "Delay Import RVA", 13 * sizeof(IMAGE_DATA_DIRECTORY) + offsetof(IMAGE_DATA_DIRECTORY, VirtualAddress), sizeof(DWORD), "Delay Import directory address" },
+    { "Delay Import Size", 13 * sizeof(IMAGE_DATA_DIRECTORY) + offsetof(IMAGE_DATA_DIRECTORY, Size), sizeof(DWORD), "Delay Import directory size" },
+    { "COM Descriptor RVA", 14 * sizeof(IMAGE_DATA_DIRECTORY) + offsetof(IMAGE_DATA_DIRECTORY, VirtualAddress), sizeof(DWORD), "COM Descriptor directory address" },
+    { "COM Descriptor Size", 14 * sizeof(IMAGE_DATA_DIRECTORY) + offsetof(IMAGE_DATA_DIRECTORY, Size), sizeof(DWORD), "COM Descriptor directory size" },
+    { "Reserved RVA", 15 * sizeof(IMAGE_DATA_DIRECTORY) + offsetof(IMAGE_DATA_DIRECTORY, VirtualAddress), sizeof(DWORD), "Reserved directory address" },
+    { "Reserved Size", 15 * sizeof(IMAGE_DATA_DIRECTORY) + offsetof(IMAGE_DATA_DIRECTORY, Size), sizeof(DWORD), "Reserved directory size" },
+};
+
+#define LAYOUT(fields) { fields, sizeof(fields) / sizeof(fields[0]) }
+
+const HeaderLayout dosHeaderLayout = LAYOUT(dosHeaderFields);
+const HeaderLayout ntHeadersLayout = LAYOUT(ntHeadersFields);
+const HeaderLayout fileHeaderLayout = LAYOUT(fileHeaderFields);
+const HeaderLayout optionalHeader32Layout = LAYOUT(optionalHeader32Fields);
+const HeaderLayout optionalHeader64Layout = LAYOUT(optionalHeader64Fields);
+const HeaderLayout dataDirectoriesLayout = LAYOUT(dataDirectoriesFields);
+
+#undef LAYOUT
+
+ULONGLONG ReadHeaderField(const BYTE* structure, const HeaderField& field)
+{
+    // Arrays such as e_res are shown by their first 8 bytes
+    ULONGLONG value = 0;
+    memcpy(&value, structure + field.offset, field.size < sizeof(value) ? field.size : sizeof(value));
+    return value;
+}
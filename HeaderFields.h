@@ -0,0 +1,33 @@
+#ifndef HEADERFIELDS_H
+#define HEADERFIELDS_H
+
+#include "PETypes.h"
+#include <cstddef>
+
+// Name, position and meaning of every field in a PE header structure.
+// Views read values straight out of the mapped image using these offsets instead of copying headers.
+struct HeaderField
+{
+    const char* name;
+    DWORD offset; // Offset from the start of the structure
+    DWORD size;
+    const char* description;
+};
+
+struct HeaderLayout
+{
+    const HeaderField* fields;
+    size_t count;
+};
+
+extern const HeaderLayout dosHeaderLayout;
+extern const HeaderLayout ntHeadersLayout;       // Signature only, the rest has its own layouts
+extern const HeaderLayout fileHeaderLayout;
+extern const HeaderLayout optionalHeader32Layout; // Without the data directory array
+extern const HeaderLayout optionalHeader64Layout;
+extern const HeaderLayout dataDirectoriesLayout;  // Relative to the start of the DataDirectory array
+
+// Read a little-endian field of up to 8 bytes
+ULONGLONG ReadHeaderField(const BYTE* structure, const HeaderField& field);
+
+#endif // HEADERFIELDS_H
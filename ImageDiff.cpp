@@ -0,0 +1,446 @@
+#include "ImageDiff.h"
+#include "PEImage.h"
+#include "Simd.h"
+#include "Trace.h"
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstring>
+#include <thread>
+
+bool ImageDiff::Identical() const
+{
+    if (!fields.empty())
+        return false;
+    for (const SectionDiff& section : sections)
+    {
+        if (section.status != DiffStatus::Same)
+            return false;
+    }
+    return true;
+}
+
+// Header structures located in one image, compared with the field tables the header views use
+struct HeaderBlock
+{
+    const char* name;
+    const BYTE* structure;
+    size_t offset; // File offset of the structure
+    const HeaderLayout* layout;
+};
+
+static void LocateHeaders(const PEImageBase& image, HeaderBlock blocks[4])
+{
+    const BYTE* base = reinterpret_cast<const BYTE*>(image.GetImageBase());
+    const BYTE* fileHeader = reinterpret_cast<const BYTE*>(image.GetFileHeader());
+    const BYTE* optionalHeader = fileHeader + sizeof(IMAGE_FILE_HEADER);
+    WORD magic;
+    memcpy(&magic, optionalHeader, sizeof(magic));
+    bool wide = magic == IMAGE_NT_OPTIONAL_HDR64_MAGIC;
+    size_t directories = static_cast<size_t>(optionalHeader - base) +
+        (wide ? offsetof(IMAGE_OPTIONAL_HEADER64, DataDirectory) : offsetof(IMAGE_OPTIONAL_HEADER32, DataDirectory));
+
+    blocks[0] = { "DOS header", base, 0, &dosHeaderLayout };
+    blocks[1] = { "File header", fileHeader, static_cast<size_t>(fileHeader - base), &fileHeaderLayout };
+    blocks[2] = { "Optional header", optionalHeader, static_cast<size_t>(optionalHeader - base), wide ? &optionalHeader64Layout : &optionalHeader32Layout };
+    // The parser's copy, with entries past NumberOfRvaAndSizes zeroed, so a shorter array compares as empty entries
+    blocks[3] = { "Data directories", reinterpret_cast<const BYTE*>(&image.GetDataDirectory(0)), directories, &dataDirectoriesLayout };
+}
+
+static void DiffHeaders(const PEImageBase& oldImage, const PEImageBase& newImage, std::vector<FieldDiff>& fields)
+{
+    HeaderBlock oldBlocks[4];
+    HeaderBlock newBlocks[4];
+    LocateHeaders(oldImage, oldBlocks);
+    LocateHeaders(newImage, newBlocks);
+
+    for (int b = 0; b < 4; b++)
+    {
+        // Fields are paired by name: a PE32 and a PE32+ optional header share most fields at different offsets
+        const HeaderLayout& oldLayout = *oldBlocks[b].layout;
+        const HeaderLayout& newLayout = *newBlocks[b].layout;
+        for (size_t i = 0; i < newLayout.count; i++)
+        {
+            const HeaderField& field = newLayout.fields[i];
+            const HeaderField* oldField = nullptr;
+            for (size_t k = 0; k < oldLayout.count && oldField == nullptr; k++)
+            {
+                if (strcmp(oldLayout.fields[k].name, field.name) == 0)
+                    oldField = &oldLayout.fields[k];
+            }
+            if (oldField == nullptr)
+                continue;
+
+            ULONGLONG oldValue = ReadHeaderField(oldBlocks[b].structure, *oldField);
+            ULONGLONG newValue = ReadHeaderField(newBlocks[b].structure, field);
+            if (oldValue != newValue)
+                fields.push_back({ newBlocks[b].name, &field, oldValue, newValue, oldBlocks[b].offset + oldField->offset, newBlocks[b].offset + field.offset });
+        }
+    }
+}
+
+// Block index over the old data: one entry per distinct hash of an aligned block, behind a bitmap
+// that rejects most of the per-byte lookups of the scan before they touch the table
+class BlockIndex
+{
+public:
+    BlockIndex(const BYTE* data, size_t size, size_t blockSize)
+    {
+        size_t blocks = size / blockSize;
+        tableBits = 4;
+        while ((size_t(1) << tableBits) < blocks + blocks / 2)
+            tableBits++;
+        filterBits = tableBits + 3;
+        table.assign(size_t(1) << tableBits, Entry{ 0, kEmpty });
+        filter.assign((size_t(1) << filterBits) / 64, 0);
+
+        for (size_t k = 0; k < blocks; k++)
+        {
+            uint64_t mixed = Mix(HashBlock(data + k * blockSize, blockSize));
+            filter[(mixed >> (64 - filterBits)) / 64] |= uint64_t(1) << ((mixed >> (64 - filterBits)) % 64);
+
+            // The first block with a hash wins; repeats (zero fill, padding) add nothing to the scan
+            for (size_t slot = mixed >> (64 - tableBits); ; slot = (slot + 1) & (table.size() - 1))
+            {
+                if (table[slot].block == kEmpty)
+                {
+                    table[slot] = { static_cast<uint32_t>(mixed), static_cast<uint32_t>(k) };
+                    break;
+                }
+                if (table[slot].tag == static_cast<uint32_t>(mixed))
+                    break;
+            }
+        }
+    }
+
+    // Block whose hash is hash; the caller still compares the bytes
+    bool Find(uint64_t hash, size_t& block) const
+    {
+        uint64_t mixed = Mix(hash);
+        size_t bit = mixed >> (64 - filterBits);
+        if ((filter[bit / 64] & (uint64_t(1) << (bit % 64))) == 0)
+            return false;
+        for (size_t slot = mixed >> (64 - tableBits); table[slot].block != kEmpty; slot = (slot + 1) & (table.size() - 1))
+        {
+            if (table[slot].tag == static_cast<uint32_t>(mixed))
+            {
+                block = table[slot].block;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Polynomial hash, rolled one byte at a time: h = sum of byte[i] * kBase^(blockSize - 1 - i)
+    static uint64_t HashBlock(const BYTE* data, size_t size)
+    {
+        uint64_t hash = 0;
+        for (size_t i = 0; i < size; i++)
+            hash = hash * kBase + data[i];
+        return hash;
+    }
+
+    static const uint64_t kBase = 0x100000001B3ull;
+
+private:
+    struct Entry
+    {
+        uint32_t tag; // Low half of the mixed hash
+        uint32_t block;
+    };
+
+    static const uint32_t kEmpty = UINT32_MAX;
+
+    // The polynomial's low bits only depend on the low bits of the input; indices come from the mixed high bits
+    static uint64_t Mix(uint64_t hash)
+    {
+        hash ^= hash >> 29;
+        return hash * 0x9E3779B97F4A7C15ull;
+    }
+
+    unsigned tableBits;
+    unsigned filterBits;
+    std::vector<Entry> table;
+    std::vector<uint64_t> filter;
+};
+
+// Bytes equal from the start of both ranges
+static size_t CommonPrefix(const BYTE* a, const BYTE* b, size_t limit)
+{
+    size_t n = 0;
+    for (; n + 8 <= limit; n += 8)
+    {
+        uint64_t x, y;
+        memcpy(&x, a + n, sizeof(x));
+        memcpy(&y, b + n, sizeof(y));
+        if (x != y)
+            return n + CountTrailingZeros(x ^ y) / 8;
+    }
+    while (n < limit && a[n] == b[n])
+        n++;
+    return n;
+}
+
+// Bytes equal backwards from aEnd and bEnd
+static size_t CommonSuffix(const BYTE* aEnd, const BYTE* bEnd, size_t limit)
+{
+    size_t n = 0;
+    for (; n + 8 <= limit; n += 8)
+    {
+        uint64_t x, y;
+        memcpy(&x, aEnd - n - 8, sizeof(x));
+        memcpy(&y, bEnd - n - 8, sizeof(y));
+        if (x != y)
+            break;
+    }
+    while (n < limit && aEnd[-1 - static_cast<ptrdiff_t>(n)] == bEnd[-1 - static_cast<ptrdiff_t>(n)])
+        n++;
+    return n;
+}
+
+struct Match
+{
+    size_t oldPosition;
+    size_t newPosition;
+    size_t length;
+};
+
+// Runs of new bytes found in the old data, in new order
+static std::vector<Match> FindMatches(const BYTE* oldData, size_t oldSize, const BYTE* newData, size_t newSize, size_t blockSize)
+{
+    std::vector<Match> matches;
+
+    // Common head and tail first: unchanged sections and in-place patches cost a couple of memcmp passes
+    size_t prefix = CommonPrefix(oldData, newData, std::min(oldSize, newSize));
+    size_t suffix = CommonSuffix(oldData + oldSize, newData + newSize, std::min(oldSize, newSize) - prefix);
+    if (prefix > 0)
+        matches.push_back({ 0, 0, prefix });
+
+    size_t newEnd = newSize - suffix;
+    size_t position = prefix;
+    if (oldSize >= blockSize && newEnd - position >= blockSize)
+    {
+        BlockIndex index(oldData, oldSize, blockSize);
+        uint64_t outFactor = 1;
+        for (size_t i = 1; i < blockSize; i++)
+            outFactor *= BlockIndex::kBase;
+
+        size_t gapStart = position;
+        bool hashValid = false;
+        uint64_t hash = 0;
+        while (position + blockSize <= newEnd)
+        {
+            if (!hashValid)
+            {
+                hash = BlockIndex::HashBlock(newData + position, blockSize);
+                hashValid = true;
+            }
+
+            size_t block;
+            if (index.Find(hash, block) && memcmp(oldData + block * blockSize, newData + position, blockSize) == 0)
+            {
+                // Grow back over the unmatched gap, then forward as far as the bytes agree
+                Match match = { block * blockSize, position, blockSize };
+                size_t back = CommonSuffix(oldData + match.oldPosition, newData + match.newPosition,
+                                           std::min(match.oldPosition, match.newPosition - gapStart));
+                match.oldPosition -= back;
+                match.newPosition -= back;
+                match.length += back;
+                match.length += CommonPrefix(oldData + match.oldPosition + match.length, newData + match.newPosition + match.length,
+                                             std::min(oldSize - match.oldPosition, newEnd - match.newPosition) - match.length);
+                matches.push_back(match);
+
+                position = match.newPosition + match.length;
+                gapStart = position;
+                hashValid = false;
+                continue;
+            }
+
+            if (position + blockSize == newEnd)
+                break;
+            hash = (hash - newData[position] * outFactor) * BlockIndex::kBase + newData[position + blockSize];
+            position++;
+        }
+    }
+
+    if (suffix > 0)
+        matches.push_back({ oldSize - suffix, newEnd, suffix });
+    return matches;
+}
+
+// Gaps between matches, on both sides, become the changes
+static void DiffContents(const BYTE* oldFile, const BYTE* newFile, SectionDiff& section, size_t blockSize)
+{
+    std::vector<Match> matches = FindMatches(oldFile + section.oldOffset, section.oldSize, newFile + section.newOffset, section.newSize, blockSize);
+    matches.push_back({ section.oldSize, section.newSize, 0 });
+
+    size_t oldCursor = 0;
+    size_t newCursor = 0;
+    for (const Match& match : matches)
+    {
+        // A match behind the old cursor is moved data; it leaves no old gap of its own
+        size_t oldGap = match.oldPosition > oldCursor ? match.oldPosition - oldCursor : 0;
+        size_t newGap = match.newPosition - newCursor;
+        if (oldGap > 0 || newGap > 0)
+        {
+            section.changes.push_back({ section.oldOffset + oldCursor, oldGap, section.newOffset + newCursor, newGap });
+            section.changedBytes += std::max(oldGap, newGap);
+        }
+        oldCursor = std::max(oldCursor, match.oldPosition + match.length);
+        newCursor = match.newPosition + match.length;
+    }
+}
+
+static std::string SectionName(const IMAGE_SECTION_HEADER& section)
+{
+    // Section names are 8 bytes and not NUL-terminated when all 8 are used
+    const char* name = reinterpret_cast<const char*>(section.Name);
+    return std::string(name, strnlen(name, IMAGE_SIZEOF_SHORT_NAME));
+}
+
+// End of the last section's raw data; anything after it is overlay
+static size_t OverlayOffset(const PEImageBase& image)
+{
+    size_t end = 0;
+    for (const IMAGE_SECTION_HEADER& section : image.GetSections())
+    {
+        size_t offset, size;
+        if (SectionRawRange(section, image.GetImageSize(), offset, size))
+            end = std::max(end, offset + size);
+    }
+    return end;
+}
+
+ImageDiff DiffImages(const PEImageBase& oldImage, const PEImageBase& newImage, const DiffOptions& options)
+{
+    TRACE_SCOPE("DiffImages");
+    TRACE_COUNT(Bytes, oldImage.GetImageSize() + newImage.GetImageSize());
+    ImageDiff diff;
+    DiffHeaders(oldImage, newImage, diff.fields);
+
+    // Pair sections by name and characteristics, then by name alone; the rest were added or removed
+    const std::vector<IMAGE_SECTION_HEADER>& oldSections = oldImage.GetSections();
+    const std::vector<IMAGE_SECTION_HEADER>& newSections = newImage.GetSections();
+    std::vector<int> pairedWith(newSections.size(), -1);
+    std::vector<bool> oldPaired(oldSections.size(), false);
+    for (int pass = 0; pass < 2; pass++)
+    {
+        for (size_t n = 0; n < newSections.size(); n++)
+        {
+            for (size_t o = 0; o < oldSections.size() && pairedWith[n] < 0; o++)
+            {
+                if (oldPaired[o] || memcmp(oldSections[o].Name, newSections[n].Name, IMAGE_SIZEOF_SHORT_NAME) != 0)
+                    continue;
+                if (pass == 0 && oldSections[o].Characteristics != newSections[n].Characteristics)
+                    continue;
+                pairedWith[n] = static_cast<int>(o);
+                oldPaired[o] = true;
+            }
+        }
+    }
+
+    size_t oldFileSize = oldImage.GetImageSize();
+    size_t newFileSize = newImage.GetImageSize();
+    for (size_t n = 0; n < newSections.size(); n++)
+    {
+        SectionDiff section;
+        section.name = SectionName(newSections[n]);
+        section.newIndex = static_cast<int>(n);
+        size_t offset, size;
+        if (SectionRawRange(newSections[n], newFileSize, offset, size))
+        {
+            section.newOffset = offset;
+            section.newSize = size;
+        }
+        if (pairedWith[n] >= 0)
+        {
+            const IMAGE_SECTION_HEADER& old = oldSections[pairedWith[n]];
+            section.oldIndex = pairedWith[n];
+            section.headerChanged = memcmp(&old, &newSections[n], sizeof(IMAGE_SECTION_HEADER)) != 0;
+            if (SectionRawRange(old, oldFileSize, offset, size))
+            {
+                section.oldOffset = offset;
+                section.oldSize = size;
+            }
+        }
+        diff.sections.push_back(section);
+    }
+    for (size_t o = 0; o < oldSections.size(); o++)
+    {
+        if (oldPaired[o])
+            continue;
+        SectionDiff section;
+        section.name = SectionName(oldSections[o]);
+        section.oldIndex = static_cast<int>(o);
+        size_t offset, size;
+        if (SectionRawRange(oldSections[o], oldFileSize, offset, size))
+        {
+            section.oldOffset = offset;
+            section.oldSize = size;
+        }
+        diff.sections.push_back(section);
+    }
+
+    size_t oldOverlay = OverlayOffset(oldImage);
+    size_t newOverlay = OverlayOffset(newImage);
+    if (oldOverlay < oldFileSize || newOverlay < newFileSize)
+    {
+        SectionDiff overlay;
+        overlay.name = "overlay";
+        overlay.overlay = true;
+        overlay.oldOffset = std::min(oldOverlay, oldFileSize);
+        overlay.oldSize = oldFileSize - overlay.oldOffset;
+        overlay.newOffset = std::min(newOverlay, newFileSize);
+        overlay.newSize = newFileSize - overlay.newOffset;
+        diff.sections.push_back(overlay);
+    }
+
+    // Largest sections first, so one big .text does not start last and leave the other threads idle
+    std::vector<size_t> order(diff.sections.size());
+    for (size_t i = 0; i < order.size(); i++)
+        order[i] = i;
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b)
+    {
+        return std::max(diff.sections[a].oldSize, diff.sections[a].newSize) > std::max(diff.sections[b].oldSize, diff.sections[b].newSize);
+    });
+
+    unsigned threads = options.threads;
+    if (threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    threads = unsigned(std::min<size_t>(threads, std::max<size_t>(order.size(), 1)));
+
+    const BYTE* oldFile = reinterpret_cast<const BYTE*>(oldImage.GetImageBase());
+    const BYTE* newFile = reinterpret_cast<const BYTE*>(newImage.GetImageBase());
+    size_t blockSize = std::max<size_t>(options.blockSize, 16);
+    std::atomic<size_t> next(0);
+    auto work = [&]()
+    {
+        for (size_t i = next++; i < order.size(); i = next++)
+        {
+            SectionDiff& section = diff.sections[order[i]];
+            bool hasOld = section.oldIndex >= 0 || (section.overlay && section.oldSize > 0);
+            bool hasNew = section.newIndex >= 0 || (section.overlay && section.newSize > 0);
+            if (hasOld && hasNew)
+            {
+                DiffContents(oldFile, newFile, section, blockSize);
+                section.status = section.changes.empty() && !section.headerChanged ? DiffStatus::Same : DiffStatus::Changed;
+            }
+            else
+            {
+                section.status = hasNew ? DiffStatus::Added : DiffStatus::Removed;
+                section.changedBytes = std::max(section.oldSize, section.newSize);
+                if (section.changedBytes > 0)
+                    section.changes.push_back({ section.oldOffset, section.oldSize, section.newOffset, section.newSize });
+            }
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (unsigned t = 1; t < threads; t++)
+        workers.emplace_back(work);
+    work();
+    for (std::thread& worker : workers)
+        worker.join();
+
+    return diff;
+}
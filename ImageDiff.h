@@ -0,0 +1,78 @@
+#ifndef IMAGEDIFF_H
+#define IMAGEDIFF_H
+
+#include "HeaderFields.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class PEImageBase;
+
+// A header field whose value differs between the two images
+struct FieldDiff
+{
+    const char* structure; // "DOS header", "File header", "Optional header" or "Data directories"
+    const HeaderField* field;
+    ULONGLONG oldValue;
+    ULONGLONG newValue;
+    size_t oldOffset; // File offsets of the field in each image
+    size_t newOffset;
+};
+
+// Bytes that differ: [oldOffset, oldOffset + oldSize) in the old file was replaced by
+// [newOffset, newOffset + newSize) in the new one. Either size may be 0 for a pure insertion or deletion.
+struct DiffRange
+{
+    uint64_t oldOffset;
+    uint64_t oldSize;
+    uint64_t newOffset;
+    uint64_t newSize;
+};
+
+enum class DiffStatus
+{
+    Same,
+    Changed,
+    Added,   // Only in the new image
+    Removed  // Only in the old image
+};
+
+// One section, matched across the images by name and characteristics, or the overlay after the last section
+struct SectionDiff
+{
+    std::string name;
+    bool overlay = false;
+    int oldIndex = -1; // Section table indices, -1 on the side the section is missing from (and for the overlay)
+    int newIndex = -1;
+    DiffStatus status = DiffStatus::Same;
+    bool headerChanged = false; // Any section header field differs
+    uint64_t oldOffset = 0;     // Raw data compared on each side
+    uint64_t oldSize = 0;
+    uint64_t newOffset = 0;
+    uint64_t newSize = 0;
+    std::vector<DiffRange> changes; // In new file order
+    uint64_t changedBytes = 0;      // Sum of the larger side of every change
+};
+
+struct DiffOptions
+{
+    size_t blockSize = 256; // Granularity of the rolling-hash index; matches are then extended byte by byte
+    unsigned threads = 0;   // 0 = hardware concurrency
+};
+
+struct ImageDiff
+{
+    std::vector<FieldDiff> fields;
+    std::vector<SectionDiff> sections;
+
+    bool Identical() const;
+};
+
+// Compare two images parsed up to ParseSections; they may differ in width.
+// Section contents are compared the way rsync does: the old section's fixed-size blocks are indexed by a rolling
+// hash, the new section is scanned with the same hash one byte at a time, and every hit is verified and grown in
+// both directions to the exact bytes that agree. Whatever no match covers is a change, so inserted or moved code
+// does not turn the rest of the section into a difference. Sections are compared in parallel.
+ImageDiff DiffImages(const PEImageBase& oldImage, const PEImageBase& newImage, const DiffOptions& options = DiffOptions());
+
+#endif // IMAGEDIFF_H
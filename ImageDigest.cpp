@@ -0,0 +1,439 @@
+#include "ImageDigest.h"
+#include "PEImage.h"
+#include "Simd.h"
+#include "Trace.h"
+#include <algorithm>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+// Sum of the little-endian 16-bit words in [data, data + size); size is even.
+// The ones' complement fold happens once at the end, so kernels only need exact wide sums.
+typedef uint64_t (*WordSumKernel)(const BYTE* data, size_t size);
+
+static uint64_t WordSumScalar(const BYTE* data, size_t size)
+{
+    uint64_t sum = 0;
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8)
+    {
+        uint64_t v;
+        memcpy(&v, data + i, sizeof(v));
+        sum += (v & 0xFFFF) + ((v >> 16) & 0xFFFF) + ((v >> 32) & 0xFFFF) + (v >> 48);
+    }
+    for (; i < size; i += 2)
+        sum += data[i] | (data[i + 1] << 8);
+    return sum;
+}
+
+#if INSPECTOR_X86 && INSPECTOR_X86_64
+
+// 32-bit lanes gain at most 2 * 0xFFFF per step, so they are widened into 64-bit lanes well before they can wrap
+static const size_t kStepsPerFlush = 16384;
+
+INSPECTOR_TARGET("sse2")
+static uint64_t WordSumSse2(const BYTE* data, size_t size)
+{
+    const __m128i lowWords = _mm_set1_epi32(0xFFFF);
+    __m128i total = _mm_setzero_si128();
+    size_t i = 0;
+    while (i + 16 <= size)
+    {
+        __m128i lanes = _mm_setzero_si128();
+        size_t steps = std::min(kStepsPerFlush, (size - i) / 16);
+        for (size_t s = 0; s < steps; s++, i += 16)
+        {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+            lanes = _mm_add_epi32(lanes, _mm_add_epi32(_mm_and_si128(v, lowWords), _mm_srli_epi32(v, 16)));
+        }
+        total = _mm_add_epi64(total, _mm_unpacklo_epi32(lanes, _mm_setzero_si128()));
+        total = _mm_add_epi64(total, _mm_unpackhi_epi32(lanes, _mm_setzero_si128()));
+    }
+    uint64_t sum = uint64_t(_mm_cvtsi128_si64(total)) + uint64_t(_mm_cvtsi128_si64(_mm_unpackhi_epi64(total, total)));
+    return sum + WordSumScalar(data + i, size - i);
+}
+
+INSPECTOR_TARGET("avx2")
+static uint64_t WordSumAvx2(const BYTE* data, size_t size)
+{
+    const __m256i lowWords = _mm256_set1_epi32(0xFFFF);
+    __m256i total = _mm256_setzero_si256();
+    size_t i = 0;
+    while (i + 32 <= size)
+    {
+        __m256i lanes = _mm256_setzero_si256();
+        size_t steps = std::min(kStepsPerFlush, (size - i) / 32);
+        for (size_t s = 0; s < steps; s++, i += 32)
+        {
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+            lanes = _mm256_add_epi32(lanes, _mm256_add_epi32(_mm256_and_si256(v, lowWords), _mm256_srli_epi32(v, 16)));
+        }
+        total = _mm256_add_epi64(total, _mm256_unpacklo_epi32(lanes, _mm256_setzero_si256()));
+        total = _mm256_add_epi64(total, _mm256_unpackhi_epi32(lanes, _mm256_setzero_si256()));
+    }
+    __m128i half = _mm_add_epi64(_mm256_castsi256_si128(total), _mm256_extracti128_si256(total, 1));
+    uint64_t sum = uint64_t(_mm_cvtsi128_si64(half)) + uint64_t(_mm_cvtsi128_si64(_mm_unpackhi_epi64(half, half)));
+    return sum + WordSumScalar(data + i, size - i);
+}
+
+#endif // INSPECTOR_X86 && INSPECTOR_X86_64
+
+struct WordSumChoice
+{
+    WordSumKernel kernel;
+    const char* name;
+};
+
+static WordSumChoice SelectWordSum()
+{
+#if INSPECTOR_X86 && INSPECTOR_X86_64
+    if (CpuHasAvx2())
+        return { WordSumAvx2, "avx2" };
+    if (CpuHasSse2())
+        return { WordSumSse2, "sse2" };
+#endif
+    return { WordSumScalar, "scalar" };
+}
+
+static const WordSumChoice& WordSum()
+{
+    static const WordSumChoice choice = SelectWordSum();
+    return choice;
+}
+
+const char* ChecksumKernelName()
+{
+    return WordSum().name;
+}
+
+// Chunks arrive in file order and every chunk but the last has an even size, so words never straddle two chunks
+class ChecksumAccumulator
+{
+public:
+    void Add(const BYTE* data, size_t size)
+    {
+        size_t even = size & ~size_t(1);
+        sum += WordSum().kernel(data, even);
+        if (even != size)
+            sum += data[even]; // A trailing odd byte counts as a word with a zero high byte
+    }
+
+    DWORD Finish(const DigestLayout& layout) const
+    {
+        // The sum is exact, so the checksum field's own bytes can simply be taken back out
+        uint64_t result = sum;
+        for (size_t k = 0; k < sizeof(DWORD); k++)
+        {
+            uint64_t byte = (layout.storedChecksum >> (8 * k)) & 0xFF;
+            result -= byte << (8 * ((layout.checksumOffset + k) & 1));
+        }
+
+        while (result >> 16)
+            result = (result & 0xFFFF) + (result >> 16);
+        return static_cast<DWORD>(result + layout.fileSize);
+    }
+
+private:
+    uint64_t sum = 0;
+};
+
+// SHA-256 over everything except the three ranges Authenticode leaves out
+class AuthenticodeHasher
+{
+public:
+    explicit AuthenticodeHasher(const DigestLayout& layout)
+    {
+        excluded[count++] = { layout.checksumOffset, layout.checksumOffset + sizeof(DWORD) };
+        if (layout.hasCertificateEntry)
+            excluded[count++] = { layout.certificateEntryOffset, layout.certificateEntryOffset + sizeof(IMAGE_DATA_DIRECTORY) };
+        if (layout.certificateSize > 0)
+            excluded[count++] = { layout.certificateOffset, layout.certificateOffset + layout.certificateSize };
+        std::sort(excluded, excluded + count, [](const Range& a, const Range& b) { return a.begin < b.begin; });
+    }
+
+    // [data, data + size) is the file at position
+    void Add(const BYTE* data, size_t position, size_t size)
+    {
+        size_t end = position + size;
+        size_t cursor = position;
+        for (size_t i = 0; i < count && cursor < end; i++)
+        {
+            if (excluded[i].end <= cursor || excluded[i].begin >= end)
+                continue;
+            if (excluded[i].begin > cursor)
+                sha.Update(data + (cursor - position), excluded[i].begin - cursor);
+            cursor = std::max(cursor, std::min(excluded[i].end, end));
+        }
+        if (cursor < end)
+            sha.Update(data + (cursor - position), end - cursor);
+    }
+
+    void Finish(uint8_t* digest) { sha.Final(digest); }
+
+private:
+    struct Range
+    {
+        size_t begin;
+        size_t end;
+    };
+
+    Range excluded[3];
+    size_t count = 0;
+    Sha256 sha;
+};
+
+template <typename Image>
+DigestLayout GetDigestLayout(const Image& image)
+{
+    const BYTE* base = reinterpret_cast<const BYTE*>(image.GetImageBase());
+    const typename Image::OptionalHeader* optionalHeader = image.GetOptionalHeader();
+
+    DigestLayout layout;
+    layout.fileSize = image.GetImageSize();
+    layout.checksumOffset = reinterpret_cast<const BYTE*>(&optionalHeader->CheckSum) - base;
+    layout.storedChecksum = optionalHeader->CheckSum;
+
+    // Without the entry there is nothing to skip and no certificate table either
+    if (optionalHeader->NumberOfRvaAndSizes > IMAGE_DIRECTORY_ENTRY_SECURITY)
+    {
+        layout.hasCertificateEntry = true;
+        layout.certificateEntryOffset = reinterpret_cast<const BYTE*>(&optionalHeader->DataDirectory[IMAGE_DIRECTORY_ENTRY_SECURITY]) - base;
+
+        const IMAGE_DATA_DIRECTORY& security = image.GetDataDirectory(IMAGE_DIRECTORY_ENTRY_SECURITY);
+        if (security.VirtualAddress != 0 && security.Size != 0 && security.VirtualAddress < layout.fileSize)
+        {
+            layout.certificateOffset = security.VirtualAddress;
+            layout.certificateSize = std::min<size_t>(security.Size, layout.fileSize - security.VirtualAddress);
+        }
+    }
+    return layout;
+}
+
+template DigestLayout GetDigestLayout<PE32>(const PE32& image);
+template DigestLayout GetDigestLayout<PE64>(const PE64& image);
+
+static void StartDigest(const DigestLayout& layout, ImageDigest& digest)
+{
+    digest = ImageDigest();
+    digest.storedChecksum = layout.storedChecksum;
+    digest.hasCertificate = layout.certificateSize > 0;
+}
+
+void ComputeImageDigest(const BYTE* data, const DigestLayout& layout, ImageDigest& digest)
+{
+    TRACE_SCOPE("ComputeImageDigest");
+    TRACE_COUNT(Bytes, layout.fileSize);
+    StartDigest(layout, digest);
+
+    // Both passes walk the same cache-sized block before moving on, so the file is read from memory once
+    const size_t kBlockSize = 256 * 1024;
+    ChecksumAccumulator checksum;
+    AuthenticodeHasher authenticode(layout);
+    for (size_t position = 0; position < layout.fileSize; position += kBlockSize)
+    {
+        size_t size = std::min(kBlockSize, layout.fileSize - position);
+        checksum.Add(data + position, size);
+        authenticode.Add(data + position, position, size);
+    }
+    digest.checksum = checksum.Finish(layout);
+    authenticode.Finish(digest.authenticode);
+}
+
+// Sequential unbuffered-by-us reader; the OS read-ahead does the rest
+class InputFile
+{
+public:
+    ~InputFile()
+    {
+#ifdef _WIN32
+        if (handle != INVALID_HANDLE_VALUE)
+            CloseHandle(handle);
+#else
+        if (fd >= 0)
+            close(fd);
+#endif
+    }
+
+    bool Open(const std::string& path)
+    {
+#ifdef _WIN32
+        int wideLength = MultiByteToWideChar(CP_UTF8, 0, path.c_str(), -1, nullptr, 0);
+        std::wstring widePath(wideLength > 0 ? wideLength - 1 : 0, L'\0');
+        if (wideLength > 0)
+            MultiByteToWideChar(CP_UTF8, 0, path.c_str(), -1, widePath.data(), wideLength);
+        handle = CreateFileW(widePath.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+        return handle != INVALID_HANDLE_VALUE;
+#else
+        fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+#ifdef POSIX_FADV_SEQUENTIAL
+        if (fd >= 0)
+            posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+        return fd >= 0;
+#endif
+    }
+
+    // Fill buffer unless the file ends first; returns the bytes read, or -1 on error
+    long long Read(BYTE* buffer, size_t size)
+    {
+        TRACE_SCOPE("ReadFile");
+        size_t done = 0;
+        while (done < size)
+        {
+#ifdef _WIN32
+            DWORD chunk = static_cast<DWORD>(std::min<size_t>(size - done, 1u << 30));
+            DWORD got = 0;
+            if (!ReadFile(handle, buffer + done, chunk, &got, NULL))
+                return -1;
+#else
+            ssize_t got = read(fd, buffer + done, size - done);
+            if (got < 0)
+                return -1;
+#endif
+            if (got == 0)
+                break;
+            done += static_cast<size_t>(got);
+        }
+        TRACE_COUNT(Bytes, done);
+        return static_cast<long long>(done);
+    }
+
+private:
+#ifdef _WIN32
+    HANDLE handle = INVALID_HANDLE_VALUE;
+#else
+    int fd = -1;
+#endif
+};
+
+bool ComputeImageDigest(const std::string& path, const DigestLayout& layout, ImageDigest& digest, std::string& error,
+                        XXHash64Stream* content)
+{
+    TRACE_SCOPE("ComputeImageDigest");
+    StartDigest(layout, digest);
+
+    InputFile file;
+    if (!file.Open(path))
+    {
+        error = "Failed to open file.";
+        return false;
+    }
+
+    // A small ring of large buffers: the reader stays up to kBufferCount chunks ahead of the hasher
+    const size_t kChunkSize = 4 * 1024 * 1024; // Even, so 16-bit words never straddle chunks
+    const size_t kBufferCount = 4;
+    struct Chunk
+    {
+        std::vector<BYTE> bytes;
+        size_t size = 0;
+    };
+    std::vector<Chunk> ring(kBufferCount);
+    for (Chunk& chunk : ring)
+        chunk.bytes.resize(std::min(kChunkSize, std::max<size_t>(layout.fileSize, 2)));
+
+    std::mutex mutex;
+    std::condition_variable filled, freed;
+    size_t produced = 0;
+    size_t consumed = 0;
+    bool finished = false;
+    bool failed = false;
+    size_t bytesRead = 0;
+
+    // Reader thread: read, fold into the checksum while the chunk is still in cache, hand over
+    ChecksumAccumulator checksum;
+    std::thread reader([&]()
+    {
+        for (;;)
+        {
+            Chunk* chunk;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                freed.wait(lock, [&] { return produced - consumed < kBufferCount || failed; });
+                if (failed)
+                    return;
+                chunk = &ring[produced % kBufferCount];
+            }
+
+            long long got = file.Read(chunk->bytes.data(), chunk->bytes.size());
+            if (got > 0)
+                checksum.Add(chunk->bytes.data(), static_cast<size_t>(got));
+
+            std::lock_guard<std::mutex> lock(mutex);
+            if (got < 0)
+                failed = true;
+            else if (got == 0)
+                finished = true;
+            else
+            {
+                chunk->size = static_cast<size_t>(got);
+                bytesRead += chunk->size;
+                produced++;
+            }
+            filled.notify_one();
+            if (got <= 0)
+                return;
+        }
+    });
+
+    // This thread: hash each chunk in file order and give its buffer back
+    AuthenticodeHasher authenticode(layout);
+    size_t position = 0;
+    for (;;)
+    {
+        Chunk* chunk;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            filled.wait(lock, [&] { return consumed < produced || finished || failed; });
+            if (consumed == produced)
+                break;
+            chunk = &ring[consumed % kBufferCount];
+        }
+
+        authenticode.Add(chunk->bytes.data(), position, chunk->size);
+        if (content != nullptr)
+            content->Update(chunk->bytes.data(), chunk->size);
+        position += chunk->size;
+
+        std::lock_guard<std::mutex> lock(mutex);
+        consumed++;
+        freed.notify_one();
+    }
+    reader.join();
+
+    if (failed)
+    {
+        error = "Failed to read file.";
+        return false;
+    }
+    if (bytesRead != layout.fileSize)
+    {
+        error = "File changed size while it was being hashed.";
+        return false;
+    }
+
+    digest.checksum = checksum.Finish(layout);
+    authenticode.Finish(digest.authenticode);
+    return true;
+}
+
+std::string DigestToHex(const uint8_t* digest, size_t size)
+{
+    static const char digits[] = "0123456789abcdef";
+    std::string hex;
+    hex.reserve(size * 2);
+    for (size_t i = 0; i < size; i++)
+    {
+        hex += digits[digest[i] >> 4];
+        hex += digits[digest[i] & 0xF];
+    }
+    return hex;
+}
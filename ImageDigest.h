@@ -0,0 +1,51 @@
+#ifndef IMAGEDIGEST_H
+#define IMAGEDIGEST_H
+
+#include "PETypes.h"
+#include "Hash.h"
+#include <cstdint>
+#include <string>
+
+// File ranges the checksum and the Authenticode digest treat specially, located by the parser
+struct DigestLayout
+{
+    size_t fileSize = 0;
+    size_t checksumOffset = 0;         // OptionalHeader.CheckSum, skipped by both
+    DWORD storedChecksum = 0;
+    bool hasCertificateEntry = false;  // The optional header declares a security directory entry
+    size_t certificateEntryOffset = 0; // DataDirectory[IMAGE_DIRECTORY_ENTRY_SECURITY], skipped by the digest
+    size_t certificateOffset = 0;      // Attribute certificate table; its "RVA" is a file offset
+    size_t certificateSize = 0;        // 0 if unsigned; clipped to the end of the file
+};
+
+// Layout of a parsed image (through ParseDataDirectories)
+template <typename Image>
+DigestLayout GetDigestLayout(const Image& image);
+
+struct ImageDigest
+{
+    DWORD storedChecksum = 0;
+    DWORD checksum = 0; // Computed like the loader and CheckSumMappedFile: 16-bit ones' complement sum plus file size
+    bool hasCertificate = false;
+    uint8_t authenticode[Sha256::kDigestSize] = {}; // SHA-256 of the file without the checksum, certificate entry and certificates
+
+    bool ChecksumMatches() const { return checksum == storedChecksum; }
+};
+
+// Name of the word-sum kernel picked for this CPU ("avx2", "sse2" or "scalar")
+const char* ChecksumKernelName();
+
+// Checksum and digest of an image already in memory, in one pass
+void ComputeImageDigest(const BYTE* data, const DigestLayout& layout, ImageDigest& digest);
+
+// Same result, streamed from disk: a reader thread reads large chunks ahead and sums them for the checksum
+// while the calling thread hashes the previous chunk, so a big installer costs little more than reading it.
+// Returns false and sets error if the file cannot be read or changed size since it was parsed.
+// content, if given, is fed every byte read, so the caller can check they are still the bytes it parsed.
+bool ComputeImageDigest(const std::string& path, const DigestLayout& layout, ImageDigest& digest, std::string& error,
+                        XXHash64Stream* content = nullptr);
+
+// Lowercase hex, two characters per byte
+std::string DigestToHex(const uint8_t* digest, size_t size);
+
+#endif // IMAGEDIGEST_H
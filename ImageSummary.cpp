@@ -0,0 +1,434 @@
+#include "ImageSummary.h"
+#include "Hash.h"
+#include <cstring>
+
+// On-disk layout, version 5:
+//   SummaryHeader
+//   IMAGE_SECTION_HEADER[sectionCount]
+//   float[sectionCount]            only with kFlagEntropy
+//   uint32 moduleName[moduleCount] pool offsets
+//   ImportRecord[importCount]
+//   ExportRecord[exportCount]
+//   ResourceRecord[resourceCount]  only with kFlagResources
+//   SignatureRecord[signatureCount] only with kFlagSignatures
+//   char pool[poolSize]            NUL-terminated strings, offset 0 is the empty string
+static const char kSummaryMagic[8] = { 'I', 'N', 'S', 'P', 'S', 'U', 'M', '\0' };
+static const uint32_t kSummaryVersion = 5;
+static const uint32_t kFlagParsed = 1;
+static const uint32_t kFlagEntropy = 2;
+static const uint32_t kFlagResources = 4;
+static const uint32_t kFlagDigest = 8;
+static const uint32_t kFlagCertificate = 16;
+static const uint32_t kFlagSignatures = 32;
+
+struct SummaryHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t flags;
+    uint64_t contentHash;
+    uint64_t fileSize;
+    uint16_t machine;
+    uint16_t imageMagic;
+    uint16_t characteristics;
+    uint16_t reserved;
+    uint32_t timestamp;
+    uint32_t entryPoint;
+    uint32_t sizeOfImage;
+    uint32_t sectionCount;
+    uint32_t moduleCount;
+    uint32_t importCount;
+    uint32_t exportCount;
+    uint32_t error;      // Pool offset
+    uint32_t exportName; // Pool offset
+    uint32_t poolSize;
+    uint32_t resourceCount;
+    uint32_t relocationCount;
+    uint32_t storedChecksum; // Digest fields are only meaningful with kFlagDigest
+    uint32_t checksum;
+    uint8_t authenticode[32];
+    uint32_t signatureCount;
+    uint32_t reserved2;
+};
+
+struct ImportRecord
+{
+    uint32_t module;
+    uint32_t name;
+    uint16_t hint;
+    uint16_t ordinal;
+};
+
+struct ExportRecord
+{
+    uint32_t name;
+    uint32_t forwarder;
+    uint32_t ordinal;
+    uint32_t rva;
+};
+
+struct ResourceRecord
+{
+    uint32_t type;
+    uint32_t leaves;
+    uint64_t bytes;
+};
+
+struct SignatureRecord
+{
+    uint32_t name;
+    uint32_t reserved;
+    uint64_t offset;
+};
+
+static_assert(sizeof(SummaryHeader) == 136, "SummaryHeader layout");
+static_assert(sizeof(ImportRecord) == 12, "ImportRecord layout");
+static_assert(sizeof(ExportRecord) == 16, "ExportRecord layout");
+static_assert(sizeof(ResourceRecord) == 16, "ResourceRecord layout");
+static_assert(sizeof(SignatureRecord) == 16, "SignatureRecord layout");
+
+template <typename Image>
+static void AssignImage(ImageSummary& summary, const Image& image)
+{
+    const IMAGE_FILE_HEADER* fileHeader = image.GetFileHeader();
+    const typename Image::OptionalHeader* optionalHeader = image.GetOptionalHeader();
+
+    summary.parsed = true;
+    summary.error.clear();
+    summary.fileSize = image.GetImageSize();
+    summary.machine = fileHeader->Machine;
+    summary.characteristics = fileHeader->Characteristics;
+    summary.timestamp = fileHeader->TimeDateStamp;
+    summary.magic = optionalHeader->Magic;
+    summary.entryPoint = optionalHeader->AddressOfEntryPoint;
+    summary.sizeOfImage = optionalHeader->SizeOfImage;
+    summary.sections = image.GetSections();
+
+    SymbolTable& symbols = SymbolTable::Global();
+    const ImportTable& importTable = image.GetImports();
+    summary.importModules.clear();
+    summary.importModules.reserve(importTable.ModuleCount());
+    for (const ImportModule& module : importTable)
+        summary.importModules.push_back(symbols.Intern(module.name));
+
+    summary.imports.clear();
+    summary.imports.reserve(importTable.FunctionCount());
+    for (size_t i = 0; i < importTable.FunctionCount(); i++)
+    {
+        ImageSummary::Import import;
+        import.module = importTable.FunctionModule(i);
+        import.name = symbols.Intern(importTable.FunctionName(i));
+        import.hint = importTable.Hint(i);
+        import.ordinal = importTable.Ordinal(i);
+        summary.imports.push_back(import);
+    }
+
+    const ExportTable& exportTable = image.GetExports();
+    summary.exportName = std::string(exportTable.GetModuleName());
+    summary.exports.clear();
+    summary.exports.reserve(exportTable.GetSymbols().size());
+    for (const ExportSymbol& symbol : exportTable.GetSymbols())
+        summary.exports.push_back({ symbols.Intern(symbol.name), symbols.Intern(symbol.forwarder), symbol.ordinal, symbol.rva });
+
+    summary.relocations = static_cast<uint32_t>(image.GetRelocations().EntryCount());
+}
+
+void ImageSummary::Assign(const PE32& image)
+{
+    AssignImage(*this, image);
+}
+
+void ImageSummary::Assign(const PE64& image)
+{
+    AssignImage(*this, image);
+}
+
+uint64_t ImageSummary::ImportHash() const
+{
+    if (imports.empty())
+        return 0;
+
+    // Ordinals get a tag bit no folded name hash is likely to share
+    const SymbolTable& symbols = SymbolTable::Global();
+    std::vector<uint64_t> pairs;
+    pairs.reserve(imports.size() * 2);
+    for (const Import& import : imports)
+    {
+        pairs.push_back(symbols.FoldedHash(importModules[import.module]));
+        pairs.push_back(import.name != 0 ? symbols.FoldedHash(import.name) : (uint64_t(1) << 63) | import.ordinal);
+    }
+    return XXHash64(pairs.data(), pairs.size() * sizeof(uint64_t));
+}
+
+void ImageSummary::AssignResources(const PEImageBase& image)
+{
+    const ResourceDirectory& directory = image.GetResources();
+    resources.clear();
+    hasResources = true;
+
+    // A handful of types per image, a linear search beats hashing the names
+    directory.Walk(image, [&](const ResourceEntry* const* path, int length)
+    {
+        std::string type = ResourceEntryName(*path[0]);
+        size_t i = 0;
+        while (i < resources.size() && resources[i].type != type)
+            i++;
+        if (i == resources.size())
+            resources.push_back({ std::move(type), 0, 0 });
+
+        ResourceData data;
+        resources[i].leaves++;
+        if (directory.ReadData(image, *path[length - 1], data))
+            resources[i].bytes += data.size;
+    });
+}
+
+// Collects strings for the pool; identical strings (module names, repeated errors) are not deduplicated,
+// summaries are small and written once
+class StringPool
+{
+public:
+    StringPool() : pool(1, '\0') {}
+
+    uint32_t Add(std::string_view text)
+    {
+        if (text.empty())
+            return 0;
+        uint32_t offset = static_cast<uint32_t>(pool.size());
+        pool.append(text.data(), text.size());
+        pool += '\0';
+        return offset;
+    }
+
+    const std::string& Data() const { return pool; }
+
+private:
+    std::string pool;
+};
+
+template <typename T>
+static void AppendRecords(std::string& out, const T* records, size_t count)
+{
+    out.append(reinterpret_cast<const char*>(records), count * sizeof(T));
+}
+
+void ImageSummary::Serialize(std::string& out) const
+{
+    StringPool pool;
+    SummaryHeader header = {};
+    memcpy(header.magic, kSummaryMagic, sizeof(header.magic));
+    header.version = kSummaryVersion;
+    header.flags = (parsed ? kFlagParsed : 0) | (hasEntropy ? kFlagEntropy : 0) | (hasResources ? kFlagResources : 0) |
+        (hasDigest ? kFlagDigest : 0) | (digest.hasCertificate ? kFlagCertificate : 0) | (hasSignatures ? kFlagSignatures : 0);
+    header.contentHash = contentHash;
+    header.fileSize = fileSize;
+    header.machine = machine;
+    header.imageMagic = magic;
+    header.characteristics = characteristics;
+    header.timestamp = timestamp;
+    header.entryPoint = entryPoint;
+    header.sizeOfImage = sizeOfImage;
+    header.sectionCount = static_cast<uint32_t>(sections.size());
+    header.moduleCount = static_cast<uint32_t>(importModules.size());
+    header.importCount = static_cast<uint32_t>(imports.size());
+    header.exportCount = static_cast<uint32_t>(exports.size());
+    header.resourceCount = static_cast<uint32_t>(resources.size());
+    header.relocationCount = relocations;
+    header.signatureCount = static_cast<uint32_t>(signatures.size());
+    header.storedChecksum = digest.storedChecksum;
+    header.checksum = digest.checksum;
+    memcpy(header.authenticode, digest.authenticode, sizeof(header.authenticode));
+    header.error = pool.Add(error);
+    header.exportName = pool.Add(exportName);
+
+    // Symbol IDs only mean something in this process, so the cache stores the names
+    const SymbolTable& symbols = SymbolTable::Global();
+    std::vector<uint32_t> modules;
+    modules.reserve(importModules.size());
+    for (uint32_t module : importModules)
+        modules.push_back(pool.Add(symbols.Name(module)));
+
+    std::vector<ImportRecord> importRecords;
+    importRecords.reserve(imports.size());
+    for (const Import& import : imports)
+        importRecords.push_back({ import.module, pool.Add(symbols.Name(import.name)), import.hint, import.ordinal });
+
+    std::vector<ExportRecord> exportRecords;
+    exportRecords.reserve(exports.size());
+    for (const Export& symbol : exports)
+        exportRecords.push_back({ pool.Add(symbols.Name(symbol.name)), pool.Add(symbols.Name(symbol.forwarder)), symbol.ordinal, symbol.rva });
+
+    std::vector<ResourceRecord> resourceRecords;
+    resourceRecords.reserve(resources.size());
+    for (const ResourceType& resource : resources)
+        resourceRecords.push_back({ pool.Add(resource.type), resource.leaves, resource.bytes });
+
+    std::vector<SignatureRecord> signatureRecords;
+    signatureRecords.reserve(signatures.size());
+    for (const SignatureHit& hit : signatures)
+        signatureRecords.push_back({ pool.Add(hit.name), 0, hit.offset });
+
+    header.poolSize = static_cast<uint32_t>(pool.Data().size());
+
+    out.clear();
+    AppendRecords(out, &header, 1);
+    AppendRecords(out, sections.data(), sections.size());
+    if (hasEntropy)
+        AppendRecords(out, sectionEntropy.data(), sections.size());
+    AppendRecords(out, modules.data(), modules.size());
+    AppendRecords(out, importRecords.data(), importRecords.size());
+    AppendRecords(out, exportRecords.data(), exportRecords.size());
+    AppendRecords(out, resourceRecords.data(), resourceRecords.size());
+    AppendRecords(out, signatureRecords.data(), signatureRecords.size());
+    out += pool.Data();
+}
+
+// Sequential reader over the mapped bytes; every read is bounds-checked
+class SummaryReader
+{
+public:
+    SummaryReader(const unsigned char* _data, size_t _size) : data(_data), size(_size) {}
+
+    template <typename T>
+    const unsigned char* Take(size_t count)
+    {
+        if (count > (size - offset) / sizeof(T))
+            return nullptr;
+        const unsigned char* records = data + offset;
+        offset += count * sizeof(T);
+        return records;
+    }
+
+    size_t Remaining() const { return size - offset; }
+
+private:
+    const unsigned char* data;
+    size_t size;
+    size_t offset = 0;
+};
+
+bool ImageSummary::Deserialize(const unsigned char* data, size_t size)
+{
+    SummaryReader reader(data, size);
+    const unsigned char* headerBytes = reader.Take<SummaryHeader>(1);
+    if (headerBytes == nullptr)
+        return false;
+
+    SummaryHeader header;
+    memcpy(&header, headerBytes, sizeof(header));
+    if (memcmp(header.magic, kSummaryMagic, sizeof(header.magic)) != 0 || header.version != kSummaryVersion)
+        return false;
+
+    bool entropy = (header.flags & kFlagEntropy) != 0;
+    const unsigned char* sectionBytes = reader.Take<IMAGE_SECTION_HEADER>(header.sectionCount);
+    const unsigned char* entropyBytes = entropy ? reader.Take<float>(header.sectionCount) : nullptr;
+    const unsigned char* moduleBytes = reader.Take<uint32_t>(header.moduleCount);
+    const unsigned char* importBytes = reader.Take<ImportRecord>(header.importCount);
+    const unsigned char* exportBytes = reader.Take<ExportRecord>(header.exportCount);
+    const unsigned char* resourceBytes = reader.Take<ResourceRecord>(header.resourceCount);
+    const unsigned char* signatureBytes = reader.Take<SignatureRecord>(header.signatureCount);
+    const unsigned char* poolBytes = reader.Take<char>(header.poolSize);
+    if (sectionBytes == nullptr || (entropy && entropyBytes == nullptr) || moduleBytes == nullptr ||
+        importBytes == nullptr || exportBytes == nullptr || resourceBytes == nullptr || signatureBytes == nullptr || poolBytes == nullptr ||
+        header.poolSize == 0 || poolBytes[header.poolSize - 1] != '\0')
+        return false;
+
+    // The pool ends in a NUL, so any in-range offset yields a terminated string
+    const char* pool = reinterpret_cast<const char*>(poolBytes);
+    bool poolValid = true;
+    auto poolString = [&](uint32_t offset) -> std::string
+    {
+        if (offset >= header.poolSize)
+        {
+            poolValid = false;
+            return std::string();
+        }
+        return std::string(pool + offset);
+    };
+    SymbolTable& symbols = SymbolTable::Global();
+    auto poolSymbol = [&](uint32_t offset) -> uint32_t
+    {
+        if (offset >= header.poolSize)
+        {
+            poolValid = false;
+            return 0;
+        }
+        return symbols.Intern(pool + offset);
+    };
+
+    contentHash = header.contentHash;
+    fileSize = header.fileSize;
+    parsed = (header.flags & kFlagParsed) != 0;
+    error = poolString(header.error);
+    machine = header.machine;
+    magic = header.imageMagic;
+    characteristics = header.characteristics;
+    timestamp = header.timestamp;
+    entryPoint = header.entryPoint;
+    sizeOfImage = header.sizeOfImage;
+
+    sections.resize(header.sectionCount);
+    memcpy(sections.data(), sectionBytes, sections.size() * sizeof(IMAGE_SECTION_HEADER));
+    hasEntropy = entropy;
+    sectionEntropy.assign(entropy ? header.sectionCount : 0, 0.0f);
+    if (entropy)
+        memcpy(sectionEntropy.data(), entropyBytes, sectionEntropy.size() * sizeof(float));
+
+    importModules.clear();
+    importModules.reserve(header.moduleCount);
+    for (uint32_t i = 0; i < header.moduleCount; i++)
+    {
+        uint32_t offset;
+        memcpy(&offset, moduleBytes + i * sizeof(uint32_t), sizeof(offset));
+        importModules.push_back(poolSymbol(offset));
+    }
+
+    imports.clear();
+    imports.reserve(header.importCount);
+    for (uint32_t i = 0; i < header.importCount; i++)
+    {
+        ImportRecord record;
+        memcpy(&record, importBytes + i * sizeof(ImportRecord), sizeof(record));
+        if (record.module >= header.moduleCount)
+            return false;
+        imports.push_back({ record.module, poolSymbol(record.name), record.hint, record.ordinal });
+    }
+
+    exportName = poolString(header.exportName);
+    exports.clear();
+    exports.reserve(header.exportCount);
+    for (uint32_t i = 0; i < header.exportCount; i++)
+    {
+        ExportRecord record;
+        memcpy(&record, exportBytes + i * sizeof(ExportRecord), sizeof(record));
+        exports.push_back({ poolSymbol(record.name), poolSymbol(record.forwarder), record.ordinal, record.rva });
+    }
+
+    relocations = header.relocationCount;
+    hasDigest = (header.flags & kFlagDigest) != 0;
+    digest.storedChecksum = header.storedChecksum;
+    digest.checksum = header.checksum;
+    digest.hasCertificate = (header.flags & kFlagCertificate) != 0;
+    memcpy(digest.authenticode, header.authenticode, sizeof(digest.authenticode));
+    hasResources = (header.flags & kFlagResources) != 0;
+    resources.clear();
+    resources.reserve(header.resourceCount);
+    for (uint32_t i = 0; i < header.resourceCount; i++)
+    {
+        ResourceRecord record;
+        memcpy(&record, resourceBytes + i * sizeof(ResourceRecord), sizeof(record));
+        resources.push_back({ poolString(record.type), record.leaves, record.bytes });
+    }
+
+    hasSignatures = (header.flags & kFlagSignatures) != 0;
+    signatures.clear();
+    signatures.reserve(header.signatureCount);
+    for (uint32_t i = 0; i < header.signatureCount; i++)
+    {
+        SignatureRecord record;
+        memcpy(&record, signatureBytes + i * sizeof(SignatureRecord), sizeof(record));
+        signatures.push_back({ poolString(record.name), record.offset });
+    }
+
+    return poolValid && reader.Remaining() == 0;
+}
@@ -0,0 +1,99 @@
+#ifndef IMAGESUMMARY_H
+#define IMAGESUMMARY_H
+
+#include "PEImage.h"
+#include "ImageDigest.h"
+#include "SymbolTable.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Self-contained copy of everything a batch scan reports about one file.
+// Unlike PEImage it owns its strings, so it outlives the mapping and can be
+// written to and read back from the parse cache. Module and symbol names are
+// IDs in SymbolTable::Global(), which keeps one copy of each for the process.
+struct ImageSummary
+{
+    struct Import
+    {
+        uint32_t module; // Index into importModules
+        uint32_t name;   // Symbol ID; 0 (the empty string) when imported by ordinal
+        WORD hint;
+        WORD ordinal;
+    };
+
+    struct Export
+    {
+        uint32_t name;      // Symbol IDs, 0 when absent
+        uint32_t forwarder;
+        DWORD ordinal;
+        DWORD rva;
+    };
+
+    // A signature that matched, by name so the summary stays valid without the set
+    struct SignatureHit
+    {
+        std::string name;
+        uint64_t offset;
+    };
+
+    // Leaves of one top-level resource type
+    struct ResourceType
+    {
+        std::string type;
+        uint32_t leaves;
+        uint64_t bytes; // Sum of the data entry sizes that lie within the file
+    };
+
+    uint64_t contentHash = 0;
+    uint64_t fileSize = 0;
+
+    bool parsed = false;   // false: error says why
+    std::string error;
+
+    WORD machine = 0;
+    WORD magic = 0;
+    WORD characteristics = 0;
+    DWORD timestamp = 0;
+    DWORD entryPoint = 0;
+    DWORD sizeOfImage = 0;
+
+    std::vector<IMAGE_SECTION_HEADER> sections;
+    bool hasEntropy = false;
+    std::vector<float> sectionEntropy; // Parallel to sections when hasEntropy
+
+    std::vector<uint32_t> importModules; // Symbol IDs
+    std::vector<Import> imports;
+    std::string exportName;
+    std::vector<Export> exports;
+    uint32_t relocations = 0; // Base relocation entries, padding excluded
+    bool hasResources = false;
+    std::vector<ResourceType> resources; // In root directory order when hasResources
+    bool hasDigest = false;
+    ImageDigest digest; // Checksum and Authenticode hash when hasDigest
+    bool hasSignatures = false;
+    std::vector<SignatureHit> signatures; // In file offset order when hasSignatures
+
+    // Copy the results of a fully parsed image
+    void Assign(const PE32& image);
+    void Assign(const PE64& image);
+
+    // Walk the whole resource tree and count leaves per type. Kept out of Assign
+    // because it is the only part of a summary that reads past the root directory.
+    void AssignResources(const PEImageBase& image);
+
+    // Imphash-style fingerprint of the import list: every (module, function or ordinal) pair in import order,
+    // names compared without case or DLL extension. Built from the symbols' folded hashes, so no string is read;
+    // stable across runs, but its own hash rather than imphash's MD5. 0 without imports.
+    uint64_t ImportHash() const;
+
+    // Compact binary form: fixed header, fixed-size record arrays, then one string pool.
+    // Records are 4-byte aligned and strings are pool offsets, so the bytes can be read straight
+    // out of a mapped file. Little-endian hosts only, like the rest of the parser.
+    void Serialize(std::string& out) const;
+
+    // Returns false if the bytes are not a complete summary of this format version
+    bool Deserialize(const unsigned char* data, size_t size);
+};
+
+#endif // IMAGESUMMARY_H
@@ -0,0 +1,129 @@
+#include "ImportTable.h"
+#include "PEImage.h"
+
+template <typename Traits>
+bool ImportTable::Parse(const PEImageBase& image, DWORD rva, Arena& arena)
+{
+    typedef typename Traits::ThunkData ThunkData;
+
+    // Counting pass: validates every descriptor and thunk array and sizes the tables.
+    // Thunk translation is cheap (the RVA index caches the last section), names are only resolved in the fill pass.
+    // Descriptors may share thunk arrays, so the total is capped at what the file could hold without sharing;
+    // past that a crafted directory would only make us walk (and later allocate for) the same entries again
+    const size_t maxThunks = image.GetImageSize() / sizeof(ThunkData);
+    size_t descriptorCount = 0;
+    size_t thunkCount = 0;
+    for (DWORD descriptorRVA = rva; rva != 0; descriptorRVA += sizeof(IMAGE_IMPORT_DESCRIPTOR))
+    {
+        const IMAGE_IMPORT_DESCRIPTOR* descriptor = image.RvaToPointer<IMAGE_IMPORT_DESCRIPTOR>(descriptorRVA);
+        if (descriptor == nullptr)
+        {
+            errorString = "Import directory extends past the end of the file.";
+            return false;
+        }
+        if (descriptor->Name == 0)
+            break;
+        descriptorCount++;
+        if (descriptor->OriginalFirstThunk == 0 && descriptor->FirstThunk == 0)
+        {
+            errorString = "Import descriptor has no thunks.";
+            return false;
+        }
+
+        // Thunks are used to resolve function calls and are found within the IAT.
+        // The lookup table (OriginalFirstThunk) is preferred, bound images overwrite the IAT on disk.
+        DWORD thunk = descriptor->OriginalFirstThunk != 0 ? descriptor->OriginalFirstThunk : descriptor->FirstThunk;
+        for (; ; thunk += sizeof(ThunkData))
+        {
+            const ThunkData* thunkData = image.RvaToPointer<ThunkData>(thunk);
+            if (thunkData == nullptr)
+            {
+                errorString = "Import thunks extend past the end of the file.";
+                return false;
+            }
+            if (thunkData->u1.AddressOfData == 0)
+                break;
+            if (++thunkCount > maxThunks)
+            {
+                errorString = "Import directory is too large.";
+                return false;
+            }
+        }
+    }
+
+    if (descriptorCount > UINT32_MAX || thunkCount > UINT32_MAX)
+    {
+        errorString = "Import directory is too large.";
+        return false;
+    }
+
+    if (descriptorCount == 0)
+        return true;
+
+    // One block for everything, plus slack for aligning each array
+    arena.Reserve(descriptorCount * sizeof(ImportModule) +
+                  thunkCount * (sizeof(std::string_view) + 2 * sizeof(WORD) + sizeof(uint32_t)) +
+                  5 * alignof(std::max_align_t));
+    modules = arena.AllocateArray<ImportModule>(descriptorCount);
+    names = arena.AllocateArray<std::string_view>(thunkCount);
+    hints = arena.AllocateArray<WORD>(thunkCount);
+    ordinals = arena.AllocateArray<WORD>(thunkCount);
+    functionModules = arena.AllocateArray<uint32_t>(thunkCount);
+
+    // Fill pass: same walk, now resolving module and function names
+    moduleCount = 0;
+    functionCount = 0;
+    for (DWORD descriptorRVA = rva; moduleCount < descriptorCount; descriptorRVA += sizeof(IMAGE_IMPORT_DESCRIPTOR))
+    {
+        const IMAGE_IMPORT_DESCRIPTOR* descriptor = image.RvaToPointer<IMAGE_IMPORT_DESCRIPTOR>(descriptorRVA);
+
+        ImportModule& module = modules[moduleCount];
+        module.name = image.RvaToStringView(descriptor->Name);
+        if (module.name.data() == nullptr)
+        {
+            errorString = "Import name points outside the file.";
+            return false;
+        }
+        module.begin = static_cast<uint32_t>(functionCount);
+
+        DWORD thunk = descriptor->OriginalFirstThunk != 0 ? descriptor->OriginalFirstThunk : descriptor->FirstThunk;
+        for (; ; thunk += sizeof(ThunkData))
+        {
+            const ThunkData* thunkData = image.RvaToPointer<ThunkData>(thunk);
+            if (thunkData->u1.AddressOfData == 0)
+                break;
+
+            size_t index = functionCount++;
+            functionModules[index] = static_cast<uint32_t>(moduleCount);
+            names[index] = std::string_view();
+            hints[index] = 0;
+            ordinals[index] = 0;
+
+            if (PEImage<Traits>::IsImportByOrdinal(thunkData->u1.AddressOfData))
+            {
+                ordinals[index] = PEImage<Traits>::GetOrdinalValue(thunkData->u1.AddressOfData);
+            }
+            else
+            {
+                // AddressOfData is the RVA of an IMAGE_IMPORT_BY_NAME: a 2-byte hint followed by the name
+                DWORD importByName = static_cast<DWORD>(thunkData->u1.AddressOfData);
+                const WORD* hint = image.RvaToPointer<WORD>(importByName);
+                std::string_view name = image.RvaToStringView(importByName + sizeof(WORD));
+                if (hint == nullptr || name.data() == nullptr)
+                {
+                    errorString = "Import function name points outside the file.";
+                    return false;
+                }
+                hints[index] = *hint;
+                names[index] = name;
+            }
+        }
+
+        module.end = static_cast<uint32_t>(functionCount);
+        moduleCount++;
+    }
+    return true;
+}
+
+template bool ImportTable::Parse<PE32Traits>(const PEImageBase& image, DWORD rva, Arena& arena);
+template bool ImportTable::Parse<PE64Traits>(const PEImageBase& image, DWORD rva, Arena& arena);
@@ -0,0 +1,58 @@
+#ifndef IMPORTTABLE_H
+#define IMPORTTABLE_H
+
+#include "PETypes.h"
+#include "Arena.h"
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+class PEImageBase;
+
+// One imported DLL and the [begin, end) range of its functions in the function arrays
+struct ImportModule
+{
+    std::string_view name;
+    uint32_t begin;
+    uint32_t end;
+};
+
+// Import directory as flat arrays: a module table, and per function a name, hint, ordinal and owning module,
+// each in its own array so display and analysis loops stream through only what they read.
+// Names point into the mapped image. All arrays come from the image's arena, sized by a counting pass first,
+// so even images with thousands of imports cost a single allocation.
+class ImportTable
+{
+public:
+    // Walk the import directory at rva; an rva of 0 yields an empty table
+    template <typename Traits>
+    bool Parse(const PEImageBase& image, DWORD rva, Arena& arena);
+
+    size_t ModuleCount() const { return moduleCount; }
+    const ImportModule& Module(size_t index) const { return modules[index]; }
+    const ImportModule* begin() const { return modules; }
+    const ImportModule* end() const { return modules + moduleCount; }
+
+    size_t FunctionCount() const { return functionCount; }
+    std::string_view FunctionName(size_t index) const { return names[index]; } // Null view when imported by ordinal
+    bool IsByOrdinal(size_t index) const { return names[index].data() == nullptr; }
+    WORD Hint(size_t index) const { return hints[index]; }
+    WORD Ordinal(size_t index) const { return ordinals[index]; }
+    uint32_t FunctionModule(size_t index) const { return functionModules[index]; }
+
+    const std::string& ErrorString() const { return errorString; }
+
+private:
+    ImportModule* modules = nullptr;
+    size_t moduleCount = 0;
+
+    std::string_view* names = nullptr;
+    WORD* hints = nullptr;
+    WORD* ordinals = nullptr;
+    uint32_t* functionModules = nullptr;
+    size_t functionCount = 0;
+
+    std::string errorString;
+};
+
+#endif // IMPORTTABLE_H
@@ -0,0 +1,236 @@
+#include "MappedFile.h"
+#include "Trace.h"
+
+#include <algorithm>
+#include <new>
+#include <utility>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::~MappedFile()
+{
+    Close();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+{
+    *this = std::move(other);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+{
+    if (this != &other)
+    {
+        Close();
+        data = std::exchange(other.data, nullptr);
+        size = std::exchange(other.size, 0);
+        writable = std::exchange(other.writable, false);
+        owned = std::exchange(other.owned, false);
+        errorString = std::move(other.errorString);
+    }
+    return *this;
+}
+
+bool MappedFile::TakeSnapshot(unsigned char* copy, size_t read, size_t expected)
+{
+    if (copy == nullptr)
+    {
+        errorString = "Not enough memory to read file.";
+        return false;
+    }
+
+    // The file shrank, or a read failed, while it was being copied; whoever is writing it will change it again
+    if (read != expected)
+    {
+        delete[] copy;
+        errorString = "File changed while it was being read.";
+        return false;
+    }
+
+    data = copy;
+    size = read;
+    owned = true;
+    return true;
+}
+
+#ifdef _WIN32
+
+bool MappedFile::Open(const std::string& path, Access access)
+{
+    TRACE_SCOPE("MapFile");
+    Close();
+
+    // Convert the UTF-8 path to UTF-16 for the wide WinAPI
+    int wideLength = MultiByteToWideChar(CP_UTF8, 0, path.c_str(), -1, nullptr, 0);
+    std::wstring widePath(wideLength > 0 ? wideLength - 1 : 0, L'\0');
+    if (wideLength > 0)
+        MultiByteToWideChar(CP_UTF8, 0, path.c_str(), -1, widePath.data(), wideLength);
+
+    // A snapshot lets the file be written or replaced even during the read; a torn read shows up as a short one
+    DWORD share = access == Snapshot ? FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE : FILE_SHARE_READ;
+    HANDLE file = CreateFileW(widePath.c_str(), GENERIC_READ, share, NULL, OPEN_EXISTING,
+                              access == Snapshot ? FILE_FLAG_SEQUENTIAL_SCAN : FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        errorString = "Failed to open file.";
+        return false;
+    }
+
+    LARGE_INTEGER fileSize = {};
+    if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+    {
+        errorString = "File is empty.";
+        CloseHandle(file);
+        return false;
+    }
+
+    if (access == Snapshot)
+    {
+        size_t length = static_cast<size_t>(fileSize.QuadPart);
+        unsigned char* copy = new (std::nothrow) unsigned char[length];
+        size_t done = 0;
+        while (copy != nullptr && done < length)
+        {
+            DWORD chunk = static_cast<DWORD>(std::min<size_t>(length - done, 1u << 30));
+            DWORD read = 0;
+            if (!ReadFile(file, copy + done, chunk, &read, NULL) || read == 0)
+                break;
+            done += read;
+        }
+        CloseHandle(file);
+        return TakeSnapshot(copy, done, length);
+    }
+
+    // Zero max size = map the whole file; PAGE_WRITECOPY still only needs read access to the file
+    HANDLE mapping = CreateFileMappingW(file, NULL, access == CopyOnWrite ? PAGE_WRITECOPY : PAGE_READONLY, 0, 0, NULL);
+    if (mapping == NULL)
+    {
+        errorString = "Failed to create file mapping.";
+        CloseHandle(file);
+        return false;
+    }
+
+    LPVOID view = MapViewOfFile(mapping, access == CopyOnWrite ? FILE_MAP_COPY : FILE_MAP_READ, 0, 0, 0);
+
+    // The view keeps the mapping and the file alive, so the handles can go right away
+    CloseHandle(mapping);
+    CloseHandle(file);
+
+    if (view == NULL)
+    {
+        errorString = "Failed to map view of file.";
+        return false;
+    }
+
+    data = static_cast<const unsigned char*>(view);
+    size = static_cast<size_t>(fileSize.QuadPart);
+    writable = access == CopyOnWrite;
+    return true;
+}
+
+void MappedFile::AdviseSequential() const
+{
+    // FILE_FLAG_SEQUENTIAL_SCAN only applies to ReadFile, and mapped views have no per-range hint
+}
+
+void MappedFile::Close()
+{
+    if (owned)
+        delete[] data;
+    else if (data != nullptr)
+        UnmapViewOfFile(data);
+
+    data = nullptr;
+    size = 0;
+    writable = false;
+    owned = false;
+}
+
+#else
+
+bool MappedFile::Open(const std::string& path, Access access)
+{
+    TRACE_SCOPE("MapFile");
+    Close();
+
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        errorString = "Failed to open file.";
+        return false;
+    }
+
+    struct stat fileInfo = {};
+    if (fstat(fd, &fileInfo) != 0 || fileInfo.st_size == 0)
+    {
+        errorString = "File is empty.";
+        close(fd);
+        return false;
+    }
+
+    if (access == Snapshot)
+    {
+        size_t length = static_cast<size_t>(fileInfo.st_size);
+        unsigned char* copy = new (std::nothrow) unsigned char[length];
+        size_t done = 0;
+        while (copy != nullptr && done < length)
+        {
+            ssize_t got = read(fd, copy + done, length - done);
+            if (got < 0 && errno == EINTR)
+                continue;
+            if (got <= 0)
+                break;
+            done += static_cast<size_t>(got);
+        }
+        close(fd);
+        return TakeSnapshot(copy, done, length);
+    }
+
+    // No MAP_POPULATE: pages are only read in when the parser touches them.
+    // MAP_PRIVATE makes a writable view copy-on-write, so the fd can stay read-only either way.
+    int protection = access == CopyOnWrite ? PROT_READ | PROT_WRITE : PROT_READ;
+    void* view = mmap(nullptr, static_cast<size_t>(fileInfo.st_size), protection, MAP_PRIVATE, fd, 0);
+
+    // The mapping holds its own reference to the file
+    close(fd);
+
+    if (view == MAP_FAILED)
+    {
+        errorString = "Failed to map file.";
+        return false;
+    }
+
+    data = static_cast<const unsigned char*>(view);
+    size = static_cast<size_t>(fileInfo.st_size);
+    writable = access == CopyOnWrite;
+    return true;
+}
+
+void MappedFile::AdviseSequential() const
+{
+    if (data != nullptr && !owned)
+        madvise(const_cast<unsigned char*>(data), size, MADV_SEQUENTIAL);
+}
+
+void MappedFile::Close()
+{
+    if (owned)
+        delete[] data;
+    else if (data != nullptr)
+        munmap(const_cast<unsigned char*>(data), size);
+
+    data = nullptr;
+    size = 0;
+    writable = false;
+    owned = false;
+}
+
+#endif
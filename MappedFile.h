@@ -0,0 +1,59 @@
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <cstddef>
+#include <string>
+
+// Memory-mapped view of a file on disk, read-only unless opened CopyOnWrite.
+// Nothing is copied up front: the OS faults in only the pages that are actually touched,
+// so opening a multi-GB image costs about the same as opening a small one.
+// A Snapshot is the exception: the file is read into memory once and closed before Open returns.
+class MappedFile
+{
+public:
+    enum Access
+    {
+        ReadOnly,
+        CopyOnWrite, // Private writable view: only pages that are written get copied, the file never changes
+        Snapshot     // Read-only copy in memory. Nothing keeps the file open, so it can be deleted, replaced or
+                     // rewritten in place (a linker writing the next build) while the copy is still in use.
+    };
+
+    MappedFile()
+    {
+
+    }
+
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+
+    // Path is UTF-8 encoded on every platform
+    bool Open(const std::string& path, Access access = ReadOnly);
+    void Close();
+
+    bool IsOpen() const { return data != nullptr; }
+    const unsigned char* Data() const { return data; }
+    unsigned char* MutableData() { return writable ? const_cast<unsigned char*>(data) : nullptr; } // nullptr unless CopyOnWrite
+    size_t Size() const { return size; }
+    const std::string& ErrorString() const { return errorString; }
+
+    // The whole view will be read front to back once, e.g. a dump being carved: read ahead further and let
+    // pages behind the reader go first. A hint only; a no-op where the OS has no equivalent.
+    void AdviseSequential() const;
+
+private:
+    // Takes ownership of copy, a Snapshot buffer of which read of expected bytes were filled
+    bool TakeSnapshot(unsigned char* copy, size_t read, size_t expected);
+
+    const unsigned char* data = nullptr;
+    size_t size = 0;
+    bool writable = false;
+    bool owned = false; // data is a Snapshot's buffer rather than a view
+    std::string errorString;
+};
+
+#endif // MAPPEDFILE_H
@@ -0,0 +1,275 @@
+#include "PEImage.h"
+#include "Trace.h"
+#include <algorithm>
+#include <cstring>
+
+WORD DetectImageMagic(LPCVOID imageBase, size_t imageSize)
+{
+    if (imageBase == nullptr || imageSize < sizeof(IMAGE_DOS_HEADER))
+        return 0;
+
+    const IMAGE_DOS_HEADER* dosHeader = reinterpret_cast<const IMAGE_DOS_HEADER*>(imageBase);
+    if (dosHeader->e_magic != IMAGE_DOS_SIGNATURE || dosHeader->e_lfanew < 0)
+        return 0;
+
+    // Signature + file header + Magic, the smallest read that tells the widths apart
+    size_t ntOffset = static_cast<size_t>(dosHeader->e_lfanew);
+    if (ntOffset > imageSize || imageSize - ntOffset < sizeof(DWORD) + sizeof(IMAGE_FILE_HEADER) + sizeof(WORD))
+        return 0;
+
+    const BYTE* ntHeaders = reinterpret_cast<const BYTE*>(imageBase) + ntOffset;
+    DWORD signature;
+    WORD magic;
+    memcpy(&signature, ntHeaders, sizeof(signature));
+    memcpy(&magic, ntHeaders + sizeof(DWORD) + sizeof(IMAGE_FILE_HEADER), sizeof(magic));
+
+    if (signature != IMAGE_NT_SIGNATURE)
+        return 0;
+    return magic;
+}
+
+bool SectionRawRange(const IMAGE_SECTION_HEADER& section, size_t fileSize, size_t& offset, size_t& size)
+{
+    // The loader rounds PointerToRawData down to 512 bytes regardless of FileAlignment
+    offset = section.PointerToRawData & ~DWORD(0x1FF);
+    if (section.SizeOfRawData == 0 || offset >= fileSize)
+        return false;
+    size = std::min<size_t>(section.SizeOfRawData, fileSize - offset);
+    return true;
+}
+
+bool PEImageBase::IsStringInImage(DWORD_PTR address) const
+{
+    if (!IsInImage(address, 1))
+        return false;
+
+    size_t remaining = imageSize - (address - reinterpret_cast<DWORD_PTR>(imageBase));
+    return memchr(reinterpret_cast<const void*>(address), '\0', remaining) != nullptr;
+}
+
+const char* PEImageBase::RvaToString(DWORD rva) const
+{
+    size_t offset;
+    if (!rvaIndex.ToOffset(rva, 1, offset))
+        return nullptr;
+
+    // The string may run past the end of its section, but never past the end of the file
+    const char* string = reinterpret_cast<const char*>(imageBase) + offset;
+    if (memchr(string, '\0', imageSize - offset) == nullptr)
+        return nullptr;
+    return string;
+}
+
+std::string_view PEImageBase::RvaToStringView(DWORD rva) const
+{
+    size_t offset;
+    if (!rvaIndex.ToOffset(rva, 1, offset))
+        return std::string_view();
+
+    const char* string = reinterpret_cast<const char*>(imageBase) + offset;
+    const void* terminator = memchr(string, '\0', imageSize - offset);
+    if (terminator == nullptr)
+        return std::string_view();
+    return std::string_view(string, static_cast<const char*>(terminator) - string);
+}
+
+bool PEImageBase::ParseDOSHeader()
+{
+    TRACE_SCOPE("ParseDOSHeader");
+    if (imageBase == nullptr || imageSize < sizeof(IMAGE_DOS_HEADER))
+    {
+        errorString = "File is too small for a DOS header.";
+        return false;
+    }
+
+    imageDOSHeader = reinterpret_cast<const IMAGE_DOS_HEADER*>(imageBase);
+    TRACE_COUNT(Bytes, sizeof(IMAGE_DOS_HEADER));
+
+    if (imageDOSHeader->e_magic != IMAGE_DOS_SIGNATURE)
+    {
+        errorString = "Missing MZ signature.";
+        return false;
+    }
+    return true;
+}
+
+bool PEImageBase::ParseFileHeader()
+{
+    TRACE_SCOPE("ParseFileHeader");
+    TRACE_COUNT(Bytes, sizeof(IMAGE_FILE_HEADER));
+    imageFileHeader = reinterpret_cast<const IMAGE_FILE_HEADER*>(ntHeadersAddress + sizeof(DWORD)); // File header follows the NT signature
+    return true;
+}
+
+bool PEImageBase::ParseSectionHeader()
+{
+    TRACE_SCOPE("ParseSectionHeader");
+    imageSectionHeader = reinterpret_cast<const IMAGE_SECTION_HEADER*>(ntHeadersAddress + 0x04 + sizeof(IMAGE_FILE_HEADER) + imageFileHeader->SizeOfOptionalHeader); // +0x04 to skip NT signature
+
+    if (!IsInImage(reinterpret_cast<DWORD_PTR>(imageSectionHeader), imageFileHeader->NumberOfSections * sizeof(IMAGE_SECTION_HEADER)))
+    {
+        errorString = "Section table extends past the end of the file.";
+        return false;
+    }
+    return true;
+}
+
+bool PEImageBase::ParseSections()
+{
+    TRACE_SCOPE("ParseSections");
+    TRACE_COUNT(Sections, imageFileHeader->NumberOfSections);
+    TRACE_COUNT(Bytes, imageFileHeader->NumberOfSections * sizeof(IMAGE_SECTION_HEADER));
+    // The section table starts right after the optional header, ParseSectionHeader already located and bounds-checked it
+    sections.assign(imageSectionHeader, imageSectionHeader + imageFileHeader->NumberOfSections);
+
+    // Every directory parser translates RVAs through this index from here on
+    rvaIndex.Build(sections, sizeOfHeaders, imageSize);
+    return true;
+}
+
+bool PEImageBase::ParseExports()
+{
+    TRACE_SCOPE("ParseExports");
+    const IMAGE_DATA_DIRECTORY& directory = dataDirectories[IMAGE_DIRECTORY_ENTRY_EXPORT];
+    if (!exports.Parse(*this, directory.VirtualAddress, directory.Size))
+    {
+        errorString = exports.ErrorString();
+        return false;
+    }
+    return true;
+}
+
+bool PEImageBase::ParseResources()
+{
+    TRACE_SCOPE("ParseResources");
+    if (!resources.Open(*this, dataDirectories[IMAGE_DIRECTORY_ENTRY_RESOURCE].VirtualAddress))
+    {
+        errorString = resources.ErrorString();
+        return false;
+    }
+    return true;
+}
+
+bool PEImageBase::ParseRelocations()
+{
+    TRACE_SCOPE("ParseRelocations");
+    const IMAGE_DATA_DIRECTORY& directory = dataDirectories[IMAGE_DIRECTORY_ENTRY_BASERELOC];
+    if (!relocations.Parse(*this, directory.VirtualAddress, directory.Size, arena))
+    {
+        errorString = relocations.ErrorString();
+        return false;
+    }
+    TRACE_COUNT(Bytes, directory.Size);
+    return true;
+}
+
+template <typename Traits>
+bool PEImage<Traits>::ParseNTHeader()
+{
+    TRACE_SCOPE("ParseNTHeader");
+    // e_lfanew is a signed LONG, so reject negative offsets before using it
+    if (imageDOSHeader->e_lfanew < 0 ||
+        !IsInImage(reinterpret_cast<DWORD_PTR>(imageDOSHeader) + imageDOSHeader->e_lfanew, sizeof(NTHeaders)))
+    {
+        errorString = "e_lfanew points outside the file.";
+        return false;
+    }
+
+    ntHeadersAddress = reinterpret_cast<DWORD_PTR>(imageDOSHeader) + imageDOSHeader->e_lfanew; // e_lfanew is the offset in bytes from the beginning of the DOS header to the NT headers
+    imageNTHeaders = reinterpret_cast<const NTHeaders*>(ntHeadersAddress);
+    TRACE_COUNT(Bytes, sizeof(NTHeaders));
+
+    if (imageNTHeaders->Signature != IMAGE_NT_SIGNATURE)
+    {
+        errorString = "Missing PE signature.";
+        return false;
+    }
+    return true;
+}
+
+template <typename Traits>
+bool PEImage<Traits>::ParseOptionalHeader()
+{
+    TRACE_SCOPE("ParseOptionalHeader");
+    imageOptionalHeader = &imageNTHeaders->OptionalHeader;
+
+    if (imageOptionalHeader->Magic != Traits::magic)
+    {
+        errorString = "Optional header magic does not match the image width.";
+        return false;
+    }
+
+    sizeOfHeaders = imageOptionalHeader->SizeOfHeaders;
+    entryPoint = imageOptionalHeader->AddressOfEntryPoint;
+    return true;
+}
+
+template <typename Traits>
+bool PEImage<Traits>::ParseDataDirectories()
+{
+    TRACE_SCOPE("ParseDataDirectories");
+    // Entries past NumberOfRvaAndSizes are not part of the header and stay zero
+    DWORD count = imageOptionalHeader->NumberOfRvaAndSizes;
+    if (count > IMAGE_NUMBEROF_DIRECTORY_ENTRIES)
+        count = IMAGE_NUMBEROF_DIRECTORY_ENTRIES;
+    for (DWORD i = 0; i < IMAGE_NUMBEROF_DIRECTORY_ENTRIES; i++)
+        dataDirectories[i] = i < count ? imageOptionalHeader->DataDirectory[i] : IMAGE_DATA_DIRECTORY{};
+    return true;
+}
+
+template <typename Traits>
+bool PEImage<Traits>::ParseImports()
+{
+    TRACE_SCOPE("ParseImports");
+
+    // No import directory is not an error, the image simply has no imports
+    if (!imports.template Parse<Traits>(*this, dataDirectories[IMAGE_DIRECTORY_ENTRY_IMPORT].VirtualAddress, arena))
+    {
+        errorString = imports.ErrorString();
+        return false;
+    }
+    TRACE_COUNT(Imports, imports.FunctionCount());
+    return true;
+}
+
+template <typename Traits>
+bool PEImage<Traits>::Parse()
+{
+    return ParseDOSHeader() &&
+           ParseNTHeader() &&
+           ParseFileHeader() &&
+           ParseOptionalHeader() &&
+           ParseSectionHeader() &&
+           ParseDataDirectories() &&
+           ParseSections() &&
+           ParseImports() &&
+           ParseExports() &&
+           ParseResources() &&
+           ParseRelocations();
+}
+
+template <typename Traits>
+bool PEImage<Traits>::Rebase(BYTE* copy, ULONGLONG newBase, RebaseResult& result) const
+{
+    typedef decltype(imageOptionalHeader->ImageBase) ImageBaseValue;
+
+    result = RebaseResult();
+    if (imageFileHeader->Characteristics & IMAGE_FILE_RELOCS_STRIPPED)
+        return false;
+    if (static_cast<ImageBaseValue>(newBase) != newBase)
+        return false;
+
+    // Relocations hold absolute addresses, so the delta wraps exactly like the loader's arithmetic
+    ULONGLONG delta = newBase - imageOptionalHeader->ImageBase;
+    size_t imageBaseOffset = reinterpret_cast<const BYTE*>(&imageOptionalHeader->ImageBase) - reinterpret_cast<const BYTE*>(imageBase);
+    ImageBaseValue value = static_cast<ImageBaseValue>(newBase);
+    memcpy(copy + imageBaseOffset, &value, sizeof(value));
+
+    if (delta != 0)
+        result = relocations.Apply(*this, copy, delta);
+    return true;
+}
+
+// Both widths are instantiated here so the parser body stays out of the header
+template class PEImage<PE32Traits>;
+template class PEImage<PE64Traits>;
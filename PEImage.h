@@ -0,0 +1,200 @@
+#ifndef PEIMAGE_H
+#define PEIMAGE_H
+
+#include "PETypes.h"
+#include "Arena.h"
+#include "ExportTable.h"
+#include "ImportTable.h"
+#include "RelocationTable.h"
+#include "ResourceDirectory.h"
+#include "RvaIndex.h"
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Compile-time description of one PE width.
+// PEImage<Traits> picks its header, thunk and ordinal-flag types from here,
+// so PE32 and PE32+ share one parser with no virtual calls.
+struct PE32Traits
+{
+    typedef IMAGE_NT_HEADERS32 NTHeaders;
+    typedef IMAGE_OPTIONAL_HEADER32 OptionalHeader;
+    typedef IMAGE_THUNK_DATA32 ThunkData;
+    typedef DWORD ThunkValue;
+
+    static constexpr WORD magic = IMAGE_NT_OPTIONAL_HDR32_MAGIC;
+    static constexpr ThunkValue ordinalFlag = IMAGE_ORDINAL_FLAG32;
+};
+
+struct PE64Traits
+{
+    typedef IMAGE_NT_HEADERS64 NTHeaders;
+    typedef IMAGE_OPTIONAL_HEADER64 OptionalHeader;
+    typedef IMAGE_THUNK_DATA64 ThunkData;
+    typedef ULONGLONG ThunkValue;
+
+    static constexpr WORD magic = IMAGE_NT_OPTIONAL_HDR64_MAGIC;
+    static constexpr ThunkValue ordinalFlag = IMAGE_ORDINAL_FLAG64;
+};
+
+// Read OptionalHeader.Magic straight from the mapped image so callers can pick PE32 or PE64
+// without reopening the file. Returns 0 if the image has no valid MZ/PE headers.
+WORD DetectImageMagic(LPCVOID imageBase, size_t imageSize);
+
+// File range of a section's raw data as the loader reads it, clipped to the file. False if it has none.
+bool SectionRawRange(const IMAGE_SECTION_HEADER& section, size_t fileSize, size_t& offset, size_t& size);
+
+// State and stages that are identical for both widths
+class PEImageBase
+{
+public:
+    PEImageBase()
+    {
+
+    }
+
+    PEImageBase(LPCVOID _imageBase, size_t _imageSize)
+    {
+        imageBase = _imageBase;
+        imageSize = _imageSize;
+    }
+
+    LPCVOID GetImageBase() const { return imageBase; }
+    size_t GetImageSize() const { return imageSize; }
+    const IMAGE_DOS_HEADER* GetDOSHeader() const { return imageDOSHeader; }
+    const IMAGE_FILE_HEADER* GetFileHeader() const { return imageFileHeader; }
+    const IMAGE_SECTION_HEADER* GetSectionHeader() const { return imageSectionHeader; }
+    const std::vector<IMAGE_SECTION_HEADER>& GetSections() const { return sections; }
+    const ImportTable& GetImports() const { return imports; }
+    const ExportTable& GetExports() const { return exports; }
+    const ResourceDirectory& GetResources() const { return resources; }
+    const RelocationTable& GetRelocations() const { return relocations; }
+    const std::string& ErrorString() const { return errorString; }
+    const RvaIndex& GetRvaIndex() const { return rvaIndex; }
+    DWORD GetEntryPoint() const { return entryPoint; } // AddressOfEntryPoint, valid after ParseOptionalHeader
+    DWORD GetSizeOfHeaders() const { return sizeOfHeaders; } // Copied by ParseOptionalHeader, like the entry point
+
+    // Data directory entry, zeroed when the optional header declares fewer than index + 1 entries
+    const IMAGE_DATA_DIRECTORY& GetDataDirectory(int index) const { return dataDirectories[index]; }
+
+    // Bounds-checked RVA translation, valid once ParseSections has built the index
+    bool RvaToOffset(DWORD rva, size_t length, size_t& offset) const
+    {
+        return rvaIndex.ToOffset(rva, length, offset);
+    }
+
+    // Pointer to count objects of type T at rva, or nullptr if they are not all in the file
+    template <typename T>
+    const T* RvaToPointer(DWORD rva, size_t count = 1) const
+    {
+        size_t offset;
+        if (count > imageSize / sizeof(T) || !rvaIndex.ToOffset(rva, count * sizeof(T), offset))
+            return nullptr;
+        return reinterpret_cast<const T*>(reinterpret_cast<const BYTE*>(imageBase) + offset);
+    }
+
+    // NUL-terminated string at rva, or nullptr if it does not end within the file
+    const char* RvaToString(DWORD rva) const;
+    // Same, without the terminator; data() is nullptr on failure
+    std::string_view RvaToStringView(DWORD rva) const;
+
+    // Each stage returns false and sets errorString if the image is malformed
+    bool ParseDOSHeader();
+    bool ParseFileHeader();
+    bool ParseSectionHeader();
+    bool ParseSections();
+    bool ParseExports();
+    bool ParseResources();
+    bool ParseRelocations();
+
+protected:
+    // Check that [address, address + length) lies within the mapped image
+    inline bool IsInImage(DWORD_PTR address, size_t length) const
+    {
+        DWORD_PTR begin = reinterpret_cast<DWORD_PTR>(imageBase);
+        return address >= begin && address - begin <= imageSize && length <= imageSize - (address - begin);
+    }
+
+    // Check that a NUL-terminated string starts at address and ends within the mapped image
+    bool IsStringInImage(DWORD_PTR address) const;
+
+    LPCVOID imageBase = nullptr;
+    size_t imageSize = 0;
+    DWORD_PTR ntHeadersAddress = 0;
+    DWORD sizeOfHeaders = 0;
+    DWORD entryPoint = 0;
+    const IMAGE_DOS_HEADER* imageDOSHeader = nullptr;
+    const IMAGE_FILE_HEADER* imageFileHeader = nullptr;
+    const IMAGE_SECTION_HEADER* imageSectionHeader = nullptr;
+    DWORD virtualSize;
+    DWORD virtualAddr;
+    std::vector<IMAGE_SECTION_HEADER> sections;
+    Arena arena; // Backs the directory tables, released with the image
+    ImportTable imports;
+    IMAGE_DATA_DIRECTORY dataDirectories[IMAGE_NUMBEROF_DIRECTORY_ENTRIES] = {};
+    ExportTable exports;
+    ResourceDirectory resources; // Root level only, deeper levels are read on demand
+    RelocationTable relocations;
+    std::string errorString;
+    RvaIndex rvaIndex;
+};
+
+template <typename Traits>
+class PEImage : public PEImageBase
+{
+public:
+    typedef typename Traits::NTHeaders NTHeaders;
+    typedef typename Traits::OptionalHeader OptionalHeader;
+    typedef typename Traits::ThunkData ThunkData;
+    typedef typename Traits::ThunkValue ThunkValue;
+
+    PEImage()
+    {
+
+    }
+
+    PEImage(LPCVOID _imageBase, size_t _imageSize)
+        : PEImageBase(_imageBase, _imageSize)
+    {
+
+    }
+
+    // Helper function to check if import is by ordinal
+    static inline bool IsImportByOrdinal(ThunkValue ordinal)
+    {
+        // MSB specifies whether import is by ordinal or by name
+        // Non-zero value = import was by ordinal
+        // Zero value = import was by name
+        return (ordinal & Traits::ordinalFlag) != 0;
+    }
+
+    // Helper function to extract ordinal value
+    static inline WORD GetOrdinalValue(ThunkValue ordinal)
+    {
+        // Extract ordinal number which is stored in lower 16 bits
+        return static_cast<WORD>(ordinal & 0xFFFF);
+    }
+
+    const NTHeaders* GetNTHeaders() const { return imageNTHeaders; }
+    const OptionalHeader* GetOptionalHeader() const { return imageOptionalHeader; }
+
+    bool ParseNTHeader();
+    bool ParseOptionalHeader();
+    bool ParseDataDirectories();
+    bool ParseImports();
+    bool Parse();
+
+    // Patch copy, a writable copy of the mapped file (e.g. a MappedFile opened CopyOnWrite), as if the image
+    // were loaded at newBase: every relocation target and OptionalHeader.ImageBase are updated.
+    // Needs a parsed image; fails if relocations were stripped or newBase does not fit the image width.
+    bool Rebase(BYTE* copy, ULONGLONG newBase, RebaseResult& result) const;
+
+private:
+    const NTHeaders* imageNTHeaders = nullptr;
+    const OptionalHeader* imageOptionalHeader = nullptr;
+};
+
+typedef PEImage<PE32Traits> PE32;
+typedef PEImage<PE64Traits> PE64;
+
+#endif // PEIMAGE_H
@@ -0,0 +1,109 @@
+#include "PageHashes.h"
+#include "Hash.h"
+#include "Trace.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <thread>
+
+// 4 MB per task: enough to hide the hand-out, and a rebuilt binary of a few hundred MB still spreads over all cores
+static const size_t kPagesPerTask = 1024;
+
+void PageHashes::Compute(const BYTE* data, size_t size, unsigned threads)
+{
+    TRACE_SCOPE("HashPages");
+    TRACE_COUNT(Bytes, size);
+    fileSize = size;
+    hashes.assign((size + kPageSize - 1) / kPageSize, 0);
+
+    size_t taskCount = (hashes.size() + kPagesPerTask - 1) / kPagesPerTask;
+    if (threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    threads = unsigned(std::max<size_t>(1, std::min<size_t>(threads, taskCount)));
+
+    std::atomic<size_t> next(0);
+    auto work = [&]()
+    {
+        for (size_t task = next++; task < taskCount; task = next++)
+        {
+            size_t last = std::min(hashes.size(), (task + 1) * kPagesPerTask);
+            for (size_t page = task * kPagesPerTask; page < last; page++)
+            {
+                size_t offset = page * kPageSize;
+                hashes[page] = XXHash64(data + offset, std::min(size - offset, size_t(kPageSize)));
+            }
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (unsigned t = 1; t < threads; t++)
+        workers.emplace_back(work);
+    work();
+    for (std::thread& worker : workers)
+        worker.join();
+}
+
+void PageHashes::Clear()
+{
+    fileSize = 0;
+    hashes.clear();
+}
+
+bool PageHashes::Changed(const PageHashes& older, size_t offset, size_t length) const
+{
+    if (length == 0)
+        return false;
+
+    // A tail page hashes only the bytes that exist, so a size change also shows up in the last page of the shorter file
+    size_t end = offset + std::min(length, SIZE_MAX - offset);
+    if (fileSize != older.fileSize && end > std::min(fileSize, older.fileSize))
+        return true;
+
+    size_t last = std::min(hashes.size(), (end + kPageSize - 1) / kPageSize);
+    for (size_t page = offset / kPageSize; page < last; page++)
+    {
+        if (hashes[page] != older.hashes[page])
+            return true;
+    }
+    return false;
+}
+
+size_t PageHashes::CountChanged(const PageHashes& older) const
+{
+    size_t common = std::min(hashes.size(), older.hashes.size());
+    size_t changed = std::max(hashes.size(), older.hashes.size()) - common;
+    for (size_t page = 0; page < common; page++)
+    {
+        if (hashes[page] != older.hashes[page])
+            changed++;
+    }
+    return changed;
+}
+
+std::vector<std::pair<size_t, size_t>> PageHashes::ChangedRanges(const PageHashes& older) const
+{
+    std::vector<std::pair<size_t, size_t>> ranges;
+    size_t common = std::min(hashes.size(), older.hashes.size());
+    for (size_t page = 0; page < common; page++)
+    {
+        if (hashes[page] == older.hashes[page])
+            continue;
+        size_t begin = page * kPageSize;
+        size_t end = std::min(fileSize, begin + kPageSize);
+        if (!ranges.empty() && ranges.back().second == begin)
+            ranges.back().second = end;
+        else
+            ranges.push_back({ begin, end });
+    }
+
+    // Pages only this file has; a shrunk file has none, its tail page already hashed differently above
+    if (fileSize != older.fileSize)
+    {
+        size_t begin = std::min(fileSize, common * kPageSize);
+        if (!ranges.empty() && ranges.back().second >= begin)
+            ranges.back().second = fileSize;
+        else if (begin < fileSize)
+            ranges.push_back({ begin, fileSize });
+    }
+    return ranges;
+}
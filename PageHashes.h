@@ -0,0 +1,40 @@
+#ifndef PAGEHASHES_H
+#define PAGEHASHES_H
+
+#include "PETypes.h"
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// XXH64 of every 4 KB page of a file. Two snapshots of the same path tell which byte ranges a rebuild touched
+// without keeping the old bytes around. Pages are hashed in parallel on up to `threads` threads
+// (0 = hardware concurrency), each taking runs of pages in file order.
+class PageHashes
+{
+public:
+    static const size_t kPageSize = 4096;
+
+    void Compute(const BYTE* data, size_t size, unsigned threads = 0);
+    void Clear();
+
+    bool IsEmpty() const { return hashes.empty(); }
+    size_t FileSize() const { return fileSize; }
+    size_t PageCount() const { return hashes.size(); }
+
+    // True if [offset, offset + length) may hold different bytes here than in older: a page it touches hashes
+    // differently, or it reaches past the end of either file while the two sizes differ
+    bool Changed(const PageHashes& older, size_t offset, size_t length) const;
+
+    // Pages that differ, counting pages that exist in only one of the two
+    size_t CountChanged(const PageHashes& older) const;
+
+    // [begin, end) byte ranges of this file that may differ from older, in file order with neighbouring pages
+    // joined; a size change also covers everything past the end of the shorter file
+    std::vector<std::pair<size_t, size_t>> ChangedRanges(const PageHashes& older) const;
+
+private:
+    size_t fileSize = 0;
+    std::vector<uint64_t> hashes;
+};
+
+#endif // PAGEHASHES_H
@@ -0,0 +1,191 @@
+#include "ParseCache.h"
+#include "MappedFile.h"
+#include "Trace.h"
+#include <algorithm>
+#include <atomic>
+#include <cinttypes>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+// Entries are evicted down to this fraction of the budget so a full cache does not evict on every store
+static const double kEvictTarget = 0.9;
+
+// Unique across every process sharing the cache directory: the process ID plus a per-process counter
+static std::string TemporarySuffix()
+{
+    static std::atomic<uint64_t> counter{0};
+#ifdef _WIN32
+    unsigned long long process = GetCurrentProcessId();
+#else
+    unsigned long long process = static_cast<unsigned long long>(getpid());
+#endif
+    char suffix[64];
+    snprintf(suffix, sizeof(suffix), ".tmp%llu-%" PRIu64, process, counter.fetch_add(1, std::memory_order_relaxed));
+    return suffix;
+}
+
+static bool ParseEntryName(const fs::path& path, uint64_t& contentHash)
+{
+    std::string name = path.filename().string();
+    if (name.size() != 20 || name.compare(16, 4, ".sum") != 0)
+        return false;
+    return sscanf(name.c_str(), "%16" SCNx64, &contentHash) == 1;
+}
+
+std::string ParseCache::EntryPath(uint64_t contentHash) const
+{
+    char name[32];
+    snprintf(name, sizeof(name), "%02x/%016" PRIx64 ".sum", static_cast<unsigned>(contentHash >> 56), contentHash);
+    return (fs::u8path(directory) / name).u8string();
+}
+
+bool ParseCache::Open(const std::string& _directory, uint64_t _maxBytes)
+{
+    directory = _directory;
+    maxBytes = _maxBytes;
+
+    std::error_code error;
+    fs::create_directories(fs::u8path(directory), error);
+    if (error)
+    {
+        errorString = "Cannot create cache directory: " + error.message();
+        return false;
+    }
+
+    // Recency order is rebuilt from mtimes, oldest first
+    std::vector<std::pair<fs::file_time_type, std::pair<uint64_t, uint64_t>>> found;
+    fs::recursive_directory_iterator it(fs::u8path(directory), error);
+    for (; !error && it != fs::recursive_directory_iterator(); it.increment(error))
+    {
+        uint64_t contentHash;
+        if (!it->is_regular_file(error) || !ParseEntryName(it->path(), contentHash))
+            continue;
+        uint64_t bytes = it->file_size(error);
+        fs::file_time_type modified = it->last_write_time(error);
+        if (!error)
+            found.push_back({ modified, { contentHash, bytes } });
+        error.clear();
+    }
+    std::sort(found.begin(), found.end());
+
+    std::lock_guard<std::mutex> lock(mutex);
+    entries.clear();
+    totalBytes = 0;
+    for (const auto& entry : found)
+    {
+        entries[entry.second.first] = Entry{ entry.second.second, ++clock };
+        totalBytes += entry.second.second;
+    }
+    EvictLocked();
+    return true;
+}
+
+bool ParseCache::Lookup(uint64_t contentHash, uint64_t fileSize, ImageSummary& summary)
+{
+    TRACE_SCOPE("CacheLookup");
+    MappedFile entry;
+    if (!entry.Open(EntryPath(contentHash)) ||
+        !summary.Deserialize(entry.Data(), entry.Size()) ||
+        summary.contentHash != contentHash || summary.fileSize != fileSize)
+    {
+        misses++;
+        return false;
+    }
+
+    hits++;
+    Touch(contentHash);
+    return true;
+}
+
+void ParseCache::Touch(uint64_t contentHash)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = entries.find(contentHash);
+        if (it != entries.end())
+            it->second.lastUse = ++clock;
+    }
+
+    // Persist recency for the next run; failure only costs eviction accuracy
+    std::error_code error;
+    fs::last_write_time(fs::u8path(EntryPath(contentHash)), fs::file_time_type::clock::now(), error);
+}
+
+void ParseCache::Store(const ImageSummary& summary)
+{
+    TRACE_SCOPE("CacheStore");
+    std::string bytes;
+    summary.Serialize(bytes);
+
+    fs::path path = fs::u8path(EntryPath(summary.contentHash));
+    std::error_code error;
+    fs::create_directories(path.parent_path(), error);
+
+    // Unique temporary name per store, renamed over the final name so readers see all or nothing
+    fs::path temporary = path;
+    temporary += TemporarySuffix();
+    {
+        std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+        out.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+        if (!out)
+        {
+            out.close();
+            fs::remove(temporary, error);
+            return;
+        }
+    }
+    fs::rename(temporary, path, error);
+    if (error)
+    {
+        fs::remove(temporary, error);
+        return;
+    }
+
+    stores++;
+    std::lock_guard<std::mutex> lock(mutex);
+    Entry& entry = entries[summary.contentHash];
+    totalBytes = totalBytes - entry.bytes + bytes.size();
+    entry.bytes = bytes.size();
+    entry.lastUse = ++clock;
+    EvictLocked();
+}
+
+void ParseCache::EvictLocked()
+{
+    if (maxBytes == 0 || totalBytes <= maxBytes)
+        return;
+
+    std::vector<std::pair<uint64_t, uint64_t>> byAge; // lastUse, hash
+    byAge.reserve(entries.size());
+    for (const auto& entry : entries)
+        byAge.push_back({ entry.second.lastUse, entry.first });
+    std::sort(byAge.begin(), byAge.end());
+
+    uint64_t target = static_cast<uint64_t>(maxBytes * kEvictTarget);
+    for (const auto& victim : byAge)
+    {
+        if (totalBytes <= target)
+            break;
+        std::error_code error;
+        fs::remove(fs::u8path(EntryPath(victim.second)), error);
+        totalBytes -= entries[victim.second].bytes;
+        entries.erase(victim.second);
+        evictions++;
+    }
+}
+
+ParseCache::Stats ParseCache::GetStats() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return Stats{ hits, misses, stores, evictions, totalBytes, entries.size() };
+}
@@ -0,0 +1,68 @@
+#ifndef PARSECACHE_H
+#define PARSECACHE_H
+
+#include "ImageSummary.h"
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+// On-disk cache of ImageSummary records keyed by the XXH64 of the file contents.
+// One file per entry (<dir>/<hh>/<hash>.sum), written to a temporary name and renamed into place,
+// so concurrent scans never see a half-written entry. The total size is kept under a byte budget
+// by evicting the least recently used entries; a hit refreshes the entry's mtime, which is what
+// recency is rebuilt from the next time the cache is opened.
+// Lookup and Store are safe to call from many threads.
+class ParseCache
+{
+public:
+    struct Stats
+    {
+        uint64_t hits;
+        uint64_t misses;
+        uint64_t stores;
+        uint64_t evictions;
+        uint64_t bytes;   // Current size of all entries
+        uint64_t entries;
+    };
+
+    // Scans the directory (creating it if needed) to rebuild size and recency bookkeeping
+    bool Open(const std::string& directory, uint64_t maxBytes);
+
+    // Fills summary and returns true if an intact entry exists for this content
+    bool Lookup(uint64_t contentHash, uint64_t fileSize, ImageSummary& summary);
+
+    // Writes the summary under summary.contentHash, then evicts down to the budget if needed
+    void Store(const ImageSummary& summary);
+
+    Stats GetStats() const;
+    const std::string& ErrorString() const { return errorString; }
+
+private:
+    struct Entry
+    {
+        uint64_t bytes;
+        uint64_t lastUse; // Monotonic tick; larger is more recent
+    };
+
+    std::string EntryPath(uint64_t contentHash) const;
+    void Touch(uint64_t contentHash);
+    void EvictLocked();
+
+    std::string directory;
+    uint64_t maxBytes = 0;
+    std::string errorString;
+
+    mutable std::mutex mutex;
+    std::unordered_map<uint64_t, Entry> entries;
+    uint64_t totalBytes = 0;
+    uint64_t clock = 0;
+
+    std::atomic<uint64_t> hits{0};
+    std::atomic<uint64_t> misses{0};
+    std::atomic<uint64_t> stores{0};
+    std::atomic<uint64_t> evictions{0};
+};
+
+#endif // PARSECACHE_H
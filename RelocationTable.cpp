@@ -0,0 +1,258 @@
+#include "RelocationTable.h"
+#include "PEImage.h"
+#include "Simd.h"
+#include <cstring>
+
+// Each WORD entry is a 4-bit type over a 12-bit page offset
+typedef void (*SplitKernel)(const BYTE* entries, size_t count, WORD* offsets, BYTE* types);
+
+static void SplitScalar(const BYTE* entries, size_t count, WORD* offsets, BYTE* types)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        WORD entry;
+        memcpy(&entry, entries + i * sizeof(WORD), sizeof(entry));
+        offsets[i] = entry & 0x0FFF;
+        types[i] = static_cast<BYTE>(entry >> 12);
+    }
+}
+
+#if INSPECTOR_X86 && INSPECTOR_X86_64
+
+INSPECTOR_TARGET("sse2")
+static void SplitSse2(const BYTE* entries, size_t count, WORD* offsets, BYTE* types)
+{
+    const __m128i offsetMask = _mm_set1_epi16(0x0FFF);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(entries + i * sizeof(WORD)));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(offsets + i), _mm_and_si128(v, offsetMask));
+
+        // Types fit in a byte, so the shifted words narrow losslessly
+        __m128i t = _mm_srli_epi16(v, 12);
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(types + i), _mm_packus_epi16(t, t));
+    }
+    SplitScalar(entries + i * sizeof(WORD), count - i, offsets + i, types + i);
+}
+
+INSPECTOR_TARGET("avx2")
+static void SplitAvx2(const BYTE* entries, size_t count, WORD* offsets, BYTE* types)
+{
+    const __m256i offsetMask = _mm256_set1_epi16(0x0FFF);
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16)
+    {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(entries + i * sizeof(WORD)));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(offsets + i), _mm256_and_si256(v, offsetMask));
+
+        // packus works per 128-bit lane; gathering qwords 0 and 2 puts the 16 types back in order
+        __m256i t = _mm256_srli_epi16(v, 12);
+        __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(t, t), 0x08);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(types + i), _mm256_castsi256_si128(packed));
+    }
+    SplitScalar(entries + i * sizeof(WORD), count - i, offsets + i, types + i);
+}
+
+#endif // INSPECTOR_X86 && INSPECTOR_X86_64
+
+struct SplitChoice
+{
+    SplitKernel kernel;
+    const char* name;
+};
+
+static SplitChoice SelectSplit()
+{
+#if INSPECTOR_X86 && INSPECTOR_X86_64
+    if (CpuHasAvx2())
+        return { SplitAvx2, "avx2" };
+    if (CpuHasSse2())
+        return { SplitSse2, "sse2" };
+#endif
+    return { SplitScalar, "scalar" };
+}
+
+static const SplitChoice& Split()
+{
+    static const SplitChoice choice = SelectSplit();
+    return choice;
+}
+
+const char* RelocationKernelName()
+{
+    return Split().name;
+}
+
+bool RelocationTable::Parse(const PEImageBase& image, DWORD rva, DWORD size, Arena& arena)
+{
+    pages = nullptr;
+    pageCount = 0;
+    offsets = nullptr;
+    types = nullptr;
+    entryCount = 0;
+    errorString.clear();
+
+    if (rva == 0 || size == 0)
+        return true;
+
+    const BYTE* directory = image.RvaToPointer<BYTE>(rva, size);
+    if (directory == nullptr)
+    {
+        errorString = "Relocation directory extends past the end of the file.";
+        return false;
+    }
+
+    // Header pass: validates the block chain and sizes the arrays. A zero block ends the chain early,
+    // some linkers pad the directory; a trailing fragment shorter than a header is ignored the same way.
+    size_t blockCount = 0;
+    size_t entryTotal = 0;
+    for (DWORD position = 0; size - position >= sizeof(IMAGE_BASE_RELOCATION); )
+    {
+        IMAGE_BASE_RELOCATION block;
+        memcpy(&block, directory + position, sizeof(block));
+        if (block.SizeOfBlock == 0)
+            break;
+        if (block.SizeOfBlock < sizeof(IMAGE_BASE_RELOCATION) || block.SizeOfBlock > size - position)
+        {
+            errorString = "Relocation block size is invalid.";
+            return false;
+        }
+        blockCount++;
+        entryTotal += (block.SizeOfBlock - sizeof(IMAGE_BASE_RELOCATION)) / sizeof(WORD);
+        position += block.SizeOfBlock;
+    }
+
+    if (blockCount == 0)
+        return true;
+    if (entryTotal > UINT32_MAX)
+    {
+        errorString = "Relocation directory is too large.";
+        return false;
+    }
+
+    arena.Reserve(blockCount * sizeof(RelocationPage) + entryTotal * (sizeof(WORD) + sizeof(BYTE)) + 3 * alignof(std::max_align_t));
+    pages = arena.AllocateArray<RelocationPage>(blockCount);
+    offsets = arena.AllocateArray<WORD>(entryTotal);
+    types = arena.AllocateArray<BYTE>(entryTotal);
+
+    // Fill pass: split each block straight into the arrays. The next block starts where the trimmed one ended,
+    // so the dropped padding slots are overwritten and the arrays stay dense.
+    SplitKernel split = Split().kernel;
+    DWORD position = 0;
+    for (size_t b = 0; b < blockCount; b++)
+    {
+        IMAGE_BASE_RELOCATION block;
+        memcpy(&block, directory + position, sizeof(block));
+        size_t count = (block.SizeOfBlock - sizeof(IMAGE_BASE_RELOCATION)) / sizeof(WORD);
+        split(directory + position + sizeof(IMAGE_BASE_RELOCATION), count, offsets + entryCount, types + entryCount);
+        position += block.SizeOfBlock;
+
+        // HIGHADJ takes the next slot as its parameter, which must not be decoded as an entry of its own
+        if (memchr(types + entryCount, IMAGE_REL_BASED_HIGHADJ, count) != nullptr)
+        {
+            size_t kept = 0;
+            for (size_t i = 0; i < count; i++)
+            {
+                BYTE type = types[entryCount + i];
+                offsets[entryCount + kept] = offsets[entryCount + i];
+                types[entryCount + kept] = type;
+                kept++;
+                if (type == IMAGE_REL_BASED_HIGHADJ)
+                    i++;
+            }
+            count = kept;
+        }
+
+        while (count > 0 && types[entryCount + count - 1] == IMAGE_REL_BASED_ABSOLUTE)
+            count--;
+        if (count == 0)
+            continue;
+
+        RelocationPage& page = pages[pageCount++];
+        page.pageRva = block.VirtualAddress;
+        page.begin = static_cast<uint32_t>(entryCount);
+        page.end = static_cast<uint32_t>(entryCount + count);
+        entryCount += count;
+    }
+    return true;
+}
+
+// Add the delta to one target; width is implied by the type
+template <typename T>
+static void AddAt(BYTE* target, T delta)
+{
+    T value;
+    memcpy(&value, target, sizeof(value));
+    value = static_cast<T>(value + delta);
+    memcpy(target, &value, sizeof(value));
+}
+
+static size_t TargetSize(BYTE type)
+{
+    switch (type)
+    {
+    case IMAGE_REL_BASED_HIGH:
+    case IMAGE_REL_BASED_LOW:
+        return sizeof(WORD);
+    case IMAGE_REL_BASED_HIGHLOW:
+        return sizeof(DWORD);
+    case IMAGE_REL_BASED_DIR64:
+        return sizeof(ULONGLONG);
+    }
+    return 0;
+}
+
+RebaseResult RelocationTable::Apply(const PEImageBase& image, BYTE* copy, ULONGLONG delta) const
+{
+    RebaseResult result;
+    const RvaIndex& rvaIndex = image.GetRvaIndex();
+
+    for (const RelocationPage& page : *this)
+    {
+        // One translation per page; targets inside the page's run of file-backed bytes need no further lookup,
+        // the rare one that crosses into the next section goes through the index on its own
+        size_t pageOffset = 0;
+        size_t extent = rvaIndex.RawExtent(page.pageRva, pageOffset);
+
+        for (uint32_t i = page.begin; i < page.end; i++)
+        {
+            BYTE type = types[i];
+            size_t width = TargetSize(type);
+            if (width == 0)
+            {
+                if (type != IMAGE_REL_BASED_ABSOLUTE)
+                    result.skipped++;
+                continue;
+            }
+
+            size_t targetOffset;
+            if (offsets[i] + width <= extent)
+                targetOffset = pageOffset + offsets[i];
+            else if (page.pageRva > UINT32_MAX - offsets[i] || !image.RvaToOffset(page.pageRva + offsets[i], width, targetOffset))
+            {
+                result.skipped++;
+                continue;
+            }
+
+            BYTE* target = copy + targetOffset;
+            switch (type)
+            {
+            case IMAGE_REL_BASED_HIGH:
+                AddAt<WORD>(target, static_cast<WORD>(delta >> 16));
+                break;
+            case IMAGE_REL_BASED_LOW:
+                AddAt<WORD>(target, static_cast<WORD>(delta));
+                break;
+            case IMAGE_REL_BASED_HIGHLOW:
+                AddAt<DWORD>(target, static_cast<DWORD>(delta));
+                break;
+            case IMAGE_REL_BASED_DIR64:
+                AddAt<ULONGLONG>(target, delta);
+                break;
+            }
+            result.applied++;
+        }
+    }
+    return result;
+}
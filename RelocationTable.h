@@ -0,0 +1,65 @@
+#ifndef RELOCATIONTABLE_H
+#define RELOCATIONTABLE_H
+
+#include "PETypes.h"
+#include "Arena.h"
+#include <cstdint>
+#include <string>
+
+class PEImageBase;
+
+// One IMAGE_BASE_RELOCATION block: the [begin, end) range of its entries in the entry arrays
+struct RelocationPage
+{
+    DWORD pageRva;
+    uint32_t begin;
+    uint32_t end;
+};
+
+// Outcome of applying relocations to a copy of the image
+struct RebaseResult
+{
+    size_t applied = 0; // Targets patched
+    size_t skipped = 0; // Unsupported types and targets outside the file
+};
+
+// Base relocation directory as flat arrays: a page table, and per entry the 12-bit page offset and 4-bit type
+// in separate arrays. Each block's WORD entries are split with SIMD, and the padding ABSOLUTE entry that ends
+// most blocks is dropped. Arrays come from the image's arena, sized by a pass over the block headers.
+class RelocationTable
+{
+public:
+    // Decode the relocation directory at [rva, rva + size); an rva of 0 yields an empty table
+    bool Parse(const PEImageBase& image, DWORD rva, DWORD size, Arena& arena);
+
+    size_t PageCount() const { return pageCount; }
+    const RelocationPage& Page(size_t index) const { return pages[index]; }
+    const RelocationPage* begin() const { return pages; }
+    const RelocationPage* end() const { return pages + pageCount; }
+
+    size_t EntryCount() const { return entryCount; }
+    WORD Offset(size_t index) const { return offsets[index]; } // Within the page
+    BYTE Type(size_t index) const { return types[index]; }     // IMAGE_REL_BASED_*
+
+    // Add delta to every relocated target in copy, a writable buffer laid out like the parsed file
+    // (GetImageSize() bytes). HIGH, LOW, HIGHLOW and DIR64 are applied, other types are counted as skipped;
+    // the parameter slot that follows a HIGHADJ is not an entry and is dropped when parsing.
+    RebaseResult Apply(const PEImageBase& image, BYTE* copy, ULONGLONG delta) const;
+
+    const std::string& ErrorString() const { return errorString; }
+
+private:
+    RelocationPage* pages = nullptr;
+    size_t pageCount = 0;
+
+    WORD* offsets = nullptr;
+    BYTE* types = nullptr;
+    size_t entryCount = 0;
+
+    std::string errorString;
+};
+
+// Name of the entry split kernel picked for this CPU ("avx2", "sse2" or "scalar")
+const char* RelocationKernelName();
+
+#endif // RELOCATIONTABLE_H
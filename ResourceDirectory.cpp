@@ -0,0 +1,260 @@
+#include "ResourceDirectory.h"
+#include "PEImage.h"
+#include <cstring>
+
+void ResourceDirectory::Clear()
+{
+    rootRva = 0;
+    root.clear();
+    errorString.clear();
+}
+
+// Directory offsets are relative to the root and may not wrap the address space
+bool ResourceDirectory::OffsetToRva(DWORD offset, DWORD& rva) const
+{
+    if (offset > UINT32_MAX - rootRva)
+        return false;
+    rva = rootRva + offset;
+    return true;
+}
+
+bool ResourceDirectory::Open(const PEImageBase& image, DWORD rva)
+{
+    Clear();
+    if (rva == 0)
+        return true;
+
+    rootRva = rva;
+    if (image.RvaToPointer<IMAGE_RESOURCE_DIRECTORY>(rva) == nullptr)
+    {
+        errorString = "Resource directory points outside the file.";
+        return false;
+    }
+    if (!ReadEntries(image, 0, 0, root))
+    {
+        errorString = "Resource directory entries extend past the end of the file.";
+        return false;
+    }
+    return true;
+}
+
+bool ResourceDirectory::ReadEntries(const PEImageBase& image, DWORD offset, int depth, std::vector<ResourceEntry>& entries) const
+{
+    entries.clear();
+
+    DWORD directoryRva;
+    if (!OffsetToRva(offset, directoryRva))
+        return false;
+    const IMAGE_RESOURCE_DIRECTORY* directory = image.RvaToPointer<IMAGE_RESOURCE_DIRECTORY>(directoryRva);
+    if (directory == nullptr)
+        return false;
+
+    // Named entries come first, then ID entries; both counts are WORDs so this cannot overflow
+    DWORD count = static_cast<DWORD>(directory->NumberOfNamedEntries) + directory->NumberOfIdEntries;
+    if (count == 0)
+        return true;
+
+    DWORD entriesRva;
+    if (!OffsetToRva(offset + static_cast<DWORD>(sizeof(IMAGE_RESOURCE_DIRECTORY)), entriesRva))
+        return false;
+    const IMAGE_RESOURCE_DIRECTORY_ENTRY* raw = image.RvaToPointer<IMAGE_RESOURCE_DIRECTORY_ENTRY>(entriesRva, count);
+    if (raw == nullptr)
+        return false;
+
+    entries.reserve(count);
+    for (DWORD i = 0; i < count; i++)
+    {
+        ResourceEntry entry = {};
+        entry.depth = depth;
+        entry.isDirectory = (raw[i].OffsetToData & IMAGE_RESOURCE_DATA_IS_DIRECTORY) != 0;
+        entry.offset = raw[i].OffsetToData & ~static_cast<DWORD>(IMAGE_RESOURCE_DATA_IS_DIRECTORY);
+
+        if (raw[i].Name & IMAGE_RESOURCE_NAME_IS_STRING)
+        {
+            // Counted UTF-16 string: a WORD length, then that many code units
+            DWORD nameOffset = raw[i].Name & ~static_cast<DWORD>(IMAGE_RESOURCE_NAME_IS_STRING);
+            DWORD lengthRva, charsRva;
+            const WORD* length = nullptr;
+            if (OffsetToRva(nameOffset, lengthRva) && OffsetToRva(nameOffset + sizeof(WORD), charsRva))
+                length = image.RvaToPointer<WORD>(lengthRva);
+            if (length == nullptr)
+                return false;
+            entry.nameLength = *length;
+            entry.name = image.RvaToPointer<BYTE>(charsRva, static_cast<size_t>(entry.nameLength) * 2);
+            if (entry.name == nullptr)
+                return false;
+        }
+        else
+        {
+            entry.id = raw[i].Name;
+        }
+        entries.push_back(entry);
+    }
+    return true;
+}
+
+bool ResourceDirectory::ReadDirectory(const PEImageBase& image, const ResourceEntry& parent, std::vector<ResourceEntry>& children) const
+{
+    children.clear();
+    if (!parent.isDirectory || parent.depth + 1 >= kMaxDepth)
+        return false;
+    return ReadEntries(image, parent.offset, parent.depth + 1, children);
+}
+
+bool ResourceDirectory::ReadData(const PEImageBase& image, const ResourceEntry& leaf, ResourceData& data) const
+{
+    if (leaf.isDirectory)
+        return false;
+
+    DWORD entryRva;
+    if (!OffsetToRva(leaf.offset, entryRva))
+        return false;
+    const IMAGE_RESOURCE_DATA_ENTRY* entry = image.RvaToPointer<IMAGE_RESOURCE_DATA_ENTRY>(entryRva);
+    if (entry == nullptr)
+        return false;
+
+    // Unlike every other offset in the tree, OffsetToData is a plain RVA
+    size_t fileOffset;
+    if (!image.RvaToOffset(entry->OffsetToData, entry->Size, fileOffset))
+        return false;
+
+    data.data = reinterpret_cast<const BYTE*>(image.GetImageBase()) + fileOffset;
+    data.size = entry->Size;
+    data.rva = entry->OffsetToData;
+    data.codePage = entry->CodePage;
+    data.fileOffset = fileOffset;
+    return true;
+}
+
+bool ResourceDirectory::Walk(const PEImageBase& image, const Visitor& visitor, size_t maxEntries) const
+{
+    struct Frame
+    {
+        std::vector<ResourceEntry> entries;
+        size_t next;
+    };
+
+    // One frame per level; kMaxDepth bounds the stack, and the heap buffers of the entry vectors
+    // do not move when frames are pushed, so path pointers stay valid
+    std::vector<Frame> stack;
+    stack.reserve(kMaxDepth);
+    stack.push_back({ root, 0 });
+    const ResourceEntry* path[kMaxDepth];
+
+    bool complete = true;
+    size_t visited = 0;
+    while (!stack.empty())
+    {
+        Frame& frame = stack.back();
+        if (frame.next == frame.entries.size())
+        {
+            stack.pop_back();
+            continue;
+        }
+        if (++visited > maxEntries)
+            return false;
+
+        const ResourceEntry& entry = frame.entries[frame.next++];
+        int length = static_cast<int>(stack.size());
+        path[length - 1] = &entry;
+        if (!entry.isDirectory)
+        {
+            visitor(path, length);
+            continue;
+        }
+
+        // A malformed subtree is skipped, the rest of the tree is still worth reporting
+        Frame child = { {}, 0 };
+        if (!ReadDirectory(image, entry, child.entries))
+        {
+            complete = false;
+            continue;
+        }
+        stack.push_back(std::move(child));
+    }
+    return complete;
+}
+
+const char* ResourceTypeName(DWORD id)
+{
+    switch (id)
+    {
+    case 1:  return "CURSOR";
+    case 2:  return "BITMAP";
+    case 3:  return "ICON";
+    case 4:  return "MENU";
+    case 5:  return "DIALOG";
+    case 6:  return "STRING";
+    case 7:  return "FONTDIR";
+    case 8:  return "FONT";
+    case 9:  return "ACCELERATOR";
+    case 10: return "RCDATA";
+    case 11: return "MESSAGETABLE";
+    case 12: return "GROUP_CURSOR";
+    case 14: return "GROUP_ICON";
+    case 16: return "VERSION";
+    case 17: return "DLGINCLUDE";
+    case 19: return "PLUGPLAY";
+    case 20: return "VXD";
+    case 21: return "ANICURSOR";
+    case 22: return "ANIICON";
+    case 23: return "HTML";
+    case 24: return "MANIFEST";
+    }
+    return nullptr;
+}
+
+std::string ResourceEntryName(const ResourceEntry& entry)
+{
+    if (entry.name == nullptr)
+    {
+        const char* typeName = entry.depth == 0 ? ResourceTypeName(entry.id) : nullptr;
+        return typeName != nullptr ? std::string(typeName) : "#" + std::to_string(entry.id);
+    }
+
+    // UTF-16LE to UTF-8; unpaired surrogates become U+FFFD
+    std::string name;
+    name.reserve(entry.nameLength);
+    for (size_t i = 0; i < entry.nameLength; i++)
+    {
+        WORD unit;
+        memcpy(&unit, entry.name + i * 2, sizeof(unit));
+        uint32_t codePoint = unit;
+        if (unit >= 0xD800 && unit < 0xDC00 && i + 1 < entry.nameLength)
+        {
+            WORD low;
+            memcpy(&low, entry.name + (i + 1) * 2, sizeof(low));
+            if (low >= 0xDC00 && low < 0xE000)
+            {
+                codePoint = 0x10000 + ((unit - 0xD800u) << 10) + (low - 0xDC00u);
+                i++;
+            }
+        }
+        if (codePoint >= 0xD800 && codePoint < 0xE000)
+            codePoint = 0xFFFD;
+
+        if (codePoint < 0x80)
+        {
+            name += static_cast<char>(codePoint);
+        }
+        else if (codePoint < 0x800)
+        {
+            name += static_cast<char>(0xC0 | (codePoint >> 6));
+            name += static_cast<char>(0x80 | (codePoint & 0x3F));
+        }
+        else if (codePoint < 0x10000)
+        {
+            name += static_cast<char>(0xE0 | (codePoint >> 12));
+            name += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+            name += static_cast<char>(0x80 | (codePoint & 0x3F));
+        }
+        else
+        {
+            name += static_cast<char>(0xF0 | (codePoint >> 18));
+            name += static_cast<char>(0x80 | ((codePoint >> 12) & 0x3F));
+            name += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+            name += static_cast<char>(0x80 | (codePoint & 0x3F));
+        }
+    }
+    return name;
+}
@@ -0,0 +1,81 @@
+#ifndef RESOURCEDIRECTORY_H
+#define RESOURCEDIRECTORY_H
+
+#include "PETypes.h"
+#include <functional>
+#include <string>
+#include <vector>
+
+class PEImageBase;
+
+// One entry of a resource directory level. Names point into the mapped image.
+struct ResourceEntry
+{
+    DWORD id;          // Integer ID, meaningful when name is nullptr
+    const BYTE* name;  // UTF-16LE, not terminated and not necessarily aligned; nullptr for ID entries
+    WORD nameLength;   // In UTF-16 code units
+    bool isDirectory;
+    DWORD offset;      // Subdirectory or data entry, relative to the start of the resource directory
+    int depth;         // 0 = type, 1 = name, 2 = language
+};
+
+// Leaf payload, a view into the mapped image
+struct ResourceData
+{
+    const BYTE* data;
+    DWORD size;
+    DWORD rva;
+    DWORD codePage;
+    size_t fileOffset;
+};
+
+// Resource tree decoded one level at a time.
+// Opening an image only reads the root; subdirectories and data entries are decoded when a caller
+// asks for them, so a huge .rsrc costs nothing until it is browsed. Every read is bounds-checked
+// through the image's RvaIndex and the depth is capped, so crafted trees cannot loop.
+// Read methods are const and safe to call from several threads once Open has returned.
+class ResourceDirectory
+{
+public:
+    // The loader never looks past type/name/language
+    static constexpr int kMaxDepth = 3;
+    // Upper bound on entries visited by one Walk; shared subdirectories can otherwise fan out exponentially
+    static constexpr size_t kMaxWalkEntries = 1 << 20;
+
+    typedef std::function<void(const ResourceEntry* const* path, int length)> Visitor;
+
+    // Decode the root directory at rva. An image without resources yields an empty tree.
+    bool Open(const PEImageBase& image, DWORD rva);
+    void Clear();
+
+    bool IsEmpty() const { return root.empty(); }
+    const std::vector<ResourceEntry>& Root() const { return root; }
+    DWORD GetRva() const { return rootRva; }
+    const std::string& ErrorString() const { return errorString; }
+
+    // Decode the level below a directory entry; false if it is malformed or nested too deeply
+    bool ReadDirectory(const PEImageBase& image, const ResourceEntry& parent, std::vector<ResourceEntry>& children) const;
+
+    // Resolve a leaf's data entry; false if it or its payload lies outside the file
+    bool ReadData(const PEImageBase& image, const ResourceEntry& leaf, ResourceData& data) const;
+
+    // Depth-first walk over every leaf with an explicit stack. path[0] is the type entry, path[length - 1] the leaf.
+    // Returns false if a subdirectory was malformed or maxEntries was reached; leaves seen so far were still visited.
+    bool Walk(const PEImageBase& image, const Visitor& visitor, size_t maxEntries = kMaxWalkEntries) const;
+
+private:
+    bool ReadEntries(const PEImageBase& image, DWORD offset, int depth, std::vector<ResourceEntry>& entries) const;
+    bool OffsetToRva(DWORD offset, DWORD& rva) const;
+
+    DWORD rootRva = 0;
+    std::vector<ResourceEntry> root;
+    std::string errorString;
+};
+
+// Predefined type name (RT_ICON -> "ICON") or nullptr if id is not one
+const char* ResourceTypeName(DWORD id);
+
+// Display name: the UTF-8 name, the type name for predefined types at depth 0, otherwise "#id"
+std::string ResourceEntryName(const ResourceEntry& entry);
+
+#endif // RESOURCEDIRECTORY_H
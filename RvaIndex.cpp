@@ -0,0 +1,135 @@
+#include "RvaIndex.h"
+#include <algorithm>
+
+void RvaIndex::Build(const std::vector<IMAGE_SECTION_HEADER>& sections, DWORD sizeOfHeaders, size_t _fileSize)
+{
+    intervals.clear();
+    lastHit = 0;
+    fileSize = _fileSize;
+    headerSize = static_cast<DWORD>(std::min<size_t>(sizeOfHeaders, fileSize));
+
+    for (size_t i = 0; i < sections.size(); i++)
+    {
+        const IMAGE_SECTION_HEADER& section = sections[i];
+
+        // A zero VirtualSize means the loader uses SizeOfRawData instead
+        DWORD virtualSize = section.Misc.VirtualSize != 0 ? section.Misc.VirtualSize : section.SizeOfRawData;
+        if (virtualSize == 0)
+            continue;
+
+        // The loader rounds PointerToRawData down to 512 bytes, whatever FileAlignment says
+        DWORD rawOffset = section.PointerToRawData & ~0x1FFu;
+        DWORD rawSize = std::min(section.SizeOfRawData, virtualSize);
+
+        // Clamp to what is actually in the file so a lookup can never run past EOF
+        if (rawOffset >= fileSize)
+            rawSize = 0;
+        else
+            rawSize = static_cast<DWORD>(std::min<size_t>(rawSize, fileSize - rawOffset));
+
+        Interval interval;
+        interval.begin = section.VirtualAddress;
+        interval.end = static_cast<DWORD>(std::min<ULONGLONG>(static_cast<ULONGLONG>(section.VirtualAddress) + virtualSize, 0xFFFFFFFFull));
+        interval.rawOffset = rawOffset;
+        interval.rawSize = rawSize;
+        interval.section = static_cast<int>(i);
+        intervals.push_back(interval);
+    }
+
+    std::sort(intervals.begin(), intervals.end(),
+              [](const Interval& a, const Interval& b) { return a.begin < b.begin; });
+}
+
+RvaIndex::RvaIndex(const RvaIndex& other)
+    : intervals(other.intervals), lastHit(other.lastHit.load(std::memory_order_relaxed)),
+      headerSize(other.headerSize), fileSize(other.fileSize)
+{
+
+}
+
+RvaIndex& RvaIndex::operator=(const RvaIndex& other)
+{
+    intervals = other.intervals;
+    lastHit.store(other.lastHit.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    headerSize = other.headerSize;
+    fileSize = other.fileSize;
+    return *this;
+}
+
+void RvaIndex::Clear()
+{
+    intervals.clear();
+    lastHit = 0;
+    headerSize = 0;
+    fileSize = 0;
+}
+
+const RvaIndex::Interval* RvaIndex::Find(DWORD rva) const
+{
+    if (intervals.empty())
+        return nullptr;
+
+    // Fast path: same section as the previous lookup
+    const Interval& cached = intervals[lastHit.load(std::memory_order_relaxed)];
+    if (rva >= cached.begin && rva < cached.end)
+        return &cached;
+
+    // Last interval starting at or before rva
+    auto it = std::upper_bound(intervals.begin(), intervals.end(), rva,
+                               [](DWORD value, const Interval& interval) { return value < interval.begin; });
+    if (it == intervals.begin())
+        return nullptr;
+    --it;
+
+    if (rva >= it->end)
+        return nullptr;
+
+    lastHit.store(static_cast<size_t>(it - intervals.begin()), std::memory_order_relaxed);
+    return &*it;
+}
+
+bool RvaIndex::ToOffset(DWORD rva, size_t length, size_t& offset) const
+{
+    const Interval* interval = Find(rva);
+    if (interval == nullptr)
+    {
+        // Headers are mapped 1:1 below the first section
+        if (rva < headerSize && length <= headerSize - rva)
+        {
+            offset = rva;
+            return true;
+        }
+        return false;
+    }
+
+    DWORD delta = rva - interval->begin;
+    if (delta > interval->rawSize || length > interval->rawSize - delta)
+        return false;
+
+    offset = static_cast<size_t>(interval->rawOffset) + delta;
+    return true;
+}
+
+size_t RvaIndex::RawExtent(DWORD rva, size_t& offset) const
+{
+    const Interval* interval = Find(rva);
+    if (interval == nullptr)
+    {
+        if (rva >= headerSize)
+            return 0;
+        offset = rva;
+        return headerSize - rva;
+    }
+
+    DWORD delta = rva - interval->begin;
+    if (delta >= interval->rawSize)
+        return 0;
+    offset = static_cast<size_t>(interval->rawOffset) + delta;
+    return interval->rawSize - delta;
+}
+
+int RvaIndex::SectionIndex(DWORD rva) const
+{
+    const Interval* interval = Find(rva);
+    return interval != nullptr ? interval->section : -1;
+}
@@ -0,0 +1,52 @@
+#ifndef RVAINDEX_H
+#define RVAINDEX_H
+
+#include "PETypes.h"
+#include <atomic>
+#include <vector>
+
+// RVA -> file offset translation shared by every directory parser.
+// Built once from the section table: intervals are sorted by RVA and looked up with a binary search,
+// with the last matching interval cached since consecutive lookups (thunks, names) usually hit the same section.
+// Build and Clear need exclusive access; lookups may run concurrently (the GUI thread reads the
+// resource tree while the worker is still parsing), the cache is only a relaxed hint.
+class RvaIndex
+{
+public:
+    RvaIndex() {}
+    RvaIndex(const RvaIndex& other);
+    RvaIndex& operator=(const RvaIndex& other);
+
+    void Build(const std::vector<IMAGE_SECTION_HEADER>& sections, DWORD sizeOfHeaders, size_t fileSize);
+    void Clear();
+
+    // Translate [rva, rva + length) to a file offset.
+    // Fails if any byte of the range is not backed by the file (unmapped, zero-fill or past EOF).
+    bool ToOffset(DWORD rva, size_t length, size_t& offset) const;
+
+    // File offset of rva and the number of bytes from there that are backed by the file in one run; 0 if none.
+    // Lets a caller translate once and bounds-check many nearby reads itself.
+    size_t RawExtent(DWORD rva, size_t& offset) const;
+
+    // Index into the section table of the section containing rva, or -1
+    int SectionIndex(DWORD rva) const;
+
+private:
+    struct Interval
+    {
+        DWORD begin;     // First RVA of the section
+        DWORD end;       // One past the last RVA of the section in memory
+        DWORD rawOffset; // File offset of begin
+        DWORD rawSize;   // Bytes of the section actually present in the file
+        int section;     // Index into the section table
+    };
+
+    const Interval* Find(DWORD rva) const;
+
+    std::vector<Interval> intervals;
+    mutable std::atomic<size_t> lastHit{0};
+    DWORD headerSize = 0;
+    size_t fileSize = 0;
+};
+
+#endif // RVAINDEX_H
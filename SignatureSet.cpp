@@ -0,0 +1,892 @@
+#include "SignatureSet.h"
+#include "Hash.h"
+#include "MappedFile.h"
+#include "PEImage.h"
+#include "Simd.h"
+#include "Trace.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <thread>
+
+typedef SignatureSet::Automaton Automaton;
+
+// Longer anchors barely cut verification work but add states
+static const size_t kMaxAnchor = 8;
+// Deep edges pack the target state under the byte in 24 bits
+static const size_t kMaxStates = size_t(1) << 24;
+// Work unit for parallel scans; chunks overlap by one anchor so none is missed at a boundary
+static const size_t kChunkSize = 1024 * 1024;
+
+static bool HasBit(const uint64_t* bits, size_t index)
+{
+    return (bits[index >> 6] >> (index & 63)) & 1;
+}
+
+static void SetBit(uint64_t* bits, size_t index)
+{
+    bits[index >> 6] |= uint64_t(1) << (index & 63);
+}
+
+// Whether an anchor can start at position. Exact for the byte pair; the last byte of the file only has the first.
+static bool IsCandidate(const Automaton& automaton, const BYTE* data, size_t position, size_t size)
+{
+    if (position + 1 < size)
+        return HasBit(automaton.pairs.data(), size_t(data[position]) << 8 | data[position + 1]);
+    return HasBit(automaton.first, data[position]);
+}
+
+// First candidate position in [position, end), or end. data must be readable up to size, end <= size.
+typedef size_t (*PrefilterKernel)(const Automaton& automaton, const BYTE* data, size_t position, size_t end, size_t size);
+
+static size_t PrefilterScalar(const Automaton& automaton, const BYTE* data, size_t position, size_t end, size_t size)
+{
+    for (; position < end; position++)
+    {
+        if (IsCandidate(automaton, data, position, size))
+            return position;
+    }
+    return end;
+}
+
+#if INSPECTOR_X86 && INSPECTOR_X86_64
+
+// Set membership for 16 bytes at once with two table lookups: the low nibble selects a row of the set (one bit per
+// high nibble, split over two tables), the high nibble selects the bit. Nonzero result bytes are members.
+INSPECTOR_TARGET("ssse3")
+static inline __m128i MembersSsse3(__m128i v, __m128i low, __m128i high)
+{
+    const __m128i nibble = _mm_set1_epi8(0x0F);
+    const __m128i bitLow = _mm_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128, 0, 0, 0, 0, 0, 0, 0, 0);
+    const __m128i bitHigh = _mm_setr_epi8(0, 0, 0, 0, 0, 0, 0, 0, 1, 2, 4, 8, 16, 32, 64, -128);
+    __m128i lo = _mm_and_si128(v, nibble);
+    __m128i hi = _mm_and_si128(_mm_srli_epi16(v, 4), nibble);
+    return _mm_or_si128(_mm_and_si128(_mm_shuffle_epi8(low, lo), _mm_shuffle_epi8(bitLow, hi)),
+                        _mm_and_si128(_mm_shuffle_epi8(high, lo), _mm_shuffle_epi8(bitHigh, hi)));
+}
+
+INSPECTOR_TARGET("ssse3")
+static size_t PrefilterSsse3(const Automaton& automaton, const BYTE* data, size_t position, size_t end, size_t size)
+{
+    const __m128i firstLow = _mm_loadu_si128(reinterpret_cast<const __m128i*>(automaton.firstLow));
+    const __m128i firstHigh = _mm_loadu_si128(reinterpret_cast<const __m128i*>(automaton.firstHigh));
+    const __m128i secondLow = _mm_loadu_si128(reinterpret_cast<const __m128i*>(automaton.secondLow));
+    const __m128i secondHigh = _mm_loadu_si128(reinterpret_cast<const __m128i*>(automaton.secondHigh));
+    const __m128i zero = _mm_setzero_si128();
+
+    // The second-byte load reads one past the block
+    for (; position + 16 < end; position += 16)
+    {
+        __m128i first = MembersSsse3(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + position)), firstLow, firstHigh);
+        __m128i second = MembersSsse3(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + position + 1)), secondLow, secondHigh);
+        __m128i rejected = _mm_or_si128(_mm_cmpeq_epi8(first, zero), _mm_cmpeq_epi8(second, zero));
+        unsigned candidates = ~unsigned(_mm_movemask_epi8(rejected)) & 0xFFFF;
+        while (candidates != 0)
+        {
+            size_t candidate = position + CountTrailingZeros(candidates);
+            if (IsCandidate(automaton, data, candidate, size))
+                return candidate;
+            candidates &= candidates - 1;
+        }
+    }
+    return PrefilterScalar(automaton, data, position, end, size);
+}
+
+INSPECTOR_TARGET("avx2")
+static inline __m256i MembersAvx2(__m256i v, __m256i low, __m256i high)
+{
+    const __m256i nibble = _mm256_set1_epi8(0x0F);
+    const __m256i bitLow = _mm256_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128, 0, 0, 0, 0, 0, 0, 0, 0,
+                                            1, 2, 4, 8, 16, 32, 64, -128, 0, 0, 0, 0, 0, 0, 0, 0);
+    const __m256i bitHigh = _mm256_setr_epi8(0, 0, 0, 0, 0, 0, 0, 0, 1, 2, 4, 8, 16, 32, 64, -128,
+                                             0, 0, 0, 0, 0, 0, 0, 0, 1, 2, 4, 8, 16, 32, 64, -128);
+    __m256i lo = _mm256_and_si256(v, nibble);
+    __m256i hi = _mm256_and_si256(_mm256_srli_epi16(v, 4), nibble);
+    return _mm256_or_si256(_mm256_and_si256(_mm256_shuffle_epi8(low, lo), _mm256_shuffle_epi8(bitLow, hi)),
+                           _mm256_and_si256(_mm256_shuffle_epi8(high, lo), _mm256_shuffle_epi8(bitHigh, hi)));
+}
+
+INSPECTOR_TARGET("avx2")
+static size_t PrefilterAvx2(const Automaton& automaton, const BYTE* data, size_t position, size_t end, size_t size)
+{
+    // vpshufb looks up within each 128-bit lane, so both lanes get a copy of the tables
+    const __m256i firstLow = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(automaton.firstLow)));
+    const __m256i firstHigh = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(automaton.firstHigh)));
+    const __m256i secondLow = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(automaton.secondLow)));
+    const __m256i secondHigh = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(automaton.secondHigh)));
+    const __m256i zero = _mm256_setzero_si256();
+
+    for (; position + 32 < end; position += 32)
+    {
+        __m256i first = MembersAvx2(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + position)), firstLow, firstHigh);
+        __m256i second = MembersAvx2(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + position + 1)), secondLow, secondHigh);
+        __m256i rejected = _mm256_or_si256(_mm256_cmpeq_epi8(first, zero), _mm256_cmpeq_epi8(second, zero));
+        unsigned candidates = ~unsigned(_mm256_movemask_epi8(rejected));
+        while (candidates != 0)
+        {
+            size_t candidate = position + CountTrailingZeros(candidates);
+            if (IsCandidate(automaton, data, candidate, size))
+                return candidate;
+            candidates &= candidates - 1;
+        }
+    }
+    return PrefilterScalar(automaton, data, position, end, size);
+}
+
+#endif // INSPECTOR_X86 && INSPECTOR_X86_64
+
+struct PrefilterChoice
+{
+    PrefilterKernel kernel;
+    const char* name;
+};
+
+static PrefilterChoice SelectPrefilter()
+{
+#if INSPECTOR_X86 && INSPECTOR_X86_64
+    if (CpuHasAvx2())
+        return { PrefilterAvx2, "avx2" };
+    if (CpuHasSsse3())
+        return { PrefilterSsse3, "ssse3" };
+#endif
+    return { PrefilterScalar, "scalar" };
+}
+
+static const PrefilterChoice& Prefilter()
+{
+    static const PrefilterChoice choice = SelectPrefilter();
+    return choice;
+}
+
+const char* SignatureKernelName()
+{
+    return Prefilter().name;
+}
+
+// Target of state on byte: one load in a dense state, otherwise the state's own edges and then its failure states
+// until one has an edge for the byte or is dense
+static uint32_t Step(const Automaton& automaton, uint32_t state, BYTE byte)
+{
+    while (state >= automaton.denseStates)
+    {
+        const uint32_t* edge = automaton.edges.data() + automaton.edgeStart[state];
+        const uint32_t* edgesEnd = automaton.edges.data() + automaton.edgeStart[state + 1];
+        for (; edge < edgesEnd; edge++)
+        {
+            if ((*edge >> 24) == byte)
+                return *edge & 0xFFFFFF;
+        }
+        state = automaton.failure[state];
+    }
+    return automaton.dense[size_t(state) * 256 + byte];
+}
+
+// Run the automaton over [begin, end) starting from the root, calling report(signature, position) for every
+// anchor that ends at a position at or after reportBegin
+template <typename Report>
+static void RunAutomaton(const Automaton& automaton, const BYTE* data, size_t size, size_t begin, size_t end,
+                         size_t reportBegin, Report&& report)
+{
+    const PrefilterKernel prefilter = Prefilter().kernel;
+    const uint32_t* dense = automaton.dense.data();
+    const uint32_t* outputStart = automaton.outputStart.data();
+    const uint32_t* outputs = automaton.outputs.data();
+
+    uint32_t state = 0;
+    for (size_t i = begin; i < end; i++)
+    {
+        // Nothing is in progress, so positions where no anchor starts can be skipped without stepping
+        if (state == 0 && !IsCandidate(automaton, data, i, size))
+        {
+            i = prefilter(automaton, data, i + 1, end, size);
+            if (i == end)
+                break;
+        }
+
+        uint32_t target = state < automaton.denseStates ? dense[size_t(state) * 256 + data[i]] : Step(automaton, state, data[i]);
+        state = target >> 1;
+        if ((target & 1) != 0 && i >= reportBegin)
+        {
+            for (uint32_t k = outputStart[state]; k < outputStart[state + 1]; k++)
+                report(outputs[k], i);
+        }
+    }
+}
+
+static bool PatternMatches(const Signature& signature, const BYTE* data)
+{
+    const BYTE* value = signature.value.data();
+    const BYTE* mask = signature.mask.data();
+    for (size_t i = 0; i < signature.value.size(); i++)
+    {
+        if ((data[i] & mask[i]) != value[i])
+            return false;
+    }
+    return true;
+}
+
+static int HexDigit(char c)
+{
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F')
+        return c - 'A' + 10;
+    return -1;
+}
+
+bool SignatureSet::ParsePattern(const std::string& text, Signature& signature, std::string& error)
+{
+    std::vector<BYTE> value;
+    std::vector<BYTE> mask;
+    size_t i = 0;
+    while (true)
+    {
+        while (i < text.size() && (text[i] == ' ' || text[i] == '\t'))
+            i++;
+        if (i == text.size())
+            break;
+        if (i + 1 == text.size())
+        {
+            error = "Incomplete byte at the end of the pattern.";
+            return false;
+        }
+
+        BYTE byteValue = 0;
+        BYTE byteMask = 0;
+        for (int half = 0; half < 2; half++)
+        {
+            char c = text[i + half];
+            int shift = half == 0 ? 4 : 0;
+            if (c == '?')
+                continue;
+            int digit = HexDigit(c);
+            if (digit < 0)
+            {
+                error = std::string("Unexpected '") + c + "' in pattern.";
+                return false;
+            }
+            byteValue |= BYTE(digit << shift);
+            byteMask |= BYTE(0x0F << shift);
+        }
+        value.push_back(byteValue);
+        mask.push_back(byteMask);
+        i += 2;
+    }
+
+    if (value.empty())
+    {
+        error = "Empty pattern.";
+        return false;
+    }
+    signature.value = std::move(value);
+    signature.mask = std::move(mask);
+    return true;
+}
+
+bool SignatureSet::Add(Signature signature)
+{
+    if (signature.value.empty() || signature.value.size() != signature.mask.size())
+    {
+        errorString = signature.name + ": Empty pattern.";
+        return false;
+    }
+    if (signature.scope == SignatureScope::Section && (signature.section.empty() || signature.section.size() > IMAGE_SIZEOF_SHORT_NAME))
+    {
+        errorString = signature.name + ": Section names are 1 to 8 characters.";
+        return false;
+    }
+
+    for (size_t i = 0; i < signature.value.size(); i++)
+        signature.value[i] &= signature.mask[i];
+    signatures.push_back(std::move(signature));
+    compiled = false;
+    return true;
+}
+
+static std::string Trim(const char* begin, const char* end)
+{
+    while (begin < end && (*begin == ' ' || *begin == '\t' || *begin == '\r'))
+        begin++;
+    while (end > begin && (end[-1] == ' ' || end[-1] == '\t' || end[-1] == '\r'))
+        end--;
+    return std::string(begin, end);
+}
+
+static std::string Lowercase(std::string text)
+{
+    for (char& c : text)
+    {
+        if (c >= 'A' && c <= 'Z')
+            c = char(c - 'A' + 'a');
+    }
+    return text;
+}
+
+bool SignatureSet::Load(const char* text, size_t size)
+{
+    const char* end = text + size;
+    if (size >= 3 && memcmp(text, "\xEF\xBB\xBF", 3) == 0)
+        text += 3;
+
+    Signature current;
+    bool open = false;
+    bool hasPattern = false;
+    size_t lineNumber = 0;
+    std::string error;
+
+    auto fail = [&](const std::string& message)
+    {
+        errorString = "Line " + std::to_string(lineNumber) + ": " + message;
+        return false;
+    };
+    // A block is added once the next one starts or the text ends
+    auto finish = [&]()
+    {
+        if (!open)
+            return true;
+        if (!hasPattern)
+            return fail("[" + current.name + "] has no signature.");
+        return Add(std::move(current));
+    };
+
+    while (text < end)
+    {
+        const char* lineEnd = static_cast<const char*>(memchr(text, '\n', size_t(end - text)));
+        if (lineEnd == nullptr)
+            lineEnd = end;
+        std::string line = Trim(text, lineEnd);
+        text = lineEnd < end ? lineEnd + 1 : end;
+        lineNumber++;
+
+        if (line.empty() || line[0] == ';' || line[0] == '#')
+            continue;
+
+        if (line[0] == '[')
+        {
+            size_t close = line.rfind(']');
+            if (close == std::string::npos || close == 1)
+                return fail("Expected [name].");
+            if (!finish())
+                return false;
+            current = Signature();
+            current.name = line.substr(1, close - 1);
+            open = true;
+            hasPattern = false;
+            continue;
+        }
+
+        size_t equals = line.find('=');
+        if (equals == std::string::npos)
+            return fail("Expected key = value.");
+        if (!open)
+            return fail("Key outside a [name] block.");
+        std::string key = Lowercase(Trim(line.data(), line.data() + equals));
+        std::string value = Trim(line.data() + equals + 1, line.data() + line.size());
+
+        if (key == "signature")
+        {
+            if (!ParsePattern(value, current, error))
+                return fail(error);
+            hasPattern = true;
+        }
+        else if (key == "ep_only")
+        {
+            bool entryPointOnly = Lowercase(value) == "true";
+            if (entryPointOnly && current.scope == SignatureScope::Section)
+                return fail("ep_only and section cannot be combined.");
+            if (entryPointOnly)
+                current.scope = SignatureScope::EntryPoint;
+        }
+        else if (key == "section")
+        {
+            if (current.scope == SignatureScope::EntryPoint)
+                return fail("ep_only and section cannot be combined.");
+            current.scope = SignatureScope::Section;
+            current.section = value;
+        }
+        // Other keys are left for other tools
+    }
+    return finish();
+}
+
+bool SignatureSet::LoadFile(const std::string& path)
+{
+    MappedFile file;
+    if (!file.Open(path))
+    {
+        errorString = path + ": " + file.ErrorString();
+        return false;
+    }
+    if (!Load(reinterpret_cast<const char*>(file.Data()), file.Size()))
+    {
+        errorString = path + ": " + errorString;
+        return false;
+    }
+    return true;
+}
+
+// Set membership as two 16-byte tables indexed by low nibble, bit (high nibble % 8) in the first table for high
+// nibbles 0-7 and in the second for 8-15
+static void NibbleTables(const uint64_t* set, BYTE* low, BYTE* high)
+{
+    for (unsigned b = 0; b < 256; b++)
+    {
+        if (!HasBit(set, b))
+            continue;
+        unsigned hi = b >> 4;
+        if (hi < 8)
+            low[b & 15] |= BYTE(1u << hi);
+        else
+            high[b & 15] |= BYTE(1u << (hi - 8));
+    }
+}
+
+bool SignatureSet::Build(Automaton& automaton, const std::vector<uint32_t>& members) const
+{
+    automaton = Automaton();
+    automaton.pairs.assign(65536 / 64, 0);
+    uint64_t second[4] = {};
+
+    // Trie of the anchors in insertion order, children kept sorted by byte
+    struct Node
+    {
+        std::vector<std::pair<BYTE, uint32_t>> children;
+        std::vector<uint32_t> outputs;
+    };
+    std::vector<Node> trie(1);
+    for (uint32_t index : members)
+    {
+        const Anchor& anchor = anchors[index];
+        const BYTE* bytes = signatures[index].value.data() + anchor.offset;
+        uint32_t node = 0;
+        for (uint32_t k = 0; k < anchor.length; k++)
+        {
+            std::vector<std::pair<BYTE, uint32_t>>& children = trie[node].children;
+            auto it = std::lower_bound(children.begin(), children.end(), std::make_pair(bytes[k], uint32_t(0)));
+            if (it == children.end() || it->first != bytes[k])
+            {
+                it = children.insert(it, { bytes[k], uint32_t(trie.size()) });
+                node = it->second;
+                trie.emplace_back();
+            }
+            else
+            {
+                node = it->second;
+            }
+        }
+        trie[node].outputs.push_back(index);
+        automaton.maxAnchor = std::max<size_t>(automaton.maxAnchor, anchor.length);
+
+        SetBit(automaton.first, bytes[0]);
+        if (anchor.length == 1)
+        {
+            for (unsigned b = 0; b < 256; b++)
+            {
+                SetBit(automaton.pairs.data(), size_t(bytes[0]) << 8 | b);
+                SetBit(second, b);
+            }
+        }
+        else
+        {
+            SetBit(automaton.pairs.data(), size_t(bytes[0]) << 8 | bytes[1]);
+            SetBit(second, bytes[1]);
+        }
+    }
+    if (trie.size() > kMaxStates)
+        return false;
+    NibbleTables(automaton.first, automaton.firstLow, automaton.firstHigh);
+    NibbleTables(second, automaton.secondLow, automaton.secondHigh);
+
+    // Number the states breadth first. Every state's failure state is shallower, so it is finished first, and its
+    // outputs (anchors that are suffixes of this one) can be appended right away.
+    size_t stateCount = trie.size();
+    std::vector<uint32_t> order;
+    std::vector<uint32_t> number(stateCount);
+    std::vector<uint32_t> failure(stateCount, 0);
+    order.reserve(stateCount);
+    order.push_back(0);
+    for (size_t q = 0; q < order.size(); q++)
+    {
+        uint32_t node = order[q];
+        number[node] = uint32_t(q);
+        for (const std::pair<BYTE, uint32_t>& edge : trie[node].children)
+        {
+            uint32_t child = edge.second;
+            if (node != 0)
+            {
+                uint32_t state = failure[node];
+                while (true)
+                {
+                    const std::vector<std::pair<BYTE, uint32_t>>& children = trie[state].children;
+                    auto it = std::lower_bound(children.begin(), children.end(), std::make_pair(edge.first, uint32_t(0)));
+                    if (it != children.end() && it->first == edge.first)
+                    {
+                        failure[child] = it->second;
+                        break;
+                    }
+                    if (state == 0)
+                        break;
+                    state = failure[state];
+                }
+            }
+            const std::vector<uint32_t>& inherited = trie[failure[child]].outputs;
+            trie[child].outputs.insert(trie[child].outputs.end(), inherited.begin(), inherited.end());
+            order.push_back(child);
+        }
+    }
+    automaton.denseStates = uint32_t(1 + trie[0].children.size());
+
+    auto target = [&](uint32_t node)
+    {
+        return number[node] * 2 + (trie[node].outputs.empty() ? 0 : 1);
+    };
+
+    // Dense rows: the root's missing edges lead back to the root, a child's to wherever the root goes
+    automaton.dense.assign(size_t(automaton.denseStates) * 256, 0);
+    for (uint32_t q = 0; q < automaton.denseStates; q++)
+    {
+        uint32_t* row = &automaton.dense[size_t(q) * 256];
+        if (q > 0)
+            std::copy(automaton.dense.begin(), automaton.dense.begin() + 256, row);
+        for (const std::pair<BYTE, uint32_t>& edge : trie[order[q]].children)
+            row[edge.first] = target(edge.second);
+    }
+
+    automaton.edgeStart.reserve(stateCount + 1);
+    automaton.failure.reserve(stateCount);
+    automaton.outputStart.reserve(stateCount + 1);
+    for (uint32_t node : order)
+    {
+        automaton.edgeStart.push_back(uint32_t(automaton.edges.size()));
+        for (const std::pair<BYTE, uint32_t>& edge : trie[node].children)
+            automaton.edges.push_back(uint32_t(edge.first) << 24 | target(edge.second));
+        automaton.failure.push_back(number[failure[node]]);
+        automaton.outputStart.push_back(uint32_t(automaton.outputs.size()));
+        automaton.outputs.insert(automaton.outputs.end(), trie[node].outputs.begin(), trie[node].outputs.end());
+    }
+    automaton.edgeStart.push_back(uint32_t(automaton.edges.size()));
+    automaton.outputStart.push_back(uint32_t(automaton.outputs.size()));
+    return true;
+}
+
+// How much an exact byte narrows down where a pattern can be. Padding and filler bytes and the commonest x86
+// opcode and ModRM bytes occur everywhere in code, an anchor made of them would be verified all the time.
+static unsigned ByteWeight(BYTE b)
+{
+    switch (b)
+    {
+    case 0x00: case 0xFF:
+        return 1;
+    case 0xCC: case 0x90: case 0x01: case 0x0F: case 0x24: case 0x44: case 0x48: case 0x4C:
+    case 0x83: case 0x89: case 0x8B: case 0x8D: case 0xC3: case 0xE8:
+        return 3;
+    default:
+        return 4;
+    }
+}
+
+// The window of up to kMaxAnchor exact bytes with the highest total weight; length stays 0 if there is none
+static void ChooseAnchor(const Signature& signature, size_t& offset, size_t& length)
+{
+    const std::vector<BYTE>& mask = signature.mask;
+    unsigned bestScore = 0;
+    for (size_t k = 0; k < mask.size();)
+    {
+        if (mask[k] != 0xFF)
+        {
+            k++;
+            continue;
+        }
+        size_t start = k;
+        while (k < mask.size() && mask[k] == 0xFF)
+            k++;
+
+        size_t window = std::min(k - start, kMaxAnchor);
+        for (size_t begin = start; begin + window <= k; begin++)
+        {
+            unsigned score = 0;
+            for (size_t i = begin; i < begin + window; i++)
+                score += ByteWeight(signature.value[i]);
+            if (score > bestScore)
+            {
+                bestScore = score;
+                offset = begin;
+                length = window;
+            }
+        }
+    }
+}
+
+bool SignatureSet::Compile()
+{
+    compiled = false;
+    anchors.clear();
+    scopeSections.clear();
+    hasFileScope = false;
+    maxEntryPointLength = 0;
+    maxAnywhereLength = 0;
+
+    std::string identity;
+    std::vector<uint32_t> anywhereMembers;
+    std::vector<uint32_t> entryPointMembers;
+    for (uint32_t i = 0; i < signatures.size(); i++)
+    {
+        const Signature& signature = signatures[i];
+
+        size_t bestOffset = 0;
+        size_t bestLength = 0;
+        ChooseAnchor(signature, bestOffset, bestLength);
+        if (bestLength == 0)
+        {
+            errorString = signature.name + ": The pattern needs at least one byte without wildcards.";
+            anchors.clear();
+            return false;
+        }
+
+        Anchor anchor = { uint32_t(bestOffset), uint32_t(std::min(bestLength, kMaxAnchor)), -1 };
+        switch (signature.scope)
+        {
+        case SignatureScope::File:
+            hasFileScope = true;
+            maxAnywhereLength = std::max(maxAnywhereLength, signature.value.size());
+            anywhereMembers.push_back(i);
+            break;
+        case SignatureScope::Section:
+            anchor.scope = int32_t(std::find(scopeSections.begin(), scopeSections.end(), signature.section) - scopeSections.begin());
+            if (anchor.scope == int32_t(scopeSections.size()))
+                scopeSections.push_back(signature.section);
+            maxAnywhereLength = std::max(maxAnywhereLength, signature.value.size());
+            anywhereMembers.push_back(i);
+            break;
+        case SignatureScope::EntryPoint:
+            maxEntryPointLength = std::max(maxEntryPointLength, signature.value.size());
+            entryPointMembers.push_back(i);
+            break;
+        }
+        anchors.push_back(anchor);
+
+        identity += signature.name + '\n' + signature.section + '\n' + char('0' + int(signature.scope));
+        identity.append(reinterpret_cast<const char*>(signature.value.data()), signature.value.size());
+        identity.append(reinterpret_cast<const char*>(signature.mask.data()), signature.mask.size());
+    }
+
+    if (!Build(anywhere, anywhereMembers) || !Build(entryPoint, entryPointMembers))
+    {
+        errorString = "Too many signatures: the automaton would exceed 16,777,216 states.";
+        anywhere = Automaton();
+        entryPoint = Automaton();
+        anchors.clear();
+        return false;
+    }
+    fingerprint = XXHash64(identity.data(), identity.size());
+    compiled = true;
+    return true;
+}
+
+size_t SignatureSet::StateCount() const
+{
+    return anywhere.failure.size() + entryPoint.failure.size();
+}
+
+// Whether [offset, offset + length) overlaps one of ranges, which are sorted and disjoint
+static bool Touches(const std::vector<std::pair<size_t, size_t>>& ranges, size_t offset, size_t length)
+{
+    auto next = std::upper_bound(ranges.begin(), ranges.end(), offset,
+                                 [](size_t value, const std::pair<size_t, size_t>& range) { return value < range.second; });
+    return next != ranges.end() && next->first < offset + length;
+}
+
+std::vector<SignatureMatch> SignatureSet::Scan(const PEImageBase& image, unsigned threads) const
+{
+    return Match(image, nullptr, nullptr, threads);
+}
+
+std::vector<SignatureMatch> SignatureSet::Rescan(const PEImageBase& image, const std::vector<SignatureMatch>& previous,
+                                                 const std::vector<std::pair<size_t, size_t>>& changed, unsigned threads) const
+{
+    return Match(image, &previous, &changed, threads);
+}
+
+std::vector<SignatureMatch> SignatureSet::Match(const PEImageBase& image, const std::vector<SignatureMatch>* previous,
+                                                const std::vector<std::pair<size_t, size_t>>* changed, unsigned threads) const
+{
+    std::vector<SignatureMatch> matches;
+    const BYTE* data = static_cast<const BYTE*>(image.GetImageBase());
+    size_t size = image.GetImageSize();
+    if (!compiled || data == nullptr || size == 0)
+        return matches;
+    TRACE_SCOPE("MatchSignatures");
+
+    // Raw data of the sections each scope names; several sections may share a name
+    std::vector<std::vector<std::pair<size_t, size_t>>> scopeRanges(scopeSections.size());
+    for (const IMAGE_SECTION_HEADER& section : image.GetSections())
+    {
+        char name[IMAGE_SIZEOF_SHORT_NAME + 1] = {};
+        memcpy(name, section.Name, IMAGE_SIZEOF_SHORT_NAME);
+        size_t offset;
+        size_t length;
+        if (!SectionRawRange(section, size, offset, length))
+            continue;
+        for (size_t s = 0; s < scopeSections.size(); s++)
+        {
+            if (scopeSections[s] == name)
+                scopeRanges[s].push_back({ offset, offset + length });
+        }
+    }
+
+    // fresh: the match must overlap one of these ranges, when given
+    auto report = [&](std::vector<SignatureMatch>& out, uint32_t index, size_t position, const std::vector<std::pair<size_t, size_t>>* fresh)
+    {
+        const Anchor& anchor = anchors[index];
+        const Signature& signature = signatures[index];
+        size_t anchorEnd = anchor.offset + anchor.length;
+        if (position + 1 < anchorEnd)
+            return;
+        size_t start = position + 1 - anchorEnd;
+        size_t length = signature.value.size();
+        if (length > size - start)
+            return;
+        // Matches clear of every change are the previous ones, carried over below
+        if (fresh != nullptr && !Touches(*fresh, start, length))
+            return;
+        if (anchor.scope >= 0)
+        {
+            bool inside = false;
+            for (const std::pair<size_t, size_t>& range : scopeRanges[anchor.scope])
+                inside = inside || (start >= range.first && start + length <= range.second);
+            if (!inside)
+                return;
+        }
+        if (PatternMatches(signature, data + start))
+            out.push_back({ start, index });
+    };
+
+    // Without file-wide signatures only the named sections need reading
+    std::vector<std::pair<size_t, size_t>> ranges;
+    if (hasFileScope)
+    {
+        ranges.push_back({ 0, size });
+    }
+    else
+    {
+        for (const std::vector<std::pair<size_t, size_t>>& scope : scopeRanges)
+            ranges.insert(ranges.end(), scope.begin(), scope.end());
+        std::sort(ranges.begin(), ranges.end());
+        std::vector<std::pair<size_t, size_t>> merged;
+        for (const std::pair<size_t, size_t>& range : ranges)
+        {
+            if (!merged.empty() && range.first <= merged.back().second)
+                merged.back().second = std::max(merged.back().second, range.second);
+            else
+                merged.push_back(range);
+        }
+        ranges.swap(merged);
+    }
+
+    // A match that overlaps a changed range has its anchor within the longest pattern of it, so a rescan only
+    // reads that far around each one
+    std::vector<std::pair<size_t, size_t>> windows;
+    if (changed != nullptr)
+    {
+        for (const std::pair<size_t, size_t>& range : *changed)
+        {
+            size_t begin = range.first - std::min(range.first, maxAnywhereLength);
+            size_t end = std::min(size, range.second + std::min(maxAnywhereLength, SIZE_MAX - range.second));
+            if (begin >= end)
+                continue;
+            if (!windows.empty() && begin <= windows.back().second)
+                windows.back().second = std::max(windows.back().second, end);
+            else
+                windows.push_back({ begin, end });
+        }
+    }
+    else
+    {
+        windows.push_back({ 0, size });
+    }
+
+    // Each chunk reports the anchors that end inside it; starting one anchor early finds those that begin before it
+    struct Chunk
+    {
+        size_t rangeBegin;
+        size_t begin;
+        size_t end;
+    };
+    std::vector<Chunk> chunks;
+    if (!anywhere.outputs.empty())
+    {
+        for (const std::pair<size_t, size_t>& range : ranges)
+        {
+            for (const std::pair<size_t, size_t>& window : windows)
+            {
+                size_t first = std::max(range.first, window.first);
+                size_t last = std::min(range.second, window.second);
+                for (size_t begin = first; begin < last; begin += kChunkSize)
+                    chunks.push_back({ range.first, begin, std::min(last, begin + kChunkSize) });
+                TRACE_COUNT(Bytes, last > first ? last - first : 0);
+            }
+        }
+    }
+
+    if (threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    threads = unsigned(std::max<size_t>(1, std::min<size_t>(threads, chunks.size())));
+
+    std::vector<std::vector<SignatureMatch>> chunkMatches(chunks.size());
+    std::atomic<size_t> next(0);
+    auto work = [&]()
+    {
+        for (size_t i = next++; i < chunks.size(); i = next++)
+        {
+            const Chunk& chunk = chunks[i];
+            size_t begin = std::max(chunk.rangeBegin, chunk.begin - std::min(chunk.begin, anywhere.maxAnchor - 1));
+            std::vector<SignatureMatch>& out = chunkMatches[i];
+            RunAutomaton(anywhere, data, size, begin, chunk.end, chunk.begin,
+                         [&](uint32_t index, size_t position) { report(out, index, position, changed); });
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (unsigned t = 1; t < threads; t++)
+        workers.emplace_back(work);
+    work();
+    for (std::thread& worker : workers)
+        worker.join();
+
+    for (const std::vector<SignatureMatch>& chunk : chunkMatches)
+        matches.insert(matches.end(), chunk.begin(), chunk.end());
+
+    // Entry point signatures are matched again below, they are only a few bytes
+    if (previous != nullptr)
+    {
+        for (const SignatureMatch& match : *previous)
+        {
+            const Signature& signature = signatures[match.signature];
+            if (signature.scope != SignatureScope::EntryPoint && !Touches(*changed, match.offset, signature.value.size()))
+                matches.push_back(match);
+        }
+    }
+
+    // Entry point signatures only need the bytes from the entry point to the end of the longest one
+    size_t entryOffset;
+    if (!entryPoint.outputs.empty() && image.GetEntryPoint() != 0 && image.RvaToOffset(image.GetEntryPoint(), 1, entryOffset))
+    {
+        std::vector<SignatureMatch> entryMatches;
+        size_t end = entryOffset + std::min(maxEntryPointLength, size - entryOffset);
+        RunAutomaton(entryPoint, data, size, entryOffset, end, entryOffset,
+                     [&](uint32_t index, size_t position) { report(entryMatches, index, position, nullptr); });
+        for (const SignatureMatch& match : entryMatches)
+        {
+            if (match.offset == entryOffset)
+                matches.push_back(match);
+        }
+    }
+
+    std::sort(matches.begin(), matches.end(), [](const SignatureMatch& a, const SignatureMatch& b)
+    {
+        return a.offset != b.offset ? a.offset < b.offset : a.signature < b.signature;
+    });
+    return matches;
+}
@@ -0,0 +1,128 @@
+#ifndef SIGNATURESET_H
+#define SIGNATURESET_H
+
+#include "PETypes.h"
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+class PEImageBase;
+
+enum class SignatureScope : uint8_t
+{
+    File,       // Anywhere in the file
+    Section,    // Entirely within the raw data of a section with the given name
+    EntryPoint  // Starting exactly at the entry point
+};
+
+// A byte pattern: data byte b matches position i when (b & mask[i]) == value[i]
+struct Signature
+{
+    std::string name;
+    std::vector<BYTE> value; // Already masked
+    std::vector<BYTE> mask;  // 0xFF for a byte, 0xF0 or 0x0F for a nibble, 0x00 for a wildcard
+    SignatureScope scope = SignatureScope::File;
+    std::string section;     // Section name for SignatureScope::Section
+};
+
+struct SignatureMatch
+{
+    uint64_t offset;    // File offset of the first byte
+    uint32_t signature; // Index into the set
+};
+
+// Many signatures matched in one pass. Compile picks the rarest run of up to 8 exact bytes in every pattern as
+// its anchor and builds one Aho-Corasick automaton over all anchors, so the work per input byte does not depend on
+// the number of signatures. The root and its children, where the automaton spends nearly all its time, are full
+// 256-entry DFA rows; deeper states keep only their own edges and a failure link, which keeps the hot part of the
+// automaton in cache however large the set grows. While the automaton is idle, a SIMD prefilter skips ahead to the
+// next byte pair that can start an anchor. Anchor hits are verified against the whole masked pattern and the
+// signature's scope. Entry point signatures get their own automaton that only ever reads the bytes at the entry point.
+class SignatureSet
+{
+public:
+    // Hex bytes, optionally separated by spaces: "55 8B EC ?? 6A ?F". "??" is any byte, "?F" and "F?" one nibble.
+    static bool ParsePattern(const std::string& text, Signature& signature, std::string& error);
+
+    // Add one signature; the set has to be compiled again before the next scan
+    bool Add(Signature signature);
+
+    // PEiD-style database: "[name]" starts a signature, followed by "signature = <pattern>" and optionally
+    // "ep_only = true" or "section = .text". Lines starting with ';' are comments.
+    bool Load(const char* text, size_t size);
+    bool LoadFile(const std::string& path);
+
+    bool Compile();
+    bool IsCompiled() const { return compiled; }
+
+    size_t Count() const { return signatures.size(); }
+    const Signature& operator[](size_t index) const { return signatures[index]; }
+    const std::string& ErrorString() const { return errorString; }
+
+    // States in both automata, for sizing
+    size_t StateCount() const;
+
+    // Hash of every signature's name, pattern and scope, so caches can tell sets apart. Valid once compiled.
+    uint64_t Fingerprint() const { return fingerprint; }
+
+    // Matches sorted by offset, then signature. The image must have been parsed up to ParseSections and the set
+    // compiled. Large images are split into chunks scanned in parallel.
+    std::vector<SignatureMatch> Scan(const PEImageBase& image, unsigned threads = 0) const;
+    // Scan for a new version of the file previous was matched in, with this set, the same size and section table.
+    // changed holds the byte ranges that may differ, sorted; only they and a pattern's length around them are read.
+    std::vector<SignatureMatch> Rescan(const PEImageBase& image, const std::vector<SignatureMatch>& previous,
+                                       const std::vector<std::pair<size_t, size_t>>& changed, unsigned threads = 0) const;
+
+    // One automaton over a subset of the anchors, with the tables its prefilter needs. States are numbered breadth
+    // first, so the root is 0 and its children follow. Transition targets are state * 2, plus 1 when the target
+    // has outputs.
+    struct Automaton
+    {
+        uint32_t denseStates = 0;          // The root and its children
+        std::vector<uint32_t> dense;       // 256 targets per dense state
+        std::vector<uint32_t> edgeStart;   // Per state, plus one past the end, into edges
+        std::vector<uint32_t> edges;       // Byte << 24 | target, the trie edges of deeper states
+        std::vector<uint32_t> failure;     // Per state: longest proper suffix that is a state, as a plain index
+        std::vector<uint32_t> outputStart; // Per state, plus one past the end, into outputs
+        std::vector<uint32_t> outputs;     // Signatures whose anchor ends in the state, suffix states' included
+        std::vector<uint64_t> pairs;       // 65536 bits: byte pairs an anchor can start with
+        uint64_t first[4] = {};            // Bytes an anchor can start with
+        BYTE firstLow[16] = {};            // Nibble tables for the SIMD membership test, see Prefilter
+        BYTE firstHigh[16] = {};
+        BYTE secondLow[16] = {};
+        BYTE secondHigh[16] = {};
+        size_t maxAnchor = 0;
+    };
+
+private:
+    struct Anchor
+    {
+        uint32_t offset; // Of the anchor within the pattern
+        uint32_t length;
+        int32_t scope;   // Index into scopeSections for SignatureScope::Section, otherwise -1
+    };
+
+    // False if the trie needs more states than the edge encoding can address
+    bool Build(Automaton& automaton, const std::vector<uint32_t>& members) const;
+    // Scan, or Rescan when previous and changed are given
+    std::vector<SignatureMatch> Match(const PEImageBase& image, const std::vector<SignatureMatch>* previous,
+                                      const std::vector<std::pair<size_t, size_t>>* changed, unsigned threads) const;
+
+    std::vector<Signature> signatures;
+    std::vector<Anchor> anchors;             // Parallel to signatures once compiled
+    std::vector<std::string> scopeSections;  // Distinct section names signatures are scoped to
+    Automaton anywhere;                      // File and section scoped signatures
+    Automaton entryPoint;                    // Entry point signatures
+    size_t maxEntryPointLength = 0;
+    size_t maxAnywhereLength = 0;
+    uint64_t fingerprint = 0;
+    bool hasFileScope = false;
+    bool compiled = false;
+    std::string errorString;
+};
+
+// Name of the prefilter picked for this CPU ("avx2", "ssse3" or "scalar")
+const char* SignatureKernelName();
+
+#endif // SIGNATURESET_H
@@ -0,0 +1,48 @@
+#include "Simd.h"
+
+#if INSPECTOR_X86 && defined(_MSC_VER)
+#include <intrin.h>
+
+// MSVC has no __builtin_cpu_supports, read CPUID directly
+static bool CpuidBit(int leaf, int subleaf, int reg, int bit)
+{
+    int info[4] = {};
+    __cpuidex(info, leaf, subleaf);
+    return (info[reg] & (1 << bit)) != 0;
+}
+
+static bool OsSavesYmm()
+{
+    // OSXSAVE and the OS enabling the XMM/YMM state in XCR0
+    return CpuidBit(1, 0, 2, 27) && (_xgetbv(0) & 0x6) == 0x6;
+}
+
+bool CpuHasSse2()  { return CpuidBit(1, 0, 3, 26); }
+bool CpuHasSsse3() { return CpuidBit(1, 0, 2, 9); }
+bool CpuHasAvx2()  { return OsSavesYmm() && CpuidBit(7, 0, 1, 5); }
+bool CpuHasSha()   { return CpuidBit(7, 0, 1, 29) && CpuidBit(1, 0, 2, 19); }
+
+#elif INSPECTOR_X86
+#include <cpuid.h>
+
+bool CpuHasSse2()  { return __builtin_cpu_supports("sse2"); }
+bool CpuHasSsse3() { return __builtin_cpu_supports("ssse3"); }
+bool CpuHasAvx2()  { return __builtin_cpu_supports("avx2"); }
+
+// Older GCCs do not know "sha" in __builtin_cpu_supports, so go to CPUID leaf 7 directly
+bool CpuHasSha()
+{
+    unsigned int eax, ebx, ecx, edx;
+    if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx) || (ebx & (1u << 29)) == 0)
+        return false;
+    return __builtin_cpu_supports("sse4.1");
+}
+
+#else
+
+bool CpuHasSse2()  { return false; }
+bool CpuHasSsse3() { return false; }
+bool CpuHasAvx2()  { return false; }
+bool CpuHasSha()   { return false; }
+
+#endif
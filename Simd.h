@@ -0,0 +1,57 @@
+#ifndef SIMD_H
+#define SIMD_H
+
+// Runtime CPU feature checks and per-function target attributes.
+// Kernels are compiled for several instruction sets in one binary and picked once at runtime,
+// so the build never has to assume more than the baseline ISA.
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define INSPECTOR_X86 1
+#include <immintrin.h>
+#else
+#define INSPECTOR_X86 0
+#endif
+
+// SSE2 is part of the x86-64 baseline; 32-bit x86 builds still check for it at runtime
+#if defined(__x86_64__) || defined(_M_X64)
+#define INSPECTOR_X86_64 1
+#else
+#define INSPECTOR_X86_64 0
+#endif
+
+// GCC and Clang need the target attribute to emit AVX2/SSSE3 code in an otherwise baseline TU; MSVC does not
+#if defined(__GNUC__) || defined(__clang__)
+#define INSPECTOR_TARGET(isa) __attribute__((target(isa)))
+#else
+#define INSPECTOR_TARGET(isa)
+#endif
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+
+// Index of the lowest set bit; value must be nonzero. Used to walk the bitmasks movemask produces.
+inline unsigned CountTrailingZeros(unsigned long long value)
+{
+#if defined(_MSC_VER) && !defined(__clang__) && (defined(_M_X64) || defined(_M_ARM64))
+    unsigned long index;
+    _BitScanForward64(&index, value);
+    return index;
+#elif defined(_MSC_VER) && !defined(__clang__)
+    unsigned long index;
+    if (_BitScanForward(&index, static_cast<unsigned long>(value)))
+        return index;
+    _BitScanForward(&index, static_cast<unsigned long>(value >> 32));
+    return index + 32;
+#else
+    return static_cast<unsigned>(__builtin_ctzll(value));
+#endif
+}
+
+bool CpuHasSse2();
+bool CpuHasSsse3();
+bool CpuHasAvx2();
+// SHA-NI together with the SSE4.1 its kernels also use
+bool CpuHasSha();
+
+#endif // SIMD_H
@@ -0,0 +1,467 @@
+#include "StringTable.h"
+#include "PEImage.h"
+#include "Simd.h"
+#include "Trace.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <thread>
+
+// Printable means 0x20-0x7E or a tab, the same set as strings(1)
+static bool IsPrintable(BYTE c)
+{
+    return (c >= 0x20 && c <= 0x7E) || c == '\t';
+}
+
+// Bit i of printable[b] / zero[b] describes byte 64 * b + i
+typedef void (*ClassifyKernel)(const BYTE* data, size_t blocks, uint64_t* printable, uint64_t* zero);
+
+static void ClassifyScalar(const BYTE* data, size_t blocks, uint64_t* printable, uint64_t* zero)
+{
+    for (size_t b = 0; b < blocks; b++, data += 64)
+    {
+        uint64_t p = 0;
+        uint64_t z = 0;
+        for (unsigned i = 0; i < 64; i++)
+        {
+            p |= uint64_t(IsPrintable(data[i])) << i;
+            z |= uint64_t(data[i] == 0) << i;
+        }
+        printable[b] = p;
+        zero[b] = z;
+    }
+}
+
+#if INSPECTOR_X86 && INSPECTOR_X86_64
+
+// Signed compares: bytes 0x80 and up are negative, so "greater than 0x1F" already excludes them
+INSPECTOR_TARGET("sse2")
+static void ClassifySse2(const BYTE* data, size_t blocks, uint64_t* printable, uint64_t* zero)
+{
+    const __m128i below = _mm_set1_epi8(0x1F);
+    const __m128i above = _mm_set1_epi8(0x7F);
+    const __m128i tab = _mm_set1_epi8('\t');
+    const __m128i nul = _mm_setzero_si128();
+    for (size_t b = 0; b < blocks; b++, data += 64)
+    {
+        uint64_t p = 0;
+        uint64_t z = 0;
+        for (unsigned k = 0; k < 4; k++)
+        {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 16 * k));
+            __m128i inRange = _mm_and_si128(_mm_cmpgt_epi8(v, below), _mm_cmplt_epi8(v, above));
+            __m128i isPrintable = _mm_or_si128(inRange, _mm_cmpeq_epi8(v, tab));
+            p |= uint64_t(uint16_t(_mm_movemask_epi8(isPrintable))) << (16 * k);
+            z |= uint64_t(uint16_t(_mm_movemask_epi8(_mm_cmpeq_epi8(v, nul)))) << (16 * k);
+        }
+        printable[b] = p;
+        zero[b] = z;
+    }
+}
+
+INSPECTOR_TARGET("avx2")
+static void ClassifyAvx2(const BYTE* data, size_t blocks, uint64_t* printable, uint64_t* zero)
+{
+    const __m256i below = _mm256_set1_epi8(0x1F);
+    const __m256i above = _mm256_set1_epi8(0x7F);
+    const __m256i tab = _mm256_set1_epi8('\t');
+    const __m256i nul = _mm256_setzero_si256();
+    for (size_t b = 0; b < blocks; b++, data += 64)
+    {
+        __m256i lo = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data));
+        __m256i hi = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + 32));
+        __m256i printableLo = _mm256_or_si256(_mm256_and_si256(_mm256_cmpgt_epi8(lo, below), _mm256_cmpgt_epi8(above, lo)), _mm256_cmpeq_epi8(lo, tab));
+        __m256i printableHi = _mm256_or_si256(_mm256_and_si256(_mm256_cmpgt_epi8(hi, below), _mm256_cmpgt_epi8(above, hi)), _mm256_cmpeq_epi8(hi, tab));
+        printable[b] = uint64_t(uint32_t(_mm256_movemask_epi8(printableLo))) | (uint64_t(uint32_t(_mm256_movemask_epi8(printableHi))) << 32);
+        zero[b] = uint64_t(uint32_t(_mm256_movemask_epi8(_mm256_cmpeq_epi8(lo, nul)))) |
+                  (uint64_t(uint32_t(_mm256_movemask_epi8(_mm256_cmpeq_epi8(hi, nul)))) << 32);
+    }
+}
+
+#endif // INSPECTOR_X86 && INSPECTOR_X86_64
+
+struct ClassifyChoice
+{
+    ClassifyKernel kernel;
+    const char* name;
+};
+
+static ClassifyChoice SelectClassify()
+{
+#if INSPECTOR_X86 && INSPECTOR_X86_64
+    if (CpuHasAvx2())
+        return { ClassifyAvx2, "avx2" };
+    if (CpuHasSse2())
+        return { ClassifySse2, "sse2" };
+#endif
+    return { ClassifyScalar, "scalar" };
+}
+
+static const ClassifyChoice& Classify()
+{
+    static const ClassifyChoice choice = SelectClassify();
+    return choice;
+}
+
+const char* StringKernelName()
+{
+    return Classify().name;
+}
+
+// Chunks are a multiple of 64 bytes, so block boundaries line up with chunk ends and UTF-16 characters stay even
+static const size_t kChunkSize = size_t(1) << 20;
+static const size_t kBatchBlocks = 64;
+static const uint64_t kEvenBits = 0x5555555555555555ull;
+
+// Run tracking for one encoding across blocks
+struct RunState
+{
+    uint64_t carry = 0; // Last character of the previous block was printable
+    bool open = false;  // A run this chunk owns is in progress
+    size_t start = 0;
+};
+
+class ChunkScanner
+{
+public:
+    ChunkScanner(const BYTE* _data, size_t _size, const StringScanOptions& _options)
+        : data(_data), size(_size), options(_options) {}
+
+    void Scan(size_t begin, size_t end, std::vector<StringHit>& hits)
+    {
+        asciiHits.clear();
+        utf16Hits.clear();
+
+        // A run already in progress at begin belongs to the previous chunk: the carry suppresses its start edge,
+        // and with nothing open its end edge is ignored
+        RunState ascii;
+        RunState utf16;
+        ascii.carry = begin > 0 && IsPrintable(data[begin - 1]);
+        utf16.carry = begin > 1 && IsPrintable(data[begin - 2]) && data[begin - 1] == 0;
+
+        ClassifyKernel classify = Classify().kernel;
+        uint64_t printable[kBatchBlocks];
+        uint64_t zero[kBatchBlocks];
+        size_t position = begin;
+        while (position < size && (position < end || ascii.open || utf16.open))
+        {
+            size_t blocks = std::min(kBatchBlocks, (size - position) / 64);
+            if (blocks > 0)
+            {
+                classify(data + position, blocks, printable, zero);
+            }
+            else
+            {
+                // Last partial block: the padding is neither printable nor zero, so it closes every open run
+                BYTE tail[64];
+                memset(tail, 0x01, sizeof(tail));
+                memcpy(tail, data + position, size - position);
+                classify(tail, 1, printable, zero);
+                blocks = 1;
+            }
+
+            for (size_t b = 0; b < blocks; b++, position += 64)
+            {
+                // Past the chunk end only runs that are still open are followed; new ones belong to the next chunk
+                bool accepting = position < end;
+                if (options.ascii)
+                    Edges(printable[b], 1, position, accepting, StringAscii, ascii, asciiHits);
+                if (options.utf16)
+                    Edges(printable[b] & (zero[b] >> 1) & kEvenBits, 2, position, accepting, StringUtf16, utf16, utf16Hits);
+            }
+        }
+
+        // The file ended inside a run
+        if (ascii.open)
+            Emit(ascii.start, size, 1, StringAscii, asciiHits);
+        if (utf16.open)
+            Emit(utf16.start, size, 2, StringUtf16, utf16Hits);
+
+        // Both lists are in offset order already
+        size_t first = hits.size();
+        hits.resize(first + asciiHits.size() + utf16Hits.size());
+        std::merge(asciiHits.begin(), asciiHits.end(), utf16Hits.begin(), utf16Hits.end(), hits.begin() + first,
+                   [](const StringHit& a, const StringHit& b) { return a.offset < b.offset; });
+    }
+
+private:
+    // chars has one bit per character at its first byte; width is the character size in bytes
+    void Edges(uint64_t chars, unsigned width, size_t position, bool accepting, StringEncoding encoding, RunState& run, std::vector<StringHit>& out)
+    {
+        uint64_t mask = width == 1 ? ~0ull : kEvenBits;
+        uint64_t edges = (chars ^ ((chars << width) | run.carry)) & mask;
+        while (edges != 0)
+        {
+            unsigned bit = CountTrailingZeros(edges);
+            edges &= edges - 1;
+            if ((chars >> bit) & 1)
+            {
+                if (accepting)
+                {
+                    run.open = true;
+                    run.start = position + bit;
+                }
+            }
+            else if (run.open)
+            {
+                Emit(run.start, position + bit, width, encoding, out);
+                run.open = false;
+            }
+        }
+        run.carry = (chars >> (64 - width)) & 1;
+    }
+
+    void Emit(size_t start, size_t stop, unsigned width, StringEncoding encoding, std::vector<StringHit>& out)
+    {
+        size_t length = (stop - start) / width;
+        if (length < options.minLength)
+            return;
+        StringHit hit = {};
+        hit.offset = start;
+        hit.length = static_cast<uint32_t>(std::min<size_t>(length, UINT32_MAX));
+        hit.section = StringTable::kNoSection;
+        hit.encoding = encoding;
+        out.push_back(hit);
+    }
+
+    const BYTE* data;
+    size_t size;
+    const StringScanOptions& options;
+    std::vector<StringHit> asciiHits;
+    std::vector<StringHit> utf16Hits;
+};
+
+// Raw range of one section as the loader reads it, for mapping hits back to sections and RVAs
+struct RawSection
+{
+    size_t begin;
+    size_t end;
+    DWORD virtualAddress;
+    uint16_t index;
+};
+
+static std::vector<RawSection> RawSections(const PEImageBase& image)
+{
+    std::vector<RawSection> ranges;
+    const std::vector<IMAGE_SECTION_HEADER>& sections = image.GetSections();
+    for (size_t i = 0; i < sections.size() && i < StringTable::kNoSection; i++)
+    {
+        size_t offset, size;
+        if (SectionRawRange(sections[i], image.GetImageSize(), offset, size))
+            ranges.push_back({ offset, offset + size, sections[i].VirtualAddress, static_cast<uint16_t>(i) });
+    }
+
+    // Overlapping raw data is legal; the stable sort keeps the first section listed ahead of later ones
+    std::stable_sort(ranges.begin(), ranges.end(), [](const RawSection& a, const RawSection& b) { return a.begin < b.begin; });
+    return ranges;
+}
+
+static void AssignSections(StringHit* hits, size_t count, const std::vector<RawSection>& ranges)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        // Last range starting at or before the hit; an earlier, longer one may still cover it
+        auto next = std::upper_bound(ranges.begin(), ranges.end(), hits[i].offset,
+                                     [](uint64_t offset, const RawSection& range) { return offset < range.begin; });
+        for (auto range = next; range != ranges.begin(); )
+        {
+            --range;
+            if (hits[i].offset < range->end)
+            {
+                hits[i].section = range->index;
+                hits[i].rva = static_cast<DWORD>(range->virtualAddress + (hits[i].offset - range->begin));
+                break;
+            }
+        }
+    }
+}
+
+// Hits of the runs that start in each [begin, end) piece, one list per piece. Pieces start on 64-byte boundaries
+// and are spread over the threads.
+static std::vector<std::vector<StringHit>> ScanPieces(const PEImageBase& image, const BYTE* data, size_t size,
+                                                      const std::vector<std::pair<size_t, size_t>>& pieces,
+                                                      const StringScanOptions& options)
+{
+    unsigned threads = options.threads;
+    if (threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    threads = unsigned(std::max<size_t>(1, std::min<size_t>(threads, pieces.size())));
+
+    std::vector<RawSection> ranges = RawSections(image);
+    std::vector<std::vector<StringHit>> pieceHits(pieces.size());
+    std::atomic<size_t> next(0);
+    auto work = [&]()
+    {
+        ChunkScanner scanner(data, size, options);
+        for (size_t i = next++; i < pieces.size(); i = next++)
+        {
+            scanner.Scan(pieces[i].first, pieces[i].second, pieceHits[i]);
+            AssignSections(pieceHits[i].data(), pieceHits[i].size(), ranges);
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (unsigned t = 1; t < threads; t++)
+        workers.emplace_back(work);
+    work();
+    for (std::thread& worker : workers)
+        worker.join();
+    return pieceHits;
+}
+
+void StringTable::Scan(const PEImageBase& image, const StringScanOptions& options)
+{
+    data = reinterpret_cast<const BYTE*>(image.GetImageBase());
+    size = image.GetImageSize();
+    hits.clear();
+    if (size == 0 || options.minLength == 0)
+        return;
+    TRACE_SCOPE("ExtractStrings");
+    TRACE_COUNT(Bytes, size);
+
+    std::vector<std::pair<size_t, size_t>> chunks;
+    for (size_t begin = 0; begin < size; begin += kChunkSize)
+        chunks.push_back({ begin, std::min(size, begin + kChunkSize) });
+
+    // Each chunk collects its own hits, concatenated in chunk order afterwards
+    std::vector<std::vector<StringHit>> chunkHits = ScanPieces(image, data, size, chunks, options);
+    size_t total = 0;
+    for (const std::vector<StringHit>& chunk : chunkHits)
+        total += chunk.size();
+    hits.reserve(total);
+    for (const std::vector<StringHit>& chunk : chunkHits)
+        hits.insert(hits.end(), chunk.begin(), chunk.end());
+}
+
+void StringTable::Rescan(const PEImageBase& image, const StringTable& previous,
+                         const std::vector<std::pair<size_t, size_t>>& changed, const StringScanOptions& options)
+{
+    data = reinterpret_cast<const BYTE*>(image.GetImageBase());
+    size = image.GetImageSize();
+    hits.clear();
+    if (size == 0 || options.minLength == 0)
+        return;
+    TRACE_SCOPE("ExtractStrings");
+
+    // Whether a run of either encoding may go on across position, judged by the bytes just before it
+    auto crossed = [&](size_t position)
+    {
+        return position > 0 && position < size &&
+               (IsPrintable(data[position - 1]) || (position > 1 && data[position - 1] == 0 && IsPrintable(data[position - 2])));
+    };
+
+    // Widen every changed range to 64-byte boundaries no run crosses. The two bytes before each boundary are
+    // unchanged, so no run crossed it in the previous version either: hits outside the windows are still exact.
+    std::vector<std::pair<size_t, size_t>> windows;
+    for (const std::pair<size_t, size_t>& range : changed)
+    {
+        if (range.first >= size || range.first >= range.second)
+            continue;
+        size_t begin = range.first / 64 * 64;
+        while (crossed(begin))
+            begin -= 64;
+        size_t end = std::min(size, (std::min(range.second, size) + 2 + 63) / 64 * 64);
+        while (crossed(end))
+            end = std::min(size, end + 64);
+        if (!windows.empty() && begin <= windows.back().second)
+            windows.back().second = std::max(windows.back().second, end);
+        else
+            windows.push_back({ begin, end });
+    }
+
+    std::vector<std::pair<size_t, size_t>> pieces;
+    for (const std::pair<size_t, size_t>& window : windows)
+    {
+        for (size_t begin = window.first; begin < window.second; begin += kChunkSize)
+            pieces.push_back({ begin, std::min(window.second, begin + kChunkSize) });
+        TRACE_COUNT(Bytes, window.second - window.first);
+    }
+    std::vector<std::vector<StringHit>> pieceHits = ScanPieces(image, data, size, pieces, options);
+
+    // Previous hits up to each window, then the window's own
+    auto kept = previous.hits.begin();
+    size_t piece = 0;
+    for (const std::pair<size_t, size_t>& window : windows)
+    {
+        auto first = std::lower_bound(kept, previous.hits.end(), window.first,
+                                      [](const StringHit& hit, size_t offset) { return hit.offset < offset; });
+        hits.insert(hits.end(), kept, first);
+        kept = std::lower_bound(first, previous.hits.end(), window.second,
+                                [](const StringHit& hit, size_t offset) { return hit.offset < offset; });
+        for (; piece < pieces.size() && pieces[piece].first < window.second; piece++)
+            hits.insert(hits.end(), pieceHits[piece].begin(), pieceHits[piece].end());
+    }
+    hits.insert(hits.end(), kept, previous.hits.end());
+}
+
+void StringTable::Clear()
+{
+    data = nullptr;
+    size = 0;
+    hits.clear();
+    hits.shrink_to_fit();
+}
+
+std::string StringTable::Text(size_t index) const
+{
+    const StringHit& hit = hits[index];
+    const BYTE* text = data + hit.offset;
+    if (hit.encoding == StringAscii)
+        return std::string(reinterpret_cast<const char*>(text), hit.length);
+
+    std::string narrow(hit.length, '\0');
+    for (uint32_t i = 0; i < hit.length; i++)
+        narrow[i] = static_cast<char>(text[2 * i]);
+    return narrow;
+}
+
+static BYTE ToLower(BYTE c)
+{
+    return (c >= 'A' && c <= 'Z') ? BYTE(c + ('a' - 'A')) : c;
+}
+
+// Case-insensitive substring test straight on the file bytes, stride 1 for ASCII and 2 for UTF-16
+static bool Contains(const BYTE* text, uint32_t length, unsigned stride, const std::string& needle)
+{
+    if (needle.size() > length)
+        return false;
+    BYTE first = static_cast<BYTE>(needle[0]);
+    for (size_t i = 0; i + needle.size() <= length; i++)
+    {
+        if (ToLower(text[i * stride]) != first)
+            continue;
+        size_t k = 1;
+        while (k < needle.size() && ToLower(text[(i + k) * stride]) == static_cast<BYTE>(needle[k]))
+            k++;
+        if (k == needle.size())
+            return true;
+    }
+    return false;
+}
+
+void StringTable::Filter(const std::string& needle, const std::vector<uint32_t>* candidates, std::vector<uint32_t>& matches) const
+{
+    std::string lowered(needle);
+    for (char& c : lowered)
+        c = static_cast<char>(ToLower(static_cast<BYTE>(c)));
+
+    matches.clear();
+    auto test = [&](uint32_t index)
+    {
+        const StringHit& hit = hits[index];
+        if (lowered.empty() || Contains(data + hit.offset, hit.length, hit.encoding == StringUtf16 ? 2 : 1, lowered))
+            matches.push_back(index);
+    };
+
+    if (candidates != nullptr)
+    {
+        for (uint32_t index : *candidates)
+            test(index);
+    }
+    else
+    {
+        matches.reserve(lowered.empty() ? hits.size() : 0);
+        for (size_t i = 0; i < hits.size(); i++)
+            test(static_cast<uint32_t>(i));
+    }
+}
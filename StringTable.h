@@ -0,0 +1,75 @@
+#ifndef STRINGTABLE_H
+#define STRINGTABLE_H
+
+#include "PETypes.h"
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+class PEImageBase;
+
+enum StringEncoding : uint8_t
+{
+    StringAscii,
+    StringUtf16
+};
+
+// One extracted string. The text itself stays in the file; Text() reads it on demand.
+struct StringHit
+{
+    uint64_t offset;   // File offset of the first byte
+    DWORD rva;         // 0 outside every section's raw data
+    uint32_t length;   // In characters
+    uint16_t section;  // Index into the section table, StringTable::kNoSection for headers and overlay
+    uint8_t encoding;  // StringEncoding
+};
+
+struct StringScanOptions
+{
+    size_t minLength = 4; // In characters
+    bool ascii = true;
+    bool utf16 = true;
+    unsigned threads = 0; // 0 = hardware concurrency
+};
+
+// Printable-ASCII runs (and tabs), and the same characters as 2-byte aligned UTF-16LE, found in the whole mapped
+// file. The file is split into chunks scanned in parallel; each chunk owns the runs that start inside it and follows
+// them past its end, so a string crossing a boundary is reported once and whole. Bytes are classified 64 at a time
+// into printable and zero bitmasks with SIMD, and runs are read off the mask edges.
+class StringTable
+{
+public:
+    static const uint16_t kNoSection = 0xFFFF;
+
+    // The image must have been parsed up to ParseSections and must outlive the table's use of Text()
+    void Scan(const PEImageBase& image, const StringScanOptions& options = StringScanOptions());
+    // Scan for a new version of the file previous was scanned from, with the same options, size and section table.
+    // Only the changed byte ranges, widened to the runs that touch them, are read; every other hit is copied.
+    void Rescan(const PEImageBase& image, const StringTable& previous,
+                const std::vector<std::pair<size_t, size_t>>& changed, const StringScanOptions& options = StringScanOptions());
+    void Clear();
+
+    // In file offset order
+    size_t Count() const { return hits.size(); }
+    const StringHit& operator[](size_t index) const { return hits[index]; }
+    const StringHit* begin() const { return hits.data(); }
+    const StringHit* end() const { return hits.data() + hits.size(); }
+
+    // The string's characters; UTF-16 strings hold only ASCII characters, so this is exact for both
+    std::string Text(size_t index) const;
+
+    // Indices of the strings that contain needle, ignoring ASCII case. With candidates, only those indices are
+    // searched, which is how a filter that grows one keystroke at a time narrows its previous result.
+    void Filter(const std::string& needle, const std::vector<uint32_t>* candidates, std::vector<uint32_t>& matches) const;
+
+private:
+    const BYTE* data = nullptr;
+    size_t size = 0;
+    std::vector<StringHit> hits;
+};
+
+// Name of the byte classifier picked for this CPU ("avx2", "sse2" or "scalar")
+const char* StringKernelName();
+
+#endif // STRINGTABLE_H
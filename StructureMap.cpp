@@ -0,0 +1,151 @@
+#include "StructureMap.h"
+#include <algorithm>
+#include <cstring>
+
+const char* StructureKindName(StructureKind kind)
+{
+    switch (kind)
+    {
+    case StructureKind::DosHeader:         return "DOS header";
+    case StructureKind::NtHeaders:         return "NT headers";
+    case StructureKind::SectionTable:      return "Section table";
+    case StructureKind::ImportDescriptors: return "Import descriptors";
+    case StructureKind::ImportThunks:      return "Import thunks";
+    case StructureKind::ImportNames:       return "Import names";
+    case StructureKind::ChangedBytes:      return "Changed bytes";
+    default:                               return "";
+    }
+}
+
+// Collects regions, skipping anything the RVA index cannot place in the file
+class RegionBuilder
+{
+public:
+    RegionBuilder(const PEImageBase& _image) : image(_image) {}
+
+    void AddOffset(size_t offset, size_t size, StructureKind kind)
+    {
+        if (size > 0 && offset < image.GetImageSize() && size <= image.GetImageSize() - offset)
+            regions.push_back({ offset, size, kind });
+    }
+
+    void AddRva(DWORD rva, size_t size, StructureKind kind)
+    {
+        size_t offset;
+        if (image.RvaToOffset(rva, size, offset))
+            AddOffset(offset, size, kind);
+    }
+
+    void AddPointer(const void* pointer, size_t size, StructureKind kind)
+    {
+        AddOffset(static_cast<size_t>(static_cast<const BYTE*>(pointer) - static_cast<const BYTE*>(image.GetImageBase())), size, kind);
+    }
+
+    std::vector<StructureRegion> Finish()
+    {
+        // Adjacent ranges of one kind (hint/name entries, per-module thunk arrays) are merged to keep lookups short;
+        // hint/name entries are word aligned, so a one-byte pad between them still counts as adjacent
+        std::sort(regions.begin(), regions.end(), [](const StructureRegion& a, const StructureRegion& b) { return a.offset < b.offset; });
+        std::vector<StructureRegion> merged;
+        for (const StructureRegion& region : regions)
+        {
+            if (!merged.empty() && merged.back().kind == region.kind && merged.back().offset + merged.back().size + 1 >= region.offset)
+                merged.back().size = std::max(merged.back().size, region.offset + region.size - merged.back().offset);
+            else
+                merged.push_back(region);
+        }
+        return merged;
+    }
+
+private:
+    const PEImageBase& image;
+    std::vector<StructureRegion> regions;
+};
+
+template <typename Image>
+std::vector<StructureRegion> BuildStructureMap(const Image& image)
+{
+    typedef typename Image::ThunkData ThunkData;
+    RegionBuilder builder(image);
+
+    if (image.GetDOSHeader() == nullptr)
+        return builder.Finish();
+    builder.AddOffset(0, sizeof(IMAGE_DOS_HEADER), StructureKind::DosHeader);
+
+    // Signature, file header and optional header up to the section table
+    if (image.GetNTHeaders() != nullptr && image.GetSectionHeader() != nullptr)
+    {
+        const BYTE* ntHeaders = reinterpret_cast<const BYTE*>(image.GetNTHeaders());
+        const BYTE* sectionTable = reinterpret_cast<const BYTE*>(image.GetSectionHeader());
+        if (sectionTable > ntHeaders)
+            builder.AddPointer(ntHeaders, static_cast<size_t>(sectionTable - ntHeaders), StructureKind::NtHeaders);
+        builder.AddPointer(sectionTable, image.GetSections().size() * sizeof(IMAGE_SECTION_HEADER), StructureKind::SectionTable);
+    }
+
+    DWORD descriptorRVA = image.GetDataDirectory(IMAGE_DIRECTORY_ENTRY_IMPORT).VirtualAddress;
+    if (descriptorRVA == 0)
+        return builder.Finish();
+
+    // Same walk as ParseImports, which has already validated every pointer followed here
+    DWORD descriptorCount = 0;
+    for (; ; descriptorRVA += sizeof(IMAGE_IMPORT_DESCRIPTOR))
+    {
+        const IMAGE_IMPORT_DESCRIPTOR* descriptor = image.template RvaToPointer<IMAGE_IMPORT_DESCRIPTOR>(descriptorRVA);
+        if (descriptor == nullptr)
+            break;
+        descriptorCount++;
+        if (descriptor->Name == 0)
+            break;
+
+        const char* moduleName = image.RvaToString(descriptor->Name);
+        if (moduleName != nullptr)
+            builder.AddRva(descriptor->Name, strlen(moduleName) + 1, StructureKind::ImportNames);
+
+        // Both the lookup table and the IAT, they are separate arrays in most images
+        DWORD thunkArrays[2] = { descriptor->OriginalFirstThunk, descriptor->FirstThunk };
+        DWORD lookupTable = descriptor->OriginalFirstThunk != 0 ? descriptor->OriginalFirstThunk : descriptor->FirstThunk;
+        for (DWORD firstThunk : thunkArrays)
+        {
+            if (firstThunk == 0)
+                continue;
+
+            DWORD count = 0;
+            for (DWORD thunk = firstThunk; ; thunk += sizeof(ThunkData))
+            {
+                const ThunkData* thunkData = image.template RvaToPointer<ThunkData>(thunk);
+                if (thunkData == nullptr)
+                    break;
+                count++;
+                if (thunkData->u1.AddressOfData == 0)
+                    break;
+
+                // Hint/name entries, reached from the same table ParseImports reads
+                if (firstThunk == lookupTable && !Image::IsImportByOrdinal(thunkData->u1.AddressOfData))
+                {
+                    DWORD importByName = static_cast<DWORD>(thunkData->u1.AddressOfData);
+                    const char* name = image.RvaToString(importByName + sizeof(WORD));
+                    if (name != nullptr)
+                        builder.AddRva(importByName, sizeof(WORD) + strlen(name) + 1, StructureKind::ImportNames);
+                }
+            }
+            builder.AddRva(firstThunk, count * sizeof(ThunkData), StructureKind::ImportThunks);
+        }
+    }
+    builder.AddRva(image.GetDataDirectory(IMAGE_DIRECTORY_ENTRY_IMPORT).VirtualAddress,
+                   descriptorCount * sizeof(IMAGE_IMPORT_DESCRIPTOR), StructureKind::ImportDescriptors);
+
+    return builder.Finish();
+}
+
+const StructureRegion* FindStructure(const std::vector<StructureRegion>& regions, size_t offset)
+{
+    auto it = std::upper_bound(regions.begin(), regions.end(), offset,
+                               [](size_t value, const StructureRegion& region) { return value < region.offset; });
+    if (it == regions.begin())
+        return nullptr;
+    --it;
+    return offset - it->offset < it->size ? &*it : nullptr;
+}
+
+template std::vector<StructureRegion> BuildStructureMap(const PE32& image);
+template std::vector<StructureRegion> BuildStructureMap(const PE64& image);
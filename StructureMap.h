@@ -0,0 +1,37 @@
+#ifndef STRUCTUREMAP_H
+#define STRUCTUREMAP_H
+
+#include "PEImage.h"
+#include <vector>
+
+// Which parsed structure a range of file bytes belongs to, for overlays in raw views
+enum class StructureKind
+{
+    DosHeader,
+    NtHeaders,
+    SectionTable,
+    ImportDescriptors,
+    ImportThunks,
+    ImportNames,
+    ChangedBytes, // Not parsed, marks the ranges a diff found
+    Count
+};
+
+struct StructureRegion
+{
+    size_t offset; // File offset
+    size_t size;
+    StructureKind kind;
+};
+
+const char* StructureKindName(StructureKind kind);
+
+// File ranges of the structures the parser walked, sorted by offset.
+// The image must have been parsed through ParseImports; ranges outside the file are dropped.
+template <typename Image>
+std::vector<StructureRegion> BuildStructureMap(const Image& image);
+
+// Region containing offset in a map from BuildStructureMap, or nullptr
+const StructureRegion* FindStructure(const std::vector<StructureRegion>& regions, size_t offset);
+
+#endif // STRUCTUREMAP_H
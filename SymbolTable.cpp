@@ -0,0 +1,111 @@
+#include "SymbolTable.h"
+#include "Hash.h"
+#include <cctype>
+#include <cstring>
+#include <functional>
+#include <string>
+
+static uint64_t FoldedNameHash(std::string_view text)
+{
+    std::string folded(text);
+    for (char& c : folded)
+        c = static_cast<char>(tolower(static_cast<unsigned char>(c)));
+    for (const char* extension : { ".dll", ".ocx", ".sys" })
+    {
+        if (folded.size() > 4 && folded.compare(folded.size() - 4, 4, extension) == 0)
+        {
+            folded.resize(folded.size() - 4);
+            break;
+        }
+    }
+    return XXHash64(folded.data(), folded.size());
+}
+
+SymbolTable::SymbolTable()
+{
+    Intern(std::string_view("", 0));
+}
+
+SymbolTable::~SymbolTable()
+{
+    for (std::atomic<Entry*>& segment : segments)
+        delete[] segment.load(std::memory_order_relaxed);
+}
+
+SymbolTable& SymbolTable::Global()
+{
+    static SymbolTable table;
+    return table;
+}
+
+void SymbolTable::Locate(uint32_t id, size_t& segment, size_t& index)
+{
+    // Segment k starts at kFirstSegment * (2^k - 1)
+    size_t scaled = id / kFirstSegment + 1;
+    segment = 0;
+    while ((scaled >> (segment + 1)) != 0)
+        segment++;
+    index = id - kFirstSegment * ((size_t(1) << segment) - 1);
+}
+
+const SymbolTable::Entry& SymbolTable::Lookup(uint32_t id) const
+{
+    size_t segment;
+    size_t index;
+    Locate(id, segment, index);
+    return segments[segment].load(std::memory_order_acquire)[index];
+}
+
+SymbolTable::Shard& SymbolTable::ShardOf(std::string_view text) const
+{
+    // The top bits of a multiplied hash, so the shard does not follow the bits the map buckets by
+    uint64_t hash = std::hash<std::string_view>()(text) * 0x9E3779B97F4A7C15ull;
+    return shards[hash >> 58];
+}
+
+SymbolTable::Entry* SymbolTable::Segment(size_t segment)
+{
+    Entry* entries = segments[segment].load(std::memory_order_acquire);
+    if (entries != nullptr)
+        return entries;
+
+    // Two shards may need the same new segment at once; the loser frees its copy
+    Entry* fresh = new Entry[kFirstSegment << segment];
+    if (segments[segment].compare_exchange_strong(entries, fresh, std::memory_order_acq_rel))
+        return fresh;
+    delete[] fresh;
+    return entries;
+}
+
+uint32_t SymbolTable::Intern(std::string_view text)
+{
+    Shard& shard = ShardOf(text);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto found = shard.ids.find(text);
+    if (found != shard.ids.end())
+        return found->second;
+
+    char* copy = shard.storage.AllocateArray<char>(text.size() + 1);
+    memcpy(copy, text.data(), text.size());
+    copy[text.size()] = '\0';
+
+    // The entry is complete before the shard unlocks, and any other thread only learns the ID through this
+    // shard's lock or from a thread that already did, so lookups need no lock of their own
+    uint32_t id = static_cast<uint32_t>(size.fetch_add(1, std::memory_order_acq_rel));
+    size_t segment;
+    size_t index;
+    Locate(id, segment, index);
+    Segment(segment)[index] = { copy, static_cast<uint32_t>(text.size()), FoldedNameHash(text) };
+
+    shard.ids.emplace(std::string_view(copy, text.size()), id);
+    bytes.fetch_add(text.size() + 1, std::memory_order_relaxed);
+    return id;
+}
+
+uint32_t SymbolTable::Find(std::string_view text) const
+{
+    Shard& shard = ShardOf(text);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto found = shard.ids.find(text);
+    return found != shard.ids.end() ? found->second : kNotFound;
+}
@@ -0,0 +1,85 @@
+#ifndef SYMBOLTABLE_H
+#define SYMBOLTABLE_H
+
+#include "Arena.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string_view>
+#include <unordered_map>
+
+// Interned strings with dense 32-bit IDs, shared by every thread of a batch scan. Across a corpus the same few
+// thousand DLL and function names repeat millions of times; summaries keep their IDs instead of copies, so memory
+// grows with the number of distinct names rather than with the number of files.
+// Interning locks one of kShardCount shards picked by the string's hash, so threads rarely meet. Looking an ID up
+// takes no lock: entries live in segments that never move once allocated. ID 0 is the empty string, and every
+// string is kept NUL-terminated.
+class SymbolTable
+{
+public:
+    static const uint32_t kNotFound = UINT32_MAX;
+
+    SymbolTable();
+    ~SymbolTable();
+
+    SymbolTable(const SymbolTable&) = delete;
+    SymbolTable& operator=(const SymbolTable&) = delete;
+
+    // The table batch summaries intern into
+    static SymbolTable& Global();
+
+    // The ID of text, added if it is new. Thread-safe.
+    uint32_t Intern(std::string_view text);
+    // kNotFound if text was never interned
+    uint32_t Find(std::string_view text) const;
+
+    // id must have come from Intern (on any thread, as long as the ID was handed over safely)
+    std::string_view Name(uint32_t id) const
+    {
+        const Entry& entry = Lookup(id);
+        return std::string_view(entry.text, entry.length);
+    }
+    const char* CString(uint32_t id) const { return Lookup(id).text; }
+
+    // XXH64 of the lowercased name with any .dll, .ocx or .sys extension dropped, so
+    // "KERNEL32.dll" and "kernel32" agree the way imphash wants them to
+    uint64_t FoldedHash(uint32_t id) const { return Lookup(id).folded; }
+
+    // IDs run from 0 to Size() - 1; the newest may still be being written until interning stops
+    size_t Size() const { return size.load(std::memory_order_acquire); }
+    size_t Bytes() const { return bytes.load(std::memory_order_relaxed); }
+
+private:
+    struct Entry
+    {
+        const char* text;
+        uint32_t length;
+        uint64_t folded;
+    };
+
+    // ~64 shards keep contention low with any realistic number of workers
+    static const size_t kShardCount = 64;
+    // Segment k holds kFirstSegment << k entries, so 23 segments cover every 32-bit ID
+    static const size_t kFirstSegment = 1024;
+    static const size_t kSegmentCount = 23;
+
+    struct Shard
+    {
+        mutable std::mutex mutex;
+        std::unordered_map<std::string_view, uint32_t> ids; // Keys point into storage
+        Arena storage{ 64 * 1024 };
+    };
+
+    static void Locate(uint32_t id, size_t& segment, size_t& index);
+    const Entry& Lookup(uint32_t id) const;
+    Shard& ShardOf(std::string_view text) const;
+    Entry* Segment(size_t segment);
+
+    mutable Shard shards[kShardCount];
+    std::atomic<Entry*> segments[kSegmentCount] = {};
+    std::atomic<size_t> size{0};
+    std::atomic<size_t> bytes{0};
+};
+
+#endif // SYMBOLTABLE_H
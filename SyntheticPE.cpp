@@ -0,0 +1,365 @@
+#include "SyntheticPE.h"
+#include "PEImage.h"
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+
+static const DWORD kFileAlignment = 0x200;
+static const DWORD kSectionAlignment = 0x1000;
+static const DWORD kDosStubSize = 0x80; // e_lfanew
+
+static DWORD AlignUp(DWORD value, DWORD alignment)
+{
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+// Growable little-endian buffer with patching for values only known later
+class ByteWriter
+{
+public:
+    size_t Size() const { return bytes.size(); }
+    std::vector<unsigned char>& Bytes() { return bytes; }
+
+    size_t Put(const void* data, size_t size)
+    {
+        size_t offset = bytes.size();
+        bytes.insert(bytes.end(), static_cast<const unsigned char*>(data), static_cast<const unsigned char*>(data) + size);
+        return offset;
+    }
+
+    template <typename T>
+    size_t Put(const T& value)
+    {
+        return Put(&value, sizeof(T));
+    }
+
+    size_t PutString(const std::string& text)
+    {
+        return Put(text.c_str(), text.size() + 1);
+    }
+
+    size_t Reserve(size_t size)
+    {
+        size_t offset = bytes.size();
+        bytes.resize(bytes.size() + size);
+        return offset;
+    }
+
+    template <typename T>
+    void Patch(size_t offset, const T& value)
+    {
+        memcpy(bytes.data() + offset, &value, sizeof(T));
+    }
+
+    void Align(size_t alignment)
+    {
+        bytes.resize((bytes.size() + alignment - 1) / alignment * alignment);
+    }
+
+private:
+    std::vector<unsigned char> bytes;
+};
+
+struct SectionPlan
+{
+    std::string name;
+    DWORD characteristics;
+    std::vector<unsigned char> content;
+    DWORD virtualAddress;
+};
+
+struct DirectoryRange
+{
+    DWORD rva = 0;
+    DWORD size = 0;
+};
+
+// Import descriptors, lookup tables, IATs, hint/name entries and module names, all inside one section at baseRva
+template <typename Traits>
+static DirectoryRange WriteImports(ByteWriter& writer, DWORD baseRva, const SyntheticPEOptions& options, std::mt19937& random)
+{
+    typedef typename Traits::ThunkValue ThunkValue;
+    DirectoryRange range;
+    if (options.importModules <= 0)
+        return range;
+
+    size_t thunksPerModule = static_cast<size_t>(options.importsPerModule) + 1;
+    size_t descriptors = writer.Reserve((options.importModules + 1) * sizeof(IMAGE_IMPORT_DESCRIPTOR));
+    size_t lookupTables = writer.Reserve(options.importModules * thunksPerModule * sizeof(ThunkValue));
+    size_t addressTables = writer.Reserve(options.importModules * thunksPerModule * sizeof(ThunkValue));
+    range.rva = baseRva + static_cast<DWORD>(descriptors);
+    range.size = static_cast<DWORD>((options.importModules + 1) * sizeof(IMAGE_IMPORT_DESCRIPTOR));
+
+    for (int module = 0; module < options.importModules; module++)
+    {
+        size_t lookup = lookupTables + module * thunksPerModule * sizeof(ThunkValue);
+        size_t address = addressTables + module * thunksPerModule * sizeof(ThunkValue);
+        for (int function = 0; function < options.importsPerModule; function++)
+        {
+            ThunkValue thunk;
+            if (function % 7 == 6)
+            {
+                thunk = Traits::ordinalFlag | static_cast<ThunkValue>(1 + random() % 0xFFFF);
+            }
+            else
+            {
+                writer.Align(2);
+                size_t hintName = writer.Put(static_cast<WORD>(random() & 0xFFFF));
+                writer.PutString("Function" + std::to_string(module) + "_" + std::to_string(function) + "_" + std::to_string(random() % 100000));
+                thunk = static_cast<ThunkValue>(baseRva + hintName);
+            }
+            writer.Patch(lookup + function * sizeof(ThunkValue), thunk);
+            writer.Patch(address + function * sizeof(ThunkValue), thunk);
+        }
+
+        IMAGE_IMPORT_DESCRIPTOR descriptor = {};
+        descriptor.OriginalFirstThunk = baseRva + static_cast<DWORD>(lookup);
+        descriptor.FirstThunk = baseRva + static_cast<DWORD>(address);
+        descriptor.Name = baseRva + static_cast<DWORD>(writer.PutString("module" + std::to_string(module) + ".dll"));
+        writer.Patch(descriptors + module * sizeof(IMAGE_IMPORT_DESCRIPTOR), descriptor);
+    }
+    return range;
+}
+
+// Export directory, address/name/ordinal tables and strings; forwarder strings sit inside the directory range
+static DirectoryRange WriteExports(ByteWriter& writer, DWORD baseRva, const SyntheticPEOptions& options, DWORD codeRva)
+{
+    DirectoryRange range;
+    if (options.exports <= 0)
+        return range;
+
+    writer.Align(4);
+    DWORD count = static_cast<DWORD>(options.exports);
+    size_t directoryOffset = writer.Reserve(sizeof(IMAGE_EXPORT_DIRECTORY));
+    size_t functions = writer.Reserve(count * sizeof(DWORD));
+    size_t names = writer.Reserve(count * sizeof(DWORD));
+    size_t ordinals = writer.Reserve(count * sizeof(WORD));
+
+    IMAGE_EXPORT_DIRECTORY directory = {};
+    directory.Name = baseRva + static_cast<DWORD>(writer.PutString("synthetic.dll"));
+    directory.Base = 1;
+    directory.NumberOfFunctions = count;
+    directory.NumberOfNames = count;
+    directory.AddressOfFunctions = baseRva + static_cast<DWORD>(functions);
+    directory.AddressOfNames = baseRva + static_cast<DWORD>(names);
+    directory.AddressOfNameOrdinals = baseRva + static_cast<DWORD>(ordinals);
+
+    // Name pointers must be sorted for the loader's binary search; zero padding keeps numeric order lexical
+    for (DWORD i = 0; i < count; i++)
+    {
+        char name[32];
+        snprintf(name, sizeof(name), "Export%06u", i);
+        writer.Patch(names + i * sizeof(DWORD), baseRva + static_cast<DWORD>(writer.PutString(name)));
+        writer.Patch(ordinals + i * sizeof(WORD), static_cast<WORD>(i));
+
+        DWORD function = codeRva + i * 16;
+        if (i % 11 == 10)
+            function = baseRva + static_cast<DWORD>(writer.PutString("module0.Function0_" + std::to_string(i)));
+        writer.Patch(functions + i * sizeof(DWORD), function);
+    }
+    writer.Patch(directoryOffset, directory);
+
+    range.rva = baseRva + static_cast<DWORD>(directoryOffset);
+    range.size = static_cast<DWORD>(writer.Size() - directoryOffset);
+    return range;
+}
+
+// Base relocation blocks, one per 4 KB page of .text, padded to a DWORD with an ABSOLUTE entry
+static std::vector<unsigned char> BuildRelocations(const SyntheticPEOptions& options, DWORD codeRva, DWORD codeSize, std::mt19937& random)
+{
+    ByteWriter writer;
+    WORD type = options.pe64 ? IMAGE_REL_BASED_DIR64 : IMAGE_REL_BASED_HIGHLOW;
+    DWORD pages = (codeSize + 0xFFF) / 0x1000;
+    int remaining = options.relocations;
+    for (DWORD page = 0; remaining > 0; page = (page + 1) % pages)
+    {
+        int entries = remaining < 64 ? remaining : 64;
+        size_t blockOffset = writer.Put(IMAGE_BASE_RELOCATION{ codeRva + page * 0x1000, 0 });
+        for (int i = 0; i < entries; i++)
+            writer.Put(static_cast<WORD>((type << 12) | (random() & 0xFF8)));
+        if (entries % 2 != 0)
+            writer.Put(static_cast<WORD>(IMAGE_REL_BASED_ABSOLUTE << 12));
+        writer.Patch(blockOffset + sizeof(DWORD), static_cast<DWORD>(writer.Size() - blockOffset));
+        remaining -= entries;
+    }
+    return writer.Bytes();
+}
+
+template <typename Traits>
+static std::vector<unsigned char> BuildImage(const SyntheticPEOptions& options)
+{
+    typedef typename Traits::NTHeaders NTHeaders;
+    std::mt19937 random(options.seed);
+
+    int sectionCount = options.sections < 3 ? 3 : options.sections;
+    DWORD headersSize = AlignUp(kDosStubSize + sizeof(NTHeaders) + sectionCount * sizeof(IMAGE_SECTION_HEADER), kFileAlignment);
+
+    // Section contents are built in RVA order, since .rdata and .reloc embed their own RVAs
+    std::vector<SectionPlan> sections;
+    DWORD nextRva = AlignUp(headersSize, kSectionAlignment);
+    auto addSection = [&](const char* name, DWORD characteristics, std::vector<unsigned char> content)
+    {
+        sections.push_back({ name, characteristics, std::move(content), nextRva });
+        nextRva += AlignUp(static_cast<DWORD>(sections.back().content.size() > 0 ? sections.back().content.size() : 1), kSectionAlignment);
+    };
+
+    DWORD codeSize = 0x2000;
+    std::vector<unsigned char> code(codeSize);
+    for (unsigned char& byte : code)
+        byte = static_cast<unsigned char>(random());
+    DWORD codeRva = nextRva;
+    addSection(".text", IMAGE_SCN_CNT_CODE | IMAGE_SCN_MEM_EXECUTE | IMAGE_SCN_MEM_READ, std::move(code));
+
+    ByteWriter rdata;
+    DWORD rdataRva = nextRva;
+    DirectoryRange imports = WriteImports<Traits>(rdata, rdataRva, options, random);
+    DirectoryRange exports = WriteExports(rdata, rdataRva, options, codeRva);
+    addSection(".rdata", IMAGE_SCN_CNT_INITIALIZED_DATA | IMAGE_SCN_MEM_READ, std::move(rdata.Bytes()));
+
+    DirectoryRange relocations;
+    relocations.rva = nextRva;
+    std::vector<unsigned char> relocationBytes = BuildRelocations(options, codeRva, codeSize, random);
+    relocations.size = static_cast<DWORD>(relocationBytes.size());
+    if (relocations.size == 0)
+        relocations.rva = 0;
+    addSection(".reloc", IMAGE_SCN_CNT_INITIALIZED_DATA | IMAGE_SCN_MEM_DISCARDABLE | IMAGE_SCN_MEM_READ, std::move(relocationBytes));
+
+    for (int i = 3; i < sectionCount; i++)
+    {
+        std::vector<unsigned char> data(0x200 * (1 + random() % 4));
+        for (size_t j = 0; j < data.size(); j += 1 + random() % 8)
+            data[j] = static_cast<unsigned char>(random());
+        addSection((".data" + std::to_string(i - 3)).substr(0, IMAGE_SIZEOF_SHORT_NAME).c_str(),
+                   IMAGE_SCN_CNT_INITIALIZED_DATA | IMAGE_SCN_MEM_READ | IMAGE_SCN_MEM_WRITE, std::move(data));
+    }
+
+    ByteWriter image;
+    IMAGE_DOS_HEADER dosHeader = {};
+    dosHeader.e_magic = IMAGE_DOS_SIGNATURE;
+    dosHeader.e_cblp = 0x90;
+    dosHeader.e_cp = 3;
+    dosHeader.e_lfanew = kDosStubSize;
+    image.Put(dosHeader);
+    image.Reserve(kDosStubSize - sizeof(IMAGE_DOS_HEADER));
+
+    NTHeaders ntHeaders = {};
+    ntHeaders.Signature = IMAGE_NT_SIGNATURE;
+    ntHeaders.FileHeader.Machine = options.pe64 ? 0x8664 : 0x14C; // AMD64 : I386
+    ntHeaders.FileHeader.NumberOfSections = static_cast<WORD>(sectionCount);
+    ntHeaders.FileHeader.TimeDateStamp = 0x60000000 + options.seed;
+    ntHeaders.FileHeader.SizeOfOptionalHeader = sizeof(ntHeaders.OptionalHeader);
+    ntHeaders.FileHeader.Characteristics = options.pe64 ? 0x2022 : 0x2102; // Executable DLL, large address aware or 32-bit machine
+    ntHeaders.OptionalHeader.Magic = Traits::magic;
+    ntHeaders.OptionalHeader.AddressOfEntryPoint = codeRva;
+    ntHeaders.OptionalHeader.ImageBase = options.pe64 ? 0x180000000ULL : 0x10000000;
+    ntHeaders.OptionalHeader.SectionAlignment = kSectionAlignment;
+    ntHeaders.OptionalHeader.FileAlignment = kFileAlignment;
+    ntHeaders.OptionalHeader.MajorOperatingSystemVersion = 6;
+    ntHeaders.OptionalHeader.MajorSubsystemVersion = 6;
+    ntHeaders.OptionalHeader.SizeOfImage = nextRva;
+    ntHeaders.OptionalHeader.SizeOfHeaders = headersSize;
+    ntHeaders.OptionalHeader.Subsystem = 2; // Windows GUI
+    ntHeaders.OptionalHeader.NumberOfRvaAndSizes = IMAGE_NUMBEROF_DIRECTORY_ENTRIES;
+    ntHeaders.OptionalHeader.DataDirectory[IMAGE_DIRECTORY_ENTRY_EXPORT] = { exports.rva, exports.size };
+    ntHeaders.OptionalHeader.DataDirectory[IMAGE_DIRECTORY_ENTRY_IMPORT] = { imports.rva, imports.size };
+    ntHeaders.OptionalHeader.DataDirectory[IMAGE_DIRECTORY_ENTRY_BASERELOC] = { relocations.rva, relocations.size };
+    size_t ntOffset = image.Put(ntHeaders);
+
+    DWORD rawOffset = headersSize;
+    std::vector<DWORD> rawOffsets;
+    for (const SectionPlan& plan : sections)
+    {
+        IMAGE_SECTION_HEADER section = {};
+        memcpy(section.Name, plan.name.c_str(), plan.name.size() < IMAGE_SIZEOF_SHORT_NAME ? plan.name.size() : IMAGE_SIZEOF_SHORT_NAME);
+        section.Misc.VirtualSize = static_cast<DWORD>(plan.content.size());
+        section.VirtualAddress = plan.virtualAddress;
+        section.SizeOfRawData = AlignUp(static_cast<DWORD>(plan.content.size()), kFileAlignment);
+        section.PointerToRawData = section.SizeOfRawData > 0 ? rawOffset : 0;
+        section.Characteristics = plan.characteristics;
+        image.Put(section);
+        rawOffsets.push_back(rawOffset);
+        rawOffset += section.SizeOfRawData;
+    }
+    image.Align(kFileAlignment);
+
+    for (const SectionPlan& plan : sections)
+    {
+        image.Put(plan.content.data(), plan.content.size());
+        image.Align(kFileAlignment);
+    }
+
+    std::vector<unsigned char>& bytes = image.Bytes();
+    size_t optionalOffset = ntOffset + sizeof(DWORD) + sizeof(IMAGE_FILE_HEADER);
+    size_t directoryOffset = ntOffset + offsetof(NTHeaders, OptionalHeader.DataDirectory);
+    size_t rdataOffset = rawOffsets[1];
+    switch (options.malformation)
+    {
+    case Malformation::Truncated:
+        bytes.resize(ntOffset + sizeof(DWORD) + sizeof(IMAGE_FILE_HEADER) / 2);
+        break;
+    case Malformation::BadLfanew:
+        memcpy(bytes.data() + offsetof(IMAGE_DOS_HEADER, e_lfanew), "\xF0\xFF\xFF\x7F", 4);
+        break;
+    case Malformation::BadMagic:
+        bytes[optionalOffset] = 0x99;
+        bytes[optionalOffset + 1] = 0x09;
+        break;
+    case Malformation::SectionTableOverflow:
+        bytes[ntOffset + sizeof(DWORD) + offsetof(IMAGE_FILE_HEADER, NumberOfSections)] = 0xFF;
+        bytes[ntOffset + sizeof(DWORD) + offsetof(IMAGE_FILE_HEADER, NumberOfSections) + 1] = 0xFF;
+        break;
+    case Malformation::ImportOutOfFile:
+    {
+        DWORD rva = 0x7FFF0000;
+        memcpy(bytes.data() + directoryOffset + IMAGE_DIRECTORY_ENTRY_IMPORT * sizeof(IMAGE_DATA_DIRECTORY), &rva, sizeof(rva));
+        break;
+    }
+    case Malformation::BadImportName:
+        if (imports.rva != 0)
+        {
+            DWORD rva = 0x7FFF0000;
+            memcpy(bytes.data() + rdataOffset + (imports.rva - rdataRva) + offsetof(IMAGE_IMPORT_DESCRIPTOR, Name), &rva, sizeof(rva));
+        }
+        break;
+    case Malformation::TruncatedImports:
+        // Keep the descriptors, cut right after them
+        if (imports.rva != 0)
+            bytes.resize(rdataOffset + (imports.rva - rdataRva) + imports.size + 8);
+        break;
+    case Malformation::BadExportNames:
+        if (exports.rva != 0)
+        {
+            DWORD count = 0x7FFFFFFF;
+            memcpy(bytes.data() + rdataOffset + (exports.rva - rdataRva) + offsetof(IMAGE_EXPORT_DIRECTORY, NumberOfNames), &count, sizeof(count));
+        }
+        break;
+    default:
+        break;
+    }
+    return bytes;
+}
+
+std::vector<unsigned char> BuildSyntheticPE(const SyntheticPEOptions& options)
+{
+    if (options.pe64)
+        return BuildImage<PE64Traits>(options);
+    return BuildImage<PE32Traits>(options);
+}
+
+const char* MalformationName(Malformation malformation)
+{
+    switch (malformation)
+    {
+    case Malformation::None:                 return "none";
+    case Malformation::Truncated:            return "truncated";
+    case Malformation::BadLfanew:            return "bad-lfanew";
+    case Malformation::BadMagic:             return "bad-magic";
+    case Malformation::SectionTableOverflow: return "section-table-overflow";
+    case Malformation::ImportOutOfFile:      return "import-out-of-file";
+    case Malformation::BadImportName:        return "bad-import-name";
+    case Malformation::TruncatedImports:     return "truncated-imports";
+    case Malformation::BadExportNames:       return "bad-export-names";
+    default:                                 return "";
+    }
+}
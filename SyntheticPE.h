@@ -0,0 +1,41 @@
+#ifndef SYNTHETICPE_H
+#define SYNTHETICPE_H
+
+#include <cstdint>
+#include <vector>
+
+// Ways a generated image can be broken. Each one makes a specific Parse* stage fail.
+enum class Malformation
+{
+    None,
+    Truncated,           // Cut inside the NT headers
+    BadLfanew,           // e_lfanew points far past the end of the file
+    BadMagic,            // Optional header magic matches neither width
+    SectionTableOverflow, // NumberOfSections runs the table past the end of the file
+    ImportOutOfFile,     // Import directory RVA is not backed by the file
+    BadImportName,       // A descriptor's Name RVA is unmapped
+    TruncatedImports,    // File ends in the middle of the thunk arrays
+    BadExportNames,      // Export name table larger than the file
+    Count
+};
+
+struct SyntheticPEOptions
+{
+    bool pe64 = false;
+    int sections = 4;          // At least 3: .text, .rdata and .reloc
+    int importModules = 4;
+    int importsPerModule = 32; // Every seventh is imported by ordinal
+    int exports = 64;          // Every eleventh is a forwarder
+    int relocations = 256;
+    Malformation malformation = Malformation::None;
+    uint32_t seed = 1;
+};
+
+// Build a complete, loader-plausible PE32 or PE32+ image in memory.
+// Layout: headers, .text (random bytes), .rdata (imports then exports), .reloc, then filler .data sections.
+// No real Windows binaries are needed, so benchmarks and fuzzing-style checks run anywhere.
+std::vector<unsigned char> BuildSyntheticPE(const SyntheticPEOptions& options);
+
+const char* MalformationName(Malformation malformation);
+
+#endif // SYNTHETICPE_H
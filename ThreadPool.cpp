@@ -0,0 +1,124 @@
+#include "ThreadPool.h"
+
+// Index of the worker running on this thread, or -1 for threads outside the pool
+static thread_local int currentWorker = -1;
+static thread_local const ThreadPool* currentPool = nullptr;
+
+ThreadPool::ThreadPool(unsigned threadCount)
+{
+    if (threadCount == 0)
+        threadCount = std::thread::hardware_concurrency();
+    if (threadCount == 0)
+        threadCount = 1;
+
+    for (unsigned i = 0; i < threadCount; i++)
+        queues.push_back(std::make_unique<WorkQueue>());
+
+    for (unsigned i = 0; i < threadCount; i++)
+        workers.emplace_back(&ThreadPool::WorkerLoop, this, i);
+}
+
+ThreadPool::~ThreadPool()
+{
+    Wait();
+
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        stopping = true;
+    }
+    wakeCondition.notify_all();
+
+    for (std::thread& worker : workers)
+        worker.join();
+}
+
+void ThreadPool::Submit(std::function<void()> task)
+{
+    // Tasks spawned by a worker stay on that worker's queue, everything else is dealt round-robin
+    unsigned index;
+    if (currentPool == this && currentWorker >= 0)
+        index = static_cast<unsigned>(currentWorker);
+    else
+        index = nextQueue.fetch_add(1, std::memory_order_relaxed) % queues.size();
+
+    pending.fetch_add(1);
+
+    // Count the task before it becomes visible so a thief can never take the counter below zero.
+    // The increment happens under the sleep lock so a worker about to sleep cannot miss it.
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        queued.fetch_add(1);
+    }
+    {
+        std::lock_guard<std::mutex> lock(queues[index]->mutex);
+        queues[index]->tasks.push_back(std::move(task));
+    }
+    wakeCondition.notify_one();
+}
+
+void ThreadPool::Wait()
+{
+    std::unique_lock<std::mutex> lock(sleepMutex);
+    idleCondition.wait(lock, [this] { return pending.load() == 0; });
+}
+
+bool ThreadPool::TryPop(unsigned index, std::function<void()>& task)
+{
+    WorkQueue& queue = *queues[index];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.tasks.empty())
+        return false;
+
+    task = std::move(queue.tasks.back());
+    queue.tasks.pop_back();
+    return true;
+}
+
+bool ThreadPool::TrySteal(unsigned index, std::function<void()>& task)
+{
+    // Start with the neighbour so thieves spread out instead of all hitting queue 0
+    for (size_t i = 1; i < queues.size(); i++)
+    {
+        WorkQueue& victim = *queues[(index + i) % queues.size()];
+        std::unique_lock<std::mutex> lock(victim.mutex, std::try_to_lock);
+        if (!lock.owns_lock() || victim.tasks.empty())
+            continue;
+
+        task = std::move(victim.tasks.front());
+        victim.tasks.pop_front();
+        return true;
+    }
+    return false;
+}
+
+void ThreadPool::WorkerLoop(unsigned index)
+{
+    currentWorker = static_cast<int>(index);
+    currentPool = this;
+
+    std::function<void()> task;
+    while (true)
+    {
+        if (TryPop(index, task) || TrySteal(index, task))
+        {
+            queued.fetch_sub(1);
+            task();
+            task = nullptr;
+
+            if (pending.fetch_sub(1) == 1)
+            {
+                std::lock_guard<std::mutex> lock(sleepMutex);
+                idleCondition.notify_all();
+            }
+            continue;
+        }
+
+        // A steal can fail on a contended lock, so only sleep once nothing is queued anywhere
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        if (stopping)
+            return;
+        wakeCondition.wait(lock, [this] { return stopping || queued.load() > 0; });
+        if (stopping && queued.load() == 0)
+            return;
+    }
+}
@@ -0,0 +1,55 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Work-stealing thread pool.
+// Every worker owns a deque: it pops its own work LIFO (cache-warm) and, when idle,
+// steals FIFO from the other workers, so uneven files do not leave cores idle.
+class ThreadPool
+{
+public:
+    // Zero threads = one per hardware thread
+    explicit ThreadPool(unsigned threadCount = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    void Submit(std::function<void()> task);
+
+    // Block until every submitted task has finished
+    void Wait();
+
+    unsigned ThreadCount() const { return static_cast<unsigned>(workers.size()); }
+
+private:
+    struct WorkQueue
+    {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    std::vector<std::unique_ptr<WorkQueue>> queues;
+    std::vector<std::thread> workers;
+    std::atomic<unsigned> nextQueue{0};
+    std::atomic<size_t> queued{0};  // Tasks sitting in a queue
+    std::atomic<size_t> pending{0}; // Tasks submitted but not yet finished
+    std::mutex sleepMutex;
+    std::condition_variable wakeCondition;
+    std::condition_variable idleCondition;
+    bool stopping = false;
+
+    bool TryPop(unsigned index, std::function<void()>& task);
+    bool TrySteal(unsigned index, std::function<void()>& task);
+    void WorkerLoop(unsigned index);
+};
+
+#endif // THREADPOOL_H
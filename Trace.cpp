@@ -0,0 +1,218 @@
+#include "Trace.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+// Per thread; a batch run keeps the latest events of every thread, about 1.5 MB each
+static const size_t kRingSize = 16384;
+static const size_t kCounterCount = size_t(TraceCounter::Count);
+
+std::atomic<bool> traceEnabled{false};
+
+struct TraceEvent
+{
+    const char* name;
+    uint64_t start;    // Nanoseconds since the trace clock started
+    uint64_t duration;
+    uint64_t counters[kCounterCount];
+    char detail[TraceScope::kDetailSize]; // NUL-terminated unless all of it is used
+};
+
+// Written only by its own thread. The registry keeps it alive after the thread exits, so pool threads that have
+// already been joined still show up in the trace.
+struct ThreadTrace
+{
+    uint32_t id = 0;
+    uint64_t counters[kCounterCount] = {}; // Running totals
+    std::vector<TraceEvent> events;        // The ring, allocated with the first event
+    std::atomic<uint64_t> written{0};
+};
+
+static std::mutex registryMutex;
+static std::vector<std::shared_ptr<ThreadTrace>> registry;
+
+static ThreadTrace& LocalTrace()
+{
+    thread_local std::shared_ptr<ThreadTrace> local;
+    if (!local)
+    {
+        local = std::make_shared<ThreadTrace>();
+        std::lock_guard<std::mutex> lock(registryMutex);
+        local->id = static_cast<uint32_t>(registry.size() + 1);
+        registry.push_back(local);
+    }
+    return *local;
+}
+
+static uint64_t Now()
+{
+    static const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count());
+}
+
+void SetTraceEnabled(bool _enabled)
+{
+    Now(); // Starts the clock
+    traceEnabled.store(_enabled, std::memory_order_relaxed);
+}
+
+void AddTraceCount(TraceCounter counter, uint64_t value)
+{
+    LocalTrace().counters[size_t(counter)] += value;
+}
+
+void TraceScope::Begin(const char* _name, const char* _detail, size_t length)
+{
+    thread = &LocalTrace();
+    name = _name;
+    memcpy(counters, thread->counters, sizeof(counters));
+
+    // The end of a long path is the part that tells files apart
+    memset(detail, 0, sizeof(detail));
+    if (length > sizeof(detail))
+    {
+        _detail += length - sizeof(detail);
+        length = sizeof(detail);
+    }
+    if (length > 0)
+        memcpy(detail, _detail, length);
+
+    start = Now();
+}
+
+void TraceScope::End()
+{
+    uint64_t end = Now();
+    if (thread->events.empty())
+        thread->events.resize(kRingSize);
+
+    uint64_t index = thread->written.load(std::memory_order_relaxed);
+    TraceEvent& event = thread->events[index % kRingSize];
+    event.name = name;
+    event.start = start;
+    event.duration = end - start;
+    for (size_t i = 0; i < kCounterCount; i++)
+        event.counters[i] = thread->counters[i] - counters[i];
+    memcpy(event.detail, detail, sizeof(detail));
+    thread->written.store(index + 1, std::memory_order_release);
+}
+
+size_t TraceEventCount()
+{
+    std::lock_guard<std::mutex> lock(registryMutex);
+    size_t count = 0;
+    for (const std::shared_ptr<ThreadTrace>& thread : registry)
+        count += static_cast<size_t>(std::min<uint64_t>(thread->written.load(std::memory_order_acquire), kRingSize));
+    return count;
+}
+
+void ClearTrace()
+{
+    std::lock_guard<std::mutex> lock(registryMutex);
+    for (const std::shared_ptr<ThreadTrace>& thread : registry)
+        thread->written.store(0, std::memory_order_release);
+}
+
+static void AppendJsonString(std::string& out, const char* text, size_t length)
+{
+    out += '"';
+    for (size_t i = 0; i < length && text[i] != '\0'; i++)
+    {
+        unsigned char c = static_cast<unsigned char>(text[i]);
+        if (c == '"' || c == '\\')
+        {
+            out += '\\';
+            out += static_cast<char>(c);
+        }
+        else if (c < 0x20 || c >= 0x7F)
+        {
+            char escaped[8];
+            snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+            out += escaped;
+        }
+        else
+        {
+            out += static_cast<char>(c);
+        }
+    }
+    out += '"';
+}
+
+bool WriteChromeTrace(const std::string& path, std::string& error)
+{
+    static const char* const counterNames[kCounterCount] = { "bytes", "sections", "imports", "allocations" };
+
+    std::ofstream out(fs::u8path(path), std::ios::binary | std::ios::trunc);
+    if (!out)
+    {
+        error = "Failed to create the trace file.";
+        return false;
+    }
+
+    // Complete ("X") events in microseconds; the viewer nests them by time per thread
+    std::string json = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    bool first = true;
+    char line[160];
+    std::lock_guard<std::mutex> lock(registryMutex);
+    for (const std::shared_ptr<ThreadTrace>& thread : registry)
+    {
+        uint64_t written = thread->written.load(std::memory_order_acquire);
+        if (written == 0)
+            continue;
+
+        snprintf(line, sizeof(line), "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"thread %u\"}}",
+                 first ? "" : ",", thread->id, thread->id);
+        json += line;
+        first = false;
+
+        for (uint64_t i = written > kRingSize ? written - kRingSize : 0; i < written; i++)
+        {
+            const TraceEvent& event = thread->events[i % kRingSize];
+            json += ",\n{\"name\":";
+            AppendJsonString(json, event.name, strlen(event.name));
+            snprintf(line, sizeof(line), ",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f,\"args\":{",
+                     thread->id, event.start / 1000.0, event.duration / 1000.0);
+            json += line;
+
+            bool firstArg = true;
+            if (event.detail[0] != '\0')
+            {
+                json += "\"detail\":";
+                AppendJsonString(json, event.detail, sizeof(event.detail));
+                firstArg = false;
+            }
+            for (size_t c = 0; c < kCounterCount; c++)
+            {
+                if (event.counters[c] == 0)
+                    continue;
+                snprintf(line, sizeof(line), "%s\"%s\":%llu", firstArg ? "" : ",", counterNames[c],
+                         static_cast<unsigned long long>(event.counters[c]));
+                json += line;
+                firstArg = false;
+            }
+            json += "}}";
+        }
+
+        // Flushed per thread so a long trace never sits in memory twice
+        out.write(json.data(), static_cast<std::streamsize>(json.size()));
+        json.clear();
+    }
+    json += "\n]}\n";
+    out.write(json.data(), static_cast<std::streamsize>(json.size()));
+
+    if (!out)
+    {
+        error = "Failed to write the trace file.";
+        return false;
+    }
+    return true;
+}
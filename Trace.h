@@ -0,0 +1,95 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+struct ThreadTrace;
+
+// Stage tracing. TRACE_SCOPE times the enclosing block and TRACE_COUNT adds to a per-thread counter; every closed
+// scope becomes one event in its thread's ring buffer, carrying the counts made on that thread while it was open
+// (nested scopes included). Nothing is recorded until SetTraceEnabled(true), and a disabled scope costs one load.
+// Building with INSPECTOR_TRACE=0 removes the hooks altogether; the functions below then see no events.
+#ifndef INSPECTOR_TRACE
+#define INSPECTOR_TRACE 1
+#endif
+
+enum class TraceCounter : uint8_t
+{
+    Bytes,       // Bytes of input read
+    Sections,    // Section headers parsed
+    Imports,     // Imported functions
+    Allocations, // Heap blocks taken by the parser's arenas
+    Count
+};
+
+// Read by every hook, so the check is inline; set it through SetTraceEnabled
+extern std::atomic<bool> traceEnabled;
+
+void SetTraceEnabled(bool enabled);
+inline bool IsTraceEnabled() { return traceEnabled.load(std::memory_order_relaxed); }
+
+void AddTraceCount(TraceCounter counter, uint64_t value);
+inline void TraceCount(TraceCounter counter, uint64_t value)
+{
+    if (IsTraceEnabled())
+        AddTraceCount(counter, value);
+}
+
+// Every thread's events as a Chrome trace (chrome://tracing, ui.perfetto.dev). Call once the traced work has
+// finished; a thread still recording may tear the event being written.
+bool WriteChromeTrace(const std::string& path, std::string& error);
+size_t TraceEventCount();
+void ClearTrace();
+
+class TraceScope
+{
+public:
+    // name must outlive the trace, e.g. a string literal. detail, such as a file name, is copied.
+    explicit TraceScope(const char* name)
+    {
+        if (IsTraceEnabled())
+            Begin(name, nullptr, 0);
+    }
+
+    TraceScope(const char* name, const std::string& detail)
+    {
+        if (IsTraceEnabled())
+            Begin(name, detail.data(), detail.size());
+    }
+
+    ~TraceScope()
+    {
+        if (thread != nullptr)
+            End();
+    }
+
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+    static const size_t kDetailSize = 40;
+
+private:
+    void Begin(const char* name, const char* detail, size_t length);
+    void End();
+
+    ThreadTrace* thread = nullptr; // Null when tracing was off as the scope opened
+    const char* name = nullptr;
+    uint64_t start = 0;
+    uint64_t counters[size_t(TraceCounter::Count)];
+    char detail[kDetailSize];
+};
+
+#if INSPECTOR_TRACE
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+#define TRACE_SCOPE(...) TraceScope TRACE_CONCAT(traceScope, __LINE__)(__VA_ARGS__)
+#define TRACE_COUNT(counter, value) TraceCount(TraceCounter::counter, static_cast<uint64_t>(value))
+#else
+#define TRACE_SCOPE(...) ((void)0)
+#define TRACE_COUNT(counter, value) ((void)0)
+#endif
+
+#endif // TRACE_H
@@ -0,0 +1,495 @@
+// inspector-bench: parse-throughput benchmark over a synthetic corpus.
+// Generates PE32 and PE32+ images in memory (a share of them deliberately malformed),
+// times every Parse* stage in isolation and the full pipeline, and prints JSON for regression tracking.
+
+#include "ImageDigest.h"
+#include "PEImage.h"
+#include "Carver.h"
+#include "SignatureSet.h"
+#include "StringTable.h"
+#include "SyntheticPE.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+struct BenchOptions
+{
+    int files = 2000;      // Per width
+    int malformedPercent = 10;
+    int iterations = 5;    // Best of
+    int signatures = 1000; // For the signature scan stage
+    uint32_t seed = 1;
+    SyntheticPEOptions image;
+    std::string writeDirectory;
+    std::string outputPath;
+};
+
+struct StageResult
+{
+    std::string width;
+    std::string stage;
+    size_t files = 0;   // Images that reached this stage
+    size_t passed = 0;  // Images the stage accepted
+    size_t bytes = 0;   // Bytes the stage reads end to end; 0 for stages that only touch headers and tables
+    double seconds = 0.0;
+};
+
+struct Corpus
+{
+    std::vector<std::vector<unsigned char>> images;
+    size_t malformed = 0;
+    size_t bytes = 0;
+};
+
+static Corpus BuildCorpus(const BenchOptions& options, bool pe64)
+{
+    Corpus corpus;
+    for (int i = 0; i < options.files; i++)
+    {
+        SyntheticPEOptions image = options.image;
+        image.pe64 = pe64;
+        image.seed = options.seed * 7919u + i;
+
+        // Spread malformed images evenly and cycle through every kind
+        if (options.malformedPercent > 0 && (i * options.malformedPercent) / 100 != ((i + 1) * options.malformedPercent) / 100)
+        {
+            image.malformation = static_cast<Malformation>(1 + corpus.malformed % (static_cast<int>(Malformation::Count) - 1));
+            corpus.malformed++;
+        }
+        corpus.images.push_back(BuildSyntheticPE(image));
+        corpus.bytes += corpus.images.back().size();
+    }
+    return corpus;
+}
+
+// Patterns copied from random varied places in the corpus, with address-sized wildcard runs and the odd nibble mask.
+// A quarter are scoped to .text and a quarter to the entry point, like a typical packer database.
+static void BuildSignatures(const Corpus& corpus, const BenchOptions& options, SignatureSet& set)
+{
+    std::mt19937 random(options.seed);
+    size_t wanted = corpus.images.empty() ? 0 : size_t(std::max(options.signatures, 0));
+    for (size_t attempt = 0; set.Count() < wanted && attempt < wanted * 16; attempt++)
+    {
+        const std::vector<unsigned char>& image = corpus.images[random() % corpus.images.size()];
+        size_t length = 8 + random() % 25;
+        if (image.size() < length)
+            continue;
+        size_t offset = random() % (image.size() - length + 1);
+
+        // Padding and zero-filled tables would match nearly everywhere; real databases have no such patterns
+        unsigned counts[256] = {};
+        for (size_t k = 0; k < length; k++)
+            counts[image[offset + k]]++;
+        if (*std::max_element(counts, counts + 256) * 4 > length)
+            continue;
+
+        size_t i = set.Count();
+        Signature signature;
+        signature.name = "bench" + std::to_string(i);
+        signature.value.assign(image.begin() + offset, image.begin() + offset + length);
+        signature.mask.assign(length, 0xFF);
+        for (size_t k = 2; k + 4 <= length; k += 4)
+        {
+            if (random() % 4 == 0)
+                std::fill(signature.mask.begin() + k, signature.mask.begin() + k + 4, 0);
+        }
+        if (random() % 8 == 0)
+            signature.mask[length - 1] = 0xF0;
+        if (i % 4 == 1)
+        {
+            signature.scope = SignatureScope::Section;
+            signature.section = ".text";
+        }
+        else if (i % 4 == 2)
+        {
+            signature.scope = SignatureScope::EntryPoint;
+        }
+        set.Add(std::move(signature));
+    }
+    set.Compile();
+}
+
+template <typename Image>
+using Stage = bool (Image::*)();
+
+template <typename Image>
+struct NamedStage
+{
+    const char* name;
+    Stage<Image> stage;
+};
+
+// Stage k is timed on its own: images are first advanced through stages 0..k-1 untimed,
+// then stage k runs over the whole batch inside one timed loop, so no per-call clock overhead
+template <typename Image>
+static void BenchStages(const Corpus& corpus, const BenchOptions& options, const char* width, std::vector<StageResult>& results)
+{
+    const NamedStage<Image> stages[] = {
+        { "ParseDOSHeader", &Image::ParseDOSHeader },
+        { "ParseNTHeader", &Image::ParseNTHeader },
+        { "ParseFileHeader", &Image::ParseFileHeader },
+        { "ParseOptionalHeader", &Image::ParseOptionalHeader },
+        { "ParseSectionHeader", &Image::ParseSectionHeader },
+        { "ParseDataDirectories", &Image::ParseDataDirectories },
+        { "ParseSections", &Image::ParseSections },
+        { "ParseImports", &Image::ParseImports },
+        { "ParseExports", &Image::ParseExports },
+        { "ParseResources", &Image::ParseResources },
+        { "ParseRelocations", &Image::ParseRelocations },
+    };
+    const size_t stageCount = sizeof(stages) / sizeof(stages[0]);
+
+    for (size_t k = 0; k < stageCount; k++)
+    {
+        StageResult result;
+        result.width = width;
+        result.stage = stages[k].name;
+        result.seconds = 1e30;
+
+        for (int iteration = 0; iteration < options.iterations; iteration++)
+        {
+            std::vector<Image> batch;
+            batch.reserve(corpus.images.size());
+            for (const std::vector<unsigned char>& bytes : corpus.images)
+            {
+                Image image(bytes.data(), bytes.size());
+                bool reached = true;
+                for (size_t s = 0; s < k && reached; s++)
+                    reached = (image.*stages[s].stage)();
+                if (reached)
+                    batch.push_back(std::move(image));
+            }
+
+            size_t passed = 0;
+            auto start = std::chrono::steady_clock::now();
+            for (Image& image : batch)
+                passed += (image.*stages[k].stage)() ? 1 : 0;
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+            result.files = batch.size();
+            result.passed = passed;
+            result.seconds = std::min(result.seconds, seconds);
+        }
+        results.push_back(result);
+    }
+
+    // Whole pipeline as callers use it, construction included
+    StageResult pipeline;
+    pipeline.width = width;
+    pipeline.stage = "Parse";
+    pipeline.seconds = 1e30;
+    for (int iteration = 0; iteration < options.iterations; iteration++)
+    {
+        size_t passed = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (const std::vector<unsigned char>& bytes : corpus.images)
+        {
+            Image image(bytes.data(), bytes.size());
+            passed += image.Parse() ? 1 : 0;
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        pipeline.files = corpus.images.size();
+        pipeline.passed = passed;
+        pipeline.bytes = corpus.bytes;
+        pipeline.seconds = std::min(pipeline.seconds, seconds);
+    }
+    results.push_back(pipeline);
+
+    // Relocation apply on its own: images are parsed and copied untimed, then every copy is rebased
+    StageResult rebase;
+    rebase.width = width;
+    rebase.stage = "Rebase";
+    rebase.seconds = 1e30;
+    for (int iteration = 0; iteration < options.iterations; iteration++)
+    {
+        std::vector<Image> batch;
+        std::vector<std::vector<unsigned char>> copies;
+        for (const std::vector<unsigned char>& bytes : corpus.images)
+        {
+            Image image(bytes.data(), bytes.size());
+            if (!image.Parse())
+                continue;
+            batch.push_back(std::move(image));
+            copies.push_back(bytes);
+        }
+
+        size_t passed = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < batch.size(); i++)
+        {
+            // Far enough from the synthetic base that every HIGHLOW and DIR64 target changes
+            RebaseResult result;
+            passed += batch[i].Rebase(copies[i].data(), 0x30000000, result) ? 1 : 0;
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        rebase.files = batch.size();
+        rebase.passed = passed;
+        rebase.seconds = std::min(rebase.seconds, seconds);
+    }
+    results.push_back(rebase);
+
+    // Checksum plus Authenticode hash of every parsed image, straight from memory
+    StageResult digest;
+    digest.width = width;
+    digest.stage = "Digest";
+    digest.seconds = 1e30;
+    for (int iteration = 0; iteration < options.iterations; iteration++)
+    {
+        std::vector<DigestLayout> layouts;
+        std::vector<const unsigned char*> images;
+        size_t bytes = 0;
+        for (const std::vector<unsigned char>& image : corpus.images)
+        {
+            Image parsed(image.data(), image.size());
+            if (!parsed.Parse())
+                continue;
+            layouts.push_back(GetDigestLayout(parsed));
+            images.push_back(image.data());
+            bytes += image.size();
+        }
+
+        size_t passed = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < images.size(); i++)
+        {
+            ImageDigest result;
+            ComputeImageDigest(images[i], layouts[i], result);
+            passed++;
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        digest.files = images.size();
+        digest.passed = passed;
+        digest.bytes = bytes;
+        digest.seconds = std::min(digest.seconds, seconds);
+    }
+    results.push_back(digest);
+
+    // String extraction over whole files, one thread per file like the rest of the stages
+    StageResult strings;
+    strings.width = width;
+    strings.stage = "Strings";
+    strings.seconds = 1e30;
+    for (int iteration = 0; iteration < options.iterations; iteration++)
+    {
+        std::vector<Image> batch;
+        size_t bytes = 0;
+        for (const std::vector<unsigned char>& image : corpus.images)
+        {
+            Image parsed(image.data(), image.size());
+            if (!parsed.Parse())
+                continue;
+            batch.push_back(std::move(parsed));
+            bytes += image.size();
+        }
+
+        StringScanOptions scanOptions;
+        scanOptions.threads = 1;
+        size_t passed = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (const Image& image : batch)
+        {
+            StringTable table;
+            table.Scan(image, scanOptions);
+            passed += table.Count() > 0 ? 1 : 0;
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        strings.files = batch.size();
+        strings.passed = passed;
+        strings.bytes = bytes;
+        strings.seconds = std::min(strings.seconds, seconds);
+    }
+    results.push_back(strings);
+
+    // Every image against one compiled signature set, one thread per file
+    SignatureSet signatureSet;
+    BuildSignatures(corpus, options, signatureSet);
+    StageResult signatures;
+    signatures.width = width;
+    signatures.stage = "Signatures";
+    signatures.seconds = 1e30;
+    for (int iteration = 0; iteration < options.iterations; iteration++)
+    {
+        std::vector<Image> batch;
+        size_t bytes = 0;
+        for (const std::vector<unsigned char>& image : corpus.images)
+        {
+            Image parsed(image.data(), image.size());
+            if (!parsed.Parse())
+                continue;
+            batch.push_back(std::move(parsed));
+            bytes += image.size();
+        }
+
+        size_t passed = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (const Image& image : batch)
+            passed += signatureSet.Scan(image, 1).empty() ? 0 : 1;
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        signatures.files = batch.size();
+        signatures.passed = passed;
+        signatures.bytes = bytes;
+        signatures.seconds = std::min(signatures.seconds, seconds);
+    }
+    results.push_back(signatures);
+
+    // The whole corpus back to back as one dump, carved on every core; passed counts the images found
+    std::vector<unsigned char> dump;
+    for (const std::vector<unsigned char>& image : corpus.images)
+        dump.insert(dump.end(), image.begin(), image.end());
+    StageResult carve;
+    carve.width = width;
+    carve.stage = "Carve";
+    carve.files = corpus.images.size();
+    carve.bytes = dump.size();
+    carve.seconds = 1e30;
+    for (int iteration = 0; iteration < options.iterations; iteration++)
+    {
+        auto start = std::chrono::steady_clock::now();
+        carve.passed = CarveImages(dump.data(), dump.size()).size();
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        carve.seconds = std::min(carve.seconds, seconds);
+    }
+    results.push_back(carve);
+}
+
+static void WriteCorpus(const Corpus& corpus, const std::string& directory, const char* width)
+{
+    std::error_code error;
+    fs::create_directories(fs::u8path(directory), error);
+    for (size_t i = 0; i < corpus.images.size(); i++)
+    {
+        char name[64];
+        snprintf(name, sizeof(name), "synthetic_%s_%05zu.dll", width, i);
+        std::ofstream out(fs::u8path(directory) / name, std::ios::binary);
+        out.write(reinterpret_cast<const char*>(corpus.images[i].data()), static_cast<std::streamsize>(corpus.images[i].size()));
+    }
+}
+
+static std::string ToJson(const BenchOptions& options, const std::vector<StageResult>& results, size_t files, size_t malformed, size_t bytes)
+{
+    std::string json = "{\n";
+    char line[512];
+    snprintf(line, sizeof(line),
+             "  \"config\": {\"filesPerWidth\": %d, \"malformedPercent\": %d, \"iterations\": %d, \"seed\": %u, "
+             "\"sections\": %d, \"importModules\": %d, \"importsPerModule\": %d, \"exports\": %d, \"relocations\": %d, "
+             "\"signatures\": %d},\n",
+             options.files, options.malformedPercent, options.iterations, options.seed, options.image.sections,
+             options.image.importModules, options.image.importsPerModule, options.image.exports, options.image.relocations,
+             options.signatures);
+    json += line;
+    snprintf(line, sizeof(line), "  \"corpus\": {\"files\": %zu, \"malformed\": %zu, \"bytes\": %zu},\n", files, malformed, bytes);
+    json += line;
+    json += "  \"results\": [\n";
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        const StageResult& result = results[i];
+        double nsPerFile = result.files > 0 ? result.seconds * 1e9 / result.files : 0.0;
+        // A header stage reads a few hundred bytes of each file, so whole-file MB/s would only restate nsPerFile
+        char mbPerSec[32] = "null";
+        if (result.bytes > 0 && result.seconds > 0)
+            snprintf(mbPerSec, sizeof(mbPerSec), "%.1f", result.bytes / (1024.0 * 1024.0) / result.seconds);
+        snprintf(line, sizeof(line),
+                 "    {\"width\": \"%s\", \"stage\": \"%s\", \"files\": %zu, \"passed\": %zu, \"nsPerFile\": %.1f, \"mbPerSec\": %s}%s\n",
+                 result.width.c_str(), result.stage.c_str(), result.files, result.passed, nsPerFile, mbPerSec,
+                 i + 1 < results.size() ? "," : "");
+        json += line;
+    }
+    json += "  ]\n}\n";
+    return json;
+}
+
+static void PrintUsage()
+{
+    fprintf(stderr,
+            "Usage: inspector-bench [options]\n"
+            "  --files N          Images per width (default 2000)\n"
+            "  --malformed PCT    Share of deliberately malformed images (default 10)\n"
+            "  --iterations N     Runs per measurement, the fastest is reported (default 5)\n"
+            "  --sections N       Sections per image (default 4, minimum 3)\n"
+            "  --imports M F      Import modules and functions per module (default 4 32)\n"
+            "  --exports N        Exported symbols (default 64)\n"
+            "  --relocs N         Base relocation entries (default 256)\n"
+            "  --signatures N     Signatures in the set the scan stage matches (default 1000)\n"
+            "  --seed N           Corpus seed (default 1)\n"
+            "  --write DIR        Also write the corpus to DIR, e.g. to feed inspector-cli\n"
+            "  --output FILE      Write the JSON report to FILE instead of stdout\n");
+}
+
+int main(int argc, char* argv[])
+{
+    BenchOptions options;
+    for (int i = 1; i < argc; i++)
+    {
+        auto next = [&]() { return i + 1 < argc ? argv[++i] : "0"; };
+        if (strcmp(argv[i], "--files") == 0)
+            options.files = atoi(next());
+        else if (strcmp(argv[i], "--malformed") == 0)
+            options.malformedPercent = std::min(100, std::max(0, atoi(next())));
+        else if (strcmp(argv[i], "--iterations") == 0)
+            options.iterations = std::max(1, atoi(next()));
+        else if (strcmp(argv[i], "--sections") == 0)
+            options.image.sections = std::min(96, atoi(next()));
+        else if (strcmp(argv[i], "--imports") == 0)
+        {
+            options.image.importModules = atoi(next());
+            options.image.importsPerModule = atoi(next());
+        }
+        else if (strcmp(argv[i], "--exports") == 0)
+            options.image.exports = std::min(65535, atoi(next()));
+        else if (strcmp(argv[i], "--relocs") == 0)
+            options.image.relocations = atoi(next());
+        else if (strcmp(argv[i], "--signatures") == 0)
+            options.signatures = std::max(0, atoi(next()));
+        else if (strcmp(argv[i], "--seed") == 0)
+            options.seed = static_cast<uint32_t>(strtoul(next(), nullptr, 10));
+        else if (strcmp(argv[i], "--write") == 0)
+            options.writeDirectory = next();
+        else if (strcmp(argv[i], "--output") == 0)
+            options.outputPath = next();
+        else
+        {
+            PrintUsage();
+            return strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0 ? 0 : 1;
+        }
+    }
+
+    Corpus corpus32 = BuildCorpus(options, false);
+    Corpus corpus64 = BuildCorpus(options, true);
+    if (!options.writeDirectory.empty())
+    {
+        WriteCorpus(corpus32, options.writeDirectory, "pe32");
+        WriteCorpus(corpus64, options.writeDirectory, "pe64");
+    }
+
+    std::vector<StageResult> results;
+    BenchStages<PE32>(corpus32, options, "pe32", results);
+    BenchStages<PE64>(corpus64, options, "pe64", results);
+
+    std::string json = ToJson(options, results, corpus32.images.size() + corpus64.images.size(),
+                              corpus32.malformed + corpus64.malformed, corpus32.bytes + corpus64.bytes);
+    if (options.outputPath.empty())
+    {
+        fwrite(json.data(), 1, json.size(), stdout);
+    }
+    else
+    {
+        std::ofstream out(fs::u8path(options.outputPath), std::ios::binary);
+        out << json;
+        if (!out)
+        {
+            fprintf(stderr, "%s: cannot write report\n", options.outputPath.c_str());
+            return 1;
+        }
+    }
+    return 0;
+}
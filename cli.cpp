@@ -0,0 +1,845 @@
+// inspector-cli: headless batch scanner.
+// Walks files and directory trees, parses every file on a work-stealing pool
+// and streams one NDJSON record per file to stdout, or writes them all to a
+// column file with --columns. Throughput goes to stderr.
+
+#include "Carver.h"
+#include "ColumnStore.h"
+#include "Entropy.h"
+#include "Hash.h"
+#include "ImageDiff.h"
+#include "ImageDigest.h"
+#include "MappedFile.h"
+#include "PEImage.h"
+#include "ParseCache.h"
+#include "SignatureSet.h"
+#include "ThreadPool.h"
+#include "Trace.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <new>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+static std::mutex outputMutex;
+static std::atomic<unsigned long long> filesScanned{0};
+static std::atomic<unsigned long long> bytesScanned{0};
+static std::atomic<unsigned long long> imagesCarved{0};
+static bool computeEntropy = false;
+static bool listResources = false;
+static bool computeDigest = false;
+static bool computeImportHash = false;
+static const SignatureSet* signatureSet = nullptr;
+static ParseCache* cache = nullptr;
+static ColumnStoreWriter* columnStore = nullptr;
+
+// Append a JSON string literal, escaping quotes, backslashes and control bytes
+static void AppendJsonString(std::string& out, const char* text)
+{
+    out += '"';
+    for (const char* p = text; *p != '\0'; p++)
+    {
+        unsigned char c = static_cast<unsigned char>(*p);
+        switch (c)
+        {
+        case '"':  out += "\\\""; break;
+        case '\\': out += "\\\\"; break;
+        case '\n': out += "\\n"; break;
+        case '\r': out += "\\r"; break;
+        case '\t': out += "\\t"; break;
+        default:
+            if (c < 0x20 || c >= 0x7F)
+            {
+                // Non-ASCII bytes are escaped so arbitrary names never produce invalid UTF-8
+                char escaped[8];
+                snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                out += escaped;
+            }
+            else
+            {
+                out += static_cast<char>(c);
+            }
+        }
+    }
+    out += '"';
+}
+
+// Seed of the cache's content hash. Options that change what a record holds are folded in so they never share
+// entries, and so is the signature set, since editing the database changes the matches.
+static uint64_t CacheSeed()
+{
+    uint64_t seed = (computeEntropy ? 1 : 0) | (listResources ? 2 : 0) | (computeDigest ? 4 : 0);
+    if (signatureSet != nullptr)
+        seed |= 8 | (signatureSet->Fingerprint() << 4);
+    return seed;
+}
+
+// Parse one image into summary; shared by both widths. path names the file the image fills, for streaming the
+// digest, and is empty for an image carved out of a larger file. Returns false when the summary depends on more
+// than the bytes at data: the file read again for the digest failed or held different bytes.
+template <typename Image>
+static bool ParseImage(ImageSummary& summary, const BYTE* data, size_t size, const std::string& path)
+{
+    Image image(data, size);
+    if (!image.Parse())
+    {
+        summary.error = image.ErrorString();
+        return true;
+    }
+
+    summary.Assign(image);
+    if (computeEntropy)
+    {
+        // The pool already keeps every core busy, so one thread per file
+        for (const SectionEntropy& entropy : ComputeSectionEntropy(image, 0, 1))
+            summary.sectionEntropy.push_back(static_cast<float>(entropy.entropy));
+        summary.hasEntropy = true;
+    }
+    if (listResources)
+        summary.AssignResources(image);
+    if (signatureSet != nullptr)
+    {
+        for (const SignatureMatch& match : signatureSet->Scan(image, 1))
+            summary.signatures.push_back({ (*signatureSet)[match.signature].name, match.offset });
+        summary.hasSignatures = true;
+    }
+    if (computeDigest)
+    {
+        // Small files are hashed straight from the mapping. Big ones are streamed so reading
+        // overlaps hashing instead of every page fault stalling it.
+        const size_t kStreamThreshold = 64 * 1024 * 1024;
+        DigestLayout layout = GetDigestLayout(image);
+        if (size < kStreamThreshold || path.empty())
+        {
+            ComputeImageDigest(data, layout, summary.digest);
+        }
+        else
+        {
+            // With a cache, what was streamed is hashed like the mapping was, so a file rewritten in between
+            // cannot leave its new digest under the old contents
+            XXHash64Stream content(CacheSeed());
+            if (!ComputeImageDigest(path, layout, summary.digest, summary.error, cache != nullptr ? &content : nullptr))
+            {
+                summary.parsed = false;
+                return false;
+            }
+            if (cache != nullptr && content.Final() != summary.contentHash)
+            {
+                summary.parsed = false;
+                summary.error = "File changed while it was being hashed.";
+                return false;
+            }
+        }
+        summary.hasDigest = true;
+    }
+    return true;
+}
+
+// Returns false when the summary must not be cached, see ParseImage
+static bool ParseFile(ImageSummary& summary, const BYTE* data, size_t size, const std::string& path)
+{
+    // Pick the width from OptionalHeader.Magic in the mapped bytes
+    switch (DetectImageMagic(data, size))
+    {
+    case IMAGE_NT_OPTIONAL_HDR32_MAGIC:
+        return ParseImage<PE32>(summary, data, size, path);
+    case IMAGE_NT_OPTIONAL_HDR64_MAGIC:
+        return ParseImage<PE64>(summary, data, size, path);
+    default:
+        summary.error = "Not a PE image.";
+        return true;
+    }
+}
+
+static void AppendSummaryRecord(std::string& record, const ImageSummary& summary)
+{
+    if (!summary.parsed)
+    {
+        record += ",\"status\":\"error\",\"error\":";
+        AppendJsonString(record, summary.error.c_str());
+        return;
+    }
+
+    record += ",\"status\":\"ok\"";
+    record += ",\"machine\":" + std::to_string(summary.machine);
+    record += ",\"timestamp\":" + std::to_string(summary.timestamp);
+    record += ",\"characteristics\":" + std::to_string(summary.characteristics);
+    record += ",\"magic\":" + std::to_string(summary.magic);
+    record += ",\"entryPoint\":" + std::to_string(summary.entryPoint);
+    record += ",\"sizeOfImage\":" + std::to_string(summary.sizeOfImage);
+
+    record += ",\"sections\":[";
+    bool first = true;
+    for (const IMAGE_SECTION_HEADER& section : summary.sections)
+    {
+        // Section names are 8 bytes and not NUL-terminated when all 8 are used
+        char name[IMAGE_SIZEOF_SHORT_NAME + 1] = {};
+        memcpy(name, section.Name, IMAGE_SIZEOF_SHORT_NAME);
+
+        if (!first)
+            record += ',';
+        AppendJsonString(record, name);
+        first = false;
+    }
+
+    if (computeEntropy && summary.hasEntropy)
+    {
+        // Parallel to "sections"
+        record += "],\"entropy\":[";
+        first = true;
+        for (float entropy : summary.sectionEntropy)
+        {
+            char value[16];
+            snprintf(value, sizeof(value), "%.3f", entropy);
+            if (!first)
+                record += ',';
+            record += value;
+            first = false;
+        }
+    }
+
+    record += "],\"imports\":[";
+    first = true;
+    const SymbolTable& symbols = SymbolTable::Global();
+    for (uint32_t module : summary.importModules)
+    {
+        if (!first)
+            record += ',';
+        AppendJsonString(record, symbols.CString(module));
+        first = false;
+    }
+    record += ']';
+
+    if (!summary.exportName.empty())
+    {
+        record += ",\"exportName\":";
+        AppendJsonString(record, summary.exportName.c_str());
+    }
+    record += ",\"exports\":" + std::to_string(summary.exports.size());
+    record += ",\"relocations\":" + std::to_string(summary.relocations);
+
+    if (computeImportHash)
+    {
+        char hash[20];
+        snprintf(hash, sizeof(hash), "%016llx", static_cast<unsigned long long>(summary.ImportHash()));
+        record += ",\"importHash\":\"" + std::string(hash) + '"';
+    }
+
+    if (computeDigest && summary.hasDigest)
+    {
+        record += ",\"checksum\":" + std::to_string(summary.digest.storedChecksum);
+        record += ",\"computedChecksum\":" + std::to_string(summary.digest.checksum);
+        record += std::string(",\"signed\":") + (summary.digest.hasCertificate ? "true" : "false");
+        record += ",\"authenticode\":\"" + DigestToHex(summary.digest.authenticode, sizeof(summary.digest.authenticode)) + '"';
+    }
+
+    if (signatureSet != nullptr && summary.hasSignatures)
+    {
+        record += ",\"signatures\":[";
+        first = true;
+        for (const ImageSummary::SignatureHit& hit : summary.signatures)
+        {
+            record += first ? "{\"name\":" : ",{\"name\":";
+            AppendJsonString(record, hit.name.c_str());
+            record += ",\"offset\":" + std::to_string(hit.offset) + '}';
+            first = false;
+        }
+        record += ']';
+    }
+
+    if (listResources && summary.hasResources)
+    {
+        record += ",\"resources\":[";
+        first = true;
+        for (const ImageSummary::ResourceType& resource : summary.resources)
+        {
+            if (!first)
+                record += ',';
+            record += "{\"type\":";
+            AppendJsonString(record, resource.type.c_str());
+            record += ",\"count\":" + std::to_string(resource.leaves);
+            record += ",\"bytes\":" + std::to_string(resource.bytes) + '}';
+            first = false;
+        }
+        record += ']';
+    }
+}
+
+// Parse (or look up) one image
+static void LookupOrParse(ImageSummary& summary, const BYTE* data, size_t size, const std::string& path)
+{
+    if (cache != nullptr)
+    {
+        // Content-addressed: renamed or copied files hit too, any changed byte misses
+        uint64_t contentHash = XXHash64(data, size, CacheSeed());
+        if (!cache->Lookup(contentHash, size, summary))
+        {
+            summary = ImageSummary();
+            summary.contentHash = contentHash;
+            summary.fileSize = size;
+            if (ParseFile(summary, data, size, path))
+                cache->Store(summary);
+        }
+    }
+    else
+    {
+        ParseFile(summary, data, size, path);
+    }
+}
+
+// Every file of a scan and every carved image goes through here: a hostile input that still manages to ask for
+// more memory than there is gets an error record instead of ending the whole batch
+static void SummarizeImage(ImageSummary& summary, const BYTE* data, size_t size, const std::string& path)
+{
+    try
+    {
+        LookupOrParse(summary, data, size, path);
+    }
+    catch (const std::bad_alloc&)
+    {
+        summary = ImageSummary();
+        summary.fileSize = size;
+        summary.error = "Out of memory while parsing.";
+    }
+}
+
+// One write per record keeps lines whole when many workers finish at once
+static void WriteRecord(const std::string& record)
+{
+    std::lock_guard<std::mutex> lock(outputMutex);
+    fwrite(record.data(), 1, record.size(), stdout);
+}
+
+static void ScanFile(const fs::path& path)
+{
+    TRACE_SCOPE("ScanFile", path.u8string());
+    MappedFile file;
+    bool opened = file.Open(path.u8string());
+    ImageSummary summary;
+    if (opened)
+    {
+        SummarizeImage(summary, file.Data(), file.Size(), path.u8string());
+        bytesScanned += file.Size();
+    }
+    filesScanned++;
+
+    if (columnStore != nullptr)
+    {
+        if (!opened)
+            summary.error = file.ErrorString();
+        columnStore->Add(path.u8string(), 0, file.Size(), summary);
+        return;
+    }
+
+    std::string record = "{\"path\":";
+    AppendJsonString(record, path.u8string().c_str());
+    if (!opened)
+    {
+        record += ",\"status\":\"error\",\"error\":";
+        AppendJsonString(record, file.ErrorString().c_str());
+    }
+    else
+    {
+        record += ",\"size\":" + std::to_string(file.Size());
+        AppendSummaryRecord(record, summary);
+    }
+    WriteRecord(record + "}\n");
+}
+
+// --carve: the file is a dump rather than an image. The search runs on its own threads over the whole mapping; each
+// image found is then parsed on the pool, which is drained before the mapping goes away.
+static void CarveFile(const fs::path& path, ThreadPool& pool, unsigned threadCount)
+{
+    MappedFile file;
+    if (!file.Open(path.u8string()))
+    {
+        filesScanned++;
+        if (columnStore != nullptr)
+        {
+            ImageSummary summary;
+            summary.error = file.ErrorString();
+            columnStore->Add(path.u8string(), 0, 0, summary);
+            return;
+        }
+        std::string record = "{\"path\":";
+        AppendJsonString(record, path.u8string().c_str());
+        record += ",\"status\":\"error\",\"error\":";
+        AppendJsonString(record, file.ErrorString().c_str());
+        WriteRecord(record + "}\n");
+        return;
+    }
+    file.AdviseSequential();
+
+    std::vector<CarvedImage> images = CarveImages(file.Data(), file.Size(), threadCount);
+    for (const CarvedImage& image : images)
+    {
+        pool.Submit([&file, path, image]
+        {
+            TRACE_SCOPE("ScanCarvedImage", path.filename().u8string() + '@' + std::to_string(image.offset));
+            ImageSummary summary;
+            SummarizeImage(summary, file.Data() + image.offset, static_cast<size_t>(image.size), std::string());
+            if (columnStore != nullptr)
+            {
+                columnStore->Add(path.u8string(), image.offset, image.size, summary);
+                return;
+            }
+
+            std::string record = "{\"path\":";
+            AppendJsonString(record, path.u8string().c_str());
+            record += ",\"offset\":" + std::to_string(image.offset);
+            record += ",\"size\":" + std::to_string(image.size);
+            AppendSummaryRecord(record, summary);
+            WriteRecord(record + "}\n");
+        });
+    }
+    pool.Wait();
+
+    imagesCarved += images.size();
+    bytesScanned += file.Size();
+    filesScanned++;
+}
+
+// One side of --diff: the mapping and the image parsed out of it, whichever width it is
+struct DiffSide
+{
+    MappedFile file;
+    PE32 pe32;
+    PE64 pe64;
+    const PEImageBase* image = nullptr;
+};
+
+static bool OpenDiffSide(const std::string& path, DiffSide& side)
+{
+    if (!side.file.Open(path))
+    {
+        fprintf(stderr, "%s: %s\n", path.c_str(), side.file.ErrorString().c_str());
+        return false;
+    }
+
+    bool parsed = false;
+    switch (DetectImageMagic(side.file.Data(), side.file.Size()))
+    {
+    case IMAGE_NT_OPTIONAL_HDR32_MAGIC:
+        side.pe32 = PE32(side.file.Data(), side.file.Size());
+        parsed = side.pe32.Parse();
+        side.image = &side.pe32;
+        break;
+    case IMAGE_NT_OPTIONAL_HDR64_MAGIC:
+        side.pe64 = PE64(side.file.Data(), side.file.Size());
+        parsed = side.pe64.Parse();
+        side.image = &side.pe64;
+        break;
+    default:
+        fprintf(stderr, "%s: Not a PE image.\n", path.c_str());
+        return false;
+    }
+
+    if (!parsed)
+        fprintf(stderr, "%s: %s\n", path.c_str(), side.image->ErrorString().c_str());
+    return parsed;
+}
+
+static const char* DiffStatusName(DiffStatus status)
+{
+    switch (status)
+    {
+    case DiffStatus::Same:    return "same";
+    case DiffStatus::Changed: return "changed";
+    case DiffStatus::Added:   return "added";
+    case DiffStatus::Removed: return "removed";
+    }
+    return "";
+}
+
+// --diff: one JSON document for the pair, exit status like diff(1)
+static int RunDiff(const std::string& oldPath, const std::string& newPath, unsigned threadCount)
+{
+    DiffSide oldSide;
+    DiffSide newSide;
+    if (!OpenDiffSide(oldPath, oldSide) || !OpenDiffSide(newPath, newSide))
+        return 2;
+
+    auto start = std::chrono::steady_clock::now();
+    DiffOptions options;
+    options.threads = threadCount;
+    ImageDiff diff = DiffImages(*oldSide.image, *newSide.image, options);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::string out = "{\"old\":";
+    AppendJsonString(out, oldPath.c_str());
+    out += ",\"new\":";
+    AppendJsonString(out, newPath.c_str());
+    out += std::string(",\"identical\":") + (diff.Identical() ? "true" : "false");
+
+    out += ",\"fields\":[";
+    for (size_t i = 0; i < diff.fields.size(); i++)
+    {
+        const FieldDiff& field = diff.fields[i];
+        out += i > 0 ? ",{\"structure\":" : "{\"structure\":";
+        AppendJsonString(out, field.structure);
+        out += ",\"field\":";
+        AppendJsonString(out, field.field->name);
+        out += ",\"old\":" + std::to_string(field.oldValue) + ",\"new\":" + std::to_string(field.newValue) + '}';
+    }
+
+    uint64_t changedBytes = 0;
+    out += "],\"sections\":[";
+    for (size_t i = 0; i < diff.sections.size(); i++)
+    {
+        const SectionDiff& section = diff.sections[i];
+        changedBytes += section.changedBytes;
+        out += i > 0 ? ",{\"name\":" : "{\"name\":";
+        AppendJsonString(out, section.name.c_str());
+        out += std::string(",\"status\":\"") + DiffStatusName(section.status) + '"';
+        if (section.overlay)
+            out += ",\"overlay\":true";
+        out += ",\"oldIndex\":" + std::to_string(section.oldIndex) + ",\"newIndex\":" + std::to_string(section.newIndex);
+        out += std::string(",\"headerChanged\":") + (section.headerChanged ? "true" : "false");
+        out += ",\"old\":[" + std::to_string(section.oldOffset) + ',' + std::to_string(section.oldSize) + ']';
+        out += ",\"new\":[" + std::to_string(section.newOffset) + ',' + std::to_string(section.newSize) + ']';
+        out += ",\"changedBytes\":" + std::to_string(section.changedBytes);
+
+        // [oldOffset, oldSize, newOffset, newSize] per changed range
+        out += ",\"changes\":[";
+        for (size_t k = 0; k < section.changes.size(); k++)
+        {
+            const DiffRange& change = section.changes[k];
+            out += k > 0 ? ",[" : "[";
+            out += std::to_string(change.oldOffset) + ',' + std::to_string(change.oldSize) + ',' +
+                   std::to_string(change.newOffset) + ',' + std::to_string(change.newSize) + ']';
+        }
+        out += "]}";
+    }
+    out += "]}\n";
+    fwrite(out.data(), 1, out.size(), stdout);
+
+    fprintf(stderr, "%zu header fields and %llu bytes differ, compared in %.3f s\n",
+            diff.fields.size(), static_cast<unsigned long long>(changedBytes), seconds);
+    return diff.Identical() ? 0 : 1;
+}
+
+template <typename Image>
+static bool RebaseImage(MappedFile& file, ULONGLONG newBase, RebaseResult& result, std::string& error)
+{
+    Image image(file.Data(), file.Size());
+    if (!image.Parse())
+    {
+        error = image.ErrorString();
+        return false;
+    }
+    if (!image.Rebase(file.MutableData(), newBase, result))
+    {
+        error = "Relocations are stripped or the address does not fit the image.";
+        return false;
+    }
+    return true;
+}
+
+// --rebase: patch a private copy-on-write view as if the image were loaded at newBase and write it out;
+// the input file itself is never changed
+static int RunRebase(const std::string& path, ULONGLONG newBase, const std::string& outputPath)
+{
+    if (newBase % 0x10000 != 0)
+    {
+        fprintf(stderr, "The new base must be a multiple of 0x10000.\n");
+        return 1;
+    }
+
+    MappedFile file;
+    if (!file.Open(path, MappedFile::CopyOnWrite))
+    {
+        fprintf(stderr, "%s: %s\n", path.c_str(), file.ErrorString().c_str());
+        return 1;
+    }
+
+    RebaseResult result;
+    std::string error;
+    bool rebased = false;
+    switch (DetectImageMagic(file.Data(), file.Size()))
+    {
+    case IMAGE_NT_OPTIONAL_HDR32_MAGIC:
+        rebased = RebaseImage<PE32>(file, newBase, result, error);
+        break;
+    case IMAGE_NT_OPTIONAL_HDR64_MAGIC:
+        rebased = RebaseImage<PE64>(file, newBase, result, error);
+        break;
+    default:
+        error = "Not a PE image.";
+    }
+    if (!rebased)
+    {
+        fprintf(stderr, "%s: %s\n", path.c_str(), error.c_str());
+        return 1;
+    }
+
+    std::ofstream out(fs::u8path(outputPath), std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char*>(file.Data()), static_cast<std::streamsize>(file.Size()));
+    if (!out)
+    {
+        fprintf(stderr, "%s: Failed to write the rebased image.\n", outputPath.c_str());
+        return 1;
+    }
+    fprintf(stderr, "%zu relocations applied, %zu skipped, written to %s\n", result.applied, result.skipped, outputPath.c_str());
+    return 0;
+}
+
+// Only once every worker is idle, so no event is being written while it is read
+static bool WriteTrace(const std::string& path)
+{
+    if (path.empty())
+        return true;
+    std::string error;
+    if (!WriteChromeTrace(path, error))
+    {
+        fprintf(stderr, "%s: %s\n", path.c_str(), error.c_str());
+        return false;
+    }
+    fprintf(stderr, "trace: %zu events written to %s\n", TraceEventCount(), path.c_str());
+    return true;
+}
+
+static void PrintUsage()
+{
+    fprintf(stderr,
+            "Usage: inspector-cli [-j threads] [--carve] [--entropy] [--resources] [--digest] [--imphash] [--signatures file] [--trace file] [--columns file] [--cache dir [--cache-size MB]] <file or directory>...\n"
+            "       inspector-cli [-j threads] --diff <old> <new>\n"
+            "       inspector-cli --rebase <address> -o <output> <file>\n"
+            "  -j N              Number of worker threads (default: one per core)\n"
+            "  --carve           Treat every file as a dump and report each PE image embedded in it, with its offset\n"
+            "  --entropy         Add per-section Shannon entropy (bits per byte) to each record\n"
+            "  --resources       Add leaf counts and sizes per resource type to each record\n"
+            "  --digest          Add the stored and computed PE checksum and the Authenticode SHA-256\n"
+            "  --imphash         Add an imphash-style fingerprint of the import list (XXH64, not MD5)\n"
+            "  --signatures FILE Add the matches of a PEiD-style signature database to each record\n"
+            "  --columns FILE    Write every record to a column file for inspector-query instead of NDJSON to stdout\n"
+            "  --trace FILE      Write a Chrome trace of every parse stage and I/O call (open in ui.perfetto.dev)\n"
+            "  --cache DIR       Reuse parse results for files whose contents were seen before\n"
+            "  --cache-size MB   Evict least recently used cache entries beyond this size (default: 1024, 0 = unbounded)\n"
+            "  --diff OLD NEW    Compare two images section by section; exits 0 if identical, 1 if not, 2 on error\n"
+            "  --rebase ADDR     Apply the base relocations as if the image were loaded at ADDR (hex with 0x) and write\n"
+            "                    the patched file to the path given with -o\n");
+}
+
+int main(int argc, char* argv[])
+{
+    unsigned threadCount = 0;
+    std::string cacheDirectory;
+    unsigned long long cacheMegabytes = 1024;
+    std::vector<fs::path> roots;
+    std::vector<std::string> diffPaths;
+    std::string signaturePath;
+    bool carve = false;
+    std::string tracePath;
+    std::string columnsPath;
+    std::string rebaseAddress;
+    std::string outputPath;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-j") == 0 && i + 1 < argc)
+        {
+            threadCount = static_cast<unsigned>(strtoul(argv[++i], nullptr, 10));
+        }
+        else if (strcmp(argv[i], "--carve") == 0)
+        {
+            carve = true;
+        }
+        else if (strcmp(argv[i], "--entropy") == 0)
+        {
+            computeEntropy = true;
+        }
+        else if (strcmp(argv[i], "--resources") == 0)
+        {
+            listResources = true;
+        }
+        else if (strcmp(argv[i], "--digest") == 0)
+        {
+            computeDigest = true;
+        }
+        else if (strcmp(argv[i], "--imphash") == 0)
+        {
+            computeImportHash = true;
+        }
+        else if (strcmp(argv[i], "--signatures") == 0 && i + 1 < argc)
+        {
+            signaturePath = argv[++i];
+        }
+        else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc)
+        {
+            tracePath = argv[++i];
+        }
+        else if (strcmp(argv[i], "--columns") == 0 && i + 1 < argc)
+        {
+            columnsPath = argv[++i];
+        }
+        else if (strcmp(argv[i], "--rebase") == 0 && i + 1 < argc)
+        {
+            rebaseAddress = argv[++i];
+        }
+        else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc)
+        {
+            outputPath = argv[++i];
+        }
+        else if (strcmp(argv[i], "--diff") == 0 && i + 2 < argc)
+        {
+            diffPaths = { argv[i + 1], argv[i + 2] };
+            i += 2;
+        }
+        else if (strcmp(argv[i], "--cache") == 0 && i + 1 < argc)
+        {
+            cacheDirectory = argv[++i];
+        }
+        else if (strcmp(argv[i], "--cache-size") == 0 && i + 1 < argc)
+        {
+            cacheMegabytes = strtoull(argv[++i], nullptr, 10);
+        }
+        else if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0)
+        {
+            PrintUsage();
+            return 0;
+        }
+        else
+        {
+            roots.push_back(fs::u8path(argv[i]));
+        }
+    }
+
+    if (!tracePath.empty())
+        SetTraceEnabled(true);
+
+    if (!diffPaths.empty())
+    {
+        int status = RunDiff(diffPaths[0], diffPaths[1], threadCount);
+        return WriteTrace(tracePath) ? status : 2;
+    }
+
+    if (!rebaseAddress.empty())
+    {
+        if (roots.size() != 1 || outputPath.empty())
+        {
+            PrintUsage();
+            return 1;
+        }
+        char* end = nullptr;
+        ULONGLONG newBase = strtoull(rebaseAddress.c_str(), &end, 0);
+        if (end == rebaseAddress.c_str() || *end != '\0')
+        {
+            fprintf(stderr, "Invalid address: %s\n", rebaseAddress.c_str());
+            return 1;
+        }
+        int status = RunRebase(roots[0].u8string(), newBase, outputPath);
+        return WriteTrace(tracePath) ? status : 1;
+    }
+
+    if (roots.empty())
+    {
+        PrintUsage();
+        return 1;
+    }
+
+    // Compiled once up front, every worker scans with the same automaton
+    SignatureSet signatures;
+    if (!signaturePath.empty())
+    {
+        if (!signatures.LoadFile(signaturePath) || !signatures.Compile())
+        {
+            fprintf(stderr, "%s\n", signatures.ErrorString().c_str());
+            return 1;
+        }
+        signatureSet = &signatures;
+    }
+
+    ParseCache parseCache;
+    if (!cacheDirectory.empty())
+    {
+        if (!parseCache.Open(cacheDirectory, cacheMegabytes * 1024 * 1024))
+        {
+            fprintf(stderr, "%s: %s\n", cacheDirectory.c_str(), parseCache.ErrorString().c_str());
+            return 1;
+        }
+        cache = &parseCache;
+    }
+
+    ColumnStoreWriter columns;
+    if (!columnsPath.empty())
+        columnStore = &columns;
+
+    auto start = std::chrono::steady_clock::now();
+
+    ThreadPool pool(threadCount);
+
+    // The walk runs on the main thread and feeds the pool as it goes,
+    // so parsing starts long before a big tree has been fully listed
+    for (const fs::path& root : roots)
+    {
+        std::error_code error;
+        if (fs::is_directory(root, error))
+        {
+            fs::recursive_directory_iterator it(root, fs::directory_options::skip_permission_denied, error);
+            for (; !error && it != fs::recursive_directory_iterator(); it.increment(error))
+            {
+                if (it->is_regular_file(error))
+                {
+                    fs::path path = it->path();
+                    if (carve)
+                        CarveFile(path, pool, threadCount);
+                    else
+                        pool.Submit([path] { ScanFile(path); });
+                }
+            }
+        }
+        else if (carve)
+        {
+            CarveFile(root, pool, threadCount);
+        }
+        else
+        {
+            pool.Submit([root] { ScanFile(root); });
+        }
+
+        if (error)
+            fprintf(stderr, "%s: %s\n", root.u8string().c_str(), error.message().c_str());
+    }
+
+    pool.Wait();
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    double megabytes = static_cast<double>(bytesScanned) / (1024.0 * 1024.0);
+    fprintf(stderr, "%llu files, %.1f MB in %.3f s on %u threads: %.1f files/sec, %.1f MB/sec\n",
+            filesScanned.load(), megabytes, seconds, pool.ThreadCount(),
+            seconds > 0 ? filesScanned / seconds : 0.0,
+            seconds > 0 ? megabytes / seconds : 0.0);
+    if (carve)
+        fprintf(stderr, "%llu images carved\n", imagesCarved.load());
+
+    if (cache != nullptr)
+    {
+        ParseCache::Stats stats = cache->GetStats();
+        fprintf(stderr, "cache: %llu hits, %llu misses, %llu stored, %llu evicted, %llu entries, %.1f MB\n",
+                static_cast<unsigned long long>(stats.hits), static_cast<unsigned long long>(stats.misses),
+                static_cast<unsigned long long>(stats.stores), static_cast<unsigned long long>(stats.evictions),
+                static_cast<unsigned long long>(stats.entries), stats.bytes / (1024.0 * 1024.0));
+    }
+
+    if (columnStore != nullptr)
+    {
+        if (!columns.Finish(columnsPath))
+        {
+            fprintf(stderr, "%s: %s\n", columnsPath.c_str(), columns.ErrorString().c_str());
+            WriteTrace(tracePath);
+            return 1;
+        }
+        fprintf(stderr, "columns: %llu rows written to %s\n", static_cast<unsigned long long>(columns.RowCount()), columnsPath.c_str());
+    }
+
+    return WriteTrace(tracePath) ? 0 : 1;
+}
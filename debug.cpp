@@ -2,9 +2,11 @@
 
 Debug::Debug(QString title, QString text)
 {
-    QMessageBox msgBox;
+    emit DebugLog::Instance()->Message(title, text);
+}
 
-    msgBox.setWindowTitle(title);
-    msgBox.setText(text);
-    msgBox.exec();
+DebugLog* DebugLog::Instance()
+{
+    static DebugLog instance;
+    return &instance;
 }
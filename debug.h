@@ -1,13 +1,27 @@
 #ifndef DEBUG_H
-#include <QMessageBox>
 #define DEBUG_H
 
+#include <QObject>
 #include <QString>
 
+// Posts a diagnostic to the log. Safe to use from any thread and never blocks:
+// messages are delivered to DebugLog's listeners through the event loop.
 class Debug
 {
 public:
     Debug(QString title, QString text);
 };
 
+// Receives every Debug message; MainWindow shows them in its log pane
+class DebugLog : public QObject
+{
+    Q_OBJECT
+
+public:
+    static DebugLog* Instance();
+
+signals:
+    void Message(QString title, QString text);
+};
+
 #endif // DEBUG_H
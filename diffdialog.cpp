@@ -0,0 +1,260 @@
+#include "diffdialog.h"
+#include <QDialogButtonBox>
+#include <QFileInfo>
+#include <QHeaderView>
+#include <QLabel>
+#include <QSplitter>
+#include <QThread>
+#include <QTreeWidget>
+#include <QVBoxLayout>
+#include <algorithm>
+#include <chrono>
+#include "StructureMap.h"
+#include "debug.h"
+#include "hexview.h"
+
+// Ranges listed per section; the highlight in the hex views still covers all of them
+static const size_t kMaxListedRanges = 10000;
+
+// Item data roles holding the range each tree row selects
+enum DiffRole
+{
+    OldOffsetRole = Qt::UserRole,
+    OldSizeRole,
+    NewOffsetRole,
+    NewSizeRole
+};
+
+static QString Hex(quint64 value)
+{
+    return "0x" + QString::number(value, 16).toUpper();
+}
+
+static QString RangeText(quint64 offset, quint64 size)
+{
+    return size == 0 ? "-" : Hex(offset) + " (" + QString::number(size) + " bytes)";
+}
+
+static const char* StatusName(DiffStatus status)
+{
+    switch (status)
+    {
+    case DiffStatus::Same:    return "same";
+    case DiffStatus::Changed: return "changed";
+    case DiffStatus::Added:   return "added";
+    case DiffStatus::Removed: return "removed";
+    }
+    return "";
+}
+
+static void SetRange(QTreeWidgetItem* item, quint64 oldOffset, quint64 oldSize, quint64 newOffset, quint64 newSize)
+{
+    item->setData(0, OldOffsetRole, oldOffset);
+    item->setData(0, OldSizeRole, oldSize);
+    item->setData(0, NewOffsetRole, newOffset);
+    item->setData(0, NewSizeRole, newSize);
+}
+
+// Sorted, non-overlapping regions as HexView expects; moved data can make one side's ranges overlap
+static std::vector<StructureRegion> MergeRegions(std::vector<StructureRegion> regions)
+{
+    std::sort(regions.begin(), regions.end(), [](const StructureRegion& a, const StructureRegion& b) { return a.offset < b.offset; });
+    std::vector<StructureRegion> merged;
+    for (const StructureRegion& region : regions)
+    {
+        if (!merged.empty() && region.offset <= merged.back().offset + merged.back().size)
+            merged.back().size = std::max(merged.back().size, region.offset + region.size - merged.back().offset);
+        else
+            merged.push_back(region);
+    }
+    return merged;
+}
+
+template <typename Image>
+static bool ParseThroughSections(Image& image, const MappedFile& mapping)
+{
+    image = Image(mapping.Data(), mapping.Size());
+    return image.ParseDOSHeader() &&
+           image.ParseNTHeader() &&
+           image.ParseFileHeader() &&
+           image.ParseOptionalHeader() &&
+           image.ParseSectionHeader() &&
+           image.ParseDataDirectories() &&
+           image.ParseSections();
+}
+
+DiffDialog::DiffDialog(const QString& oldPath, const QString& newPath, QWidget *parent)
+    : QDialog(parent)
+{
+    setWindowTitle("Compare " + QFileInfo(oldPath).fileName() + " with " + QFileInfo(newPath).fileName());
+    setAttribute(Qt::WA_DeleteOnClose);
+    resize(1400, 800);
+
+    summary = new QLabel("Comparing...", this);
+
+    tree = new QTreeWidget(this);
+    tree->setColumnCount(4);
+    tree->setHeaderLabels({"Item", "Status", "Old", "New"});
+    tree->setUniformRowHeights(true);
+    tree->header()->setSectionResizeMode(QHeaderView::ResizeToContents);
+    connect(tree, &QTreeWidget::currentItemChanged, this, [this](QTreeWidgetItem* item) { OnItemSelected(item); });
+
+    oldView = new HexView(this);
+    newView = new HexView(this);
+    QSplitter* views = new QSplitter(Qt::Horizontal, this);
+    views->addWidget(oldView);
+    views->addWidget(newView);
+
+    QSplitter* splitter = new QSplitter(Qt::Vertical, this);
+    splitter->addWidget(tree);
+    splitter->addWidget(views);
+    splitter->setStretchFactor(1, 2);
+
+    QDialogButtonBox* buttons = new QDialogButtonBox(QDialogButtonBox::Close, this);
+    connect(buttons, &QDialogButtonBox::rejected, this, &QDialog::reject);
+
+    QVBoxLayout* layout = new QVBoxLayout(this);
+    layout->addWidget(summary);
+    layout->addWidget(splitter);
+    layout->addWidget(buttons);
+
+    // The thread owns its result until it finishes, so closing the dialog early only drops the answer
+    QSharedPointer<Result> pending(new Result);
+    pending->oldFile.reset(new ParsedFile);
+    pending->newFile.reset(new ParsedFile);
+    pending->oldFile->path = oldPath;
+    pending->newFile->path = newPath;
+    QThread* thread = QThread::create([pending]
+    {
+        if (!OpenSide(*pending->oldFile, pending->error) || !OpenSide(*pending->newFile, pending->error))
+            return;
+        auto start = std::chrono::steady_clock::now();
+        pending->diff = DiffImages(Image(*pending->oldFile), Image(*pending->newFile));
+        pending->seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    });
+    connect(thread, &QThread::finished, this, [this, pending] { ShowResult(pending); });
+    connect(thread, &QThread::finished, thread, &QObject::deleteLater);
+    thread->start();
+}
+
+bool DiffDialog::OpenSide(ParsedFile& file, QString& error)
+{
+    if (!file.mapping.Open(file.path.toStdString()))
+    {
+        error = file.path + ": " + QString::fromStdString(file.mapping.ErrorString());
+        return false;
+    }
+
+    bool parsed = false;
+    file.magic = DetectImageMagic(file.mapping.Data(), file.mapping.Size());
+    switch (file.magic)
+    {
+    case IMAGE_NT_OPTIONAL_HDR32_MAGIC:
+        parsed = ParseThroughSections(file.pe32, file.mapping);
+        break;
+    case IMAGE_NT_OPTIONAL_HDR64_MAGIC:
+        parsed = ParseThroughSections(file.pe64, file.mapping);
+        break;
+    default:
+        error = file.path + ": Invalid architecture.";
+        return false;
+    }
+
+    if (!parsed)
+        error = file.path + ": " + QString::fromStdString(Image(file).ErrorString());
+    return parsed;
+}
+
+const PEImageBase& DiffDialog::Image(const ParsedFile& file)
+{
+    if (file.magic == IMAGE_NT_OPTIONAL_HDR64_MAGIC)
+        return file.pe64;
+    return file.pe32;
+}
+
+void DiffDialog::ShowResult(const QSharedPointer<Result>& _result)
+{
+    if (!_result->error.isEmpty())
+    {
+        Debug("Error", _result->error);
+        summary->setText(_result->error);
+        return;
+    }
+    result = _result;
+    const ImageDiff& diff = result->diff;
+
+    std::vector<StructureRegion> oldRegions;
+    std::vector<StructureRegion> newRegions;
+    auto mark = [](std::vector<StructureRegion>& regions, quint64 offset, quint64 size)
+    {
+        if (size > 0)
+            regions.push_back({static_cast<size_t>(offset), static_cast<size_t>(size), StructureKind::ChangedBytes});
+    };
+
+    tree->setUpdatesEnabled(false);
+    if (!diff.fields.empty())
+    {
+        QTreeWidgetItem* headers = new QTreeWidgetItem(tree, {"Headers", QString::number(diff.fields.size()) + " fields changed"});
+        for (const FieldDiff& field : diff.fields)
+        {
+            QTreeWidgetItem* item = new QTreeWidgetItem(headers, {QString(field.structure) + ": " + field.field->name, "changed",
+                                                                  Hex(field.oldValue), Hex(field.newValue)});
+            item->setToolTip(0, field.field->description);
+            SetRange(item, field.oldOffset, field.field->size, field.newOffset, field.field->size);
+            mark(oldRegions, field.oldOffset, field.field->size);
+            mark(newRegions, field.newOffset, field.field->size);
+        }
+        headers->setExpanded(true);
+    }
+
+    quint64 changedBytes = 0;
+    for (const SectionDiff& section : diff.sections)
+    {
+        QString name = section.overlay ? "(overlay)" : QString::fromStdString(section.name);
+        QString status = StatusName(section.status);
+        if (section.headerChanged)
+            status += ", header changed";
+        QTreeWidgetItem* item = new QTreeWidgetItem(tree, {name, status, RangeText(section.oldOffset, section.oldSize),
+                                                           RangeText(section.newOffset, section.newSize)});
+        SetRange(item, section.oldOffset, section.oldSize, section.newOffset, section.newSize);
+
+        for (size_t i = 0; i < section.changes.size(); i++)
+        {
+            const DiffRange& change = section.changes[i];
+            mark(oldRegions, change.oldOffset, change.oldSize);
+            mark(newRegions, change.newOffset, change.newSize);
+            if (i < kMaxListedRanges)
+            {
+                QTreeWidgetItem* range = new QTreeWidgetItem(item, {"Range " + QString::number(i + 1), "",
+                                                                    RangeText(change.oldOffset, change.oldSize),
+                                                                    RangeText(change.newOffset, change.newSize)});
+                SetRange(range, change.oldOffset, change.oldSize, change.newOffset, change.newSize);
+            }
+        }
+        if (section.changes.size() > kMaxListedRanges)
+            new QTreeWidgetItem(item, {QString::number(section.changes.size() - kMaxListedRanges) + " more ranges"});
+        changedBytes += section.changedBytes;
+    }
+    tree->setUpdatesEnabled(true);
+
+    oldView->SetData(result->oldFile->mapping.Data(), result->oldFile->mapping.Size());
+    oldView->SetRegions(MergeRegions(std::move(oldRegions)));
+    newView->SetData(result->newFile->mapping.Data(), result->newFile->mapping.Size());
+    newView->SetRegions(MergeRegions(std::move(newRegions)));
+
+    if (diff.Identical())
+        summary->setText(QString("The images are identical, compared in %1 s.").arg(result->seconds, 0, 'f', 3));
+    else
+        summary->setText(QString("%1 header fields and %2 bytes differ, compared in %3 s.")
+                             .arg(diff.fields.size()).arg(changedBytes).arg(result->seconds, 0, 'f', 3));
+}
+
+void DiffDialog::OnItemSelected(QTreeWidgetItem* item)
+{
+    if (item == nullptr || !item->data(0, OldOffsetRole).isValid())
+        return;
+
+    // A pure insertion or deletion has no bytes on one side; show where it happened there instead
+    oldView->GoToOffset(item->data(0, OldOffsetRole).toULongLong(), item->data(0, OldSizeRole).toULongLong());
+    newView->GoToOffset(item->data(0, NewOffsetRole).toULongLong(), item->data(0, NewSizeRole).toULongLong());
+}
@@ -0,0 +1,48 @@
+#ifndef DIFFDIALOG_H
+#define DIFFDIALOG_H
+
+#include <QDialog>
+#include <QSharedPointer>
+#include <QString>
+#include "ImageDiff.h"
+#include "parseworker.h"
+
+class QLabel;
+class QTreeWidget;
+class QTreeWidgetItem;
+class HexView;
+
+// Two images side by side. Both are parsed and compared on a background thread; the tree then lists the header
+// fields and section ranges that differ, and selecting one scrolls both hex views to it. Changed bytes are
+// highlighted on each side.
+class DiffDialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    DiffDialog(const QString& oldPath, const QString& newPath, QWidget *parent = nullptr);
+
+private:
+    // Filled on the diff thread, handed to the dialog once the thread finishes
+    struct Result
+    {
+        QSharedPointer<ParsedFile> oldFile;
+        QSharedPointer<ParsedFile> newFile;
+        ImageDiff diff;
+        QString error;
+        double seconds = 0;
+    };
+
+    static bool OpenSide(ParsedFile& file, QString& error);
+    static const PEImageBase& Image(const ParsedFile& file);
+    void ShowResult(const QSharedPointer<Result>& result);
+    void OnItemSelected(QTreeWidgetItem* item);
+
+    QSharedPointer<Result> result; // Keeps both mappings alive while the hex views point into them
+    QLabel* summary;
+    QTreeWidget* tree;
+    HexView* oldView;
+    HexView* newView;
+};
+
+#endif // DIFFDIALOG_H
@@ -0,0 +1,84 @@
+#include "exporttablemodel.h"
+
+ExportTableModel::ExportTableModel(QObject *parent)
+    : QAbstractTableModel(parent)
+{
+
+}
+
+void ExportTableModel::SetImage(const PEImageBase* _image)
+{
+    beginResetModel();
+    image = _image;
+    endResetModel();
+}
+
+void ExportTableModel::Rebind(const PEImageBase* _image)
+{
+    if (image == nullptr || _image == nullptr || image->GetExports().GetSymbols().size() != _image->GetExports().GetSymbols().size())
+    {
+        SetImage(_image);
+        return;
+    }
+
+    image = _image;
+    int rows = rowCount();
+    if (rows > 0)
+        emit dataChanged(index(0, 0), index(rows - 1, ColumnCount - 1));
+}
+
+void ExportTableModel::Clear()
+{
+    SetImage(nullptr);
+}
+
+int ExportTableModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() || image == nullptr ? 0 : static_cast<int>(image->GetExports().GetSymbols().size());
+}
+
+int ExportTableModel::columnCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : ColumnCount;
+}
+
+// Names and forwarders are string views into the mapped image, not NUL-terminated copies
+static QString FromView(std::string_view view)
+{
+    return QString::fromLatin1(view.data(), static_cast<int>(view.size()));
+}
+
+QVariant ExportTableModel::data(const QModelIndex &index, int role) const
+{
+    if (role != Qt::DisplayRole || !index.isValid() || image == nullptr)
+        return QVariant();
+
+    const ExportSymbol& symbol = image->GetExports().GetSymbols()[index.row()];
+    switch (index.column())
+    {
+    case OrdinalColumn:
+        return QString::number(symbol.ordinal);
+    case NameColumn:
+        return FromView(symbol.name);
+    case AddressColumn:
+        return symbol.forwarder.empty() ? QString("0x%1").arg(symbol.rva, 0, 16) : QString();
+    case ForwarderColumn:
+        return FromView(symbol.forwarder);
+    }
+    return QVariant();
+}
+
+QVariant ExportTableModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (role != Qt::DisplayRole || orientation != Qt::Horizontal)
+        return QAbstractTableModel::headerData(section, orientation, role);
+
+    switch (section)
+    {
+    case OrdinalColumn:   return QString("Ordinal");
+    case NameColumn:      return QString("Name");
+    case AddressColumn:   return QString("RVA");
+    case ForwarderColumn: return QString("Forwarded To");
+    }
+    return QVariant();
+}
@@ -0,0 +1,40 @@
+#ifndef EXPORTTABLEMODEL_H
+#define EXPORTTABLEMODEL_H
+
+#include <QAbstractTableModel>
+#include "PEImage.h"
+
+// One row per exported symbol, named exports first. Reads the image's ExportTable directly.
+class ExportTableModel : public QAbstractTableModel
+{
+    Q_OBJECT
+
+public:
+    enum Column
+    {
+        OrdinalColumn,
+        NameColumn,
+        AddressColumn,
+        ForwarderColumn,
+        ColumnCount
+    };
+
+    explicit ExportTableModel(QObject *parent = nullptr);
+
+    // The image must outlive the model's use of it
+    void SetImage(const PEImageBase* image);
+    // A newer image of the same file. Keeps the selection and scroll position when it has as many exports as the
+    // current one, otherwise it is SetImage.
+    void Rebind(const PEImageBase* image);
+    void Clear();
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+
+private:
+    const PEImageBase* image = nullptr;
+};
+
+#endif // EXPORTTABLEMODEL_H
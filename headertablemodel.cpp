@@ -0,0 +1,102 @@
+#include "headertablemodel.h"
+
+HeaderTableModel::HeaderTableModel(QObject *parent)
+    : QAbstractTableModel(parent)
+{
+
+}
+
+void HeaderTableModel::SetHeader(const BYTE* imageBase, size_t _structureOffset, const HeaderLayout& _layout)
+{
+    beginResetModel();
+    structure = imageBase + _structureOffset;
+    structureOffset = _structureOffset;
+    layout = _layout;
+    endResetModel();
+}
+
+void HeaderTableModel::Rebind(const BYTE* imageBase)
+{
+    if (structure == nullptr)
+        return;
+
+    structure = imageBase + structureOffset;
+    int rows = rowCount();
+    if (rows > 0)
+        emit dataChanged(index(0, ValueColumn), index(rows - 1, ValueColumn));
+}
+
+void HeaderTableModel::Clear()
+{
+    beginResetModel();
+    structure = nullptr;
+    structureOffset = 0;
+    layout = { nullptr, 0 };
+    endResetModel();
+}
+
+size_t HeaderTableModel::FieldOffset(int row) const
+{
+    if (row < 0 || static_cast<size_t>(row) >= layout.count)
+        return structureOffset;
+    return structureOffset + layout.fields[row].offset;
+}
+
+size_t HeaderTableModel::FieldSize(int row) const
+{
+    if (row < 0 || static_cast<size_t>(row) >= layout.count)
+        return 0;
+    return layout.fields[row].size;
+}
+
+int HeaderTableModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() || structure == nullptr ? 0 : static_cast<int>(layout.count);
+}
+
+int HeaderTableModel::columnCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : ColumnCount;
+}
+
+QVariant HeaderTableModel::data(const QModelIndex &index, int role) const
+{
+    if (role != Qt::DisplayRole || !index.isValid() || structure == nullptr)
+        return QVariant();
+
+    const HeaderField& field = layout.fields[index.row()];
+    switch (index.column())
+    {
+    case ValueColumn:
+        return QString("0x%1").arg(ReadHeaderField(structure, field), 0, 16);
+    case OffsetColumn:
+        return QString("0x%1").arg(structureOffset + field.offset, 0, 16);
+    case SizeColumn:
+        return QString("0x%1").arg(field.size, 0, 16);
+    case DescriptionColumn:
+        return QString(field.description);
+    }
+    return QVariant();
+}
+
+QVariant HeaderTableModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (role != Qt::DisplayRole)
+        return QVariant();
+
+    if (orientation == Qt::Vertical)
+    {
+        if (section >= 0 && static_cast<size_t>(section) < layout.count)
+            return QString(layout.fields[section].name);
+        return QVariant();
+    }
+
+    switch (section)
+    {
+    case ValueColumn:       return QString("Value");
+    case OffsetColumn:      return QString("Offset");
+    case SizeColumn:        return QString("Size");
+    case DescriptionColumn: return QString("Description");
+    }
+    return QVariant();
+}
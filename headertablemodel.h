@@ -0,0 +1,46 @@
+#ifndef HEADERTABLEMODEL_H
+#define HEADERTABLEMODEL_H
+
+#include <QAbstractTableModel>
+#include "HeaderFields.h"
+
+// Table of one header structure (DOS header, file header, ...).
+// Holds only a pointer into the mapped image; cells are formatted when the view asks for them.
+class HeaderTableModel : public QAbstractTableModel
+{
+    Q_OBJECT
+
+public:
+    enum Column
+    {
+        ValueColumn,
+        OffsetColumn,
+        SizeColumn,
+        DescriptionColumn,
+        ColumnCount
+    };
+
+    explicit HeaderTableModel(QObject *parent = nullptr);
+
+    // structureOffset is the file offset of the structure, imageBase + structureOffset must stay mapped
+    void SetHeader(const BYTE* imageBase, size_t structureOffset, const HeaderLayout& layout);
+    // Same structure at the same offset in a new mapping of the file; values update without resetting the view
+    void Rebind(const BYTE* imageBase);
+    void Clear();
+
+    // File offset of the field shown in row
+    size_t FieldOffset(int row) const;
+    size_t FieldSize(int row) const;
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+
+private:
+    const BYTE* structure = nullptr;
+    size_t structureOffset = 0;
+    HeaderLayout layout = { nullptr, 0 };
+};
+
+#endif // HEADERTABLEMODEL_H
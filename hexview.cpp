@@ -0,0 +1,276 @@
+#include "hexview.h"
+#include <QFontDatabase>
+#include <QHelpEvent>
+#include <QMouseEvent>
+#include <QPainter>
+#include <QScrollBar>
+#include <QToolTip>
+#include <climits>
+
+HexView::HexView(QWidget *parent)
+    : QAbstractScrollArea(parent)
+{
+    setFont(QFontDatabase::systemFont(QFontDatabase::FixedFont));
+    UpdateMetrics();
+    connect(verticalScrollBar(), &QScrollBar::valueChanged, this, &HexView::OnScrolled);
+}
+
+void HexView::SetData(const uchar* _data, size_t _size)
+{
+    data = _data;
+    size = _data != nullptr ? _size : 0;
+    regions.clear();
+    selectionStart = 0;
+    selectionLength = 0;
+    topRow = 0;
+
+    // 8 offset digits up to 4 GB, 16 beyond
+    offsetDigits = size > 0xFFFFFFFFull ? 16 : 8;
+    UpdateScrollBar();
+    viewport()->update();
+}
+
+void HexView::ReplaceData(const uchar* _data, size_t _size)
+{
+    if (_data == nullptr || _size != size)
+    {
+        SetData(_data, _size);
+        return;
+    }
+    data = _data;
+    viewport()->update();
+}
+
+void HexView::SetRegions(std::vector<StructureRegion> _regions)
+{
+    regions = std::move(_regions);
+    viewport()->update();
+}
+
+void HexView::Clear()
+{
+    SetData(nullptr, 0);
+}
+
+QColor HexView::RegionColor(StructureKind kind)
+{
+    // Translucent so the text stays readable on both the light and the dark palette
+    switch (kind)
+    {
+    case StructureKind::DosHeader:         return QColor(70, 130, 180, 110);
+    case StructureKind::NtHeaders:         return QColor(60, 179, 113, 110);
+    case StructureKind::SectionTable:      return QColor(218, 165, 32, 110);
+    case StructureKind::ImportDescriptors: return QColor(199, 21, 133, 110);
+    case StructureKind::ImportThunks:      return QColor(106, 90, 205, 110);
+    case StructureKind::ImportNames:       return QColor(205, 92, 92, 110);
+    case StructureKind::ChangedBytes:      return QColor(255, 69, 0, 130);
+    default:                               return QColor(Qt::transparent);
+    }
+}
+
+void HexView::GoToOffset(size_t offset, size_t length)
+{
+    if (offset >= size)
+        return;
+
+    selectionStart = offset;
+    selectionLength = qMax<size_t>(1, qMin(length, size - offset));
+
+    // Keep the range where it is if it is already on screen, otherwise put it a few rows from the top
+    quint64 row = offset / kBytesPerRow;
+    quint64 visible = static_cast<quint64>(VisibleRows());
+    if (row < topRow || row >= topRow + visible)
+    {
+        quint64 maxTop = RowCount() > visible ? RowCount() - visible : 0;
+        topRow = qMin(row > 2 ? row - 2 : 0, maxTop);
+
+        QSignalBlocker blocker(verticalScrollBar());
+        verticalScrollBar()->setValue(static_cast<int>(topRow / rowsPerStep));
+    }
+    viewport()->update();
+}
+
+quint64 HexView::RowCount() const
+{
+    return (static_cast<quint64>(size) + kBytesPerRow - 1) / kBytesPerRow;
+}
+
+int HexView::VisibleRows() const
+{
+    return qMax(1, viewport()->height() / lineHeight);
+}
+
+void HexView::UpdateMetrics()
+{
+    QFontMetrics metrics(font());
+    charWidth = qMax(1, metrics.horizontalAdvance(QLatin1Char('0')));
+    lineHeight = qMax(1, metrics.height());
+    ascent = metrics.ascent();
+}
+
+void HexView::UpdateScrollBar()
+{
+    quint64 visible = static_cast<quint64>(VisibleRows());
+    quint64 scrollRows = RowCount() > visible ? RowCount() - visible : 0;
+    rowsPerStep = scrollRows / INT_MAX + 1;
+
+    QSignalBlocker blocker(verticalScrollBar());
+    verticalScrollBar()->setRange(0, static_cast<int>(scrollRows / rowsPerStep));
+    verticalScrollBar()->setPageStep(static_cast<int>(qMax<quint64>(1, visible / rowsPerStep)));
+    verticalScrollBar()->setSingleStep(1);
+    verticalScrollBar()->setValue(static_cast<int>(topRow / rowsPerStep));
+}
+
+void HexView::OnScrolled(int value)
+{
+    quint64 visible = static_cast<quint64>(VisibleRows());
+    quint64 maxTop = RowCount() > visible ? RowCount() - visible : 0;
+    topRow = qMin(static_cast<quint64>(value) * rowsPerStep, maxTop);
+    viewport()->update();
+}
+
+// Layout: offset, two spaces, 16 hex bytes with an extra space after the eighth, two spaces, ASCII
+int HexView::HexColumnX(int byte) const
+{
+    return charWidth * (offsetDigits + 2 + byte * 3 + (byte >= 8 ? 1 : 0));
+}
+
+int HexView::AsciiColumnX(int byte) const
+{
+    return HexColumnX(kBytesPerRow) + charWidth * (1 + byte);
+}
+
+void HexView::paintEvent(QPaintEvent *)
+{
+    QPainter painter(viewport());
+    painter.fillRect(viewport()->rect(), palette().color(QPalette::Base));
+    if (data == nullptr)
+        return;
+
+    static const char digits[] = "0123456789abcdef";
+    const QColor textColor = palette().color(QPalette::Text);
+    const QColor offsetColor = palette().color(QPalette::PlaceholderText);
+    QColor selectionColor = palette().color(QPalette::Highlight);
+    selectionColor.setAlpha(160);
+
+    int rows = VisibleRows() + 1;
+    char hexText[kBytesPerRow * 3 + 2];
+    char asciiText[kBytesPerRow + 1];
+    char offsetText[17];
+
+    for (int row = 0; row < rows; row++)
+    {
+        quint64 rowOffset = (topRow + row) * kBytesPerRow;
+        if (rowOffset >= size)
+            break;
+
+        int y = row * lineHeight;
+        int count = static_cast<int>(qMin<quint64>(kBytesPerRow, size - rowOffset));
+        const uchar* bytes = data + rowOffset;
+
+        // Backgrounds first: structure colour, then selection on top
+        for (int i = 0; i < count; i++)
+        {
+            size_t offset = static_cast<size_t>(rowOffset) + i;
+            QColor background;
+            if (offset - selectionStart < selectionLength)
+                background = selectionColor;
+            else if (const StructureRegion* region = FindStructure(regions, offset))
+                background = RegionColor(region->kind);
+            else
+                continue;
+
+            int hexWidth = charWidth * (i == 7 || i == kBytesPerRow - 1 ? 2 : 3);
+            painter.fillRect(HexColumnX(i), y, hexWidth, lineHeight, background);
+            painter.fillRect(AsciiColumnX(i), y, charWidth, lineHeight, background);
+        }
+
+        // One drawText per column per row, formatted into stack buffers
+        for (int d = 0; d < offsetDigits; d++)
+            offsetText[d] = digits[(rowOffset >> (4 * (offsetDigits - 1 - d))) & 0xF];
+        painter.setPen(offsetColor);
+        painter.drawText(0, y + ascent, QString::fromLatin1(offsetText, offsetDigits));
+
+        int length = 0;
+        for (int i = 0; i < count; i++)
+        {
+            if (i == 8)
+                hexText[length++] = ' ';
+            hexText[length++] = digits[bytes[i] >> 4];
+            hexText[length++] = digits[bytes[i] & 0xF];
+            hexText[length++] = ' ';
+            asciiText[i] = bytes[i] >= 0x20 && bytes[i] < 0x7F ? static_cast<char>(bytes[i]) : '.';
+        }
+        painter.setPen(textColor);
+        painter.drawText(HexColumnX(0), y + ascent, QString::fromLatin1(hexText, length));
+        painter.drawText(AsciiColumnX(0), y + ascent, QString::fromLatin1(asciiText, count));
+    }
+}
+
+void HexView::resizeEvent(QResizeEvent *event)
+{
+    QAbstractScrollArea::resizeEvent(event);
+    UpdateScrollBar();
+}
+
+void HexView::changeEvent(QEvent *event)
+{
+    QAbstractScrollArea::changeEvent(event);
+    if (event->type() == QEvent::FontChange)
+    {
+        UpdateMetrics();
+        UpdateScrollBar();
+        viewport()->update();
+    }
+}
+
+bool HexView::OffsetAt(const QPoint& position, size_t& offset) const
+{
+    if (data == nullptr || position.y() < 0)
+        return false;
+
+    int byte = -1;
+    for (int i = 0; i < kBytesPerRow && byte < 0; i++)
+    {
+        if ((position.x() >= HexColumnX(i) && position.x() < HexColumnX(i) + 2 * charWidth) ||
+            (position.x() >= AsciiColumnX(i) && position.x() < AsciiColumnX(i) + charWidth))
+            byte = i;
+    }
+    if (byte < 0)
+        return false;
+
+    quint64 candidate = (topRow + static_cast<quint64>(position.y() / lineHeight)) * kBytesPerRow + byte;
+    if (candidate >= size)
+        return false;
+    offset = static_cast<size_t>(candidate);
+    return true;
+}
+
+void HexView::mousePressEvent(QMouseEvent *event)
+{
+    size_t offset;
+    if (event->button() == Qt::LeftButton && OffsetAt(event->pos(), offset))
+    {
+        selectionStart = offset;
+        selectionLength = 1;
+        viewport()->update();
+    }
+    QAbstractScrollArea::mousePressEvent(event);
+}
+
+bool HexView::viewportEvent(QEvent *event)
+{
+    // Hovering a coloured byte names the structure it belongs to
+    if (event->type() == QEvent::ToolTip)
+    {
+        QHelpEvent *help = static_cast<QHelpEvent *>(event);
+        size_t offset;
+        const StructureRegion* region = OffsetAt(help->pos(), offset) ? FindStructure(regions, offset) : nullptr;
+        if (region != nullptr)
+            QToolTip::showText(help->globalPos(), QString("0x%1: %2").arg(offset, 0, 16).arg(StructureKindName(region->kind)), viewport());
+        else
+            QToolTip::hideText();
+        return true;
+    }
+    return QAbstractScrollArea::viewportEvent(event);
+}
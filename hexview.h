@@ -0,0 +1,65 @@
+#ifndef HEXVIEW_H
+#define HEXVIEW_H
+
+#include <QAbstractScrollArea>
+#include <vector>
+#include "StructureMap.h"
+
+// Hex/ASCII view straight over the mapped image.
+// Only the rows in the viewport are formatted, on every paint, so memory use and frame time
+// do not depend on the file size. Bytes that belong to a parsed structure get a coloured background.
+class HexView : public QAbstractScrollArea
+{
+    Q_OBJECT
+
+public:
+    explicit HexView(QWidget *parent = nullptr);
+
+    // data must stay mapped until Clear or the next SetData
+    void SetData(const uchar* data, size_t size);
+    // A new mapping of the same file at the same size, e.g. after a rebuild; keeps the position and selection
+    void ReplaceData(const uchar* data, size_t size);
+    void SetRegions(std::vector<StructureRegion> regions);
+    void Clear();
+
+    // Scroll so the range is visible and highlight it
+    void GoToOffset(size_t offset, size_t length = 1);
+
+    static QColor RegionColor(StructureKind kind);
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+    void resizeEvent(QResizeEvent *event) override;
+    void changeEvent(QEvent *event) override;
+    void mousePressEvent(QMouseEvent *event) override;
+    bool viewportEvent(QEvent *event) override;
+
+private slots:
+    void OnScrolled(int value);
+
+private:
+    static const int kBytesPerRow = 16;
+
+    void UpdateMetrics();
+    void UpdateScrollBar();
+    quint64 RowCount() const;
+    int VisibleRows() const;
+    int HexColumnX(int byte) const;
+    int AsciiColumnX(int byte) const;
+    bool OffsetAt(const QPoint& position, size_t& offset) const;
+
+    const uchar* data = nullptr;
+    size_t size = 0;
+    std::vector<StructureRegion> regions;
+    size_t selectionStart = 0;
+    size_t selectionLength = 0;
+
+    quint64 topRow = 0;
+    quint64 rowsPerStep = 1; // Scroll bar values are ints, files with more rows than that scroll in steps
+    int offsetDigits = 8;
+    int charWidth = 1;
+    int lineHeight = 1;
+    int ascent = 0;
+};
+
+#endif // HEXVIEW_H
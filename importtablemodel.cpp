@@ -0,0 +1,85 @@
+#include "importtablemodel.h"
+
+ImportTableModel::ImportTableModel(QObject *parent)
+    : QAbstractTableModel(parent)
+{
+
+}
+
+void ImportTableModel::SetImage(const PEImageBase* _image)
+{
+    beginResetModel();
+    image = _image;
+    endResetModel();
+}
+
+void ImportTableModel::Rebind(const PEImageBase* _image)
+{
+    if (image == nullptr || _image == nullptr || image->GetImports().FunctionCount() != _image->GetImports().FunctionCount())
+    {
+        SetImage(_image);
+        return;
+    }
+
+    image = _image;
+    int rows = rowCount();
+    if (rows > 0)
+        emit dataChanged(index(0, 0), index(rows - 1, ColumnCount - 1));
+}
+
+void ImportTableModel::Clear()
+{
+    SetImage(nullptr);
+}
+
+int ImportTableModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() || image == nullptr ? 0 : static_cast<int>(image->GetImports().FunctionCount());
+}
+
+int ImportTableModel::columnCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : ColumnCount;
+}
+
+// Names are string views into the mapped image, not NUL-terminated copies
+static QString FromView(std::string_view view)
+{
+    return QString::fromLatin1(view.data(), static_cast<int>(view.size()));
+}
+
+QVariant ImportTableModel::data(const QModelIndex &index, int role) const
+{
+    if (role != Qt::DisplayRole || !index.isValid() || image == nullptr)
+        return QVariant();
+
+    const ImportTable& imports = image->GetImports();
+    size_t row = static_cast<size_t>(index.row());
+    switch (index.column())
+    {
+    case ModuleColumn:
+        return FromView(imports.Module(imports.FunctionModule(row)).name);
+    case FunctionColumn:
+        return FromView(imports.FunctionName(row));
+    case HintColumn:
+        return imports.IsByOrdinal(row) ? QString() : QString("0x%1").arg(imports.Hint(row), 0, 16);
+    case OrdinalColumn:
+        return imports.IsByOrdinal(row) ? QString::number(imports.Ordinal(row)) : QString();
+    }
+    return QVariant();
+}
+
+QVariant ImportTableModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (role != Qt::DisplayRole || orientation != Qt::Horizontal)
+        return QAbstractTableModel::headerData(section, orientation, role);
+
+    switch (section)
+    {
+    case ModuleColumn:   return QString("Module");
+    case FunctionColumn: return QString("Function");
+    case HintColumn:     return QString("Hint");
+    case OrdinalColumn:  return QString("Ordinal");
+    }
+    return QVariant();
+}
@@ -0,0 +1,41 @@
+#ifndef IMPORTTABLEMODEL_H
+#define IMPORTTABLEMODEL_H
+
+#include <QAbstractTableModel>
+#include "PEImage.h"
+
+// One row per imported function. Names point into the mapped image and are only
+// turned into QStrings for the rows the view actually paints.
+class ImportTableModel : public QAbstractTableModel
+{
+    Q_OBJECT
+
+public:
+    enum Column
+    {
+        ModuleColumn,
+        FunctionColumn,
+        HintColumn,
+        OrdinalColumn,
+        ColumnCount
+    };
+
+    explicit ImportTableModel(QObject *parent = nullptr);
+
+    // The image must outlive the model's use of it
+    void SetImage(const PEImageBase* image);
+    // A newer image of the same file. Keeps the selection and scroll position when it has as many imports as the
+    // current one, otherwise it is SetImage.
+    void Rebind(const PEImageBase* image);
+    void Clear();
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+
+private:
+    const PEImageBase* image = nullptr;
+};
+
+#endif // IMPORTTABLEMODEL_H
@@ -2,9 +2,24 @@
 #include "./ui_mainwindow.h"
 #include <cstddef>
 #include <QString>
+#include <QHeaderView>
+#include <QLineEdit>
+#include <QDockWidget>
+#include <QFileSystemWatcher>
+#include <QPlainTextEdit>
+#include <QStatusBar>
+#include <QStringListModel>
+#include <QThread>
+#include <QTimer>
+#include <QTreeView>
+#include <QVBoxLayout>
 #include <QStyleFactory>
-#include "PE32.h"
+#include "PEImage.h"
 #include "debug.h"
+#include "sparklinedelegate.h"
+#include "hexview.h"
+#include "diffdialog.h"
+#include "StructureMap.h"
 
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent)
@@ -12,10 +27,130 @@ MainWindow::MainWindow(QWidget *parent)
 {
     SetDarkMode();
     ui->setupUi(this);
+
+    // Models read straight from the parsed image, cells are only formatted when a view paints them
+    dosHeaderModel = new HeaderTableModel(this);
+    ntHeadersModel = new HeaderTableModel(this);
+    fileHeaderModel = new HeaderTableModel(this);
+    optionalHeaderModel = new HeaderTableModel(this);
+    dataDirectoriesModel = new HeaderTableModel(this);
+    sectionModel = new SectionTableModel(this);
+    importModel = new ImportTableModel(this);
+    exportModel = new ExportTableModel(this);
+    resourceModel = new ResourceTreeModel(this);
+    stringModel = new StringTableModel(this);
+    summaryModel = new QStringListModel(this);
+
+    ui->listView->setModel(summaryModel);
+    ui->dosHeaderTableView->setModel(dosHeaderModel);
+    ui->ntHeadersTableView->setModel(ntHeadersModel);
+    ui->fileHeaderTableView->setModel(fileHeaderModel);
+    ui->optionalHeaderTableView->setModel(optionalHeaderModel);
+    ui->dataDirectoriesTableView->setModel(dataDirectoriesModel);
+    ui->sectionHeaderTableView->setModel(sectionModel);
+    ui->dllImportTableView->setModel(importModel);
+    ui->exportTableView->setModel(exportModel);
+    ui->sectionHeaderTableView->setItemDelegateForColumn(SectionTableModel::EntropyProfileColumn, new SparklineDelegate(this));
+
+    // Uniform rows let the import view skip measuring every row when the table is huge
+    ui->dllImportTableView->verticalHeader()->setSectionResizeMode(QHeaderView::Fixed);
+    ui->dllImportTableView->verticalHeader()->hide();
+    ui->exportTableView->verticalHeader()->setSectionResizeMode(QHeaderView::Fixed);
+    ui->exportTableView->verticalHeader()->hide();
+
+    // Raw bytes of the open file; clicking a header field jumps to it
+    hexView = new HexView(this);
+    ui->tabWidget->addTab(hexView, "Hex");
+    LinkToHexView(ui->dosHeaderTableView, dosHeaderModel);
+    LinkToHexView(ui->ntHeadersTableView, ntHeadersModel);
+    LinkToHexView(ui->fileHeaderTableView, fileHeaderModel);
+    LinkToHexView(ui->optionalHeaderTableView, optionalHeaderModel);
+    LinkToHexView(ui->dataDirectoriesTableView, dataDirectoriesModel);
+
+    // Resource tree, read one level at a time as it is expanded; double-clicking a leaf shows its data
+    resourceTreeView = new QTreeView(this);
+    resourceTreeView->setModel(resourceModel);
+    resourceTreeView->setUniformRowHeights(true);
+    ui->tabWidget->insertTab(ui->tabWidget->indexOf(hexView), resourceTreeView, "Resources");
+    connect(resourceTreeView, &QTreeView::doubleClicked, this, [this](const QModelIndex& index)
+    {
+        ResourceData data;
+        if (!resourceModel->LeafData(index, data))
+            return;
+        hexView->GoToOffset(data.fileOffset, data.size);
+        ui->tabWidget->setCurrentWidget(hexView);
+    });
+
+    // Strings from the whole file; the filter narrows the index as it is typed, double-clicking shows the bytes
+    QWidget* stringsTab = new QWidget(this);
+    QLineEdit* stringFilter = new QLineEdit(stringsTab);
+    stringFilter->setPlaceholderText("Filter");
+    stringFilter->setClearButtonEnabled(true);
+    stringTableView = new QTableView(stringsTab);
+    stringTableView->setModel(stringModel);
+    stringTableView->verticalHeader()->setSectionResizeMode(QHeaderView::Fixed);
+    stringTableView->verticalHeader()->hide();
+    stringTableView->horizontalHeader()->setStretchLastSection(true);
+    QVBoxLayout* stringsLayout = new QVBoxLayout(stringsTab);
+    stringsLayout->addWidget(stringFilter);
+    stringsLayout->addWidget(stringTableView);
+    ui->tabWidget->insertTab(ui->tabWidget->indexOf(hexView), stringsTab, "Strings");
+    connect(stringFilter, &QLineEdit::textChanged, stringModel, &StringTableModel::SetFilter);
+    connect(stringTableView, &QTableView::doubleClicked, this, [this](const QModelIndex& index)
+    {
+        const StringHit* hit = stringModel->HitAt(index);
+        if (hit == nullptr)
+            return;
+        hexView->GoToOffset(hit->offset, size_t(hit->length) * (hit->encoding == StringUtf16 ? 2 : 1));
+        ui->tabWidget->setCurrentWidget(hexView);
+    });
+
+    // Non-modal log pane, diagnostics from any thread land here without stalling anything
+    logView = new QPlainTextEdit(this);
+    logView->setReadOnly(true);
+    logView->setMaximumBlockCount(10000);
+    QDockWidget* logDock = new QDockWidget("Log", this);
+    logDock->setObjectName("logDock");
+    logDock->setWidget(logView);
+    addDockWidget(Qt::BottomDockWidgetArea, logDock);
+    connect(DebugLog::Instance(), &DebugLog::Message, this, &MainWindow::AppendLog);
+
+    // Parsing runs on its own thread so large files never freeze the window
+    parseThread = new QThread(this);
+    parseWorker = new ParseWorker;
+    parseWorker->moveToThread(parseThread);
+    connect(parseThread, &QThread::finished, parseWorker, &QObject::deleteLater);
+    connect(parseWorker, &ParseWorker::HeadersParsed, this, &MainWindow::OnHeadersParsed);
+    connect(parseWorker, &ParseWorker::SectionsParsed, this, &MainWindow::OnSectionsParsed);
+    connect(parseWorker, &ParseWorker::ImportsParsed, this, &MainWindow::OnImportsParsed);
+    connect(parseWorker, &ParseWorker::ExportsParsed, this, &MainWindow::OnExportsParsed);
+    connect(parseWorker, &ParseWorker::ResourcesParsed, this, &MainWindow::OnResourcesParsed);
+    connect(parseWorker, &ParseWorker::EntropyComputed, this, &MainWindow::OnEntropyComputed);
+    connect(parseWorker, &ParseWorker::StringsExtracted, this, &MainWindow::OnStringsExtracted);
+    connect(parseWorker, &ParseWorker::SignaturesMatched, this, &MainWindow::OnSignaturesMatched);
+    connect(parseWorker, &ParseWorker::DigestComputed, this, &MainWindow::OnDigestComputed);
+    connect(parseWorker, &ParseWorker::Finished, this, &MainWindow::OnParseFinished);
+    connect(parseWorker, &ParseWorker::Failed, this, &MainWindow::OnParseFailed);
+    connect(parseWorker, &ParseWorker::Unchanged, this, &MainWindow::OnParseUnchanged);
+    parseThread->start();
+
+    // Watch mode: once a rebuild has stopped writing, the file is parsed again and compared with the version shown
+    fileWatcher = new QFileSystemWatcher(this);
+    reloadTimer = new QTimer(this);
+    reloadTimer->setSingleShot(true);
+    reloadTimer->setInterval(300);
+    connect(fileWatcher, &QFileSystemWatcher::fileChanged, reloadTimer, [this] { reloadTimer->start(); });
+    connect(reloadTimer, &QTimer::timeout, this, &MainWindow::OnReloadTimeout);
 }
 
 MainWindow::~MainWindow()
 {
+    // Stop at the next stage boundary, then let the thread drain and exit
+    parseWorker->Cancel();
+    parseThread->quit();
+    parseThread->wait();
+
+    ClearModels();
     delete ui;
 }
 
@@ -25,6 +160,15 @@ void MainWindow::on_actionOpenFile_triggered()
     fileName = QFileDialog::getOpenFileName(this, "Open a file", QDir::currentPath(), "Executables (*.exe)");
     QFileInfo fileInfo(fileName);
     setWindowTitle("File: " + fileInfo.fileName());
+
+    // Watch mode follows the selected file
+    if (ui->actionWatchFile->isChecked())
+    {
+        if (!fileWatcher->files().isEmpty())
+            fileWatcher->removePaths(fileWatcher->files());
+        if (!fileName.isEmpty())
+            fileWatcher->addPath(fileName);
+    }
 }
 
 void MainWindow::on_pushButton_clicked()
@@ -33,150 +177,445 @@ void MainWindow::on_pushButton_clicked()
     {
         Debug("Error", "Please select a file.");
         on_actionOpenFile_triggered();
+        if (fileName.isEmpty())
+            return;
     }
 
-    // Open file
-    HANDLE file = CreateFileW(fileName.toStdWString().c_str(), GENERIC_ALL, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
-    if (file == INVALID_HANDLE_VALUE)
+    // Views must let go of the old image before its mapping can be released
+    ClearModels();
+    currentFile.reset();
+    watchedFile.reset();
+    StartParse(false);
+}
+
+// A refresh parses the file again against watchedFile and updates the views in place; anything else starts from
+// empty views. In watch mode every version is hashed so that the next one can be compared with it.
+void MainWindow::StartParse(bool refresh)
+{
+    // Supersedes any parse still running; the worker picks this up once the old one stops
+    parseGeneration = parseWorker->BeginRequest();
+    quint64 generation = parseGeneration;
+    QString path = fileName;
+    refreshing = refresh;
+    if (ui->actionWatchFile->isChecked())
+    {
+        QSharedPointer<const ParsedFile> previous;
+        if (refresh)
+            previous = watchedFile;
+        QMetaObject::invokeMethod(parseWorker, [this, path, generation, previous] { parseWorker->Reparse(path, generation, previous); }, Qt::QueuedConnection);
+    }
+    else
     {
-        Debug("Error", fileName);
+        QMetaObject::invokeMethod(parseWorker, [this, path, generation] { parseWorker->Parse(path, generation); }, Qt::QueuedConnection);
+    }
+
+    statusBar()->showMessage((refresh ? "Re-parsing " : "Parsing ") + QFileInfo(fileName).fileName() + "...");
+}
+
+// A refresh that stops early leaves some views on the new version and some on the previous one, and the next
+// refresh would release one of them under the views. Start over from empty views instead.
+void MainWindow::StopRefresh()
+{
+    if (!refreshing)
+        return;
+
+    refreshing = false;
+    ClearModels();
+    currentFile.reset();
+    watchedFile.reset();
+}
+
+void MainWindow::on_actionCancelParse_triggered()
+{
+    parseWorker->Cancel();
+    parseGeneration = 0;
+    StopRefresh();
+    reloadPending = false;
+    statusBar()->showMessage("Parse cancelled.", 3000);
+}
+
+void MainWindow::on_actionWatchFile_toggled(bool checked)
+{
+    if (!fileWatcher->files().isEmpty())
+        fileWatcher->removePaths(fileWatcher->files());
+    reloadTimer->stop();
+    reloadPending = false;
+    if (!checked)
+    {
+        statusBar()->showMessage("Stopped watching.", 3000);
         return;
     }
 
-    // Allocate space on heap to load PE
-    DWORD fileSize = GetFileSize(file, nullptr);
-    LPVOID fileData = HeapAlloc(GetProcessHeap(), 0, fileSize);
+    if (fileName.isEmpty())
+    {
+        Debug("Error", "Please select a file.");
+        on_actionOpenFile_triggered();
+        if (fileName.isEmpty())
+        {
+            ui->actionWatchFile->setChecked(false);
+            return;
+        }
+    }
+
+    // The version on screen was not hashed, so watching starts with one full parse
+    fileWatcher->addPath(fileName);
+    on_pushButton_clicked();
+}
 
-    DWORD bytesRead;
+void MainWindow::OnReloadTimeout()
+{
+    if (fileName.isEmpty() || !ui->actionWatchFile->isChecked())
+        return;
 
-    bool readFileStatus = ReadFile(file, fileData, fileSize, &bytesRead, nullptr);
-    if (!readFileStatus || bytesRead != fileSize)
+    // Builds often write a new file and rename it over the old one, which drops the path from the watcher.
+    // Keep checking until it is back, then watch the new file.
+    if (!QFileInfo::exists(fileName))
     {
-        Debug("Error", "Failed to read entire file.");
-        HeapFree(GetProcessHeap(), 0, fileData);
-        CloseHandle(file);
+        reloadTimer->start();
         return;
     }
+    if (!fileWatcher->files().contains(fileName))
+        fileWatcher->addPath(fileName);
 
-    // Detect architecture
-    DWORD arch = 0;
-    GetBinaryTypeW(fileName.toStdWString().c_str(), &arch);
+    // One refresh at a time, the views of the running one may still point into watchedFile
+    if (refreshing)
+    {
+        reloadPending = true;
+        return;
+    }
+
+    if (!watchedFile || watchedFile->path != fileName)
+        on_pushButton_clicked();
+    else
+        StartParse(true);
+}
 
-    switch(arch)
+void MainWindow::on_actionCompareFile_triggered()
+{
+    if (fileName.isEmpty())
     {
-    case SCS_32BIT_BINARY:
-        architecture = "x86 (32-bit)";
-        Debug("Alert", "This is a 32-bit executable.");
-        ParseImage32(fileData);
-        DisplayImage32();
-        break;
-    case SCS_64BIT_BINARY:
-        architecture = "x86-64 (64-bit)";
-        Debug("Alert", "This is a 64-bit executable.");
-        ParseImage64(fileData);
-        break;
-    default:
-        Debug("Error", "Invalid architecture.");
+        Debug("Error", "Please select a file.");
+        on_actionOpenFile_triggered();
+        if (fileName.isEmpty())
+            return;
     }
 
-    // Cleanup
-    HeapFree(GetProcessHeap(), 0, fileData);
-    CloseHandle(file);
+    QString otherName = QFileDialog::getOpenFileName(this, "Compare with", QFileInfo(fileName).absolutePath(), "Executables (*.exe *.dll *.sys);;All files (*)");
+    if (otherName.isEmpty())
+        return;
+
+    // Non-modal and deletes itself on close, so several comparisons can stay open next to the main window
+    DiffDialog* dialog = new DiffDialog(fileName, otherName, this);
+    dialog->show();
 }
 
-// Add row to table
+void MainWindow::on_actionLoadSignatures_triggered()
+{
+    QString path = QFileDialog::getOpenFileName(this, "Load signatures", QDir::currentPath(), "Signature databases (*.txt *.sig);;All files (*)");
+    if (path.isEmpty())
+        return;
 
-// 32 bit everything is DWORD or smaller, 64 bit everything is UNSIGNED LONG LONG or smaller
-void MainWindow::AddTableRow(QTableWidget* table, int row, int column, unsigned long long value, size_t offset, size_t size)
+    // Compiled here once, then shared read-only with the worker; queued so it lands before the next parse request
+    QSharedPointer<SignatureSet> set(new SignatureSet);
+    if (!set->LoadFile(path.toStdString()) || !set->Compile())
+    {
+        Debug("Error", path + ": " + QString::fromStdString(set->ErrorString()));
+        return;
+    }
+    QSharedPointer<const SignatureSet> compiled = set;
+    QMetaObject::invokeMethod(parseWorker, [this, compiled] { parseWorker->SetSignatures(compiled); }, Qt::QueuedConnection);
+
+    statusBar()->showMessage(QString("Loaded %1 signatures from %2.").arg(set->Count()).arg(QFileInfo(path).fileName()), 3000);
+}
+
+void MainWindow::AppendLog(QString title, QString text)
 {
-    table->setItem(row, column, new QTableWidgetItem(QString("0x%1").arg(value, 0, 16)));
-    table->setItem(row, column + 1, new QTableWidgetItem(QString("0x%1").arg(offset, 0, 16)));
-    table->setItem(row, column + 2, new QTableWidgetItem(QString("0x%1").arg(size, 0, 16)));
+    logView->appendPlainText(title + ": " + text);
 }
 
-void MainWindow::DisplayDOSHeader()
+// Each stage fills its tabs as soon as it lands. Signals from a superseded or cancelled parse are dropped.
+void MainWindow::OnHeadersParsed(quint64 generation, QSharedPointer<ParsedFile> file)
 {
-    // Treat DOS header like a WORD* so we can iterate through it
-    WORD* dosHeaderMember = reinterpret_cast<WORD*>(pe32Image.GetDOSHeader());
+    if (generation != parseGeneration)
+        return;
 
-    // Get number of words
-    size_t numWords = sizeof(IMAGE_DOS_HEADER) / sizeof(WORD);
-    for (size_t i = 0; i < numWords; ++i)
+    currentFile = file;
+    architecture = file->magic == IMAGE_NT_OPTIONAL_HDR64_MAGIC ? "x86-64 (64-bit)" : "x86 (32-bit)";
+    if (file->incremental)
+    {
+        // Same layout as the version on screen: every header field sits where it was, only values may differ
+        const BYTE* base = file->mapping.Data();
+        hexView->ReplaceData(base, file->mapping.Size());
+        dosHeaderModel->Rebind(base);
+        ntHeadersModel->Rebind(base);
+        fileHeaderModel->Rebind(base);
+        optionalHeaderModel->Rebind(base);
+        dataDirectoriesModel->Rebind(base);
+    }
+    else
     {
-        size_t memberOffset = i * sizeof(WORD);
-        size_t memberSize = sizeof(dosHeaderMember[i]);
-        AddTableRow(ui->dosHeaderTableWidget, i, 0, dosHeaderMember[i], memberOffset, memberSize);
+        hexView->SetData(file->mapping.Data(), file->mapping.Size());
+        if (file->magic == IMAGE_NT_OPTIONAL_HDR64_MAGIC)
+            DisplayHeaders(file->pe64);
+        else
+            DisplayHeaders(file->pe32);
     }
+
+    summaryModel->setStringList({
+        "File:          " + QFileInfo(file->path).fileName(),
+        "Size:          " + QString::number(file->mapping.Size()) + " bytes",
+        "Architecture:  " + architecture
+    });
+}
+
+void MainWindow::OnSectionsParsed(quint64 generation, QSharedPointer<ParsedFile> file)
+{
+    if (generation != parseGeneration)
+        return;
+
+    if (file->incremental)
+        sectionModel->Rebind(&CurrentImage(*file).GetSections());
+    else
+        DisplaySections(CurrentImage(*file));
+}
+
+void MainWindow::OnImportsParsed(quint64 generation, QSharedPointer<ParsedFile> file)
+{
+    if (generation != parseGeneration)
+        return;
+
+    if (file->incremental)
+        importModel->Rebind(&CurrentImage(*file));
+    else
+        DisplayImports(CurrentImage(*file));
+
+    // Import descriptors and thunks are known now, so every overlay can be placed
+    if (file->magic == IMAGE_NT_OPTIONAL_HDR64_MAGIC)
+        hexView->SetRegions(BuildStructureMap(file->pe64));
+    else
+        hexView->SetRegions(BuildStructureMap(file->pe32));
+}
+
+void MainWindow::OnExportsParsed(quint64 generation, QSharedPointer<ParsedFile> file)
+{
+    if (generation != parseGeneration)
+        return;
+
+    if (file->incremental)
+        exportModel->Rebind(&CurrentImage(*file));
+    else
+        DisplayExports(CurrentImage(*file));
+}
+
+void MainWindow::OnResourcesParsed(quint64 generation, QSharedPointer<ParsedFile> file)
+{
+    if (generation != parseGeneration)
+        return;
+
+    // Expanded directories hold entries read from the old bytes, so they are only kept while those bytes are
+    if (file->incremental && !(file->changedStages & StageResources))
+        resourceModel->Rebind(&CurrentImage(*file));
+    else
+        resourceModel->SetImage(&CurrentImage(*file));
+}
+
+void MainWindow::OnEntropyComputed(quint64 generation, QSharedPointer<ParsedFile> file)
+{
+    if (generation != parseGeneration)
+        return;
+
+    sectionModel->SetEntropy(&file->sectionEntropy);
+    ui->sectionHeaderTableView->resizeColumnToContents(SectionTableModel::EntropyProfileColumn);
+}
+
+void MainWindow::OnStringsExtracted(quint64 generation, QSharedPointer<ParsedFile> file)
+{
+    if (generation != parseGeneration)
+        return;
+
+    stringModel->SetTable(&CurrentImage(*file), &file->strings);
+}
+
+void MainWindow::OnSignaturesMatched(quint64 generation, QSharedPointer<ParsedFile> file)
+{
+    if (generation != parseGeneration)
+        return;
+
+    QStringList lines = summaryModel->stringList();
+    if (file->signatureMatches.empty())
+        lines << "Signatures:    none matched";
+    for (const SignatureMatch& match : file->signatureMatches)
+        lines << "Signature:     " + QString::fromStdString((*file->signatureSet)[match.signature].name) + " at 0x" + QString::number(match.offset, 16).toUpper();
+    summaryModel->setStringList(lines);
 }
 
-void MainWindow::DisplayNTHeaders()
+void MainWindow::OnDigestComputed(quint64 generation, QSharedPointer<ParsedFile> file)
 {
-    WORD* ntHeadersMember = reinterpret_cast<WORD*>(pe32Image.GetNTHeaders());
+    if (generation != parseGeneration)
+        return;
+
+    // A stored checksum of 0 means the linker never set one, which is normal for anything but drivers
+    const ImageDigest& digest = file->digest;
+    auto hex = [](DWORD value) { return QString("0x%1").arg(value, 8, 16, QChar('0')); };
+    QString verdict = digest.storedChecksum == 0 ? "not set" : (digest.ChecksumMatches() ? "matches" : "MISMATCH");
 
-    // Get number of words
-    size_t numWords = sizeof(IMAGE_NT_HEADERS32) / sizeof(WORD);
-    for (size_t i = 0; i < numWords; ++i)
+    QStringList lines = summaryModel->stringList();
+    lines << "Checksum:      " + hex(digest.storedChecksum) + " stored, " + hex(digest.checksum) + " computed (" + verdict + ")";
+    lines << "Signed:        " + QString(digest.hasCertificate ? "yes" : "no");
+    lines << "Authenticode:  " + QString::fromStdString(DigestToHex(digest.authenticode, sizeof(digest.authenticode)));
+    summaryModel->setStringList(lines);
+}
+
+void MainWindow::OnParseFinished(quint64 generation)
+{
+    if (generation != parseGeneration)
+        return;
+
+    // Every view now points into currentFile, so the previous version can go
+    refreshing = false;
+    if (ui->actionWatchFile->isChecked())
+        watchedFile = currentFile;
+    if (reloadPending)
+    {
+        reloadPending = false;
+        reloadTimer->start();
+    }
+
+    // Where the time went, so a slow file points at its slow stage
+    QStringList timings;
+    double total = 0;
+    if (currentFile)
     {
-        size_t memberOffset = i * sizeof(WORD);
-        size_t memberSize = sizeof(ntHeadersMember[i]);
-        AddTableRow(ui->ntHeadersTableWidget, i, 0, ntHeadersMember[i], memberOffset, memberSize);
+        for (const StageTiming& timing : currentFile->stageTimings)
+        {
+            timings << QString("%1 %2 ms").arg(timing.name).arg(timing.milliseconds, 0, 'f', 1);
+            total += timing.milliseconds;
+        }
     }
+    statusBar()->showMessage(QFileInfo(fileName).fileName() + ": " + architecture +
+                             QString(currentFile && currentFile->incremental ? " | re-parsed in %1 ms: " : " | parsed in %1 ms: ").arg(total, 0, 'f', 1) +
+                             timings.join(", "));
 }
 
-void MainWindow::DisplayFileHeader()
+void MainWindow::OnParseFailed(quint64 generation)
 {
+    if (generation != parseGeneration)
+        return;
 
+    StopRefresh();
+    if (reloadPending)
+    {
+        reloadPending = false;
+        reloadTimer->start();
+    }
+    statusBar()->showMessage("Parse failed, see the log for details.");
 }
 
-void MainWindow::DisplayOptionalHeader()
+void MainWindow::OnParseUnchanged(quint64 generation)
 {
+    if (generation != parseGeneration)
+        return;
 
+    refreshing = false;
+    if (reloadPending)
+    {
+        reloadPending = false;
+        reloadTimer->start();
+    }
+    statusBar()->showMessage(QFileInfo(fileName).fileName() + " was rewritten with the same contents.", 3000);
+}
+
+const PEImageBase& MainWindow::CurrentImage(const ParsedFile& file)
+{
+    if (file.magic == IMAGE_NT_OPTIONAL_HDR64_MAGIC)
+        return file.pe64;
+    return file.pe32;
 }
 
-void MainWindow::DisplaySectionHeader()
+// File offset of a structure inside the mapped image
+static size_t OffsetInImage(const PEImageBase& image, const void* structure)
 {
+    return static_cast<size_t>(reinterpret_cast<const BYTE*>(structure) - reinterpret_cast<const BYTE*>(image.GetImageBase()));
+}
 
+void MainWindow::ClearModels()
+{
+    dosHeaderModel->Clear();
+    ntHeadersModel->Clear();
+    fileHeaderModel->Clear();
+    optionalHeaderModel->Clear();
+    dataDirectoriesModel->Clear();
+    sectionModel->Clear();
+    importModel->Clear();
+    exportModel->Clear();
+    resourceModel->Clear();
+    stringModel->Clear();
+    summaryModel->setStringList(QStringList());
+    hexView->Clear();
 }
 
-void MainWindow::DisplayDataDirectories()
+void MainWindow::LinkToHexView(QTableView* view, HeaderTableModel* model)
 {
+    connect(view, &QTableView::clicked, this, [this, model](const QModelIndex& index)
+    {
+        hexView->GoToOffset(model->FieldOffset(index.row()), model->FieldSize(index.row()));
+        ui->tabWidget->setCurrentWidget(hexView);
+    });
+}
 
+void MainWindow::DisplayDOSHeader(const PEImageBase& image)
+{
+    dosHeaderModel->SetHeader(reinterpret_cast<const BYTE*>(image.GetImageBase()), 0, dosHeaderLayout);
 }
 
-void MainWindow::DisplaySections()
+template <typename Image>
+void MainWindow::DisplayNTHeaders(const Image& image)
 {
+    ntHeadersModel->SetHeader(reinterpret_cast<const BYTE*>(image.GetImageBase()), OffsetInImage(image, image.GetNTHeaders()), ntHeadersLayout);
+}
 
+void MainWindow::DisplayFileHeader(const PEImageBase& image)
+{
+    fileHeaderModel->SetHeader(reinterpret_cast<const BYTE*>(image.GetImageBase()), OffsetInImage(image, image.GetFileHeader()), fileHeaderLayout);
 }
 
-void MainWindow::DisplayImports()
+template <typename Image>
+void MainWindow::DisplayOptionalHeader(const Image& image)
 {
+    // PE32+ drops BaseOfData and widens ImageBase and the stack/heap sizes
+    const HeaderLayout& layout = image.GetOptionalHeader()->Magic == IMAGE_NT_OPTIONAL_HDR64_MAGIC ? optionalHeader64Layout : optionalHeader32Layout;
+    optionalHeaderModel->SetHeader(reinterpret_cast<const BYTE*>(image.GetImageBase()), OffsetInImage(image, image.GetOptionalHeader()), layout);
+}
 
+template <typename Image>
+void MainWindow::DisplayDataDirectories(const Image& image)
+{
+    dataDirectoriesModel->SetHeader(reinterpret_cast<const BYTE*>(image.GetImageBase()), OffsetInImage(image, image.GetOptionalHeader()->DataDirectory), dataDirectoriesLayout);
 }
 
-void MainWindow::DisplayImage32()
+void MainWindow::DisplaySections(const PEImageBase& image)
 {
-    DisplayDOSHeader();
-    DisplayNTHeaders();
-//    DisplayFileHeader();
-//    DisplayOptionalHeader();
-//    DisplaySectionHeader();
-//    DisplayDataDirectories();
-//    DisplaySections();
-//    DisplayImports();
+    sectionModel->SetSections(&image.GetSections());
 }
 
-// 32-bit images
-void MainWindow::ParseImage32(LPVOID imageBase)
+void MainWindow::DisplayImports(const PEImageBase& image)
 {
-    PE32 pe32(imageBase);
-    pe32.Parse();
-    pe32Image = pe32;
+    importModel->SetImage(&image);
 }
 
-// 64-bit images
-void MainWindow::ParseImage64(LPVOID imageBase)
+void MainWindow::DisplayExports(const PEImageBase& image)
 {
+    exportModel->SetImage(&image);
+}
 
+template <typename Image>
+void MainWindow::DisplayHeaders(const Image& image)
+{
+    DisplayDOSHeader(image);
+    DisplayNTHeaders(image);
+    DisplayFileHeader(image);
+    DisplayOptionalHeader(image);
+    DisplayDataDirectories(image);
 }
 
 void MainWindow::SetLightMode()
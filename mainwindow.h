@@ -2,14 +2,28 @@
 #define MAINWINDOW_H
 
 #include <QMainWindow>
-#include <QTableWidget>
 #include <QFile>
 #include <QFileDialog>
 #include <QFileInfo>
 #include <QMessageBox>
-#include <Windows.h>
-#include <TlHelp32.h> //WinAPI Process API
-#include "PE32.h"
+#include <QSharedPointer>
+#include "PEImage.h"
+#include "parseworker.h"
+#include "headertablemodel.h"
+#include "sectiontablemodel.h"
+#include "importtablemodel.h"
+#include "exporttablemodel.h"
+#include "resourcetreemodel.h"
+#include "stringtablemodel.h"
+
+class QFileSystemWatcher;
+class QPlainTextEdit;
+class QStringListModel;
+class QTableView;
+class QTreeView;
+class HexView;
+class QThread;
+class QTimer;
 
 QT_BEGIN_NAMESPACE
 namespace Ui {
@@ -32,26 +46,77 @@ private slots:
 
     void on_actionToggleDarkMode_triggered();
 
+    void on_actionCancelParse_triggered();
+
+    void on_actionCompareFile_triggered();
+
+    void on_actionLoadSignatures_triggered();
+
+    void on_actionWatchFile_toggled(bool checked);
+
+    void OnReloadTimeout();
+
+    void AppendLog(QString title, QString text);
+
+    void OnHeadersParsed(quint64 generation, QSharedPointer<ParsedFile> file);
+    void OnSectionsParsed(quint64 generation, QSharedPointer<ParsedFile> file);
+    void OnImportsParsed(quint64 generation, QSharedPointer<ParsedFile> file);
+    void OnExportsParsed(quint64 generation, QSharedPointer<ParsedFile> file);
+    void OnResourcesParsed(quint64 generation, QSharedPointer<ParsedFile> file);
+    void OnEntropyComputed(quint64 generation, QSharedPointer<ParsedFile> file);
+    void OnStringsExtracted(quint64 generation, QSharedPointer<ParsedFile> file);
+    void OnSignaturesMatched(quint64 generation, QSharedPointer<ParsedFile> file);
+    void OnDigestComputed(quint64 generation, QSharedPointer<ParsedFile> file);
+    void OnParseFinished(quint64 generation);
+    void OnParseFailed(quint64 generation);
+    void OnParseUnchanged(quint64 generation);
+
 private:
     Ui::MainWindow *ui;
     QString architecture;
     QString fileName; 
     bool darkModeOn = 1;
-    PE32 pe32Image;
-
-    void AddTableRow(QTableWidget* table, int row, int column, unsigned long long value, size_t offset, size_t size);
-    void ParseImage32(LPVOID imageBase);   
-    void ParseImage64(LPVOID imageBase);
-    void DisplayImage32();
-    void DisplayImage64();
-    void DisplayDOSHeader();
-    void DisplayNTHeaders();
-    void DisplayFileHeader();
-    void DisplayOptionalHeader();
-    void DisplaySectionHeader();
-    void DisplayDataDirectories();
-    void DisplaySections();
-    void DisplayImports();
+    QSharedPointer<ParsedFile> currentFile; // Keeps the mapping alive while the views point into it
+    QThread* parseThread;
+    ParseWorker* parseWorker;
+    quint64 parseGeneration = 0; // Generation of the parse whose results the views accept
+    QFileSystemWatcher* fileWatcher;
+    QTimer* reloadTimer; // Turns the burst of change notifications a build produces into one reparse
+    QSharedPointer<ParsedFile> watchedFile; // Last complete version in watch mode, compared with the next one
+    bool refreshing = false;    // A reparse against watchedFile is running; views may point into either version
+    bool reloadPending = false; // The file changed again meanwhile
+    QPlainTextEdit* logView;
+    HexView* hexView;
+    QTreeView* resourceTreeView;
+    QTableView* stringTableView;
+
+    HeaderTableModel* dosHeaderModel;
+    HeaderTableModel* ntHeadersModel;
+    HeaderTableModel* fileHeaderModel;
+    HeaderTableModel* optionalHeaderModel;
+    HeaderTableModel* dataDirectoriesModel;
+    SectionTableModel* sectionModel;
+    ImportTableModel* importModel;
+    ExportTableModel* exportModel;
+    ResourceTreeModel* resourceModel;
+    StringTableModel* stringModel;
+    QStringListModel* summaryModel;
+
+    // One body for both widths, instantiated for PE32 and PE64 in mainwindow.cpp
+    template <typename Image> void DisplayHeaders(const Image& image);
+    template <typename Image> void DisplayNTHeaders(const Image& image);
+    template <typename Image> void DisplayOptionalHeader(const Image& image);
+    template <typename Image> void DisplayDataDirectories(const Image& image);
+    void DisplayDOSHeader(const PEImageBase& image);
+    void DisplayFileHeader(const PEImageBase& image);
+    void DisplaySections(const PEImageBase& image);
+    void DisplayImports(const PEImageBase& image);
+    void DisplayExports(const PEImageBase& image);
+    void StartParse(bool refresh);
+    void StopRefresh();
+    void ClearModels();
+    void LinkToHexView(QTableView* view, HeaderTableModel* model);
+    static const PEImageBase& CurrentImage(const ParsedFile& file);
     void SetDarkMode();
     void SetLightMode();
 };
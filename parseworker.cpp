@@ -0,0 +1,331 @@
+#include "parseworker.h"
+#include "debug.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+ParseWorker::ParseWorker(QObject *parent)
+    : QObject(parent)
+{
+    qRegisterMetaType<QSharedPointer<ParsedFile>>();
+}
+
+quint64 ParseWorker::BeginRequest()
+{
+    return ++currentGeneration;
+}
+
+void ParseWorker::Cancel()
+{
+    ++currentGeneration;
+}
+
+void ParseWorker::SetSignatures(QSharedPointer<const SignatureSet> set)
+{
+    signatureSet = set;
+}
+
+void ParseWorker::Parse(const QString& path, quint64 generation)
+{
+    Run(path, generation, nullptr, false);
+}
+
+void ParseWorker::Reparse(const QString& path, quint64 generation, QSharedPointer<const ParsedFile> previous)
+{
+    // Only a version that was hashed can be compared against
+    Run(path, generation, previous && !previous->pages.IsEmpty() ? previous.data() : nullptr, true);
+}
+
+void ParseWorker::Run(const QString& path, quint64 generation, const ParsedFile* previous, bool hashPages)
+{
+    // A newer request was queued behind this one
+    if (IsCancelled(generation))
+        return;
+
+    QSharedPointer<ParsedFile> file(new ParsedFile);
+    file->path = path;
+
+    // Map file; pages are only read in as the parser touches them. Watch mode reads a snapshot instead: a mapping
+    // would keep the file open under the build that is about to rewrite it (and fault if it is truncated on POSIX).
+    if (!file->mapping.Open(path.toStdString(), hashPages ? MappedFile::Snapshot : MappedFile::ReadOnly))
+    {
+        Debug("Error", path + ": " + QString::fromStdString(file->mapping.ErrorString()));
+        emit Failed(generation);
+        return;
+    }
+
+    // Watch mode hashes every page of the snapshot; that is what lets a rebuild skip the work it did not touch
+    if (hashPages)
+    {
+        file->pages.Compute(file->mapping.Data(), file->mapping.Size());
+        if (previous != nullptr)
+        {
+            size_t changed = file->pages.CountChanged(previous->pages);
+            if (changed == 0)
+            {
+                emit Unchanged(generation);
+                return;
+            }
+            Debug("Alert", QString("%1 of %2 pages changed.").arg(changed).arg(file->pages.PageCount()));
+        }
+    }
+
+    // Detect architecture from OptionalHeader.Magic in the mapped image, no need to reopen the file
+    file->magic = DetectImageMagic(file->mapping.Data(), file->mapping.Size());
+    bool sameWidth = previous != nullptr && previous->magic == file->magic;
+
+    bool parsed = false;
+    switch (file->magic)
+    {
+    case IMAGE_NT_OPTIONAL_HDR32_MAGIC:
+        Debug("Alert", "This is a 32-bit executable.");
+        parsed = RunStages(file, file->pe32, previous, sameWidth ? &previous->pe32 : nullptr, generation);
+        break;
+    case IMAGE_NT_OPTIONAL_HDR64_MAGIC:
+        Debug("Alert", "This is a 64-bit executable.");
+        parsed = RunStages(file, file->pe64, previous, sameWidth ? &previous->pe64 : nullptr, generation);
+        break;
+    default:
+        Debug("Error", "Invalid architecture.");
+    }
+
+    if (IsCancelled(generation))
+        return;
+
+    if (parsed)
+        emit Finished(generation);
+    else
+        emit Failed(generation);
+}
+
+// File offset of a structure the parser located in image
+template <typename Image>
+static size_t OffsetOf(const Image& image, const void* structure)
+{
+    return static_cast<const BYTE*>(structure) - static_cast<const BYTE*>(image.GetImageBase());
+}
+
+// Same file size, header offsets, section table and data directories as the previous version, compared through the
+// copies the previous image made while parsing: a rebuild may have rewritten the old mapping's pages in place.
+// The header views rebind at the offsets they already have, so a moved e_lfanew (a Rich header that grew) or a
+// different SizeOfOptionalHeader needs a full parse. image has only been through the header stages.
+template <typename Image>
+static bool SameLayout(const Image& image, const Image& previous)
+{
+    const std::vector<IMAGE_SECTION_HEADER>& sections = previous.GetSections();
+    if (image.GetImageSize() != previous.GetImageSize() ||
+        OffsetOf(image, image.GetNTHeaders()) != OffsetOf(previous, previous.GetNTHeaders()) ||
+        OffsetOf(image, image.GetSectionHeader()) != OffsetOf(previous, previous.GetSectionHeader()) ||
+        image.GetSizeOfHeaders() != previous.GetSizeOfHeaders() ||
+        image.GetFileHeader()->NumberOfSections != sections.size() ||
+        memcmp(image.GetSectionHeader(), sections.data(), sections.size() * sizeof(IMAGE_SECTION_HEADER)) != 0)
+        return false;
+
+    for (int i = 0; i < IMAGE_NUMBEROF_DIRECTORY_ENTRIES; i++)
+    {
+        if (memcmp(&image.GetDataDirectory(i), &previous.GetDataDirectory(i), sizeof(IMAGE_DATA_DIRECTORY)) != 0)
+            return false;
+    }
+    return true;
+}
+
+// Whether the section holding a directory changed. Linkers keep descriptors, thunks and the names they point to in
+// the directory's section, so the whole section stands in for everything the table is read from; a directory
+// outside every section lives in the headers.
+template <typename Image>
+static bool DirectoryChanged(const Image& image, int index, const PageHashes& pages, const PageHashes& older)
+{
+    const IMAGE_DATA_DIRECTORY& directory = image.GetDataDirectory(index);
+    if (directory.VirtualAddress == 0 || directory.Size == 0)
+        return false;
+
+    const IMAGE_SECTION_HEADER* sections = image.GetSectionHeader();
+    for (WORD i = 0; i < image.GetFileHeader()->NumberOfSections; i++)
+    {
+        DWORD extent = std::max<DWORD>(sections[i].Misc.VirtualSize, sections[i].SizeOfRawData);
+        if (directory.VirtualAddress >= sections[i].VirtualAddress && directory.VirtualAddress - sections[i].VirtualAddress < extent)
+        {
+            size_t offset, size;
+            return SectionRawRange(sections[i], image.GetImageSize(), offset, size) && pages.Changed(older, offset, size);
+        }
+    }
+    return pages.Changed(older, 0, image.GetSizeOfHeaders());
+}
+
+// 32-bit and 64-bit images share one pipeline, Image is PE32 or PE64
+template <typename Image>
+bool ParseWorker::RunStages(const QSharedPointer<ParsedFile>& file, Image& image, const ParsedFile* previous, const Image* previousImage, quint64 generation)
+{
+    image = Image(file->mapping.Data(), file->mapping.Size());
+
+    // Wall time of each stage for the status bar; the parser's own trace scopes break it down further
+    auto stageStart = std::chrono::steady_clock::now();
+    auto lap = [&](const char* stage)
+    {
+        auto now = std::chrono::steady_clock::now();
+        file->stageTimings.push_back({ stage, std::chrono::duration<double, std::milli>(now - stageStart).count() });
+        stageStart = now;
+    };
+
+    if (!(image.ParseDOSHeader() &&
+          image.ParseNTHeader() &&
+          image.ParseFileHeader() &&
+          image.ParseOptionalHeader() &&
+          image.ParseSectionHeader() &&
+          image.ParseDataDirectories()))
+    {
+        Debug("Error", QString::fromStdString(image.ErrorString()));
+        return false;
+    }
+
+    // Every stage is decided here, before the views see anything. Strings, signatures and the digest cover the whole
+    // file and some page did change, so they always change; the first two are only scanned again around the changed
+    // pages, the digest still reads everything.
+    std::vector<bool> sectionChanged;
+    std::vector<std::pair<size_t, size_t>> changedRanges;
+    if (previousImage != nullptr && SameLayout(image, *previousImage))
+    {
+        const PageHashes& older = previous->pages;
+        changedRanges = file->pages.ChangedRanges(older);
+        unsigned changed = StageStrings | StageSignatures | StageDigest;
+        if (file->pages.Changed(older, 0, image.GetSizeOfHeaders()))
+            changed |= StageHeaders;
+        if (DirectoryChanged(image, IMAGE_DIRECTORY_ENTRY_IMPORT, file->pages, older) ||
+            DirectoryChanged(image, IMAGE_DIRECTORY_ENTRY_IAT, file->pages, older))
+            changed |= StageImports;
+        if (DirectoryChanged(image, IMAGE_DIRECTORY_ENTRY_EXPORT, file->pages, older))
+            changed |= StageExports;
+        if (DirectoryChanged(image, IMAGE_DIRECTORY_ENTRY_RESOURCE, file->pages, older))
+            changed |= StageResources;
+
+        const IMAGE_SECTION_HEADER* sections = image.GetSectionHeader();
+        sectionChanged.resize(image.GetFileHeader()->NumberOfSections);
+        for (size_t i = 0; i < sectionChanged.size(); i++)
+        {
+            size_t offset, size;
+            sectionChanged[i] = SectionRawRange(sections[i], image.GetImageSize(), offset, size) && file->pages.Changed(older, offset, size);
+            if (sectionChanged[i])
+                changed |= StageEntropy;
+        }
+
+        file->incremental = true;
+        file->changedStages = changed;
+    }
+    lap("Headers");
+    emit HeadersParsed(generation, file);
+
+    if (IsCancelled(generation))
+        return false;
+    if (!image.ParseSections())
+    {
+        Debug("Error", QString::fromStdString(image.ErrorString()));
+        return false;
+    }
+    lap("Sections");
+    emit SectionsParsed(generation, file);
+
+    if (IsCancelled(generation))
+        return false;
+    if (!image.ParseImports())
+    {
+        Debug("Error", QString::fromStdString(image.ErrorString()));
+        return false;
+    }
+    lap("Imports");
+    emit ImportsParsed(generation, file);
+
+    if (IsCancelled(generation))
+        return false;
+    if (!image.ParseExports())
+    {
+        Debug("Error", QString::fromStdString(image.ErrorString()));
+        return false;
+    }
+    lap("Exports");
+    emit ExportsParsed(generation, file);
+
+    // Only the root directory; the GUI reads deeper levels as the user expands them
+    if (IsCancelled(generation))
+        return false;
+    if (!image.ParseResources())
+    {
+        Debug("Error", QString::fromStdString(image.ErrorString()));
+        return false;
+    }
+    lap("Resources");
+    emit ResourcesParsed(generation, file);
+
+    // Reads every raw byte of every section, so it runs late and spreads sections over all cores
+    if (IsCancelled(generation))
+        return false;
+    // Stage names say when only part of the file was read, the status bar shows them as they are
+    if (file->incremental)
+    {
+        file->sectionEntropy = UpdateSectionEntropy(image, previous->sectionEntropy, sectionChanged);
+        lap("Entropy (changed sections)");
+    }
+    else
+    {
+        file->sectionEntropy = ComputeSectionEntropy(image);
+        lap("Entropy");
+    }
+    emit EntropyComputed(generation, file);
+
+    // Whole file, headers and overlay included, in parallel chunks
+    if (IsCancelled(generation))
+        return false;
+    if (file->incremental)
+    {
+        file->strings.Rescan(image, previous->strings, changedRanges);
+        lap("Strings (changed pages)");
+    }
+    else
+    {
+        file->strings.Scan(image);
+        lap("Strings");
+    }
+    emit StringsExtracted(generation, file);
+
+    // One pass over the file for every loaded signature, chunks spread over all cores. Matches of the previous
+    // version only carry over if they came from the same set.
+    if (IsCancelled(generation))
+        return false;
+    if (signatureSet)
+    {
+        file->signatureSet = signatureSet;
+        if (file->incremental && previous->signatureSet == signatureSet)
+        {
+            file->signatureMatches = signatureSet->Rescan(image, previous->signatureMatches, changedRanges);
+            lap("Signatures (changed pages)");
+        }
+        else
+        {
+            file->signatureMatches = signatureSet->Scan(image);
+            lap("Signatures");
+        }
+        emit SignaturesMatched(generation, file);
+    }
+
+    // Reads the whole file, overlay included. Streamed rather than read through the mapping,
+    // so a large installer is not faulted into memory just to be hashed once. A snapshot is in memory already,
+    // and the file it came from may have changed again.
+    if (IsCancelled(generation))
+        return false;
+    if (!file->pages.IsEmpty())
+    {
+        ComputeImageDigest(file->mapping.Data(), GetDigestLayout(image), file->digest);
+    }
+    else
+    {
+        std::string error;
+        if (!ComputeImageDigest(file->path.toStdString(), GetDigestLayout(image), file->digest, error))
+        {
+            Debug("Error", QString::fromStdString(error));
+            return false;
+        }
+    }
+    lap("Digest");
+    emit DigestComputed(generation, file);
+
+    return true;
+}
@@ -0,0 +1,117 @@
+#ifndef PARSEWORKER_H
+#define PARSEWORKER_H
+
+#include <QObject>
+#include <QSharedPointer>
+#include <QString>
+#include <atomic>
+#include <vector>
+#include "Entropy.h"
+#include "ImageDigest.h"
+#include "MappedFile.h"
+#include "PageHashes.h"
+#include "PEImage.h"
+#include "SignatureSet.h"
+#include "StringTable.h"
+
+// Pipeline stages, as bits of ParsedFile::changedStages
+enum ParseStage : unsigned
+{
+    StageHeaders = 1 << 0,
+    StageSections = 1 << 1,
+    StageImports = 1 << 2,
+    StageExports = 1 << 3,
+    StageResources = 1 << 4,
+    StageEntropy = 1 << 5,
+    StageStrings = 1 << 6,
+    StageSignatures = 1 << 7,
+    StageDigest = 1 << 8,
+    StageAll = (1 << 9) - 1
+};
+
+struct StageTiming
+{
+    const char* name;
+    double milliseconds;
+};
+
+// Mapping plus the image parsed out of it. Shared between the worker and the GUI,
+// so the mapping stays alive until neither side refers into it any more. In watch mode the mapping is a
+// MappedFile::Snapshot, so the file itself is never held open.
+struct ParsedFile
+{
+    QString path;
+    MappedFile mapping;
+    WORD magic = 0; // Selects pe32 or pe64
+    PE32 pe32;
+    PE64 pe64;
+    std::vector<SectionEntropy> sectionEntropy; // One entry per section
+    StringTable strings; // Points into the mapping
+    QSharedPointer<const SignatureSet> signatureSet; // The set signatureMatches index into, null if none was loaded
+    std::vector<SignatureMatch> signatureMatches;
+    ImageDigest digest; // Filled by the last stage
+    std::vector<StageTiming> stageTimings; // Appended as each stage finishes, complete once Finished fires
+    PageHashes pages; // Only filled by Reparse, to be compared with the next version of the file
+
+    // Set before the first stage signal. incremental means this is a new version of a file parsed by Reparse whose
+    // section table and data directories did not move: every table has the rows it had, so views can update in place.
+    // Tables are still re-read, they point into the new mapping; strings and signatures are only scanned again
+    // around the changed pages. changedStages has a bit for each stage whose bytes differ from the previous
+    // version, and stages without one are known to show the same values.
+    bool incremental = false;
+    unsigned changedStages = StageAll;
+};
+
+Q_DECLARE_METATYPE(QSharedPointer<ParsedFile>)
+
+// Parses images on its own thread and reports each stage as it completes.
+// Every request carries a generation number; starting a new request or cancelling bumps it,
+// and the worker stops at the next stage boundary once its generation is stale.
+class ParseWorker : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit ParseWorker(QObject *parent = nullptr);
+
+    // Called from the GUI thread. Returns the generation to pass to Parse.
+    quint64 BeginRequest();
+    void Cancel();
+
+    // Runs on the worker thread
+    void Parse(const QString& path, quint64 generation);
+    // Watch mode: Parse that also hashes every page of the file. Given the version of the same file that the last
+    // Reparse produced, sections whose pages are unchanged keep their entropy, and if no page changed at all only
+    // Unchanged is emitted.
+    void Reparse(const QString& path, quint64 generation, QSharedPointer<const ParsedFile> previous);
+    void SetSignatures(QSharedPointer<const SignatureSet> set); // Compiled; applies to later parses
+
+signals:
+    // A stage's data is complete and will not be modified again when its signal fires
+    void HeadersParsed(quint64 generation, QSharedPointer<ParsedFile> file);
+    void SectionsParsed(quint64 generation, QSharedPointer<ParsedFile> file);
+    void ImportsParsed(quint64 generation, QSharedPointer<ParsedFile> file);
+    void ExportsParsed(quint64 generation, QSharedPointer<ParsedFile> file);
+    void ResourcesParsed(quint64 generation, QSharedPointer<ParsedFile> file);
+    void EntropyComputed(quint64 generation, QSharedPointer<ParsedFile> file);
+    void StringsExtracted(quint64 generation, QSharedPointer<ParsedFile> file);
+    void SignaturesMatched(quint64 generation, QSharedPointer<ParsedFile> file);
+    void DigestComputed(quint64 generation, QSharedPointer<ParsedFile> file);
+    void Finished(quint64 generation);
+    void Failed(quint64 generation);
+    void Unchanged(quint64 generation); // Reparse found the same bytes as before, nothing else is emitted
+
+private:
+    std::atomic<quint64> currentGeneration{0};
+    QSharedPointer<const SignatureSet> signatureSet; // Only touched on the worker thread
+
+    bool IsCancelled(quint64 generation) const { return generation != currentGeneration.load(); }
+
+    void Run(const QString& path, quint64 generation, const ParsedFile* previous, bool hashPages);
+
+    // previousImage is the same width's image in previous, or nullptr for a full parse
+    template <typename Image>
+    bool RunStages(const QSharedPointer<ParsedFile>& file, Image& image, const ParsedFile* previous, const Image* previousImage, quint64 generation);
+};
+
+#endif // PARSEWORKER_H
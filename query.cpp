@@ -0,0 +1,407 @@
+// inspector-query: filters a column file written by inspector-cli --columns.
+// Every predicate is one pass over a mapped column that yields a bitmap of matching rows; predicates on sections
+// and imports are folded into the file rows that own them, and all of them are ANDed together.
+
+#include "ColumnQuery.h"
+#include "ColumnStore.h"
+#include "Simd.h"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <vector>
+
+typedef std::vector<uint64_t> RowBits;
+
+static RowBits MakeBits(size_t count)
+{
+    return RowBits((count + 63) / 64 + 1, 0); // One spare word so an empty set still has storage
+}
+
+static void AndInto(RowBits& result, const RowBits& bits)
+{
+    for (size_t w = 0; w < result.size(); w++)
+        result[w] &= bits[w];
+}
+
+static void Invert(RowBits& bits, size_t count)
+{
+    // Rows past the end must stay clear
+    for (size_t w = 0; w < bits.size(); w++)
+    {
+        if (w < count / 64)
+            bits[w] = ~bits[w];
+        else if (w == count / 64 && count % 64 != 0)
+            bits[w] = ~bits[w] & ((uint64_t(1) << (count % 64)) - 1);
+        else
+            bits[w] = 0;
+    }
+}
+
+// FIELD OP VALUE on one header column. The comparison operators become one unsigned range; & (any of the bits set)
+// has no range form and is tested row by row.
+template <typename T>
+static bool SelectCompare(const T* values, size_t count, const std::string& op, uint64_t value, RowBits& bits)
+{
+    const T max = std::numeric_limits<T>::max();
+    const bool over = value > max; // Larger than anything the column can hold
+    const T v = over ? max : T(value);
+    bool invert = false;
+    T lo = 1;
+    T hi = 0; // Empty
+
+    if (op == "==" || op == "!=")
+    {
+        if (!over)
+            lo = hi = v;
+        invert = op == "!=";
+    }
+    else if (op == "<")
+    {
+        if (over || v > 0)
+        {
+            lo = 0;
+            hi = over ? max : T(v - 1);
+        }
+    }
+    else if (op == "<=")
+    {
+        lo = 0;
+        hi = v;
+    }
+    else if (op == ">")
+    {
+        if (!over && v < max)
+        {
+            lo = T(v + 1);
+            hi = max;
+        }
+    }
+    else if (op == ">=")
+    {
+        if (!over)
+        {
+            lo = v;
+            hi = max;
+        }
+    }
+    else if (op == "&")
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            if ((values[i] & value) != 0)
+                bits[i / 64] |= uint64_t(1) << (i % 64);
+        }
+        return true;
+    }
+    else
+    {
+        return false;
+    }
+
+    SelectRange(values, count, lo, hi, bits.data());
+    if (invert)
+        Invert(bits, count);
+    return true;
+}
+
+static bool SelectField(const ColumnStoreReader& store, const std::string& field, const std::string& op, uint64_t value, RowBits& bits)
+{
+    static const char* const u16Fields[] = { "machine", "magic", "characteristics" };
+    static const char* const u32Fields[] = { "timestamp", "entryPoint", "sizeOfImage" };
+    static const char* const u64Fields[] = { "fileSize", "offset", "importHash" };
+
+    size_t count;
+    for (const char* name : u16Fields)
+    {
+        if (field == name)
+        {
+            const uint16_t* values = store.Column<uint16_t>(name, count);
+            return SelectCompare(values, count, op, value, bits);
+        }
+    }
+    for (const char* name : u32Fields)
+    {
+        if (field == name)
+        {
+            const uint32_t* values = store.Column<uint32_t>(name, count);
+            return SelectCompare(values, count, op, value, bits);
+        }
+    }
+    for (const char* name : u64Fields)
+    {
+        if (field == name)
+        {
+            const uint64_t* values = store.Column<uint64_t>(name, count);
+            return SelectCompare(values, count, op, value, bits);
+        }
+    }
+    return false;
+}
+
+static bool EqualsIgnoreCase(std::string_view a, std::string_view b)
+{
+    if (a.size() != b.size())
+        return false;
+    for (size_t i = 0; i < a.size(); i++)
+    {
+        if (tolower(static_cast<unsigned char>(a[i])) != tolower(static_cast<unsigned char>(b[i])))
+            return false;
+    }
+    return true;
+}
+
+// Files importing from a DLL (any case), or a function by name from it when pattern is "DLL!Function"
+static void SelectImports(const ColumnStoreReader& store, const std::string& pattern, RowBits& files)
+{
+    size_t split = pattern.find('!');
+    std::string module = pattern.substr(0, split);
+    std::string function = split == std::string::npos ? std::string() : pattern.substr(split + 1);
+
+    // The dictionary is shared, so each name is looked up once rather than compared per import
+    std::vector<uint32_t> modules;
+    uint32_t functionId = 0;
+    for (size_t id = 1; id < store.DictionarySize(); id++)
+    {
+        std::string_view text = store.DictionaryString(static_cast<uint32_t>(id));
+        if (EqualsIgnoreCase(text, module))
+            modules.push_back(static_cast<uint32_t>(id));
+        if (!function.empty() && text == function)
+            functionId = static_cast<uint32_t>(id);
+    }
+    if (modules.empty() || (!function.empty() && functionId == 0))
+        return;
+
+    size_t count;
+    const uint32_t* owners = store.Column<uint32_t>("import.file", count);
+    const uint32_t* moduleIds = store.Column<uint32_t>("import.module", count);
+    RowBits imports = MakeBits(count);
+    if (!function.empty())
+    {
+        // The function ID is the selective one; the module is then checked on the few rows that match
+        const uint32_t* functionIds = store.Column<uint32_t>("import.function", count);
+        SelectRange(functionIds, count, functionId, functionId, imports.data());
+        for (size_t w = 0; w < imports.size(); w++)
+        {
+            for (uint64_t word = imports[w]; word != 0; word &= word - 1)
+            {
+                unsigned bit = CountTrailingZeros(word);
+                if (std::find(modules.begin(), modules.end(), moduleIds[w * 64 + bit]) == modules.end())
+                    imports[w] &= ~(uint64_t(1) << bit);
+            }
+        }
+    }
+    else
+    {
+        RowBits matches = MakeBits(count);
+        for (uint32_t id : modules)
+        {
+            SelectRange(moduleIds, count, id, id, matches.data());
+            for (size_t w = 0; w < imports.size(); w++)
+                imports[w] |= matches[w];
+        }
+    }
+    MarkParents(owners, imports.data(), count, files.data(), static_cast<size_t>(store.RowCount()));
+}
+
+static void SelectSectionName(const ColumnStoreReader& store, const std::string& name, RowBits& files)
+{
+    uint64_t packed = 0;
+    memcpy(&packed, name.data(), name.size());
+
+    size_t count;
+    const uint32_t* owners = store.Column<uint32_t>("section.file", count);
+    const uint64_t* names = store.Column<uint64_t>("section.name", count);
+    RowBits sections = MakeBits(count);
+    SelectRange(names, count, packed, packed, sections.data());
+    MarkParents(owners, sections.data(), count, files.data(), static_cast<size_t>(store.RowCount()));
+}
+
+static void SelectEntropyAbove(const ColumnStoreReader& store, float threshold, RowBits& files)
+{
+    size_t count;
+    const uint32_t* owners = store.Column<uint32_t>("section.file", count);
+    const float* entropy = store.Column<float>("section.entropy", count);
+    RowBits sections = MakeBits(count);
+    SelectAbove(entropy, count, threshold, sections.data());
+    MarkParents(owners, sections.data(), count, files.data(), static_cast<size_t>(store.RowCount()));
+}
+
+struct FieldFilter
+{
+    std::string field;
+    std::string op;
+    uint64_t value;
+};
+
+static void PrintUsage()
+{
+    fprintf(stderr,
+            "Usage: inspector-query <column file> [--where field op value]... [--imports dll[!function]]... [--section name]...\n"
+            "                       [--entropy-above bits] [--failed] [--count]\n"
+            "  --where F OP V        Header field test; F is machine, magic, characteristics, timestamp, entryPoint,\n"
+            "                        sizeOfImage, fileSize, offset or importHash; OP is == != < <= > >= or & (any bit set);\n"
+            "                        V is decimal or 0x hex\n"
+            "  --imports DLL[!FUNC]  Imports from DLL (any case), or the function FUNC by name from it\n"
+            "  --section NAME        Has a section called NAME\n"
+            "  --entropy-above BITS  Has a section whose entropy is above BITS (needs a file written with --entropy)\n"
+            "  --failed              Match the files that failed to parse instead of the ones that parsed\n"
+            "  --count               Print only the number of matching files\n"
+            "Every test must hold. Matching paths go to stdout, carved images as path@offset.\n");
+}
+
+int main(int argc, char* argv[])
+{
+    std::string path;
+    std::vector<FieldFilter> fields;
+    std::vector<std::string> imports;
+    std::vector<std::string> sections;
+    bool hasEntropy = false;
+    float entropyThreshold = 0.0f;
+    bool failed = false;
+    bool countOnly = false;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--where") == 0 && i + 3 < argc)
+        {
+            fields.push_back({ argv[i + 1], argv[i + 2], strtoull(argv[i + 3], nullptr, 0) });
+            i += 3;
+        }
+        else if (strcmp(argv[i], "--imports") == 0 && i + 1 < argc)
+        {
+            imports.push_back(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--section") == 0 && i + 1 < argc)
+        {
+            sections.push_back(argv[++i]);
+            if (sections.back().size() > 8)
+            {
+                fprintf(stderr, "Section names are at most 8 bytes: %s\n", sections.back().c_str());
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "--entropy-above") == 0 && i + 1 < argc)
+        {
+            hasEntropy = true;
+            entropyThreshold = strtof(argv[++i], nullptr);
+        }
+        else if (strcmp(argv[i], "--failed") == 0)
+        {
+            failed = true;
+        }
+        else if (strcmp(argv[i], "--count") == 0)
+        {
+            countOnly = true;
+        }
+        else if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0)
+        {
+            PrintUsage();
+            return 0;
+        }
+        else if (path.empty() && argv[i][0] != '-')
+        {
+            path = argv[i];
+        }
+        else
+        {
+            PrintUsage();
+            return 1;
+        }
+    }
+
+    if (path.empty())
+    {
+        PrintUsage();
+        return 1;
+    }
+
+    ColumnStoreReader store;
+    if (!store.Open(path))
+    {
+        fprintf(stderr, "%s: %s\n", path.c_str(), store.ErrorString().c_str());
+        return 1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    size_t rows = static_cast<size_t>(store.RowCount());
+    size_t count;
+
+    // Parsed files have error ID 0
+    RowBits result = MakeBits(rows);
+    const uint32_t* errors = store.Column<uint32_t>("error", count);
+    SelectRange(errors, rows, 0u, 0u, result.data());
+    if (failed)
+        Invert(result, rows);
+
+    for (const FieldFilter& filter : fields)
+    {
+        RowBits bits = MakeBits(rows);
+        if (!SelectField(store, filter.field, filter.op, filter.value, bits))
+        {
+            fprintf(stderr, "Unknown field or operator: %s %s\n", filter.field.c_str(), filter.op.c_str());
+            return 1;
+        }
+        AndInto(result, bits);
+    }
+    for (const std::string& pattern : imports)
+    {
+        RowBits bits = MakeBits(rows);
+        SelectImports(store, pattern, bits);
+        AndInto(result, bits);
+    }
+    for (const std::string& name : sections)
+    {
+        RowBits bits = MakeBits(rows);
+        SelectSectionName(store, name, bits);
+        AndInto(result, bits);
+    }
+    if (hasEntropy)
+    {
+        RowBits bits = MakeBits(rows);
+        SelectEntropyAbove(store, entropyThreshold, bits);
+        AndInto(result, bits);
+    }
+
+    size_t matched = CountRows(result.data(), rows);
+    double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    if (countOnly)
+    {
+        printf("%zu\n", matched);
+    }
+    else
+    {
+        const uint64_t* offsets = store.Column<uint64_t>("offset", count);
+        std::string out;
+        for (size_t w = 0; w < result.size(); w++)
+        {
+            for (uint64_t word = result[w]; word != 0; word &= word - 1)
+            {
+                size_t row = w * 64 + CountTrailingZeros(word);
+                out += store.Path(row);
+                if (offsets[row] != 0)
+                {
+                    char offset[24];
+                    snprintf(offset, sizeof(offset), "@0x%llx", static_cast<unsigned long long>(offsets[row]));
+                    out += offset;
+                }
+                out += '\n';
+                if (out.size() >= 65536)
+                {
+                    fwrite(out.data(), 1, out.size(), stdout);
+                    out.clear();
+                }
+            }
+        }
+        fwrite(out.data(), 1, out.size(), stdout);
+    }
+
+    fprintf(stderr, "%zu of %zu files matched in %.3f ms (%s)\n", matched, rows, milliseconds, QueryKernelName());
+    return 0;
+}
@@ -0,0 +1,188 @@
+#include "resourcetreemodel.h"
+
+ResourceTreeModel::ResourceTreeModel(QObject *parent)
+    : QAbstractItemModel(parent)
+{
+
+}
+
+void ResourceTreeModel::SetImage(const PEImageBase* _image)
+{
+    beginResetModel();
+    image = _image;
+    root.children.clear();
+    root.fetched = true;
+    if (image != nullptr)
+        AddChildren(&root, image->GetResources().Root());
+    endResetModel();
+}
+
+void ResourceTreeModel::Rebind(const PEImageBase* _image)
+{
+    if (image == nullptr || _image == nullptr || root.children.size() != _image->GetResources().Root().size())
+    {
+        SetImage(_image);
+        return;
+    }
+
+    // Names point into the mapping; the same bytes sit at the same offsets in the new one
+    RebaseNames(&root, reinterpret_cast<const BYTE*>(image->GetImageBase()), reinterpret_cast<const BYTE*>(_image->GetImageBase()));
+    image = _image;
+}
+
+void ResourceTreeModel::RebaseNames(Node* node, const BYTE* oldBase, const BYTE* newBase)
+{
+    for (std::unique_ptr<Node>& child : node->children)
+    {
+        if (child->entry.name != nullptr)
+            child->entry.name = newBase + (child->entry.name - oldBase);
+        RebaseNames(child.get(), oldBase, newBase);
+    }
+}
+
+void ResourceTreeModel::Clear()
+{
+    SetImage(nullptr);
+}
+
+void ResourceTreeModel::AddChildren(Node* node, const std::vector<ResourceEntry>& entries)
+{
+    node->children.reserve(entries.size());
+    for (const ResourceEntry& entry : entries)
+    {
+        std::unique_ptr<Node> child(new Node());
+        child->entry = entry;
+        child->parent = node;
+        child->row = static_cast<int>(node->children.size());
+        child->fetched = !entry.isDirectory;
+        node->children.push_back(std::move(child));
+    }
+}
+
+ResourceTreeModel::Node* ResourceTreeModel::NodeFor(const QModelIndex &index) const
+{
+    if (!index.isValid())
+        return const_cast<Node*>(&root);
+    return static_cast<Node*>(index.internalPointer());
+}
+
+QModelIndex ResourceTreeModel::index(int row, int column, const QModelIndex &parent) const
+{
+    Node* node = NodeFor(parent);
+    if (row < 0 || column < 0 || column >= ColumnCount || row >= static_cast<int>(node->children.size()))
+        return QModelIndex();
+    return createIndex(row, column, node->children[row].get());
+}
+
+QModelIndex ResourceTreeModel::parent(const QModelIndex &index) const
+{
+    if (!index.isValid())
+        return QModelIndex();
+    Node* parentNode = NodeFor(index)->parent;
+    if (parentNode == &root)
+        return QModelIndex();
+    return createIndex(parentNode->row, 0, parentNode);
+}
+
+int ResourceTreeModel::rowCount(const QModelIndex &parent) const
+{
+    if (parent.column() > 0)
+        return 0;
+    return static_cast<int>(NodeFor(parent)->children.size());
+}
+
+int ResourceTreeModel::columnCount(const QModelIndex &parent) const
+{
+    Q_UNUSED(parent);
+    return ColumnCount;
+}
+
+// Directories report children before they are read, so the view draws an expander without decoding anything
+bool ResourceTreeModel::hasChildren(const QModelIndex &parent) const
+{
+    Node* node = NodeFor(parent);
+    if (!node->fetched)
+        return true;
+    return !node->children.empty();
+}
+
+bool ResourceTreeModel::canFetchMore(const QModelIndex &parent) const
+{
+    return image != nullptr && !NodeFor(parent)->fetched;
+}
+
+void ResourceTreeModel::fetchMore(const QModelIndex &parent)
+{
+    Node* node = NodeFor(parent);
+    if (image == nullptr || node->fetched)
+        return;
+
+    node->fetched = true;
+    std::vector<ResourceEntry> entries;
+    if (!image->GetResources().ReadDirectory(*image, node->entry, entries))
+    {
+        // Nested too deeply or outside the file; the row stays, marked, with nothing under it
+        node->malformed = true;
+        emit dataChanged(parent.sibling(parent.row(), 0), parent.sibling(parent.row(), ColumnCount - 1));
+        return;
+    }
+    if (entries.empty())
+        return;
+
+    beginInsertRows(parent, 0, static_cast<int>(entries.size()) - 1);
+    AddChildren(node, entries);
+    endInsertRows();
+}
+
+bool ResourceTreeModel::LeafData(const QModelIndex &index, ResourceData& data) const
+{
+    if (!index.isValid() || image == nullptr)
+        return false;
+    return image->GetResources().ReadData(*image, NodeFor(index)->entry, data);
+}
+
+QVariant ResourceTreeModel::data(const QModelIndex &index, int role) const
+{
+    if (role != Qt::DisplayRole || !index.isValid() || image == nullptr)
+        return QVariant();
+
+    const Node* node = NodeFor(index);
+    if (index.column() == NameColumn)
+    {
+        QString name = QString::fromStdString(ResourceEntryName(node->entry));
+        return node->malformed ? name + " (malformed)" : name;
+    }
+    if (node->entry.isDirectory)
+        return QVariant();
+
+    // Data entries are resolved per painted cell, only visible leaves are ever touched
+    ResourceData leaf;
+    if (!image->GetResources().ReadData(*image, node->entry, leaf))
+        return index.column() == SizeColumn ? QString("(outside file)") : QVariant();
+
+    switch (index.column())
+    {
+    case SizeColumn:
+        return QString::number(leaf.size);
+    case CodePageColumn:
+        return QString::number(leaf.codePage);
+    case AddressColumn:
+        return QString("0x%1").arg(leaf.rva, 0, 16);
+    }
+    return QVariant();
+}
+
+QVariant ResourceTreeModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (role != Qt::DisplayRole || orientation != Qt::Horizontal)
+        return QAbstractItemModel::headerData(section, orientation, role);
+
+    switch (section)
+    {
+    case NameColumn:     return QString("Name");
+    case SizeColumn:     return QString("Size");
+    case CodePageColumn: return QString("Code Page");
+    case AddressColumn:  return QString("RVA");
+    }
+    return QVariant();
+}
@@ -0,0 +1,66 @@
+#ifndef RESOURCETREEMODEL_H
+#define RESOURCETREEMODEL_H
+
+#include <QAbstractItemModel>
+#include <memory>
+#include <vector>
+#include "PEImage.h"
+
+// Resource tree that only decodes what the view shows. Top-level types come from the root the parser
+// already read; a directory's children are read through canFetchMore/fetchMore when it is first expanded.
+class ResourceTreeModel : public QAbstractItemModel
+{
+    Q_OBJECT
+
+public:
+    enum Column
+    {
+        NameColumn,
+        SizeColumn,
+        CodePageColumn,
+        AddressColumn,
+        ColumnCount
+    };
+
+    explicit ResourceTreeModel(QObject *parent = nullptr);
+
+    // The image must outlive the model's use of it
+    void SetImage(const PEImageBase* image);
+    // A newer image of the same file whose resource section has the same bytes: expanded directories stay expanded.
+    // Falls back to SetImage if the root level differs.
+    void Rebind(const PEImageBase* image);
+    void Clear();
+
+    // Payload of a leaf row; false for directories and entries outside the file
+    bool LeafData(const QModelIndex &index, ResourceData& data) const;
+
+    QModelIndex index(int row, int column, const QModelIndex &parent = QModelIndex()) const override;
+    QModelIndex parent(const QModelIndex &index) const override;
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    bool hasChildren(const QModelIndex &parent = QModelIndex()) const override;
+    bool canFetchMore(const QModelIndex &parent) const override;
+    void fetchMore(const QModelIndex &parent) override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+
+private:
+    struct Node
+    {
+        ResourceEntry entry;
+        Node* parent;
+        int row;
+        bool fetched;   // Children have been read (or the read failed)
+        bool malformed; // The subdirectory could not be read
+        std::vector<std::unique_ptr<Node>> children;
+    };
+
+    Node* NodeFor(const QModelIndex &index) const;
+    void AddChildren(Node* node, const std::vector<ResourceEntry>& entries);
+    static void RebaseNames(Node* node, const BYTE* oldBase, const BYTE* newBase);
+
+    const PEImageBase* image = nullptr;
+    Node root = {};
+};
+
+#endif // RESOURCETREEMODEL_H
@@ -0,0 +1,107 @@
+#include "sectiontablemodel.h"
+
+SectionTableModel::SectionTableModel(QObject *parent)
+    : QAbstractTableModel(parent)
+{
+
+}
+
+void SectionTableModel::SetSections(const std::vector<IMAGE_SECTION_HEADER>* _sections)
+{
+    beginResetModel();
+    sections = _sections;
+    entropy = nullptr;
+    endResetModel();
+}
+
+void SectionTableModel::Rebind(const std::vector<IMAGE_SECTION_HEADER>* _sections)
+{
+    if (sections == nullptr || _sections == nullptr || sections->size() != _sections->size())
+    {
+        SetSections(_sections);
+        return;
+    }
+    sections = _sections;
+}
+
+void SectionTableModel::SetEntropy(const std::vector<SectionEntropy>* _entropy)
+{
+    entropy = _entropy;
+
+    // Only the entropy columns change, keep the selection and scroll position
+    int rows = rowCount();
+    if (rows > 0)
+        emit dataChanged(index(0, EntropyColumn), index(rows - 1, EntropyProfileColumn));
+}
+
+void SectionTableModel::Clear()
+{
+    SetSections(nullptr);
+}
+
+const SectionEntropy* SectionTableModel::EntropyAt(int row) const
+{
+    if (entropy == nullptr || row < 0 || static_cast<size_t>(row) >= entropy->size())
+        return nullptr;
+    return &(*entropy)[row];
+}
+
+int SectionTableModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() || sections == nullptr ? 0 : static_cast<int>(sections->size());
+}
+
+int SectionTableModel::columnCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : ColumnCount;
+}
+
+QVariant SectionTableModel::data(const QModelIndex &index, int role) const
+{
+    if (role != Qt::DisplayRole || !index.isValid() || sections == nullptr)
+        return QVariant();
+
+    const IMAGE_SECTION_HEADER& section = (*sections)[index.row()];
+    switch (index.column())
+    {
+    case NameColumn:
+        // Names are 8 bytes and only NUL-terminated when shorter than that
+        return QString::fromLatin1(reinterpret_cast<const char*>(section.Name),
+                                   static_cast<int>(qstrnlen(reinterpret_cast<const char*>(section.Name), IMAGE_SIZEOF_SHORT_NAME)));
+    case VirtualSizeColumn:
+        return QString("0x%1").arg(section.Misc.VirtualSize, 0, 16);
+    case VirtualAddressColumn:
+        return QString("0x%1").arg(section.VirtualAddress, 0, 16);
+    case RawSizeColumn:
+        return QString("0x%1").arg(section.SizeOfRawData, 0, 16);
+    case RawOffsetColumn:
+        return QString("0x%1").arg(section.PointerToRawData, 0, 16);
+    case CharacteristicsColumn:
+        return QString("0x%1").arg(section.Characteristics, 0, 16);
+    case EntropyColumn:
+    {
+        const SectionEntropy* sectionEntropy = EntropyAt(index.row());
+        return sectionEntropy != nullptr ? QString::number(sectionEntropy->entropy, 'f', 3) : QVariant();
+    }
+    }
+    return QVariant();
+}
+
+QVariant SectionTableModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (role != Qt::DisplayRole || orientation != Qt::Horizontal)
+        return QAbstractTableModel::headerData(section, orientation, role);
+
+    switch (section)
+    {
+    case NameColumn:            return QString("Name");
+    case VirtualSizeColumn:     return QString("Virtual Size");
+    case VirtualAddressColumn:  return QString("Virtual Address");
+    case RawSizeColumn:         return QString("Raw Size");
+    case RawOffsetColumn:       return QString("Raw Offset");
+    case CharacteristicsColumn: return QString("Characteristics");
+    case EntropyColumn:         return QString("Entropy");
+    case EntropyProfileColumn:  return QString("Entropy Profile");
+    }
+    return QVariant();
+}
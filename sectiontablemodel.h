@@ -0,0 +1,52 @@
+#ifndef SECTIONTABLEMODEL_H
+#define SECTIONTABLEMODEL_H
+
+#include <QAbstractTableModel>
+#include <vector>
+#include "PETypes.h"
+#include "Entropy.h"
+
+// Section table view over the parsed image's section headers
+class SectionTableModel : public QAbstractTableModel
+{
+    Q_OBJECT
+
+public:
+    enum Column
+    {
+        NameColumn,
+        VirtualSizeColumn,
+        VirtualAddressColumn,
+        RawSizeColumn,
+        RawOffsetColumn,
+        CharacteristicsColumn,
+        EntropyColumn,
+        EntropyProfileColumn, // Painted by SparklineDelegate
+        ColumnCount
+    };
+
+    explicit SectionTableModel(QObject *parent = nullptr);
+
+    // The vector is owned by the image and must outlive the model's use of it
+    void SetSections(const std::vector<IMAGE_SECTION_HEADER>* sections);
+    // An identical section table owned by a newer image. The entropy pointer is kept until SetEntropy replaces it,
+    // so its owner must stay alive until then. Falls back to SetSections if the row count differs.
+    void Rebind(const std::vector<IMAGE_SECTION_HEADER>* sections);
+    // Entropy arrives after the section table, one entry per section; owned by the caller like the sections
+    void SetEntropy(const std::vector<SectionEntropy>* entropy);
+    void Clear();
+
+    // Entropy of a row, or nullptr until it has been computed
+    const SectionEntropy* EntropyAt(int row) const;
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+
+private:
+    const std::vector<IMAGE_SECTION_HEADER>* sections = nullptr;
+    const std::vector<SectionEntropy>* entropy = nullptr;
+};
+
+#endif // SECTIONTABLEMODEL_H
@@ -0,0 +1,78 @@
+#include "sparklinedelegate.h"
+#include "sectiontablemodel.h"
+#include <QApplication>
+#include <QPainter>
+#include <QPolygonF>
+
+// Entropy above this is typical of compressed or encrypted data
+static const double kPackedEntropy = 7.2;
+static const double kMaxEntropy = 8.0;
+
+SparklineDelegate::SparklineDelegate(QObject *parent)
+    : QStyledItemDelegate(parent)
+{
+
+}
+
+void SparklineDelegate::paint(QPainter *painter, const QStyleOptionViewItem &option, const QModelIndex &index) const
+{
+    // Background and selection as for any other cell
+    QStyleOptionViewItem background = option;
+    initStyleOption(&background, index);
+    background.text.clear();
+    QStyle *style = option.widget != nullptr ? option.widget->style() : QApplication::style();
+    style->drawControl(QStyle::CE_ItemViewItem, &background, painter, option.widget);
+
+    const SectionTableModel *model = qobject_cast<const SectionTableModel *>(index.model());
+    const SectionEntropy *entropy = model != nullptr ? model->EntropyAt(index.row()) : nullptr;
+    if (entropy == nullptr || entropy->windows.empty())
+        return;
+
+    QRectF area = QRectF(option.rect).adjusted(3, 3, -3, -3);
+    if (area.width() <= 1 || area.height() <= 1)
+        return;
+
+    const std::vector<float>& windows = entropy->windows;
+    auto yFor = [&](double value) { return area.bottom() - area.height() * value / kMaxEntropy; };
+
+    // More windows than pixels: plot the maximum per pixel column so packed regions never vanish
+    int points = static_cast<int>(qMin<size_t>(windows.size(), static_cast<size_t>(area.width())));
+    QPolygonF line;
+    line.reserve(points);
+    bool packed = false;
+    for (int i = 0; i < points; i++)
+    {
+        size_t first = windows.size() * i / points;
+        size_t last = qMax(first + 1, windows.size() * (i + 1) / points);
+        float value = 0.0f;
+        for (size_t w = first; w < last; w++)
+            value = qMax(value, windows[w]);
+        packed = packed || value >= kPackedEntropy;
+
+        double x = points > 1 ? area.left() + area.width() * i / (points - 1) : area.center().x();
+        line.append(QPointF(x, yFor(value)));
+    }
+
+    painter->save();
+    painter->setRenderHint(QPainter::Antialiasing);
+
+    QPen thresholdPen(option.palette.color(QPalette::Mid), 1, Qt::DotLine);
+    painter->setPen(thresholdPen);
+    painter->drawLine(QPointF(area.left(), yFor(kPackedEntropy)), QPointF(area.right(), yFor(kPackedEntropy)));
+
+    QColor lineColor = packed ? QColor(220, 60, 60)
+                              : option.palette.color((option.state & QStyle::State_Selected) ? QPalette::HighlightedText : QPalette::Text);
+    painter->setPen(QPen(lineColor, 1.5));
+    if (line.size() == 1)
+        painter->drawPoint(line.first());
+    else
+        painter->drawPolyline(line);
+
+    painter->restore();
+}
+
+QSize SparklineDelegate::sizeHint(const QStyleOptionViewItem &option, const QModelIndex &index) const
+{
+    QSize size = QStyledItemDelegate::sizeHint(option, index);
+    return QSize(qMax(size.width(), 160), size.height());
+}
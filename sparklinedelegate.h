@@ -0,0 +1,19 @@
+#ifndef SPARKLINEDELEGATE_H
+#define SPARKLINEDELEGATE_H
+
+#include <QStyledItemDelegate>
+
+// Paints a section's per-window entropy as a small line chart in the section view.
+// Reads the series straight from SectionTableModel::EntropyAt, windows above the packed threshold are highlighted.
+class SparklineDelegate : public QStyledItemDelegate
+{
+    Q_OBJECT
+
+public:
+    explicit SparklineDelegate(QObject *parent = nullptr);
+
+    void paint(QPainter *painter, const QStyleOptionViewItem &option, const QModelIndex &index) const override;
+    QSize sizeHint(const QStyleOptionViewItem &option, const QModelIndex &index) const override;
+};
+
+#endif // SPARKLINEDELEGATE_H
@@ -0,0 +1,122 @@
+#include "stringtablemodel.h"
+#include <cstring>
+
+StringTableModel::StringTableModel(QObject *parent)
+    : QAbstractTableModel(parent)
+{
+
+}
+
+void StringTableModel::SetTable(const PEImageBase* _image, const StringTable* _table)
+{
+    beginResetModel();
+    image = _image;
+    table = _table;
+    filtered = false;
+    rows.clear();
+    endResetModel();
+
+    // Keep whatever the user already typed
+    QString text = filter;
+    filter.clear();
+    SetFilter(text);
+}
+
+void StringTableModel::Clear()
+{
+    SetTable(nullptr, nullptr);
+}
+
+void StringTableModel::SetFilter(const QString &text)
+{
+    if (table == nullptr)
+    {
+        filter = text;
+        return;
+    }
+
+    beginResetModel();
+    if (text.isEmpty())
+    {
+        filtered = false;
+        rows.clear();
+    }
+    else
+    {
+        // Anything that contains the longer text also contains the shorter one, so typing only ever narrows
+        std::vector<uint32_t> matches;
+        bool narrowing = filtered && text.contains(filter, Qt::CaseInsensitive);
+        table->Filter(text.toStdString(), narrowing ? &rows : nullptr, matches);
+        rows.swap(matches);
+        filtered = true;
+    }
+    filter = text;
+    endResetModel();
+}
+
+const StringHit* StringTableModel::HitAt(const QModelIndex &index) const
+{
+    if (!index.isValid() || table == nullptr || index.row() >= rowCount())
+        return nullptr;
+    return &(*table)[TableIndex(index.row())];
+}
+
+int StringTableModel::rowCount(const QModelIndex &parent) const
+{
+    if (parent.isValid() || table == nullptr)
+        return 0;
+    return static_cast<int>(filtered ? rows.size() : table->Count());
+}
+
+int StringTableModel::columnCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : ColumnCount;
+}
+
+QVariant StringTableModel::data(const QModelIndex &index, int role) const
+{
+    if (role != Qt::DisplayRole || !index.isValid() || table == nullptr)
+        return QVariant();
+
+    size_t tableIndex = TableIndex(index.row());
+    const StringHit& hit = (*table)[tableIndex];
+    switch (index.column())
+    {
+    case OffsetColumn:
+        return QString("0x%1").arg(hit.offset, 0, 16);
+    case AddressColumn:
+        return hit.section == StringTable::kNoSection ? QString() : QString("0x%1").arg(hit.rva, 0, 16);
+    case SectionColumn:
+    {
+        if (hit.section == StringTable::kNoSection)
+            return QString();
+        // Section names are 8 bytes and not NUL-terminated when all 8 are used
+        const BYTE* name = image->GetSections()[hit.section].Name;
+        return QString::fromLatin1(reinterpret_cast<const char*>(name), static_cast<int>(strnlen(reinterpret_cast<const char*>(name), IMAGE_SIZEOF_SHORT_NAME)));
+    }
+    case EncodingColumn:
+        return hit.encoding == StringUtf16 ? QString("UTF-16") : QString("ASCII");
+    case LengthColumn:
+        return QString::number(hit.length);
+    case TextColumn:
+        return QString::fromStdString(table->Text(tableIndex));
+    }
+    return QVariant();
+}
+
+QVariant StringTableModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (role != Qt::DisplayRole || orientation != Qt::Horizontal)
+        return QAbstractTableModel::headerData(section, orientation, role);
+
+    switch (section)
+    {
+    case OffsetColumn:   return QString("Offset");
+    case AddressColumn:  return QString("RVA");
+    case SectionColumn:  return QString("Section");
+    case EncodingColumn: return QString("Type");
+    case LengthColumn:   return QString("Length");
+    case TextColumn:     return QString("String");
+    }
+    return QVariant();
+}
@@ -0,0 +1,54 @@
+#ifndef STRINGTABLEMODEL_H
+#define STRINGTABLEMODEL_H
+
+#include <QAbstractTableModel>
+#include <vector>
+#include "PEImage.h"
+#include "StringTable.h"
+
+// Extracted strings, read from the StringTable index as rows are painted. A filter keeps only the row indices
+// that match; when the new filter text contains the old one, only the previous matches are searched again.
+class StringTableModel : public QAbstractTableModel
+{
+    Q_OBJECT
+
+public:
+    enum Column
+    {
+        OffsetColumn,
+        AddressColumn,
+        SectionColumn,
+        EncodingColumn,
+        LengthColumn,
+        TextColumn,
+        ColumnCount
+    };
+
+    explicit StringTableModel(QObject *parent = nullptr);
+
+    // The image and the table must outlive the model's use of them
+    void SetTable(const PEImageBase* image, const StringTable* table);
+    void Clear();
+
+    // Case-insensitive substring filter; an empty text shows every string
+    void SetFilter(const QString &text);
+
+    // The string shown in a row, or nullptr
+    const StringHit* HitAt(const QModelIndex &index) const;
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+
+private:
+    size_t TableIndex(int row) const { return filtered ? rows[row] : static_cast<size_t>(row); }
+
+    const PEImageBase* image = nullptr;
+    const StringTable* table = nullptr;
+    QString filter;
+    bool filtered = false;
+    std::vector<uint32_t> rows; // Matching table indices while filtered
+};
+
+#endif // STRINGTABLEMODEL_H